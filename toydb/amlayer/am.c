@@ -25,7 +25,7 @@ char *key; /* returns the key to be filled in the parent */
 
 	AM_LEAFHEADER head,temphead; /* local header */
 	AM_LEAFHEADER *header,*tempheader;
-	char tempPage[PF_PAGE_SIZE]; /* temporary page for manipulation on the 
+	char tempPage[AM_MAX_PAGE_SIZE]; /* temporary page for manipulation on the 
 								         page */
 	char *tempPageBuf,*tempPageBuf1;/* buffers for new pages to be
 								    allocated */
@@ -69,7 +69,7 @@ char *key; /* returns the key to be filled in the parent */
 	bcopy(tempPage,tempheader,AM_sl);
 	tempheader->nextLeafPage = tempPageNum;
 	bcopy(tempheader,tempPage,AM_sl);
-	bcopy(tempPage,pageBuf,PF_PAGE_SIZE);
+	bcopy(tempPage,pageBuf,AM_PageSize);
 
 	/* copy the value of key to be written onto the parent */
 
@@ -89,7 +89,7 @@ char *key; /* returns the key to be filled in the parent */
 							   leftmost page hence*/
 
 		/* copy the old first half(actually the root) into a new page */ 
-		bcopy(pageBuf,tempPageBuf1,PF_PAGE_SIZE);
+		bcopy(pageBuf,tempPageBuf1,AM_PageSize);
 		/* Initialise the new root page */ 
 
 		AM_FillRootPage(pageBuf,tempPageNum1,tempPageNum,key,
@@ -123,7 +123,7 @@ char *value; /*  pointer to attribute value to be added -
 int attrLength;
 
 {
-	char tempPage[PF_PAGE_SIZE];/* temporary page for manipulating page */
+	char tempPage[AM_MAX_PAGE_SIZE];/* temporary page for manipulating page */
 	int pageNumber; /* pageNumber of parent to which key is to be added- 
 			                                        got from stack*/
 	int offset; /* Place in parent where key is to be added - 
@@ -180,7 +180,7 @@ int attrLength;
 			AM_Check;
 
 			/* copy the first half into another buffer */
-			bcopy(tempPage,pageBuf2,PF_PAGE_SIZE);
+			bcopy(tempPage,pageBuf2,AM_PageSize);
 
 			/* fill the header of new root page and the 
 			attribute value */
@@ -200,7 +200,7 @@ int attrLength;
 		}
 		else
 		{
-			bcopy(tempPage,pageBuf,PF_PAGE_SIZE);
+			bcopy(tempPage,pageBuf,AM_PageSize);
 
 			errVal = PF_UnfixPage(fileDesc,pageNumber,TRUE);
 			AM_Check;
@@ -289,7 +289,7 @@ int pageNum,offset;
 {
 	AM_INTHEADER temphead,*tempheader;
 	int recSize;
-	char tempPage[PF_PAGE_SIZE + AM_MAXATTRLENGTH];/* temp page for 
+	char tempPage[AM_MAX_PAGE_SIZE + AM_MAXATTRLENGTH];/* temp page for 
 	                                               manipulating pageBuf */
 	int length1,length2;
 
@@ -27,6 +27,8 @@ typedef struct am_intheader
 
 /* index-management API */
 int  AM_CreateIndex(char *fileName, int indexNo, char attrType, int attrLength);
+int  AM_CreateIndexSized(char *fileName, int indexNo, char attrType,
+                         int attrLength, int pageSize);
 int  AM_DestroyIndex(char *fileName, int indexNo);
 int  AM_InsertEntry(int fileDesc, char attrType, int attrLength,
                     char *value, int recId);
@@ -109,6 +111,7 @@ int  AM_Compare(char *keyPtr, char attrType, int attrLength, char *value);
 
 extern int AM_RootPageNum; /* The page number of the root */
 extern int AM_LeftPageNum; /* The page Number of the leftmost leaf */
+extern int AM_PageSize; /* The page size of the index being worked on */
 extern int AM_Errno; /* last error in AM layer */
 #include <stdlib.h>
 // extern char *calloc();
@@ -141,6 +144,8 @@ extern int AM_Errno; /* last error in AM layer */
 # define NOT_EQUAL 6
 # define MAXSCANS 20
 # define AM_MAXATTRLENGTH 256
+# define AM_MAX_PAGE_SIZE 16384 /* leaf offsets are shorts, so pages
+				   larger than this are not supported */
 
 
 # define AME_OK 0
@@ -155,3 +160,4 @@ extern int AM_Errno; /* last error in AM layer */
 # define AME_INVALIDATTRTYPE -9
 # define AME_FD -10
 # define AME_INVALIDVALUE -11
+# define AME_INVALIDPAGESIZE -12
@@ -11,6 +11,22 @@ int indexNo;/*number of this index for file */
 char attrType;/* 'c' for char ,'i' for int ,'f' for float */
 int attrLength; /* 4 for 'i' or 'f', 1-255 for 'c' */
 
+{
+	return(AM_CreateIndexSized(fileName,indexNo,attrType,attrLength,
+				   PF_PAGE_SIZE));
+}
+
+
+/* Creates a secondary idex file called fileName.indexNo with pages of
+pageSize bytes. Larger pages hold more keys per node and so give a
+shallower tree */
+int AM_CreateIndexSized(fileName,indexNo,attrType,attrLength,pageSize)
+char *fileName;/* Name of indexed file */
+int indexNo;/*number of this index for file */
+char attrType;/* 'c' for char ,'i' for int ,'f' for float */
+int attrLength; /* 4 for 'i' or 'f', 1-255 for 'c' */
+int pageSize; /* PF_MIN_PAGE_SIZE to AM_MAX_PAGE_SIZE */
+
 
 {
 	char *pageBuf; /* buffer for holding a page */
@@ -42,11 +58,17 @@ int attrLength; /* 4 for 'i' or 'f', 1-255 for 'c' */
 			 return(AME_INVALIDATTRLENGTH);
                         }
 	
+	if (pageSize > AM_MAX_PAGE_SIZE)
+		{
+		 AM_Errno = AME_INVALIDPAGESIZE;
+		 return(AME_INVALIDPAGESIZE);
+		}
+
 	header = &head;
 	
 	/* Get the filename with extension and create a paged file by that name*/
 	sprintf(indexfName,"%s.%d",fileName,indexNo);
-	errVal = PF_CreateFile(indexfName);
+	errVal = PF_CreateFileSized(indexfName,pageSize);
 	AM_Check;
 
 	/* open the new file */
@@ -64,14 +86,14 @@ int attrLength; /* 4 for 'i' or 'f', 1-255 for 'c' */
 	/* initialise the header */
 	header->pageType = 'l';
 	header->nextLeafPage = AM_NULL_PAGE;
-	header->recIdPtr = PF_PAGE_SIZE;
+	header->recIdPtr = pageSize;
 	header->keyPtr = AM_sl;
 	header->freeListPtr = AM_NULL;
 	header->numinfreeList = 0;
 	header->attrLength = attrLength;
 	header->numKeys = 0;
 	/* the maximum keys in an internal node- has to be even always*/
-	maxKeys = (PF_PAGE_SIZE - AM_sint - AM_si)/(AM_si + attrLength);
+	maxKeys = (pageSize - AM_sint - AM_si)/(AM_si + attrLength);
 	if (( maxKeys % 2) != 0) 
 		header->maxKeys = maxKeys - 1;
 	else 
@@ -361,7 +383,8 @@ static char *AMerrormsg[] = {
 "Scan Table is full",
 "Invalid Attribute Type",
 "Invalid file Descriptor",
-"Invalid value to Delete or Insert Entry"
+"Invalid value to Delete or Insert Entry",
+"Invalid page size"
 };
 
 
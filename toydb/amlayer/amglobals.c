@@ -1,6 +1,8 @@
 # include "am.h"
+# include "pf.h"
 
 int AM_RootPageNum = 0;
 int AM_LeftPageNum = 0;
+int AM_PageSize = PF_PAGE_SIZE;
 int AM_Errno;
 
@@ -9,7 +9,7 @@ int AM_InsertintoLeaf(char *pageBuf, int attrLength, char *value,
 
 {
 	int recSize;
-	char tempPage[PF_PAGE_SIZE];
+	char tempPage[AM_MAX_PAGE_SIZE];
 	AM_LEAFHEADER head,*header;
 	int errVal;
 
@@ -64,7 +64,7 @@ int AM_InsertintoLeaf(char *pageBuf, int attrLength, char *value,
 		/* Compact the freelist so that we get enough space in the middle                   so that the new key can be inserted */
 		AM_Compact(1,header->numKeys,pageBuf,tempPage,header);
 		
-		bcopy(tempPage,pageBuf,PF_PAGE_SIZE);
+		bcopy(tempPage,pageBuf,AM_PageSize);
 		bcopy(pageBuf,header,AM_sl);
 		/* Insert into leaf a new key - no need to split */
 		AM_InsertToLeafNotFound(pageBuf,value,recId,index,header);
@@ -162,7 +162,7 @@ void AM_Compact(int low, int high, char *pageBuf, char *tempPage,
 	bcopy(header,tempheader,AM_sl);
 	
 	recSize = header->attrLength + AM_ss;
-	recIdPtr = PF_PAGE_SIZE - AM_si - AM_ss ;
+	recIdPtr = AM_PageSize - AM_si - AM_ss ;
 
 	for (i = low, j = 1; i <= high; i++,j++)
 	{
@@ -27,6 +27,9 @@ int *indexPtr; /* pointer to index in leaf where key is present or
 	lheader = &lhead;
 	iheader = &ihead;
 
+	/* node sizes for the rest of this operation */
+	AM_PageSize = PF_GetPageSize(fileDesc);
+
         /* get the root of the B+ tree */
 
 	errVal = PF_GetFirstPage(fileDesc,pageNum,pageBuf);
@@ -56,16 +59,16 @@ int *indexPtr; /* pointer to index in leaf where key is present or
 		needed later */
 		AM_PushStack(*pageNum,*indexPtr);
 
-		errVal = PF_UnfixPage(fileDesc,*pageNum,FALSE);
+		/* unfix this page and get the next page to be followed,
+		through this page's swizzled reference to it if it is in
+		the buffer */
+		errVal = PF_GetChildPage(fileDesc,*pageNum,*indexPtr,nextPage,
+					pageBuf);
 		AM_Check;
 
 		/* set pageNum to the next page to be followed */
 		*pageNum = nextPage;
 
-		/* Get the next page to be followed */
-		errVal = PF_GetThisPage(fileDesc,*pageNum,pageBuf);
-		AM_Check;
-
 		if (**pageBuf == 'l' ) 
 		{
 			/* if next page is a leaf */
@@ -4,6 +4,7 @@
 #include <sys/time.h>
 
 #include "../pflayer/pf.h"   /* PF_Init, PF_OpenFile, PF_CloseFile, PF_PrintError */
+#include "../pflayer/schema.h" /* HF_LoadSchema, HF_EncodeTuple, field access */
 #include "am.h"              /* AM_CreateIndex, AM_DestroyIndex, AM_InsertEntry, scans, etc. */
 
 #define MAX_LINE_LEN  2048
@@ -24,20 +25,22 @@ static int cmpRecKey(const void *a, const void *b) {
     return 0;
 }
 
-/* Parse roll-no from the *second* field (semicolon-separated) of a line */
-static int parse_rollno(const char *line) {
-    char buf[MAX_LINE_LEN];
-    strncpy(buf, line, MAX_LINE_LEN - 1);
-    buf[MAX_LINE_LEN - 1] = '\0';
+/* Get roll-no, column "col" of the student schema, from a line: the
+   line is encoded as a tuple and the column read at its offset */
+static int parse_rollno(HF_Schema *schema, int col, const char *line, int len) {
+    char tuple[schema->maxLen];
+    const char *value;
+    int vlen, roll = 0;
 
-    char *token = strtok(buf, ";");   /* field 1 */
-    token = strtok(NULL, ";");        /* field 2 = roll-no */
-
-    if (!token) {
+    if (HF_EncodeTuple(schema, line, len, tuple) < 0 ||
+            HF_TupleIsNull(schema, tuple, col)) {
         fprintf(stderr, "parse_rollno: malformed line: %s\n", line);
         return -1;
     }
-    return atoi(token);
+    value = HF_TupleChar(schema, tuple, col, &vlen);
+    for (int i = 0; i < vlen && value[i] >= '0' && value[i] <= '9'; i++)
+        roll = roll * 10 + (value[i] - '0');
+    return roll;
 }
 
 /* Small helper to compute milliseconds from timeval */
@@ -50,9 +53,13 @@ static double elapsed_ms(struct timeval t1, struct timeval t2) {
 int main(int argc, char *argv[]) {
     if (argc < 3) {
         fprintf(stderr,
-            "Usage: %s <student_txt_path> <mode>\n"
+            "Usage: %s <student_txt_path> <mode> [pageSize] [lookups]\n"
             "  mode = 1  -> build index inserting in FILE ORDER (unsorted)\n"
             "  mode = 2  -> build index inserting in SORTED ORDER (bulk-load style)\n"
+            "  pageSize  -> index page size in bytes (default 4096, max 16384)\n"
+            "  lookups   -> # of random point lookups timed (default 200000)\n"
+            "The student schema is read from schema.cat (see hfcatalog) next\n"
+            "to student_txt_path.\n"
             "\nExample:\n"
             "  %s ../data/student.txt 1\n"
             "  %s ../data/student.txt 2\n",
@@ -62,12 +69,26 @@ int main(int argc, char *argv[]) {
 
     const char *student_txt = argv[1];
     int mode = atoi(argv[2]);
+    int pageSize = (argc > 3) ? atoi(argv[3]) : PF_PAGE_SIZE;
+    int lookups = (argc > 4) ? atoi(argv[4]) : 200000;
     if (mode != 1 && mode != 2) {
         fprintf(stderr, "Invalid mode %d (use 1 or 2)\n", mode);
         return 1;
     }
 
     /* -------- 1. Read student.txt and collect (roll, recId) -------- */
+    char catalog[MAX_LINE_LEN];
+    const char *slash = strrchr(student_txt, '/');
+    HF_Schema schema;
+    int rollCol;
+    snprintf(catalog, sizeof(catalog), "%.*sschema.cat",
+             slash ? (int)(slash - student_txt + 1) : 0, student_txt);
+    if (HF_LoadSchema(catalog, "student", &schema) != HFE_OK ||
+            (rollCol = HF_ColumnNum(&schema, "c2")) < 0) {
+        fprintf(stderr, "No student.c2 in schema catalog %s\n", catalog);
+        return 1;
+    }
+
     FILE *fp = fopen(student_txt, "r");
     if (!fp) {
         perror("fopen student_txt");
@@ -99,7 +120,7 @@ int main(int argc, char *argv[]) {
             line[--len] = '\0';
         }
 
-        int roll = parse_rollno(line);
+        int roll = parse_rollno(&schema, rollCol, line, (int)len);
         if (roll < 0) {
             fprintf(stderr, "Skipping malformed line %d\n", n);
             continue;
@@ -131,9 +152,9 @@ int main(int argc, char *argv[]) {
     /* Remove any old index; ignore error code */
     AM_DestroyIndex("student.idx", 1);
 
-    int err = AM_CreateIndex("student.idx", 1, 'i', sizeof(int));
+    int err = AM_CreateIndexSized("student.idx", 1, 'i', sizeof(int), pageSize);
     if (err != AME_OK) {
-        AM_PrintError("AM_CreateIndex");
+        AM_PrintError("AM_CreateIndexSized");
         free(arr);
         return 1;
     }
@@ -227,7 +248,43 @@ int main(int argc, char *argv[]) {
         AM_CloseIndexScan(scanDesc);
     }
 
-    /* -------- 6. Cleanup ------------------------------------------- */
+    /* -------- 6. Point lookups: root-to-leaf descents --------------- */
+    /* Each lookup is one AM_Search descent. Run with the swizzled
+       child references of PF_GetChildPage() off, then on. */
+    printf("Timing %d random point lookups (AM_Search descents)...\n",
+           lookups);
+    PF_SetBufferSize(100);     /* the largest pool: keep the tree resident */
+    for (int swizzle = 0; swizzle <= 1; swizzle++) {
+        PF_SetSwizzle(swizzle);
+        srand(1);
+        PF_ResetStats();
+        gettimeofday(&t1, NULL);
+        for (int i = 0; i < lookups; i++) {
+            int roll = arr[rand() % n].roll;
+            int pageNum, index;
+            char *pageBuf;
+
+            AM_EmptyStack();
+            if (AM_Search(fd, 'i', sizeof(int), (char *)&roll,
+                          &pageNum, &pageBuf, &index) != AM_FOUND) {
+                fprintf(stderr, "Lookup failed for roll=%d\n", roll);
+                AM_PrintError("AM_Search");
+                PF_CloseFile(fd);
+                free(arr);
+                return 1;
+            }
+            PF_UnfixPage(fd, pageNum, FALSE);
+        }
+        gettimeofday(&t2, NULL);
+        double ms = elapsed_ms(t1, t2);
+        printf("  swizzle %-3s: %.3f ms, %.0f lookups/s, "
+               "%d page gets, %d swizzle hits\n",
+               swizzle ? "on" : "off", ms, lookups / (ms / 1000.0),
+               PF_stats.logicalReads, PF_stats.swizzleHits);
+    }
+    printf("\n");
+
+    /* -------- 7. Cleanup ------------------------------------------- */
     PF_CloseFile(fd);
     free(arr);
 
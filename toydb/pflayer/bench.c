@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "bench.h"
+
+double elapsed_ms(struct timeval t1, struct timeval t2) {
+    long sec  = (long)(t2.tv_sec  - t1.tv_sec);
+    long usec = (long)(t2.tv_usec - t1.tv_usec);
+    return (double)sec * 1000.0 + (double)usec / 1000.0;
+}
+
+long sum_bytes(const char *rec, int len) {
+    long s = 0;
+    for (int i = 0; i < len; i++)
+        s += (unsigned char)rec[i];
+    return s;
+}
+
+char **read_rows(const char *dataFile, int *n, int **lens) {
+    char line[BENCH_MAX_LINE];
+    int cap = 1024;
+    FILE *fp = fopen(dataFile, "r");
+
+    if (!fp) {
+        perror(dataFile);
+        exit(1);
+    }
+    char **rows = malloc(cap * sizeof(char*));
+    if (lens != NULL)
+        *lens = malloc(cap * sizeof(int));
+    *n = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (strchr(line, ';') == NULL)
+            continue;
+        if (*n == cap) {
+            rows = realloc(rows, (cap *= 2) * sizeof(char*));
+            if (lens != NULL)
+                *lens = realloc(*lens, cap * sizeof(int));
+        }
+        if (lens != NULL)
+            (*lens)[*n] = strlen(line);
+        rows[(*n)++] = strdup(line);
+    }
+    fclose(fp);
+    return rows;
+}
+
+void free_rows(char **rows, int *lens, int n) {
+    for (int i = 0; i < n; i++)
+        free(rows[i]);
+    free(rows);
+    free(lens);
+}
+
+double scan_file(int fd, HF_Pred *preds, int numPreds, int batched,
+                 int *count, long *check) {
+    static RID rids[BENCH_BATCH];
+    static char *recs[BENCH_BATCH];
+    static int lens[BENCH_BATCH];
+    struct timeval t1, t2;
+    long s = 0;
+
+    for (int p = 0; p <= BENCH_PASSES; p++) {
+        HF_Scan scan;
+        RID rid;
+        char *rec;
+        int len, n;
+        if (p == 1)
+            gettimeofday(&t1, NULL);
+        *count = 0;
+        s = 0;
+        HF_OpenFileScanWhere(fd, &scan, preds, numPreds);
+        if (batched) {
+            while ((n = HF_GetNextBatch(fd, &scan, rids, recs, lens, BENCH_BATCH)) > 0) {
+                *count += n;
+                for (int i = 0; i < n; i++)
+                    s += lens[i] + (unsigned char)recs[i][0];
+            }
+        } else {
+            while (HF_GetNextRec(fd, &scan, &rid, &rec, &len) == HFE_OK) {
+                (*count)++;
+                s += len + (unsigned char)rec[0];
+            }
+        }
+        HF_CloseFileScan(&scan);
+    }
+    gettimeofday(&t2, NULL);
+    if (check != NULL)
+        *check = s;
+    return elapsed_ms(t1, t2) / BENCH_PASSES;
+}
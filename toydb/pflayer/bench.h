@@ -0,0 +1,44 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <sys/time.h>
+#include "hf.h"
+
+/*
+ * Helpers the HF layer benchmarks (hfload, hfbatch, hfzone, ...)
+ * share: timing, reading the rows of a data/ table, and timed scans.
+ */
+
+#define BENCH_MAX_LINE  4096    /* longest line of a data/ table */
+#define BENCH_PASSES    20      /* passes of a timed scan */
+#define BENCH_BATCH     1024    /* records a batch scan gets at a time */
+
+// Milliseconds from t1 to t2
+double elapsed_ms(struct timeval t1, struct timeval t2);
+
+// Adds up the bytes of a record or value: the work done with each one
+long sum_bytes(const char *rec, int len);
+
+/*
+ * Reads the rows of a data/ table: its lines with a ';' in them (so
+ * not the title line), without the newline. Sets *n to their number
+ * and, unless lens is NULL, *lens to their lengths. Exits if the file
+ * cannot be read.
+ */
+char **read_rows(const char *dataFile, int *n, int **lens);
+
+// Frees the rows (and lengths, if not NULL) read_rows gave
+void free_rows(char **rows, int *lens, int n);
+
+/*
+ * Scans file fd BENCH_PASSES times, after one pass to bring it into
+ * the buffer pool, for the records matching the numPreds predicates
+ * (every record if there are none): a batch of BENCH_BATCH at a time
+ * if "batched", otherwise a record at a time. Sets *count to the
+ * records found in a pass and, unless check is NULL, *check to the
+ * sum of their lengths and first bytes. Returns ms per pass.
+ */
+double scan_file(int fd, HF_Pred *preds, int numPreds, int batched,
+                 int *count, long *check);
+
+#endif // BENCH_H
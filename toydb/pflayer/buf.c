@@ -1,8 +1,9 @@
 /* buf.c: buffer management routines. The interface routines are:
-PFbufGet(), PFbufUnfix(), PFbufAlloc(), PFbufReleaseFile(), PFbufUsed() and
-PFbufPrint() */
+PFbufGet(), PFbufUnfix(), PFbufAlloc(), PFbufDescFixed(), PFbufReleaseFile(),
+PFbufFlushFile(), PFbufGetChild(), PFbufUsed() and PFbufPrint() */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "pf.h"
 #include "pftypes.h"
 
@@ -12,6 +13,7 @@ static int PFnumbpage = 0;	/* # of buffer pages in memory */
 static PFbpage *PFfirstbpage= NULL;	/* ptr to first buffer page, or NULL */
 static PFbpage *PFlastbpage = NULL;	/* ptr to last buffer page, or NULL */
 static PFbpage *PFfreebpage= NULL;	/* list of free buffer pages */
+static PFbpage *PFfixedbpage = NULL;	/* page fixed last, or NULL */
 
 
 static void PFbufInsertFree(bpage)
@@ -28,6 +30,66 @@ AUTHOR: clc
 }
 
 
+static void PFbufUnswizzle(bpage)
+PFbpage *bpage;		/* buffer page about to hold another page */
+/****************************************************************************
+SPECIFICATIONS:
+	Drop the swizzled references to and from the buffer page
+	"bpage", which is being freed or given to another page.
+*****************************************************************************/
+{
+int i;
+
+	if (bpage->swizparent != NULL){
+		bpage->swizparent->swiz[bpage->swizslot] = NULL;
+		bpage->swizparent = NULL;
+	}
+	for (i=0; i < bpage->nswiz; i++)
+		if (bpage->swiz[i] != NULL){
+			bpage->swiz[i]->swizparent = NULL;
+			bpage->swiz[i] = NULL;
+		}
+	if (PFfixedbpage == bpage)
+		PFfixedbpage = NULL;
+}
+
+static void PFbufSwizzle(parent,slot,child)
+PFbpage *parent;	/* buffer page of the parent */
+int slot;		/* slot of the parent pointing to child */
+PFbpage *child;		/* buffer page of the child */
+/****************************************************************************
+SPECIFICATIONS:
+	Make slot "slot" of buffer page "parent" refer directly to the
+	buffer page "child". A child is referred to from one slot at
+	most, so any older reference to it is dropped. If there is no
+	memory for the reference, nothing is done.
+*****************************************************************************/
+{
+PFbpage **swiz;
+int n;
+
+	if (slot >= parent->nswiz){
+		for (n = (parent->nswiz > 0)? parent->nswiz : 16; n <= slot;
+				n *= 2)
+			;
+		if ((swiz=(PFbpage **)realloc((char *)parent->swiz,
+				n*sizeof(PFbpage *))) == NULL)
+			return;
+		memset((char *)(swiz+parent->nswiz),0,
+			(n-parent->nswiz)*sizeof(PFbpage *));
+		parent->swiz = swiz;
+		parent->nswiz = n;
+	}
+
+	if (child->swizparent != NULL)
+		child->swizparent->swiz[child->swizslot] = NULL;
+	if (parent->swiz[slot] != NULL)
+		parent->swiz[slot]->swizparent = NULL;
+	parent->swiz[slot] = child;
+	child->swizparent = parent;
+	child->swizslot = slot;
+}
+
 static void PFbufLinkHead(bpage)
 PFbpage *bpage;		/* pointer to buffer page to be linked */
 /****************************************************************************
@@ -93,15 +155,111 @@ GLOBAL VARIABLES MODIFIED:
 }
 
 
-static int PFbufInternalAlloc(bpage,writefcn)
+static int PFbufFixedBy(bpage,desc)
+PFbpage *bpage;		/* buffer page */
+int desc;		/* descriptor */
+/****************************************************************************
+SPECIFICATIONS:
+	Find descriptor "desc" among the descriptors that have the
+	buffer page "bpage" fixed.
+
+RETURN VALUE:
+	Its index in bpage->fixdesc, or -1 if it does not have the
+	page fixed.
+*****************************************************************************/
+{
+int i;
+
+	for (i=0; i < bpage->fixcnt; i++)
+		if (bpage->fixdesc[i] == desc)
+			return(i);
+	return(-1);
+}
+
+static int PFbufFix(bpage,desc)
+PFbpage *bpage;		/* buffer page */
+int desc;		/* descriptor fixing it */
+/****************************************************************************
+SPECIFICATIONS:
+	Fix the buffer page "bpage" through descriptor "desc", which
+	does not have it fixed yet. A page that no descriptor has fixed
+	always has room for one, so this cannot fail for it.
+
+RETURN VALUE:
+	PFE_OK	if no error.
+	PFE_NOMEM	if no memory.
+*****************************************************************************/
+{
+int *fixdesc;
+int n;
+
+	if (bpage->fixcnt == bpage->fixsize){
+		n = 2*bpage->fixsize;
+		if ((fixdesc=(int *)realloc((char *)bpage->fixdesc,
+				n*sizeof(int))) == NULL){
+			PFerrno = PFE_NOMEM;
+			return(PFerrno);
+		}
+		bpage->fixdesc = fixdesc;
+		bpage->fixsize = n;
+	}
+	bpage->fixdesc[bpage->fixcnt++] = desc;
+	PFfixedbpage = bpage;
+	return(PFE_OK);
+}
+
+static void PFbufUnfixAt(bpage,i)
+PFbpage *bpage;		/* buffer page */
+int i;			/* index of the descriptor in bpage->fixdesc */
+/****************************************************************************
+SPECIFICATIONS:
+	Unfix the buffer page "bpage" for the "i"th descriptor that
+	has it fixed, and make it the most recently used page.
+*****************************************************************************/
+{
+	bpage->fixdesc[i] = bpage->fixdesc[--bpage->fixcnt];
+	PFbufUnlink(bpage);
+	PFbufLinkHead(bpage);
+}
+
+
+static int PFbufSetSize(bpage,size)
+PFbpage *bpage;		/* buffer page */
+int size;		/* page size the buffer must hold */
+/****************************************************************************
+SPECIFICATIONS:
+	Make the buffer page "bpage" hold a page of "size" bytes,
+	(re)allocating its page data if it is of a different size.
+	The old page data is lost.
+
+RETURN VALUE:
+	PFE_OK	if no error.
+	PFE_NOMEM	if no memory. bpage then has no page data.
+*****************************************************************************/
+{
+	if (bpage->fpage != NULL && bpage->size == size)
+		return(PFE_OK);
+
+	free((char *)bpage->fpage);
+	if ((bpage->fpage=(PFfpage *)malloc(PFfpageSize(size)))==NULL){
+		PFerrno = PFE_NOMEM;
+		return(PFerrno);
+	}
+	bpage->size = size;
+	return(PFE_OK);
+}
+
+static int PFbufInternalAlloc(bpage,size,writefcn)
 PFbpage **bpage;	/* pointer to pointer to buffer bpage to be allocated*/
+int size;		/* page size of the page to be held in the buffer */
 int (*writefcn)();
 /****************************************************************************
 SPECIFICATIONS:
 	Allocate a buffer page and set *bpage to point to it. *bpage
 	is set to NULL if one can not be allocated.
 	The "nextpage" and "prevpage" fields of *bpage are linked as
-	the head of the list of used buffers.All the other fields are undefined.
+	the head of the list of used buffers. "fpage" holds "size" bytes
+	of page data. All the other fields are undefined.
 	writefcn() is used to write pages. (See PFbufGet()).
 
 ALGORITHM:
@@ -143,6 +301,19 @@ int error;		/* error value returned*/
 			PFerrno = PFE_NOMEM;
 			return(PFerrno);
 		}
+		if (((*bpage)->fixdesc=(int *)malloc(sizeof(int)))==NULL){
+			/* no mem */
+			free((char *)*bpage);
+			*bpage = NULL;
+			PFerrno = PFE_NOMEM;
+			return(PFerrno);
+		}
+		(*bpage)->fixcnt = 0;
+		(*bpage)->fixsize = 1;
+		(*bpage)->fpage = NULL;
+		(*bpage)->swiz = NULL;
+		(*bpage)->nswiz = 0;
+		(*bpage)->swizparent = NULL;
 		/* increment # of pages allocated */
 		PFnumbpage++;
 	}
@@ -153,7 +324,7 @@ int error;		/* error value returned*/
 		*bpage = NULL;		/* set initial return value */
 
 		// for (tbpage=PFlastbpage;tbpage!=NULL;tbpage=tbpage->prevpage){
-		// 	if (!tbpage->fixed)
+		// 	if (tbpage->fixcnt == 0)
 		// 		/* found a page that can be swapped out */
 		// 		break;
 		// }
@@ -162,13 +333,32 @@ int error;		/* error value returned*/
         if (PF_replacementPolicy == PF_REPL_LRU) {
             /* LRU: evict least recently used => from the tail */
             for (tbpage = PFlastbpage; tbpage != NULL; tbpage = tbpage->prevpage) {
-                if (!tbpage->fixed)
+                if (tbpage->fixcnt == 0)
                     break;   /* found a victim */
             }
+        } else if (PF_replacementPolicy == PF_REPL_CFLRU) {
+            /* CFLRU: evict the least recently used clean page among
+            the window of least recently used pages, so that dirty
+            pages stay buffered and absorb more writes. Only when
+            the window has no clean page, evict as LRU does. */
+            int window = (PF_cflruWindow > 0) ? PF_cflruWindow
+                                              : (PFnumbpage + 1) / 2;
+            for (tbpage = PFlastbpage; tbpage != NULL && window-- > 0;
+                    tbpage = tbpage->prevpage) {
+                if (tbpage->fixcnt == 0 && !tbpage->dirty)
+                    break;   /* clean victim */
+            }
+            if (tbpage == NULL || window < 0) {
+                for (tbpage = PFlastbpage; tbpage != NULL;
+                        tbpage = tbpage->prevpage) {
+                    if (tbpage->fixcnt == 0)
+                        break;   /* dirty victim */
+                }
+            }
         } else {
             /* MRU: evict most recently used => from the head */
             for (tbpage = PFfirstbpage; tbpage != NULL; tbpage = tbpage->nextpage) {
-                if (!tbpage->fixed)
+                if (tbpage->fixcnt == 0)
                     break;   /* found a victim */
             }
         }
@@ -183,21 +373,33 @@ int error;		/* error value returned*/
 
 		/* write out the dirty page */
 		if (tbpage->dirty&&((error=(*writefcn)(tbpage->fd,
-				tbpage->page,&tbpage->fpage))!= PFE_OK))
+				tbpage->page,tbpage->fpage))!= PFE_OK))
 			return(error);
 		tbpage->dirty = FALSE;
 
+		/* keep a compressed copy of the now clean page */
+		PFzcachePut(tbpage->fd,tbpage->page,tbpage->fpage,
+			tbpage->size);
+
 		/* unlink from hash table */
 		if ((error=PFhashDelete(tbpage->fd,tbpage->page))!= PFE_OK)
 			return(error);
 		
 		/* unlink from buffer list */
 		PFbufUnlink(tbpage);
+		PFbufUnswizzle(tbpage);
 
 		*bpage = tbpage;
 
 	}
 
+	/* give it page data of the right size */
+	if ((error=PFbufSetSize(*bpage,size))!= PFE_OK){
+		PFbufInsertFree(*bpage);
+		*bpage = NULL;
+		return(error);
+	}
+
 	/* Link the page as the head of the used list */
 	PFbufLinkHead(*bpage);
 	return(PFE_OK);
@@ -205,16 +407,20 @@ int error;		/* error value returned*/
 
 
 /************************* Interface to the Outside World ****************/
-int PFbufGet(fd,pagenum,fpage,readfcn,writefcn)
+int PFbufGet(fd,desc,pagenum,size,fpage,readfcn,writefcn)
 int fd;	/* file descriptor */
+int desc;	/* descriptor it is fixed through */
 int pagenum;	/* page number */
+int size;	/* page size of the file */
 PFfpage **fpage;	/* pointer to pointer to file page */
 int (*readfcn)();	/* function to read a page */
 int (*writefcn)();	/* function to write a page */
 /****************************************************************************
 SPECIFICATIONS:
 	Get a page whose number is "pagenum" from the file pointed
-	by "fd". Set *fpage to point to the data for that page.
+	by "fd", and fix it through descriptor "desc" of the file.
+	Set *fpage to point to the data for that page, which
+	is "size" bytes long.
 	This function requires two functions:
 		readfcn(fd,pagenum,fpage) 
 		int fd;
@@ -227,7 +433,9 @@ SPECIFICATIONS:
 		in pagenum;
 		PFpage *fpage;
 	which will write one page into the file.
-	It is an error to read a page already fixed in the buffer.
+	It is an error to read a page already fixed in the buffer
+	through the same descriptor. Other descriptors of the file
+	can fix it too: the page stays fixed until each has unfixed it.
 
 RETURN VALUE:
 	PFE_OK	if no error.
@@ -245,14 +453,15 @@ int error;
 		/* page not in buffer. */
 		
 		/* allocate an empty page */
-		if ((error=PFbufInternalAlloc(&bpage,writefcn))!= PFE_OK){
+		if ((error=PFbufInternalAlloc(&bpage,size,writefcn))!= PFE_OK){
 			/* error */
 			*fpage = NULL;
 			return(error);
 		}
 		
-		/* read the page */
-		if ((error=(*readfcn)(fd,pagenum,&bpage->fpage))!= PFE_OK){
+		/* read the page, unless the compressed cache has it */
+		if (!PFzcacheGet(fd,pagenum,bpage->fpage,size) &&
+			(error=(*readfcn)(fd,pagenum,bpage->fpage))!= PFE_OK){
 			/* error reading the page. put buffer back into 
 			the free list, and return gracefully */
 			PFbufUnlink(bpage);
@@ -275,28 +484,28 @@ int error;
 		bpage->page = pagenum;
 		bpage->dirty = FALSE;
 	}
-	else if (bpage->fixed){
-		/* page already in memory, and is fixed, so we can't
-		get it again. */
-		*fpage = &bpage->fpage;
+	else if (PFbufFixedBy(bpage,desc) >= 0){
+		/* page already in memory, and is fixed through this
+		descriptor, so we can't get it again. */
+		*fpage = bpage->fpage;
 		PFerrno = PFE_PAGEFIXED;
 		return(PFerrno);
 	}
 
 	/* Fix the page in the buffer then return*/
-	bpage->fixed = TRUE;
-	*fpage = &bpage->fpage;
-	return(PFE_OK);
+	*fpage = bpage->fpage;
+	return(PFbufFix(bpage,desc));
 }
 
-int PFbufUnfix(fd,pagenum,dirty)
+int PFbufUnfix(fd,desc,pagenum,dirty)
 int fd;		/* file descriptor */
+int desc;	/* descriptor it was fixed through */
 int pagenum;	/* page number */
 int dirty;	/* TRUE if page is dirty */
 /****************************************************************************
 SPECIFICATIONS:
-	Unfix the file page whose number is "pagenum" from the buffer.
-	If dirty is TRUE, then mark the buffer as having been modified.
+	Unfix the file page whose number is "pagenum" from the buffer
+	for descriptor "desc". If dirty is TRUE, then mark the buffer as having been modified.
 	Otherwise, the dirty flag is left unchanged.
 
 AUTHOR: clc
@@ -308,6 +517,7 @@ RETURN VALUE:
 *****************************************************************************/
 {
 PFbpage *bpage;
+int i;
 
 	if ((bpage= PFhashFind(fd,pagenum))==NULL){
 		/* page not in buffer */
@@ -315,7 +525,7 @@ PFbpage *bpage;
 		return(PFerrno);
 	}
 
-	if (!bpage->fixed){
+	if ((i=PFbufFixedBy(bpage,desc)) < 0){
 		/* page already unfixed */
 		PFerrno = PFE_PAGEUNFIXED;
 		return(PFerrno);
@@ -325,27 +535,24 @@ PFbpage *bpage;
 		/* mark this page dirty */
 		bpage->dirty = TRUE;
 	
-	/* unfix the page */
-	bpage->fixed = FALSE;
-	
-	/* unlink this page */
-	PFbufUnlink(bpage);
-
-	/* insert it as head of linked list to make it most recently used*/
-	PFbufLinkHead(bpage);
+	/* unfix the page, and make it most recently used */
+	PFbufUnfixAt(bpage,i);
 
 	return(PFE_OK);
 }
 
-int PFbufAlloc(fd,pagenum,fpage,writefcn)
+int PFbufAlloc(fd,desc,pagenum,size,fpage,writefcn)
 int fd;		/* file descriptor */
+int desc;	/* descriptor it is fixed through */
 int pagenum;	/* page number */
+int size;	/* page size of the file */
 PFfpage **fpage;	/* pointer to file page */
 int (*writefcn)();
 /****************************************************************************
 SPECIFICATIONS:
 	Allocate a buffer and mark it belonging to page "pagenum"
-	of file "fd".  Set *fpage to point to the buffer data.
+	of file "fd", fixed through descriptor "desc".  Set *fpage
+	to point to the buffer data, which is "size" bytes long.
 	The function "writefcn" is used to write out pages. (See PFbufGet()).
 
 AUTHOR: clc
@@ -366,9 +573,12 @@ int error;
 		return(PFerrno);
 	}
 
-	if ((error=PFbufInternalAlloc(&bpage,writefcn))!= PFE_OK)
+	if ((error=PFbufInternalAlloc(&bpage,size,writefcn))!= PFE_OK)
 		/* can't get any buffer */
 		return(error);
+
+	/* a new page: any cached copy is stale */
+	PFzcacheDrop(fd,pagenum);
 	
 	/* put ourselves into the hash table */
 	if ((error=PFhashInsert(fd,pagenum,bpage))!= PFE_OK){
@@ -382,14 +592,35 @@ int error;
 	/* init the fields of bpage and return */
 	bpage->fd = fd;
 	bpage->page = pagenum;
-	bpage->fixed = TRUE;
 	bpage->dirty = FALSE;
+	PFbufFix(bpage,desc);	/* cannot fail for an unfixed page */
 
-	*fpage = &bpage->fpage;
+	*fpage = bpage->fpage;
 	return(PFE_OK);
 }
 
 
+int PFbufDescFixed(fd,desc)
+int fd;		/* file descriptor */
+int desc;	/* one of the descriptors of the file */
+/****************************************************************************
+SPECIFICATIONS:
+	Tell whether descriptor "desc" of file "fd" has any page of the
+	file fixed in the buffer.
+
+RETURN VALUE:
+	TRUE or FALSE.
+*****************************************************************************/
+{
+PFbpage *bpage;
+
+	for (bpage=PFfirstbpage; bpage != NULL; bpage=bpage->nextpage)
+		if (bpage->fd == fd && PFbufFixedBy(bpage,desc) >= 0)
+			return(TRUE);
+	return(FALSE);
+}
+
+
 int PFbufReleaseFile(fd,writefcn)
 int fd;		/* file descriptor */
 int (*writefcn)();	/* function to write a page of file */
@@ -418,14 +649,14 @@ int error;		/* error code */
 	while (bpage != NULL){
 		if (bpage->fd == fd){
 			/* The file descriptor matches*/
-			if (bpage->fixed){
+			if (bpage->fixcnt > 0){
 				PFerrno = PFE_PAGEFIXED;
 				return(PFerrno);
 			}
 
 			/* write out dirty page */
 			if (bpage->dirty&&((error=(*writefcn)(fd,bpage->page,
-					&bpage->fpage))!= PFE_OK))
+					bpage->fpage))!= PFE_OK))
 				/* error writing file */
 				return(error);
 			bpage->dirty = FALSE;
@@ -441,11 +672,138 @@ int error;		/* error code */
 			temppage = bpage;
 			bpage = bpage->nextpage;
 			PFbufUnlink(temppage);
+			PFbufUnswizzle(temppage);
 			PFbufInsertFree(temppage);
 
 		}
 		else	bpage = bpage->nextpage;
 	}
+
+	/* the file descriptor may be reused for another file */
+	PFzcacheDropFile(fd);
+	return(PFE_OK);
+}
+
+
+int PFbufGetChild(fd,desc,pagenum,slot,childnum,size,fpage,readfcn,writefcn)
+int fd;		/* file descriptor */
+int desc;	/* descriptor the pages are fixed through */
+int pagenum;	/* fixed page to go down from */
+int slot;	/* slot of page "pagenum" that points to the child */
+int childnum;	/* page number of the child */
+int size;	/* page size of the file */
+PFfpage **fpage;	/* pointer to pointer to file page */
+int (*readfcn)();	/* function to read a page */
+int (*writefcn)();	/* function to write a page */
+/****************************************************************************
+SPECIFICATIONS:
+	Unfix page "pagenum" of file "fd", which is not dirty, and get
+	page "childnum", its child through slot "slot", as PFbufGet()
+	does. While both pages are in the buffer, the buffer page of
+	the parent keeps a direct (swizzled) reference to the child's,
+	so the next descent through the same slot finds the child
+	without looking in the hash table. The reference is checked
+	against "childnum", and dropped when either page leaves the
+	buffer.
+
+RETURN VALUE:
+	As PFbufGet().
+*****************************************************************************/
+{
+PFbpage *parent, *child;
+int i;
+int error;
+
+	/* the parent was nearly always the page fixed last */
+	if ((parent=PFfixedbpage) == NULL || parent->fd != fd ||
+			parent->page != pagenum)
+		parent = PFhashFind(fd,pagenum);
+	if (parent == NULL){
+		PFerrno = PFE_PAGENOTINBUF;
+		return(PFerrno);
+	}
+	if ((i=PFbufFixedBy(parent,desc)) < 0){
+		PFerrno = PFE_PAGEUNFIXED;
+		return(PFerrno);
+	}
+
+	/* unfix the parent, as PFbufUnfix() does */
+	PFbufUnfixAt(parent,i);
+
+	if (PF_swizzle && slot >= 0 && slot < parent->nswiz &&
+			(child=parent->swiz[slot]) != NULL &&
+			child->page == childnum && child->fd == fd){
+		*fpage = child->fpage;
+		if (PFbufFixedBy(child,desc) >= 0){
+			PFerrno = PFE_PAGEFIXED;
+			return(PFerrno);
+		}
+		if ((error=PFbufFix(child,desc)) != PFE_OK)
+			return(error);
+		PF_stats.swizzleHits++;
+		return(PFE_OK);
+	}
+
+	if ((error=PFbufGet(fd,desc,childnum,size,fpage,readfcn,writefcn))
+			!= PFE_OK)
+		return(error);
+
+	/* the parent may have been replaced to make room for the child */
+	if (PF_swizzle && slot >= 0 && parent->fd == fd &&
+			parent->page == pagenum)
+		PFbufSwizzle(parent,slot,PFfixedbpage);
+	return(PFE_OK);
+}
+
+
+/* order buffer pages by page number, for qsort() */
+static int PFbufPageCmp(a,b)
+const void *a;
+const void *b;
+{
+	return((*(PFbpage **)a)->page - (*(PFbpage **)b)->page);
+}
+
+int PFbufFlushFile(fd,writevfcn)
+int fd;		/* file descriptor */
+int (*writevfcn)();	/* function to write a batch of pages of file */
+/****************************************************************************
+SPECIFICATIONS:
+	Write out all the dirty pages of file "fd". The pages stay in
+	the buffer, and are no longer dirty. The pages are written with
+	one call (*writevfcn)(fd,pagenums,fpages,n), where "fpages" are
+	the "n" pages numbered "pagenums", in page number order.
+
+RETURN VALUE:
+	PFE_OK if no error.
+	PF error code if error.
+*****************************************************************************/
+{
+PFbpage *dirty[PF_MAX_BUFS_LIMIT];	/* dirty pages of the file */
+PFfpage *fpages[PF_MAX_BUFS_LIMIT];
+int pagenums[PF_MAX_BUFS_LIMIT];
+PFbpage *bpage;
+int ndirty;	/* # of dirty pages */
+int i;
+int error;
+
+	ndirty = 0;
+	for (bpage=PFfirstbpage; bpage != NULL; bpage=bpage->nextpage)
+		if (bpage->fd == fd && bpage->dirty)
+			dirty[ndirty++] = bpage;
+	if (ndirty == 0)
+		return(PFE_OK);
+	qsort((char *)dirty,ndirty,sizeof(PFbpage *),PFbufPageCmp);
+
+	for (i=0; i < ndirty; i++){
+		pagenums[i] = dirty[i]->page;
+		fpages[i] = dirty[i]->fpage;
+	}
+	if ((error=(*writevfcn)(fd,pagenums,fpages,ndirty))!= PFE_OK)
+		return(error);
+
+	for (i=0; i < ndirty; i++)
+		dirty[i]->dirty = FALSE;
 	return(PFE_OK);
 }
 
@@ -474,7 +832,7 @@ PFbpage *bpage;	/* pointer to the bpage we are looking for */
 		return(PFerrno);
 	}
 
-	if (!(bpage->fixed)){
+	if (bpage->fixcnt == 0){
 		/* page not fixed */
 		PFerrno = PFE_PAGEUNFIXED;
 		return(PFerrno);
@@ -505,10 +863,10 @@ PFbpage *bpage;
 	if (PFfirstbpage == NULL)
 		printf("empty\n");
 	else {
-		printf("fd\tpage\tfixed\tdirty\tfpage\n");
+		printf("fd\tpage\tfixcnt\tdirty\tfpage\n");
 		for(bpage = PFfirstbpage; bpage != NULL; bpage= bpage->nextpage)
 			printf("%d\t%d\t%d\t%d\t%d\n",
-				bpage->fd,bpage->page,(int)bpage->fixed,
-				(int)bpage->dirty,(int)&bpage->fpage);
+				bpage->fd,bpage->page,(int)bpage->fixcnt,
+				(int)bpage->dirty,(int)bpage->fpage);
 	}
 }
@@ -1,6 +1,12 @@
 #include "hf.h"
 #include <stdio.h>
+#include <stdlib.h> // for malloc
 #include <string.h> // for memcpy
+#include <math.h> // for HUGE_VAL, in zone maps
+#include <pthread.h> // for HF_ParallelScan
+#ifdef __SSE2__
+#include <emmintrin.h> // for the delimiter search of scan predicates
+#endif
 
 /*
  * Helper function to get a pointer to the header of a page.
@@ -18,347 +24,3605 @@ static HF_SlotEntry* HF_GetSlotArray(char *pageBuf) {
 }
 
 /*
- * Initializes a new, empty slotted page.
+ * Slotted pages are of the first format or of format 2 (see hf.h).
+ * The functions below read and write the header and slots of either;
+ * slot lengths are given in the first format's terms, HF_SLOT_FREE,
+ * HF_SLOT_FORWARD, or bytes with HF_SLOT_MOVED and HF_SLOT_LONG.
+ */
+static int HF_IsPage2(char *pageBuf) {
+    int kind = HF_GetPageHeader(pageBuf)->numSlots;
+
+    return kind == HF_PAGE2 || kind == HF_DICT_PAGE;
+}
+
+/* Tells whether a page is a dictionary page, a format 2 page too */
+static int HF_IsDictPage(char *pageBuf) {
+    return HF_GetPageHeader(pageBuf)->numSlots == HF_DICT_PAGE;
+}
+
+static HF_PageHeader2* HF_GetPageHeader2(char *pageBuf) {
+    return (HF_PageHeader2*)pageBuf;
+}
+
+static HF_SlotEntry2* HF_GetSlotArray2(char *pageBuf) {
+    // A dictionary page's header is longer
+    return (HF_SlotEntry2*)(pageBuf + (HF_IsDictPage(pageBuf) ?
+        sizeof(HF_DictHeader) : sizeof(HF_PageHeader2)));
+}
+
+/* Tells whether a page is a slotted page, of either format */
+static int HF_IsSlottedPage(char *pageBuf) {
+    return HF_GetPageHeader(pageBuf)->numSlots >= 0 || HF_IsPage2(pageBuf);
+}
+
+/*
+ * Bytes of the data heap taken by the record of a slot, given the
+ * slot's length.
+ */
+static int HF_SlotBytes(int length) {
+    if (length == HF_SLOT_FREE) {
+        return 0;
+    }
+    if (length == HF_SLOT_FORWARD) {
+        return sizeof(RID);
+    }
+    return length & ~(HF_SLOT_MOVED | HF_SLOT_LONG | HF_SLOT_DICT);
+}
+
+static int HF_NumSlots(char *pageBuf) {
+    return HF_IsPage2(pageBuf) ? HF_GetPageHeader2(pageBuf)->numSlots
+                               : HF_GetPageHeader(pageBuf)->numSlots;
+}
+
+static int HF_DataStart(char *pageBuf) {
+    return HF_IsPage2(pageBuf) ? HF_GetPageHeader2(pageBuf)->dataStart
+                               : HF_GetPageHeader(pageBuf)->dataStartPtr;
+}
+
+static void HF_SetDataStart(char *pageBuf, int dataStart) {
+    if (HF_IsPage2(pageBuf)) {
+        HF_GetPageHeader2(pageBuf)->dataStart = dataStart;
+    } else {
+        HF_GetPageHeader(pageBuf)->dataStartPtr = dataStart;
+    }
+}
+
+/* Size of the header and slot array of a page with numSlots slots */
+static int HF_SlotsEnd(char *pageBuf, int numSlots) {
+    return HF_IsPage2(pageBuf) ?
+        (int)((char*)&HF_GetSlotArray2(pageBuf)[numSlots] - pageBuf) :
+        (int)(sizeof(HF_PageHeader) + numSlots * sizeof(HF_SlotEntry));
+}
+
+/* Bytes a new slot takes on a slotted page, of either format */
+static int HF_SlotSize(char *pageBuf) {
+    return HF_SlotsEnd(pageBuf, 1) - HF_SlotsEnd(pageBuf, 0);
+}
+
+static int HF_SlotOffset(char *pageBuf, int slotNum) {
+    return HF_IsPage2(pageBuf) ? HF_GetSlotArray2(pageBuf)[slotNum].offset
+                               : HF_GetSlotArray(pageBuf)[slotNum].offset;
+}
+
+static int HF_SlotLength(char *pageBuf, int slotNum) {
+    if (!HF_IsPage2(pageBuf)) {
+        return HF_GetSlotArray(pageBuf)[slotNum].length;
+    }
+    int length = HF_GetSlotArray2(pageBuf)[slotNum].length;
+    if (length == HF_SLOT2_FREE) {
+        return HF_SLOT_FREE;
+    }
+    if (length == HF_SLOT2_FORWARD) {
+        return HF_SLOT_FORWARD;
+    }
+    if (HF_IsDictPage(pageBuf) && (length & HF_SLOT2_DICT)) {
+        length = (length & ~HF_SLOT2_DICT) | HF_SLOT_DICT;
+    }
+    return (length & (HF_SLOT2_BYTES | HF_SLOT_DICT)) |
+        ((length & HF_SLOT2_MOVED) ? HF_SLOT_MOVED : 0) |
+        ((length & HF_SLOT2_LONG) ? HF_SLOT_LONG : 0);
+}
+
+/*
+ * Sets a slot. On a format 2 page, the free bytes and slots in use
+ * in the header follow the change.
+ */
+static void HF_SetSlot(char *pageBuf, int slotNum, int offset, int length) {
+    if (!HF_IsPage2(pageBuf)) {
+        HF_GetSlotArray(pageBuf)[slotNum].offset = offset;
+        HF_GetSlotArray(pageBuf)[slotNum].length = length;
+        return;
+    }
+    HF_PageHeader2 *header = HF_GetPageHeader2(pageBuf);
+    HF_SlotEntry2 *slot = &HF_GetSlotArray2(pageBuf)[slotNum];
+    int old = HF_SlotLength(pageBuf, slotNum);
+    header->freeBytes += HF_SlotBytes(old) - HF_SlotBytes(length);
+    header->numRecs += (length != HF_SLOT_FREE) - (old != HF_SLOT_FREE);
+    slot->offset = offset;
+    if (length == HF_SLOT_FREE) {
+        slot->length = HF_SLOT2_FREE;
+    } else if (length == HF_SLOT_FORWARD) {
+        slot->length = HF_SLOT2_FORWARD;
+    } else {
+        slot->length = (length & HF_SLOT2_BYTES) |
+            ((length & HF_SLOT_MOVED) ? HF_SLOT2_MOVED : 0) |
+            ((length & HF_SLOT_LONG) ? HF_SLOT2_LONG : 0) |
+            ((length & HF_SLOT_DICT) ? HF_SLOT2_DICT : 0);
+    }
+}
+
+/* Or's flags (HF_SLOT_MOVED, HF_SLOT_LONG) into the length of a slot */
+static void HF_SlotAddFlags(char *pageBuf, int slotNum, int flags) {
+    HF_SetSlot(pageBuf, slotNum, HF_SlotOffset(pageBuf, slotNum),
+               HF_SlotLength(pageBuf, slotNum) | flags);
+}
+
+/*
+ * Sets the number of slots of a page. New slots are free; on a
+ * format 2 page, the slot array's bytes come off the free bytes.
+ */
+static void HF_SetNumSlots(char *pageBuf, int numSlots) {
+    if (!HF_IsPage2(pageBuf)) {
+        HF_PageHeader *header = HF_GetPageHeader(pageBuf);
+        for (int i = header->numSlots; i < numSlots; i++) {
+            HF_GetSlotArray(pageBuf)[i].length = HF_SLOT_FREE;
+        }
+        header->numSlots = numSlots;
+        return;
+    }
+    HF_PageHeader2 *header = HF_GetPageHeader2(pageBuf);
+    for (int i = header->numSlots; i < numSlots; i++) {
+        HF_GetSlotArray2(pageBuf)[i].length = HF_SLOT2_FREE;
+    }
+    header->freeBytes -= (numSlots - header->numSlots) * (int)sizeof(HF_SlotEntry2);
+    header->numSlots = numSlots;
+}
+
+/*
+ * ======================================================
+ * Fixed Page Implementation
+ * ======================================================
+ */
+
+/*
+ * Tells whether a page is a fixed page (or a PAX page, which is a
+ * fixed page too).
+ */
+static int HF_IsFixedPage(char *pageBuf) {
+    int numSlots = HF_GetPageHeader(pageBuf)->numSlots;
+
+    return numSlots == HF_FIXED_PAGE || numSlots == HF_PAX_PAGE;
+}
+
+static int HF_IsPaxPage(char *pageBuf) {
+    return HF_GetPageHeader(pageBuf)->numSlots == HF_PAX_PAGE;
+}
+
+/*
+ * Sets up the rows of a new fixed page whose header has its numSlots
+ * set: as many rows of recLen bytes as fit in the "room" bytes after
+ * the header, bitmap included, all free.
+ */
+static void HF_FixedInitRows(char *pageBuf, int room, int recLen) {
+    HF_FixedHeader *header = (HF_FixedHeader*)pageBuf;
+
+    // Each row takes recLen bytes and one bit
+    int capacity = room * 8 / (recLen * 8 + 1);
+    while ((capacity + 7) / 8 + capacity * recLen > room) {
+        capacity--;
+    }
+    header->recLen = recLen;
+    header->capacity = capacity;
+    header->numRecs = 0;
+    memset(HF_FixedBitmap(pageBuf), 0, (capacity + 7) / 8);
+}
+
+/*
+ * Initializes a new, empty fixed page of pageSize bytes with room
+ * for as many rows of recLen bytes as fit, bitmap included.
+ */
+void HF_InitFixedPage(char *pageBuf, int pageSize, int recLen) {
+    ((HF_FixedHeader*)pageBuf)->numSlots = HF_FIXED_PAGE;
+    HF_FixedInitRows(pageBuf, pageSize - (int)sizeof(HF_FixedHeader), recLen);
+}
+
+/*
+ * Initializes a new, empty PAX page of pageSize bytes for records
+ * with the given fields.
+ */
+static void HF_PaxInitPage(char *pageBuf, int pageSize, HF_PaxFields *fields) {
+    HF_PaxHeader *header = (HF_PaxHeader*)pageBuf;
+    int recLen = 0;
+
+    header->fixed.numSlots = HF_PAX_PAGE;
+    header->fields = *fields;
+    for (int f = 0; f < fields->numFields; f++) {
+        recLen += fields->width[f];
+    }
+    HF_FixedInitRows(pageBuf, pageSize - (int)sizeof(HF_PaxHeader), recLen);
+}
+
+void HF_InitPaxPage(char *pageBuf, int pageSize, int numFields, int widths[]) {
+    HF_PaxFields fields;
+
+    memset(&fields, 0, sizeof(fields));
+    fields.numFields = numFields;
+    for (int f = 0; f < numFields; f++) {
+        fields.width[f] = widths[f];
+    }
+    HF_PaxInitPage(pageBuf, pageSize, &fields);
+}
+
+/*
+ * Where the value of field "field" of row "row" of a PAX page is:
+ * the minipages of the fields before it come first.
+ */
+static char *HF_PaxValue(char *pageBuf, int field, int row) {
+    HF_PaxHeader *header = (HF_PaxHeader*)pageBuf;
+    int capacity = header->fixed.capacity;
+    char *minipage = (char*)HF_FixedBitmap(pageBuf) + (capacity + 7) / 8;
+
+    for (int f = 0; f < field; f++) {
+        minipage += capacity * header->fields.width[f];
+    }
+    return minipage + row * header->fields.width[field];
+}
+
+/* A PAX record is put together here, since it is not in one piece on its page */
+static char HF_paxRec[PF_MAX_PAGE_SIZE];
+
+/* ... and the records of a batch (see HF_GetNextBatch), which fit in a page */
+static char HF_paxBatch[PF_MAX_PAGE_SIZE];
+
+/*
+ * Writes a record into row "row" of a fixed page; on a PAX page,
+ * each field into its minipage.
+ */
+static void HF_FixedPut(char *pageBuf, int row, char *record) {
+    if (!HF_IsPaxPage(pageBuf)) {
+        memcpy(HF_FixedRow(pageBuf, row), record, ((HF_FixedHeader*)pageBuf)->recLen);
+        return;
+    }
+    HF_PaxHeader *header = (HF_PaxHeader*)pageBuf;
+    int capacity = header->fixed.capacity;
+    char *minipage = (char*)HF_FixedBitmap(pageBuf) + (capacity + 7) / 8;
+    for (int f = 0; f < header->fields.numFields; f++) {
+        int width = header->fields.width[f];
+        memcpy(minipage + row * width, record, width);
+        record += width;
+        minipage += capacity * width;
+    }
+}
+
+/* Puts the record in row "row" of a PAX page together at "out" */
+static char *HF_PaxGather(char *pageBuf, int row, char *out) {
+    HF_PaxHeader *header = (HF_PaxHeader*)pageBuf;
+    int capacity = header->fixed.capacity;
+    char *minipage = (char*)HF_FixedBitmap(pageBuf) + (capacity + 7) / 8;
+    char *rec = out;
+    for (int f = 0; f < header->fields.numFields; f++) {
+        int width = header->fields.width[f];
+        memcpy(out, minipage + row * width, width);
+        out += width;
+        minipage += capacity * width;
+    }
+    return rec;
+}
+
+/*
+ * The record in row "row" of a fixed page. That of a PAX page is
+ * put together in HF_paxRec, so it lasts until the next call.
+ */
+static char *HF_FixedGet(char *pageBuf, int row) {
+    if (!HF_IsPaxPage(pageBuf)) {
+        return HF_FixedRow(pageBuf, row);
+    }
+    return HF_PaxGather(pageBuf, row, HF_paxRec);
+}
+
+/* Tells whether row "row" of a fixed page holds a record */
+static int HF_FixedUsed(char *pageBuf, int row) {
+    HF_FixedHeader *header = (HF_FixedHeader*)pageBuf;
+
+    return row >= 0 && row < header->capacity &&
+        (HF_FixedBitmap(pageBuf)[row / 8] & (1 << (row % 8)));
+}
+
+/*
+ * Puts a record in the first free row of a fixed page.
+ * Returns the row number, HFE_PAGENOFREE or HFE_RECLEN.
+ */
+static int HF_FixedInsertRec(char *pageBuf, char *record, int recLen) {
+    HF_FixedHeader *header = (HF_FixedHeader*)pageBuf;
+    unsigned char *bitmap = HF_FixedBitmap(pageBuf);
+    int row = 0;
+
+    if (recLen != header->recLen) {
+        return HFE_RECLEN;
+    }
+    if (header->numRecs == header->capacity) {
+        return HFE_PAGENOFREE;
+    }
+    // Skip full bytes of the bitmap, then find the free bit
+    while (bitmap[row / 8] == 0xff) {
+        row += 8;
+    }
+    while (bitmap[row / 8] & (1 << (row % 8))) {
+        row++;
+    }
+    bitmap[row / 8] |= 1 << (row % 8);
+    HF_FixedPut(pageBuf, row, record);
+    header->numRecs++;
+    return row;
+}
+
+static int HF_FixedDeleteRec(char *pageBuf, int row) {
+    if (!HF_FixedUsed(pageBuf, row)) {
+        return HFE_INVALIDSLOT;
+    }
+    HF_FixedBitmap(pageBuf)[row / 8] &= ~(1 << (row % 8));
+    ((HF_FixedHeader*)pageBuf)->numRecs--;
+    return HFE_OK;
+}
+
+static int HF_FixedGetRec(char *pageBuf, int row, char **record, int *recLen) {
+    if (!HF_FixedUsed(pageBuf, row)) {
+        return HFE_INVALIDSLOT;
+    }
+    *record = HF_FixedGet(pageBuf, row);
+    *recLen = ((HF_FixedHeader*)pageBuf)->recLen;
+    return HFE_OK;
+}
+
+/*
+ * Finds the first row of a fixed page after row currentRow that
+ * holds a record, going through the bitmap a byte at a time where
+ * it is empty. Returns the row, or HFE_EOF.
+ */
+static int HF_FixedNextRow(char *pageBuf, int currentRow) {
+    HF_FixedHeader *header = (HF_FixedHeader*)pageBuf;
+    unsigned char *bitmap = HF_FixedBitmap(pageBuf);
+    int row = currentRow + 1;
+
+    while (row < header->capacity) {
+        unsigned bits = bitmap[row / 8] >> (row % 8);
+        if (bits == 0) {
+            row = (row / 8 + 1) * 8;    // no more records in this byte
+            continue;
+        }
+        while (!(bits & 1)) {
+            bits >>= 1;
+            row++;
+        }
+        return row;
+    }
+    return HFE_EOF;
+}
+
+static int HF_FixedGetNextRec(char *pageBuf, int currentRow, char **record, int *recLen) {
+    int row = HF_FixedNextRow(pageBuf, currentRow);
+
+    if (row >= 0) {
+        *record = HF_FixedGet(pageBuf, row);
+        *recLen = ((HF_FixedHeader*)pageBuf)->recLen;
+    }
+    return row;
+}
+
+/*
+ * Free bytes of a fixed page: those of its free rows, but at least
+ * one FSM unit if it has any, so the FSM does not lose the page.
+ */
+static int HF_FixedFreeBytes(char *pageBuf, int pageSize) {
+    HF_FixedHeader *header = (HF_FixedHeader*)pageBuf;
+    int freeBytes = (header->capacity - header->numRecs) * header->recLen;
+
+    if (freeBytes > 0 && freeBytes < HF_FsmUnit(pageSize)) {
+        freeBytes = HF_FsmUnit(pageSize);
+    }
+    return freeBytes;
+}
+
+static int HF_FixedUpdateRec(char *pageBuf, int row, char *record, int recLen) {
+    if (!HF_FixedUsed(pageBuf, row)) {
+        return HFE_INVALIDSLOT;
+    }
+    if (recLen != ((HF_FixedHeader*)pageBuf)->recLen) {
+        return HFE_RECLEN;
+    }
+    HF_FixedPut(pageBuf, row, record);
+    return HFE_OK;
+}
+
+/*
+ * Gets the minipage of field "field" of a PAX page, for reading
+ * the field of all its records at once: *values is set to the value
+ * of row 0, that of row i being *width * i bytes further on.
+ * Rows whose bit in HF_FixedBitmap is clear hold no record.
+ *
+ * Returns the number of rows, or HFE_NOFIELDS if the page is not a
+ * PAX page or has no such field.
+ */
+int HF_Page_GetColumn(char *pageBuf, int field, char **values, int *width) {
+    HF_PaxHeader *header = (HF_PaxHeader*)pageBuf;
+
+    if (!HF_IsPaxPage(pageBuf) || field < 0 || field >= header->fields.numFields) {
+        return HFE_NOFIELDS;
+    }
+    *values = HF_PaxValue(pageBuf, field, 0);
+    *width = header->fields.width[field];
+    return header->fixed.capacity;
+}
+
+/*
+ * Gets field "field" of the record in a slot of a PAX page.
+ *
+ * Outputs:
+ * value: A pointer to the value *within its minipage*
+ * len: The width of the field
+ *
+ * Returns:
+ * HFE_OK if successful
+ * HFE_INVALIDSLOT if the slot is invalid or deleted
+ * HFE_NOFIELDS if the page is not a PAX page or has no such field
+ */
+int HF_Page_GetField(char *pageBuf, int slotNum, int field,
+                     char **value, int *len) {
+    HF_PaxHeader *header = (HF_PaxHeader*)pageBuf;
+
+    if (!HF_IsPaxPage(pageBuf) || field < 0 || field >= header->fields.numFields) {
+        return HFE_NOFIELDS;
+    }
+    if (!HF_FixedUsed(pageBuf, slotNum)) {
+        return HFE_INVALIDSLOT;
+    }
+    *value = HF_PaxValue(pageBuf, field, slotNum);
+    *len = header->fields.width[field];
+    return HFE_OK;
+}
+
+/*
+ * ======================================================
+ * Dictionary Pages
+ * ======================================================
+ */
+
+/* An encoded record is decoded here, since it is not as it was on its page */
+static char HF_dictRec[PF_MAX_PAGE_SIZE];
+
+/*
+ * Initializes a new, empty dictionary page of pageSize bytes, with
+ * no dictionary yet.
+ */
+void HF_InitDictPage(char *pageBuf, int pageSize) {
+    HF_DictHeader *header = (HF_DictHeader*)pageBuf;
+
+    header->page.kind = HF_DICT_PAGE;
+    header->page.numSlots = 0;
+    header->page.dataStart = pageSize;
+    header->page.freeBytes = pageSize - sizeof(HF_DictHeader);
+    header->page.numRecs = 0;
+    header->dictOffset = 0;
+    header->dictLen = 0;
+}
+
+/* Reads an unsigned short of a dictionary, which need not be aligned */
+static int HF_DictShort(const char *p) {
+    unsigned short v;
+
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/* The dictionary of a dictionary page, or NULL if it has none */
+static const char *HF_DictOf(char *pageBuf) {
+    HF_DictHeader *header = (HF_DictHeader*)pageBuf;
+
+    return (header->dictOffset != 0) ? pageBuf + header->dictOffset : NULL;
+}
+
+/* Value "code" of a dictionary; sets *len to its length */
+static const char *HF_DictValue(const char *dict, int code, int *len) {
+    int start = HF_DictShort(dict + 2 + 2 * code);
+
+    *len = HF_DictShort(dict + 4 + 2 * code) - start;
+    return dict + start;
+}
+
+/* Compares two values as byte strings, a prefix first */
+static int HF_DictCmp(const char *a, int lenA, const char *b, int lenB) {
+    int cmp = memcmp(a, b, lenA < lenB ? lenA : lenB);
+    return (cmp != 0) ? cmp : lenA - lenB;
+}
+
+/*
+ * The code of a value in the dictionary of a page, or -1 if it is
+ * not in it. The values are in order, so it is a binary search.
+ */
+static int HF_DictCode(char *pageBuf, const char *value, int len) {
+    const char *dict = HF_DictOf(pageBuf);
+
+    if (dict == NULL) {
+        return -1;
+    }
+    int lo = 0, hi = HF_DictShort(dict) - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2, valueLen;
+        const char *v = HF_DictValue(dict, mid, &valueLen);
+        int cmp = HF_DictCmp(v, valueLen, value, len);
+        if (cmp == 0) {
+            return mid;
+        }
+        if (cmp < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Decodes an encoded record of len bytes of a dictionary page into
+ * "out", which has room for "room" bytes. Returns the record's
+ * length, or -1 if it does not fit.
+ */
+static int HF_DictDecode(char *pageBuf, const char *rec, int len, char *out, int room) {
+    const char *dict = HF_DictOf(pageBuf);
+    int n = 0;
+
+    if (len > room) {
+        return -1;
+    }
+    for (int i = 0; i < len; i++) {
+        // A code starts a field: it is at the start, or after a separator
+        if (rec[i] == HF_DICT_ESC && (i == 0 || rec[i - 1] == HF_FIELD_SEP)) {
+            int valueLen;
+            const char *value = HF_DictValue(dict, (unsigned char)rec[i + 1], &valueLen);
+            if (n + valueLen + len - i - 2 > room) {
+                return -1;
+            }
+            memcpy(out + n, value, valueLen);
+            n += valueLen;
+            i++;
+        } else {
+            out[n++] = rec[i];
+        }
+    }
+    return n;
+}
+
+/*
+ * Finds value "field" (from 0) of an encoded record, as HF_FindField
+ * does: sets *value to it, and *code to its code, or to -1 if it is
+ * not one of the dictionary's. Returns its length, or -1 if the record
+ * has no such field.
+ */
+static int HF_DictField(char *pageBuf, const char *rec, int len, int field,
+                        const char **value, int *code) {
+    int i = 0;
+
+    for (; field > 0; field--) {
+        // Fields are short, so they are walked through rather than memchr'ed
+        if (i < len && rec[i] == HF_DICT_ESC) {
+            i += 2;
+        } else {
+            while (i < len && rec[i] != HF_FIELD_SEP) {
+                i++;
+            }
+        }
+        if (i >= len) {
+            return -1;
+        }
+        i++;    // the separator
+    }
+    if (i < len && rec[i] == HF_DICT_ESC) {
+        int valueLen;
+        *code = (unsigned char)rec[i + 1];
+        *value = HF_DictValue(HF_DictOf(pageBuf), *code, &valueLen);
+        return valueLen;
+    }
+    *code = -1;
+    *value = rec + i;
+    const char *end = memchr(rec + i, HF_FIELD_SEP, len - i);
+    return (end != NULL) ? (int)(end - (rec + i)) : len - i;
+}
+
+/* A field value of the records of a page, as HF_Page_Encode counts them */
+typedef struct {
+    const char *value;  // The value, in the records put together
+    int len;        // Its length
+    int count;      // How many fields have it
+    int code;       // Its code in the new dictionary, or -1
+} HF_DictEntry;
+
+static int HF_DictSavedCmp(const void *a, const void *b) {
+    // Most bytes saved first
+    const HF_DictEntry *x = *(HF_DictEntry* const*)a, *y = *(HF_DictEntry* const*)b;
+    int savedX = x->count * (x->len - 2) - (x->len + 2);
+    int savedY = y->count * (y->len - 2) - (y->len + 2);
+    return savedY - savedX;
+}
+
+static int HF_DictValueCmp(const void *a, const void *b) {
+    const HF_DictEntry *x = *(HF_DictEntry* const*)a, *y = *(HF_DictEntry* const*)b;
+    return HF_DictCmp(x->value, x->len, y->value, y->len);
+}
+
+/*
+ * Scratch space of HF_Page_Encode, kept from one call to the next:
+ * the page it makes and a record it encodes, which fit in the largest
+ * dictionary page, and the records put together, where each starts,
+ * and the hash table of their values and the values chosen, which
+ * grow as pages need.
+ */
+static char HF_dictPage[HF_DICT_MAX_SIZE];
+static char HF_dictEnc[HF_DICT_MAX_SIZE];
+static char *HF_dictRecs = NULL;
+static int HF_dictRecsCap = 0;
+static int *HF_dictStarts = NULL;
+static int HF_dictStartsCap = 0;
+static HF_DictEntry *HF_dictTable = NULL;
+static HF_DictEntry **HF_dictChosen = NULL;
+static int HF_dictTableCap = 0;
+
+/*
+ * Grows buf, of *cap elements of "size" bytes, to hold at least n,
+ * doubling it. Returns the buffer, or NULL with PFerrno set if there
+ * is no memory, buf being left as it was.
+ */
+static void *HF_DictGrow(void *buf, int *cap, int n, size_t size) {
+    if (n <= *cap) {
+        return buf;
+    }
+    int max = (*cap == 0) ? 16 : *cap;
+    while (max < n) {
+        max *= 2;
+    }
+    void *more = realloc(buf, max * size);
+    if (more == NULL) {
+        PFerrno = PFE_NOMEM;
+        return NULL;
+    }
+    *cap = max;
+    return more;
+}
+
+/* Finds the entry of a value in the hash table of HF_Page_Encode */
+static HF_DictEntry *HF_DictLookup(HF_DictEntry *table, int size,
+                                   const char *value, int len) {
+    unsigned h = 2166136261u;
+    for (int k = 0; k < len; k++) {
+        h = (h ^ (unsigned char)value[k]) * 16777619u;
+    }
+    for (int k = h & (size - 1); ; k = (k + 1) & (size - 1)) {
+        if (table[k].len < 0 ||
+                (table[k].len == len && memcmp(table[k].value, value, len) == 0)) {
+            return &table[k];
+        }
+    }
+}
+
+/*
+ * Tells whether a record has a field starting with HF_DICT_ESC, which
+ * would be taken for a code: such a record is never encoded.
+ */
+static int HF_DictPlain(const char *rec, int len) {
+    for (int k = 0; k < len; k++) {
+        if (rec[k] == HF_DICT_ESC && (k == 0 || rec[k - 1] == HF_FIELD_SEP)) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/* Tells whether the slot length of a record says HF_Page_Encode may encode it */
+static int HF_DictEncodable(int length) {
+    return length != HF_SLOT_FREE && length != HF_SLOT_FORWARD &&
+        !(length & (HF_SLOT_MOVED | HF_SLOT_LONG));
+}
+
+/*
+ * Encodes the records of a dictionary page of pageSize bytes with a
+ * new dictionary: the values of at least 3 bytes that save the most
+ * bytes by being stored once, HF_DICT_MAX_VALUES at most. Records
+ * that were encoded are decoded first. The page is left as it was
+ * unless this gains free space. Slot numbers do not change.
+ *
+ * Returns the number of bytes of free space gained, or a PF error
+ * code if there is no memory.
+ */
+int HF_Page_Encode(char *pageBuf, int pageSize) {
+    if (!HF_IsDictPage(pageBuf)) {
+        return 0;
+    }
+    int numSlots = HF_NumSlots(pageBuf);
+    int oldFree = HF_GetPageHeader2(pageBuf)->freeBytes;
+
+    // 1. Put the records that may be encoded together, decoded
+    int used = 0, numFields = 0;
+    char *recs;
+    int *starts;
+    if ((recs = HF_DictGrow(HF_dictRecs, &HF_dictRecsCap, 2 * pageSize, 1)) == NULL) {
+        return PFerrno;
+    }
+    HF_dictRecs = recs;
+    if ((starts = HF_DictGrow(HF_dictStarts, &HF_dictStartsCap, numSlots + 1,
+                              sizeof(int))) == NULL) {
+        return PFerrno;
+    }
+    HF_dictStarts = starts;
+    for (int i = 0; i < numSlots; i++) {
+        int length = HF_SlotLength(pageBuf, i);
+        char *rec = pageBuf + HF_SlotOffset(pageBuf, i);
+        int len = HF_SlotBytes(length);
+        starts[i] = used;
+        if (!HF_DictEncodable(length)) {
+            continue;
+        }
+        if ((recs = HF_DictGrow(HF_dictRecs, &HF_dictRecsCap, used + pageSize, 1)) == NULL) {
+            return PFerrno;
+        }
+        HF_dictRecs = recs;
+        if (length & HF_SLOT_DICT) {
+            len = HF_DictDecode(pageBuf, rec, len, recs + used, pageSize);
+        } else {
+            memcpy(recs + used, rec, len);
+        }
+        for (int k = 0; k < len; k++) {
+            numFields += (recs[used + k] == HF_FIELD_SEP);
+        }
+        numFields++;
+        used += len;
+    }
+    starts[numSlots] = used;
+
+    // 2. Count the values of their fields, but for those of a record
+    //    with a field starting with HF_DICT_ESC, which is left as it is
+    int size = 16;
+    while (size < 2 * numFields) {
+        size *= 2;
+    }
+    if (size > HF_dictTableCap) {
+        int tableCap = HF_dictTableCap, chosenCap = HF_dictTableCap;
+        HF_DictEntry *table = HF_DictGrow(HF_dictTable, &tableCap, size, sizeof(HF_DictEntry));
+        if (table == NULL) {
+            return PFerrno;
+        }
+        HF_dictTable = table;
+        HF_DictEntry **chosen = HF_DictGrow(HF_dictChosen, &chosenCap, size,
+                                            sizeof(HF_DictEntry*));
+        if (chosen == NULL) {
+            return PFerrno;
+        }
+        HF_dictChosen = chosen;
+        HF_dictTableCap = tableCap;
+    }
+    HF_DictEntry *table = HF_dictTable, **chosen = HF_dictChosen;
+    for (int k = 0; k < size; k++) {
+        table[k].len = -1;
+    }
+    int numValues = 0;
+    for (int i = 0; i < numSlots; i++) {
+        const char *rec = recs + starts[i];
+        int len = starts[i + 1] - starts[i];
+        if (!HF_DictEncodable(HF_SlotLength(pageBuf, i)) || HF_DictPlain(rec, len)) {
+            continue;
+        }
+        for (int k = 0; k <= len; ) {
+            const char *end = memchr(rec + k, HF_FIELD_SEP, len - k);
+            int valueLen = (end != NULL) ? (int)(end - (rec + k)) : len - k;
+            if (valueLen >= 3 && valueLen <= 255) {
+                HF_DictEntry *e = HF_DictLookup(table, size, rec + k, valueLen);
+                if (e->len < 0) {
+                    e->value = rec + k;
+                    e->len = valueLen;
+                    e->count = 0;
+                    e->code = -1;
+                    chosen[numValues++] = e;
+                }
+                e->count++;
+            }
+            k += valueLen + 1;
+        }
+    }
+
+    // 3. The dictionary: the values that save the most, in order
+    qsort(chosen, numValues, sizeof(HF_DictEntry*), HF_DictSavedCmp);
+    int numCodes = 0, dictLen = 4;
+    while (numCodes < numValues && numCodes < HF_DICT_MAX_VALUES &&
+           chosen[numCodes]->count * (chosen[numCodes]->len - 2) >
+           chosen[numCodes]->len + 2) {
+        dictLen += 2 + chosen[numCodes]->len;
+        numCodes++;
+    }
+    qsort(chosen, numCodes, sizeof(HF_DictEntry*), HF_DictValueCmp);
+    for (int code = 0; code < numCodes; code++) {
+        chosen[code]->code = code;
+    }
+    if (numCodes == 0) {
+        dictLen = 0;
+    }
+
+    // 4. The page made anew: each record encoded if it has a value of
+    //    the dictionary, the others as they were, then the dictionary
+    char *newPage = HF_dictPage;
+    int headerBytes = HF_SlotsEnd(pageBuf, numSlots);
+    memcpy(newPage, pageBuf, headerBytes);
+    HF_DictHeader *header = (HF_DictHeader*)newPage;
+    header->page.freeBytes = pageSize - headerBytes;
+    header->page.numRecs = 0;
+    for (int i = 0; i < numSlots; i++) {
+        HF_GetSlotArray2(newPage)[i].length = HF_SLOT2_FREE;
+    }
+    int end = pageSize, fits = TRUE;
+    for (int i = 0; i < numSlots && fits; i++) {
+        int length = HF_SlotLength(pageBuf, i);
+        const char *rec = pageBuf + HF_SlotOffset(pageBuf, i);
+        int len = HF_SlotBytes(length);
+        if (length == HF_SLOT_FREE) {
+            continue;
+        }
+        char *enc = HF_dictEnc;
+        if (HF_DictEncodable(length)) {
+            rec = recs + starts[i];
+            len = starts[i + 1] - starts[i];
+            length = len;
+            int n = 0, codes = 0;
+            int plain = (numCodes == 0 || HF_DictPlain(rec, len));
+            for (int k = 0; k <= len && !plain; ) {
+                const char *sep = memchr(rec + k, HF_FIELD_SEP, len - k);
+                int valueLen = (sep != NULL) ? (int)(sep - (rec + k)) : len - k;
+                HF_DictEntry *e = (valueLen >= 3 && valueLen <= 255) ?
+                    HF_DictLookup(table, size, rec + k, valueLen) : NULL;
+                if (k > 0) {
+                    enc[n++] = HF_FIELD_SEP;
+                }
+                if (e != NULL && e->code >= 0) {
+                    enc[n++] = HF_DICT_ESC;
+                    enc[n++] = e->code;
+                    codes++;
+                } else {
+                    memcpy(enc + n, rec + k, valueLen);
+                    n += valueLen;
+                }
+                k += valueLen + 1;
+            }
+            if (codes > 0) {
+                rec = enc;
+                len = n;
+                length = n | HF_SLOT_DICT;
+            }
+        }
+        // Decoded, a record left plain may take more room than it did
+        fits = (end - len >= headerBytes + dictLen);
+        if (fits) {
+            end -= len;
+            memcpy(newPage + end, rec, len);
+            HF_SetSlot(newPage, i, end, length);
+        }
+    }
+    int gained = -1;
+    if (fits) {
+        header->dictOffset = 0;
+        header->dictLen = dictLen;
+        if (numCodes > 0) {
+            end -= dictLen;
+            char *dict = newPage + end;
+            unsigned short offset = 4 + 2 * numCodes;
+            memcpy(dict, &(unsigned short){ numCodes }, 2);
+            for (int code = 0; code < numCodes; code++) {
+                memcpy(dict + 2 + 2 * code, &offset, 2);
+                memcpy(dict + offset, chosen[code]->value, chosen[code]->len);
+                offset += chosen[code]->len;
+            }
+            memcpy(dict + 2 + 2 * numCodes, &offset, 2);
+            header->dictOffset = end;
+        }
+        header->page.dataStart = end;
+        header->page.freeBytes -= dictLen;
+        gained = header->page.freeBytes - oldFree;
+    }
+    if (gained > 0) {
+        memcpy(pageBuf, newPage, pageSize);
+    }
+    return (gained > 0) ? gained : 0;
+}
+
+/*
+ * ======================================================
+ * Slotted Page Implementation
+ * ======================================================
+ */
+
+/*
+ * Initializes a new, empty slotted page of pageSize bytes, of the
+ * first format, whose header and slots are ints.
+ */
+void HF_InitPage1(char *pageBuf, int pageSize) {
+    HF_PageHeader *header = HF_GetPageHeader(pageBuf);
+    
+    // This page has no records yet
+    header->numSlots = 0; 
+    
+    // The data heap starts at the very end of the page
+    // and grows "backward" (towards the front)
+    header->dataStartPtr = pageSize;
+}
+
+/*
+ * Initializes a new, empty slotted page of pageSize bytes.
  * This is called by the PF layer right after allocating a new page.
+ * The page is of format 2 if its offsets fit in a short.
+ */
+void HF_InitPage(char *pageBuf, int pageSize) {
+    if (pageSize > HF_PAGE2_MAX_SIZE) {
+        HF_InitPage1(pageBuf, pageSize);
+        return;
+    }
+    HF_PageHeader2 *header = HF_GetPageHeader2(pageBuf);
+    header->kind = HF_PAGE2;
+    header->numSlots = 0;
+    header->dataStart = pageSize;
+    header->freeBytes = pageSize - sizeof(HF_PageHeader2);
+    header->numRecs = 0;
+}
+
+/*
+ * Inserts a new record onto the page.
+ * The slot of a deleted record is reused if there is one.
+ * Returns the new slot number if successful.
+ * Returns an error code if it fails.
+ */
+int HF_Page_InsertRec(char *pageBuf, char *record, int recLen) {
+    if (HF_IsFixedPage(pageBuf)) {
+        return HF_FixedInsertRec(pageBuf, record, recLen);
+    }
+    if (!HF_IsSlottedPage(pageBuf)) {
+        return HFE_PAGENOFREE;  // an overflow page takes no records
+    }
+    int numSlots = HF_NumSlots(pageBuf);
+    
+    // 1. Calculate the end of the slot array
+    int slotArrayEnd = HF_SlotsEnd(pageBuf, numSlots);
+    
+    // 2. Calculate the available free space
+    //    (Space between the data heap and the slot array)
+    int freeSpace = HF_DataStart(pageBuf) - slotArrayEnd;
+    
+    // 3. Look for a free slot to reuse (no use if even the data does not
+    //    fit, and none to find if a format 2 page has every slot in use)
+    int newSlotNum = numSlots;
+    if (!HF_IsPage2(pageBuf) || HF_GetPageHeader2(pageBuf)->numRecs < numSlots) {
+        for (int i = 0; i < numSlots && freeSpace >= recLen; i++) {
+            if (HF_SlotLength(pageBuf, i) == HF_SLOT_FREE) {
+                newSlotNum = i;
+                break;
+            }
+        }
+    }
+
+    // 4. Calculate space needed for this new record
+    //    (The record's data + one new slot entry, unless one is reused)
+    int spaceNeeded = recLen;
+    if (newSlotNum == numSlots) {
+        spaceNeeded += HF_SlotsEnd(pageBuf, numSlots + 1) - slotArrayEnd;
+    }
+
+    // 5. Check if there is enough space
+    if (freeSpace < spaceNeeded) {
+        // Not enough free space on this page
+        return HFE_PAGENOFREE;
+    }
+    
+    // --- We have enough space, so let's insert ---
+
+    // 6. Find the new record's destination
+    //    (Move the data pointer "back" by recLen)
+    int dataStart = HF_DataStart(pageBuf) - recLen;
+    HF_SetDataStart(pageBuf, dataStart);
+    
+    // 7. Copy the record data into the data heap
+    memcpy(pageBuf + dataStart, record, recLen);
+    
+    // 8. Update the header, then the slot's info
+    if (newSlotNum == numSlots) {
+        HF_SetNumSlots(pageBuf, numSlots + 1);
+    }
+    HF_SetSlot(pageBuf, newSlotNum, dataStart, recLen);
+    
+    // Return the slot number where we inserted the record
+    return newSlotNum;
+}
+
+/*
+ * Deletes a record from the page, given its slot number.
+ *
+ * This is a "lazy" delete: it marks the slot as free by setting
+ * its length to -1, so the slots (and RIDs) of the other records
+ * stay the same. The record's bytes are given back at once only
+ * if it is the lowest one in the data heap, and free slots at the
+ * end of the slot array are dropped. Otherwise the space is
+ * reclaimed by HF_Page_Compact.
+ */
+int HF_Page_DeleteRec(char *pageBuf, int slotNum) {
+    if (HF_IsFixedPage(pageBuf)) {
+        return HF_FixedDeleteRec(pageBuf, slotNum);
+    }
+    int numSlots = HF_NumSlots(pageBuf);
+
+    // 1. Check if the slot number is valid
+    if (slotNum < 0 || slotNum >= numSlots) {
+        return HFE_INVALIDSLOT;
+    }
+
+    // 2. Check if it's already deleted
+    int length = HF_SlotLength(pageBuf, slotNum);
+    if (length == HF_SLOT_FREE) {
+        return HFE_INVALIDSLOT;
+    }
+
+    // 3. "Delete" the record by invalidating its slot
+    int offset = HF_SlotOffset(pageBuf, slotNum);
+    if (offset == HF_DataStart(pageBuf)) {
+        HF_SetDataStart(pageBuf, offset + HF_SlotBytes(length));
+    }
+    HF_SetSlot(pageBuf, slotNum, offset, HF_SLOT_FREE);
+
+    // 4. Drop free slots at the end of the array
+    while (numSlots > 0 && HF_SlotLength(pageBuf, numSlots - 1) == HF_SLOT_FREE) {
+        numSlots--;
+    }
+    HF_SetNumSlots(pageBuf, numSlots);
+
+    return HFE_OK;
+}
+
+/*
+ * Free bytes on a page of pageSize bytes, counting the space of
+ * deleted records (which HF_Page_Compact reclaims) as well as the
+ * space between the slot array and the data heap. A format 2 page
+ * keeps the count in its header.
+ */
+int HF_Page_FreeBytes(char *pageBuf, int pageSize) {
+    if (HF_IsFixedPage(pageBuf)) {
+        return HF_FixedFreeBytes(pageBuf, pageSize);
+    }
+    if (HF_IsPage2(pageBuf)) {
+        return HF_GetPageHeader2(pageBuf)->freeBytes;
+    }
+    if (!HF_IsSlottedPage(pageBuf)) {
+        return 0;   // an overflow page
+    }
+
+    HF_PageHeader *header = HF_GetPageHeader(pageBuf);
+    HF_SlotEntry *slotArray = HF_GetSlotArray(pageBuf);
+    int freeBytes = pageSize -
+        (int)(sizeof(HF_PageHeader) + header->numSlots * sizeof(HF_SlotEntry));
+    for (int i = 0; i < header->numSlots; i++) {
+        freeBytes -= HF_SlotBytes(slotArray[i].length);
+    }
+    return freeBytes;
+}
+
+/* A live record, as HF_Page_Compact moves it */
+typedef struct {
+    int offset;
+    int slotNum;
+} HF_LiveRec;
+
+static int HF_LiveRecCmp(const void *a, const void *b) {
+    // Highest offset first
+    return ((const HF_LiveRec*)b)->offset - ((const HF_LiveRec*)a)->offset;
+}
+
+/*
+ * Compacts a page of pageSize bytes: moves the live records up
+ * against the end of the page, so the space of deleted records
+ * joins the free space in the middle. Slot numbers do not change.
+ * The dictionary of a dictionary page moves with the records, and
+ * goes when the page has none. Fixed pages need no compacting.
+ *
+ * Returns the number of bytes of free space gained.
+ */
+int HF_Page_Compact(char *pageBuf, int pageSize) {
+    int oldStart = HF_DataStart(pageBuf);
+    int numSlots = HF_NumSlots(pageBuf);
+    int nlive = 0;
+
+    if (HF_IsFixedPage(pageBuf)) {
+        return 0;
+    }
+    if (numSlots <= 0) {
+        if (HF_IsDictPage(pageBuf)) {
+            int oldFree = HF_GetPageHeader2(pageBuf)->freeBytes;
+            HF_InitDictPage(pageBuf, pageSize);
+            return HF_GetPageHeader2(pageBuf)->freeBytes - oldFree;
+        }
+        HF_SetDataStart(pageBuf, pageSize);
+        return pageSize - oldStart;
+    }
+
+    // The dictionary, if any, is a live "record" of slot -1
+    HF_LiveRec live[numSlots + 1];
+    if (HF_IsDictPage(pageBuf) && HF_DictOf(pageBuf) != NULL) {
+        live[nlive].offset = ((HF_DictHeader*)pageBuf)->dictOffset;
+        live[nlive].slotNum = -1;
+        nlive++;
+    }
+    for (int i = 0; i < numSlots; i++) {
+        if (HF_SlotLength(pageBuf, i) != HF_SLOT_FREE) {
+            live[nlive].offset = HF_SlotOffset(pageBuf, i);
+            live[nlive].slotNum = i;
+            nlive++;
+        }
+    }
+    qsort(live, nlive, sizeof(HF_LiveRec), HF_LiveRecCmp);
+
+    // Going down the page, each record only ever moves up
+    int end = pageSize;
+    for (int i = 0; i < nlive; i++) {
+        if (live[i].slotNum < 0) {
+            HF_DictHeader *header = (HF_DictHeader*)pageBuf;
+            end -= header->dictLen;
+            memmove(pageBuf + end, pageBuf + live[i].offset, header->dictLen);
+            header->dictOffset = end;
+            continue;
+        }
+        int length = HF_SlotLength(pageBuf, live[i].slotNum);
+        end -= HF_SlotBytes(length);
+        if (end != live[i].offset) {
+            memmove(pageBuf + end, pageBuf + live[i].offset, HF_SlotBytes(length));
+            HF_SetSlot(pageBuf, live[i].slotNum, end, length);
+        }
+    }
+    HF_SetDataStart(pageBuf, end);
+    return end - oldStart;
+}
+
+
+/*
+ * Retrieves a specific record from a page. An encoded record of a
+ * dictionary page is decoded into a buffer of the HF layer, which
+ * the next one overwrites.
+ *
+ * Inputs:
+ * pageBuf: Pointer to the page data
+ * slotNum: The slot of the record to retrieve
+ *
+ * Outputs:
+ * record: A pointer to the record data *within the page buffer*
+ * recLen: The length of the record
+ *
+ * Returns:
+ * HFE_OK if successful
+ * HFE_INVALIDSLOT if the slot is invalid or deleted
+ * HFE_FORWARDED if the slot is a forwarding stub; record then
+ * points to the RID of the record's new place
+ * HFE_LONGREC if the slot holds a long record; record then points
+ * to its HF_LongRec
+ */
+int HF_Page_GetRec(char *pageBuf, int slotNum, char **record, int *recLen) {
+    if (HF_IsFixedPage(pageBuf)) {
+        return HF_FixedGetRec(pageBuf, slotNum, record, recLen);
+    }
+
+    // 1. Check if the slot number is valid
+    if (slotNum < 0 || slotNum >= HF_NumSlots(pageBuf)) {
+        return HFE_INVALIDSLOT;
+    }
+
+    // 2. Check if the slot is deleted
+    int length = HF_SlotLength(pageBuf, slotNum);
+    if (length == HF_SLOT_FREE) {
+        return HFE_INVALIDSLOT;
+    }
+
+    // 3. Set the output pointers
+    *record = pageBuf + HF_SlotOffset(pageBuf, slotNum);
+    *recLen = HF_SlotBytes(length);
+    if (length == HF_SLOT_FORWARD) {
+        return HFE_FORWARDED;
+    }
+    if (length & HF_SLOT_DICT) {
+        // An encoded record is decoded into HF_dictRec
+        *recLen = HF_DictDecode(pageBuf, *record, *recLen, HF_dictRec, PF_MAX_PAGE_SIZE);
+        *record = HF_dictRec;
+    }
+    if (length & HF_SLOT_MOVED) {
+        // Skip the home RID in front of a moved record
+        *record += sizeof(RID);
+        *recLen -= sizeof(RID);
+    }
+    if (length & HF_SLOT_LONG) {
+        return HFE_LONGREC;
+    }
+
+    return HFE_OK;
+}
+
+
+/*
+ * Scans the page for the next valid record.
+ *
+ * Inputs:
+ * pageBuf: Pointer to the page data
+ * currentSlotNum: The slot number to *start scanning from*
+ * (pass -1 to start from the beginning)
+ *
+ * Outputs:
+ * record: A pointer to the next record's data (for a long record,
+ * to its HF_LongRec, as HF_Page_GetRec gives it)
+ * recLen: The length of the next record
+ *
+ * Returns:
+ * The slot number of the record found.
+ * HFE_EOF if no more valid records are found.
+ */
+int HF_Page_GetNextRec(char *pageBuf, int currentSlotNum, char **record, int *recLen) {
+    if (HF_IsFixedPage(pageBuf)) {
+        return HF_FixedGetNextRec(pageBuf, currentSlotNum, record, recLen);
+    }
+    int numSlots = HF_NumSlots(pageBuf);
+
+    // 1. Start scanning from the *next* slot
+    for (int i = currentSlotNum + 1; i < numSlots; i++) {
+        
+        // 2. Check if this slot is valid (not deleted). Forwarding
+        //    stubs are skipped: their records are found where they are.
+        int length = HF_SlotLength(pageBuf, i);
+        if (length != HF_SLOT_FREE && length != HF_SLOT_FORWARD) {
+            
+            // 3. Found a valid record. Set output pointers.
+            HF_Page_GetRec(pageBuf, i, record, recLen);
+            
+            // 4. Return the slot number we found it in
+            return i;
+        }
+    }
+
+    // 5. No more valid records were found on this page
+    return HFE_EOF;
+}
+
+/*
+ * Rewrites the record in a slot of a page of pageSize bytes:
+ * in place if it is no longer than before, otherwise in the free
+ * space, compacting the page if need be. A forwarding stub becomes
+ * an ordinary record; a moved record stays marked as moved.
+ * The new record must not be in the page itself.
+ *
+ * Returns:
+ * HFE_OK if successful
+ * HFE_PAGENOFREE if it does not fit (the page is unchanged)
+ * HFE_INVALIDSLOT if the slot is invalid or deleted
+ * HFE_RECLEN if a fixed page has records of another length
+ */
+int HF_Page_UpdateRec(char *pageBuf, int pageSize, int slotNum,
+                      char *record, int recLen) {
+    if (HF_IsFixedPage(pageBuf)) {
+        return HF_FixedUpdateRec(pageBuf, slotNum, record, recLen);
+    }
+
+    if (slotNum < 0 || slotNum >= HF_NumSlots(pageBuf) ||
+            HF_SlotLength(pageBuf, slotNum) == HF_SLOT_FREE) {
+        return HFE_INVALIDSLOT;
+    }
+    int length = HF_SlotLength(pageBuf, slotNum);
+    int offset = HF_SlotOffset(pageBuf, slotNum);
+    int oldBytes = HF_SlotBytes(length);
+    int moved = (length != HF_SLOT_FORWARD) ? (length & HF_SLOT_MOVED) : 0;
+
+    if (recLen > oldBytes) {
+        int gap = HF_DataStart(pageBuf) - HF_SlotsEnd(pageBuf, HF_NumSlots(pageBuf));
+        if (gap < recLen) {
+            // Only fits if the old record and any dead space are reclaimed
+            if (HF_Page_FreeBytes(pageBuf, pageSize) + oldBytes < recLen) {
+                return HFE_PAGENOFREE;
+            }
+            HF_SetSlot(pageBuf, slotNum, offset, HF_SLOT_FREE);
+            HF_Page_Compact(pageBuf, pageSize);
+        }
+        offset = HF_DataStart(pageBuf) - recLen;
+        HF_SetDataStart(pageBuf, offset);
+    }
+    memmove(pageBuf + offset, record, recLen);
+    HF_SetSlot(pageBuf, slotNum, offset, recLen | moved);
+    return HFE_OK;
+}
+
+/*
+ * If the record in a slot was moved there from its home slot,
+ * sets *home to the RID of the home slot and returns TRUE.
+ */
+static int HF_PageHomeRID(char *pageBuf, int slotNum, RID *home) {
+    if (HF_IsFixedPage(pageBuf)) {
+        return FALSE;
+    }
+    int length = HF_SlotLength(pageBuf, slotNum);
+    if (length == HF_SLOT_FREE || length == HF_SLOT_FORWARD || !(length & HF_SLOT_MOVED)) {
+        return FALSE;
+    }
+    memcpy(home, pageBuf + HF_SlotOffset(pageBuf, slotNum), sizeof(RID));
+    return TRUE;
+}
+
+/*
+ * Rewrites the record in a slot, as HF_Page_UpdateRec does. If the
+ * page is "held" (see HF_HoldPage), records on it must stay where
+ * they are: one that only fits if the page is compacted gets
+ * HFE_PAGENOFREE instead.
+ */
+static int HF_PageUpdate(char *pageBuf, int pageSize, int slotNum,
+                         char *record, int recLen, int held) {
+    if (held && !HF_IsFixedPage(pageBuf) && HF_IsSlottedPage(pageBuf) &&
+            slotNum >= 0 && slotNum < HF_NumSlots(pageBuf) &&
+            HF_SlotLength(pageBuf, slotNum) != HF_SLOT_FREE &&
+            recLen > HF_SlotBytes(HF_SlotLength(pageBuf, slotNum)) &&
+            recLen > HF_DataStart(pageBuf) - HF_SlotsEnd(pageBuf, HF_NumSlots(pageBuf))) {
+        return HFE_PAGENOFREE;
+    }
+    return HF_Page_UpdateRec(pageBuf, pageSize, slotNum, record, recLen);
+}
+
+/*
+ * Turns a slot into a forwarding stub to the record at "target".
+ * Returns HFE_OK, or HFE_PAGENOFREE if there is no room for it.
+ */
+static int HF_PageSetForward(char *pageBuf, int pageSize, int slotNum, RID target,
+                             int held) {
+    int error = HF_PageUpdate(pageBuf, pageSize, slotNum,
+                              (char*)&target, sizeof(RID), held);
+    if (error == HFE_OK) {
+        HF_SetSlot(pageBuf, slotNum, HF_SlotOffset(pageBuf, slotNum), HF_SLOT_FORWARD);
+    }
+    return error;
+}
+
+/*
+ * Inserts a record on a page of pageSize bytes, or'ing "flags" into
+ * the length in its slot, compacting the page first if the record
+ * only fits in the space of deleted records. A dictionary page is
+ * encoded anew when it is full, or this record leaves it too full
+ * for another like it. A "held" page (see HF_HoldPage) is neither
+ * compacted nor encoded. Returns the slot number, or HFE_PAGENOFREE.
+ */
+static int HF_PageInsert(char *pageBuf, int pageSize, char *record, int recLen, int flags,
+                         int held) {
+    int slotNum = HF_Page_InsertRec(pageBuf, record, recLen);
+
+    if (held) {
+        if (slotNum >= 0 && flags) {
+            HF_SlotAddFlags(pageBuf, slotNum, flags);
+        }
+        return slotNum;
+    }
+    if (slotNum == HFE_PAGENOFREE &&
+            HF_Page_FreeBytes(pageBuf, pageSize) >= recLen + HF_SlotSize(pageBuf)) {
+        HF_Page_Compact(pageBuf, pageSize);
+        slotNum = HF_Page_InsertRec(pageBuf, record, recLen);
+    }
+    if (slotNum == HFE_PAGENOFREE && HF_IsDictPage(pageBuf) &&
+            HF_Page_Encode(pageBuf, pageSize) > 0) {
+        slotNum = HF_Page_InsertRec(pageBuf, record, recLen);
+    }
+    if (slotNum >= 0 && flags) {
+        HF_SlotAddFlags(pageBuf, slotNum, flags);
+    }
+    if (slotNum >= 0 && HF_IsDictPage(pageBuf) &&
+            HF_Page_FreeBytes(pageBuf, pageSize) < recLen + (int)sizeof(HF_SlotEntry2)) {
+        HF_Page_Encode(pageBuf, pageSize);
+    }
+    return slotNum;
+}
+
+/*
+ * ======================================================
+ * Free-Space Map (FSM) Implementation
+ * ======================================================
+ */
+
+/* Returned by HF_FsmFind for files created before FSM pages existed */
+#define HF_NOFSM 1
+
+/*
+ * Initializes an empty FSM page: every page it covers is full.
+ */
+static void HF_FsmInitPage(char *pageBuf, int pageSize) {
+    HF_FsmHeader *fsm = (HF_FsmHeader*)pageBuf;
+
+    fsm->numSlots = HF_FSM_PAGE;
+    fsm->nextFsmPage = -1;
+    fsm->hint = 0;
+    fsm->recLen = 0;
+    memset(&fsm->pax, 0, sizeof(fsm->pax));
+    memset(pageBuf + sizeof(HF_FsmHeader), 0, HF_FsmEntries(pageSize));
+}
+
+/*
+ * Finds a page that the FSM says has at least "want" units of free
+ * space. Sets *pagenum to it, or to -1 if there is none.
+ *
+ * Returns HFE_OK, HF_NOFSM if page 0 is not an FSM page, or a PF
+ * error code.
+ */
+static int HF_FsmFind(int fd, int want, int *pagenum) {
+    int perFsm = HF_FsmEntries(PF_GetPageSize(fd));
+    int fsmPage = 0;    /* page number of the FSM page being looked at */
+    int k;              /* ... which is the k-th one */
+    char *fsmBuf;
+    int error;
+
+    for (k = 0; fsmPage != -1; k++) {
+        if ((error = PF_GetThisPage(fd, fsmPage, &fsmBuf)) != PFE_OK) {
+            if (k == 0 && error == PFE_INVALIDPAGE)
+                return HF_NOFSM;    // empty file
+            return error;
+        }
+        HF_FsmHeader *fsm = (HF_FsmHeader*)fsmBuf;
+        if (fsm->numSlots != HF_FSM_PAGE) {
+            PF_UnfixPage(fd, fsmPage, FALSE);
+            return HF_NOFSM;
+        }
+        unsigned char *entry = (unsigned char*)fsmBuf + sizeof(HF_FsmHeader);
+
+        // Skip the full pages at the front for good
+        int hint = fsm->hint;
+        while (hint < perFsm && entry[hint] == 0)
+            hint++;
+        int dirty = (hint != fsm->hint);
+        fsm->hint = hint;
+
+        int i;
+        for (i = hint; i < perFsm && entry[i] < want; i++)
+            ;
+        int next = fsm->nextFsmPage;
+        if ((error = PF_UnfixPage(fd, fsmPage, dirty)) != PFE_OK)
+            return error;
+        if (i < perFsm) {
+            *pagenum = k * perFsm + i;
+            return HFE_OK;
+        }
+        fsmPage = next;
+    }
+    *pagenum = -1;
+    return HFE_OK;
+}
+
+/*
+ * Records in the FSM that page "pagenum" has "freeBytes" free,
+ * adding FSM pages to the chain if the page is past the ones there.
+ * Does nothing for files without an FSM.
+ */
+static int HF_FsmUpdate(int fd, int pagenum, int freeBytes) {
+    int pageSize = PF_GetPageSize(fd);
+    int perFsm = HF_FsmEntries(pageSize);
+    int fsmPage = 0;
+    char *fsmBuf, *newBuf;
+    int newPage;
+    int error;
+
+    if ((error = PF_GetThisPage(fd, fsmPage, &fsmBuf)) != PFE_OK)
+        return error;
+    if (((HF_FsmHeader*)fsmBuf)->numSlots != HF_FSM_PAGE)
+        return PF_UnfixPage(fd, fsmPage, FALSE);   // file has no FSM
+    for (int k = 0; k < pagenum / perFsm; k++) {
+        // Go to the next FSM page, adding it if need be
+        HF_FsmHeader *fsm = (HF_FsmHeader*)fsmBuf;
+        int dirty = FALSE;
+        if (fsm->nextFsmPage == -1) {
+            if ((error = PF_AllocPage(fd, &newPage, &newBuf)) != PFE_OK) {
+                PF_UnfixPage(fd, fsmPage, FALSE);
+                return error;
+            }
+            HF_FsmInitPage(newBuf, pageSize);
+            if ((error = PF_UnfixPage(fd, newPage, TRUE)) != PFE_OK)
+                return error;
+            fsm->nextFsmPage = newPage;
+            dirty = TRUE;
+        }
+        int next = fsm->nextFsmPage;
+        if ((error = PF_UnfixPage(fd, fsmPage, dirty)) != PFE_OK)
+            return error;
+        fsmPage = next;
+        if ((error = PF_GetThisPage(fd, fsmPage, &fsmBuf)) != PFE_OK)
+            return error;
+    }
+
+    HF_FsmHeader *fsm = (HF_FsmHeader*)fsmBuf;
+    unsigned char *entry = (unsigned char*)fsmBuf + sizeof(HF_FsmHeader);
+    int i = pagenum % perFsm;
+    entry[i] = freeBytes / HF_FsmUnit(pageSize);
+    if (entry[i] > 0 && i < fsm->hint)
+        fsm->hint = i;
+    return PF_UnfixPage(fd, fsmPage, TRUE);
+}
+
+/*
+ * Tells whether file fd starts with an FSM page.
+ * Returns TRUE, FALSE or a PF error code.
+ */
+static int HF_FsmPresent(int fd) {
+    char *pageBuf;
+    int error;
+
+    if ((error = PF_GetThisPage(fd, 0, &pageBuf)) != PFE_OK)
+        return (error == PFE_INVALIDPAGE) ? FALSE : error;
+    int present = (HF_GetPageHeader(pageBuf)->numSlots == HF_FSM_PAGE);
+    if ((error = PF_UnfixPage(fd, 0, FALSE)) != PFE_OK)
+        return error;
+    return present;
+}
+
+/* How the data pages of a file are laid out, as its page 0 says */
+typedef struct {
+    int recLen;             // record length of a fixed-length file, or 0
+    HF_PaxFields pax;       // fields of a PAX file (numFields 0 if not)
+    HF_ZoneRoot zones;      // zone map of any other (numFields 0 if none)
+} HF_Layout;
+
+/*
+ * Reads the layout of file fd: slotted pages (recLen 0), dictionary
+ * pages (recLen HF_DICT_FILE), fixed pages, or PAX pages, and its
+ * zone map if it has one. Returns HFE_OK or a PF error code.
+ */
+static int HF_GetLayout(int fd, HF_Layout *layout) {
+    char *pageBuf;
+    int error;
+
+    memset(layout, 0, sizeof(HF_Layout));
+    if ((error = PF_GetThisPage(fd, 0, &pageBuf)) != PFE_OK)
+        return (error == PFE_INVALIDPAGE) ? HFE_OK : error;
+    HF_FsmHeader *fsm = (HF_FsmHeader*)pageBuf;
+    if (fsm->numSlots == HF_FSM_PAGE) {
+        layout->recLen = fsm->recLen;
+        if (fsm->pax.numFields > 0)
+            layout->pax = fsm->pax;
+        else
+            layout->zones = fsm->zones;
+    }
+    return PF_UnfixPage(fd, 0, FALSE);
+}
+
+/* Initializes a new data page of a file with the given layout */
+static void HF_InitDataPage(char *pageBuf, int pageSize, HF_Layout *layout) {
+    if (layout->pax.numFields > 0) {
+        HF_PaxInitPage(pageBuf, pageSize, &layout->pax);
+    } else if (layout->recLen > 0) {
+        HF_InitFixedPage(pageBuf, pageSize, layout->recLen);
+    } else if (layout->recLen == HF_DICT_FILE && pageSize <= HF_DICT_MAX_SIZE) {
+        HF_InitDictPage(pageBuf, pageSize);
+    } else {
+        HF_InitPage(pageBuf, pageSize);
+    }
+}
+
+/* Length of the longest record kept in its slot in a file with the given layout */
+static int HF_LayoutMaxInline(HF_Layout *layout, int pageSize) {
+    return (layout->recLen == HF_DICT_FILE) ? HF_DictMaxInline(pageSize)
+                                            : HF_MaxInline(pageSize);
+}
+
+/*
+ * Units of free space (see HF_FsmUnit) that a page of a file with the
+ * given layout needs for a record of recLen bytes kept in its slot,
+ * with a slot of the format of the file's new pages (see HF_InitPage).
+ */
+static int HF_FsmWant(HF_Layout *layout, int pageSize, int recLen) {
+    int unit = HF_FsmUnit(pageSize);
+    int slotSize = (pageSize <= HF_PAGE2_MAX_SIZE) ? (int)sizeof(HF_SlotEntry2)
+                                                    : (int)sizeof(HF_SlotEntry);
+
+    if (layout->recLen > 0) {
+        return 1;   // any page with a free row
+    }
+    return (recLen + slotSize + unit - 1) / unit;
+}
+
+/*
+ * ======================================================
+ * Record Fields
+ * ======================================================
+ */
+
+/*
+ * Finds value "field" (from 0) of a record of values separated by
+ * HF_FIELD_SEP. Sets *value to it and returns its length, or -1 if
+ * the record has fewer values. With SSE2, the separators are counted
+ * 16 bytes at a time, and the block holding the one before the value
+ * is looked at no further than its bit mask.
+ */
+static int HF_FindField(const char *rec, int len, int field, const char **value) {
+    int i = 0;
+
+#ifdef __SSE2__
+    const __m128i sep = _mm_set1_epi8(HF_FIELD_SEP);
+    while (field > 0 && i + 16 <= len) {
+        __m128i block = _mm_loadu_si128((const __m128i*)(rec + i));
+        unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, sep));
+        int count = __builtin_popcount(mask);
+        if (count < field) {
+            field -= count;
+            i += 16;
+            continue;
+        }
+        // The field-th separator is in this block: drop the ones before it
+        while (--field > 0) {
+            mask &= mask - 1;
+        }
+        i += __builtin_ctz(mask) + 1;
+    }
+#endif
+    for (; field > 0 && i < len; i++) {
+        if (rec[i] == HF_FIELD_SEP) {
+            field--;
+        }
+    }
+    if (field > 0) {
+        return -1;
+    }
+    *value = rec + i;
+    const char *end = memchr(rec + i, HF_FIELD_SEP, len - i);
+    return (end != NULL) ? (int)(end - (rec + i)) : len - i;
+}
+
+/*
+ * Parses len bytes of text, [-]digits[.digits], as a number.
+ * Returns FALSE if it is not one.
+ */
+static int HF_ParseNumber(const char *text, int len, double *num) {
+    int i = (len > 0 && text[0] == '-');
+    int digits = 0;
+    double v = 0, scale = 1;
+
+    for (; i < len && text[i] >= '0' && text[i] <= '9'; i++, digits++) {
+        v = v * 10 + (text[i] - '0');
+    }
+    if (i < len && text[i] == '.') {
+        for (i++; i < len && text[i] >= '0' && text[i] <= '9'; i++, digits++) {
+            v = v * 10 + (text[i] - '0');
+            scale *= 10;
+        }
+    }
+    if (i != len || digits == 0) {
+        return FALSE;
+    }
+    *num = (text[0] == '-' ? -v : v) / scale;
+    return TRUE;
+}
+
+/*
+ * ======================================================
+ * Zone Maps
+ * ======================================================
+ */
+
+/*
+ * Initializes an empty zone map page for numFields fields: no page
+ * it covers has numbers yet.
+ */
+static void HF_ZoneInitPage(char *pageBuf, int pageSize, int numFields) {
+    HF_ZoneHeader *header = (HF_ZoneHeader*)pageBuf;
+    HF_ZoneRange empty = { HUGE_VAL, -HUGE_VAL };
+    int n = HF_ZoneEntries(pageSize, numFields) * numFields;
+
+    header->numSlots = HF_ZONE_PAGE;
+    header->nextZonePage = -1;
+    for (int i = 0; i < n; i++) {
+        memcpy(pageBuf + sizeof(HF_ZoneHeader) + i * sizeof(HF_ZoneRange),
+               &empty, sizeof(empty));
+    }
+}
+
+/*
+ * Fixes the zone map page with the entry of page "pagenum", sets
+ * *zonePage to it and *entry to the entry's ranges, one per field.
+ * If "create", zone map pages are added to the chain if the page is
+ * past the ones there; if not, *zonePage is set to -1 instead.
+ * Buffer pages are not aligned for doubles, so the ranges are
+ * copied in and out of the entry.
+ */
+static int HF_ZoneEntry(int fd, HF_ZoneRoot *zones, int pagenum, int create,
+                        int *zonePage, char **entry) {
+    int pageSize = PF_GetPageSize(fd);
+    int perZone = HF_ZoneEntries(pageSize, zones->numFields);
+    int page = zones->firstPage;
+    char *zoneBuf, *newBuf;
+    int newPage;
+    int error;
+
+    if ((error = PF_GetThisPage(fd, page, &zoneBuf)) != PFE_OK)
+        return error;
+    for (int k = 0; k < pagenum / perZone; k++) {
+        // Go to the next zone map page, adding it if need be
+        HF_ZoneHeader *header = (HF_ZoneHeader*)zoneBuf;
+        int dirty = FALSE;
+        if (header->nextZonePage == -1) {
+            if (!create) {
+                *zonePage = -1;
+                return PF_UnfixPage(fd, page, FALSE);
+            }
+            if ((error = PF_AllocPage(fd, &newPage, &newBuf)) != PFE_OK) {
+                PF_UnfixPage(fd, page, FALSE);
+                return error;
+            }
+            HF_ZoneInitPage(newBuf, pageSize, zones->numFields);
+            if ((error = PF_UnfixPage(fd, newPage, TRUE)) != PFE_OK)
+                return error;
+            header->nextZonePage = newPage;
+            dirty = TRUE;
+        }
+        int next = header->nextZonePage;
+        if ((error = PF_UnfixPage(fd, page, dirty)) != PFE_OK)
+            return error;
+        page = next;
+        if ((error = PF_GetThisPage(fd, page, &zoneBuf)) != PFE_OK)
+            return error;
+    }
+    *zonePage = page;
+    *entry = zoneBuf + sizeof(HF_ZoneHeader) +
+             (pagenum % perZone) * zones->numFields * sizeof(HF_ZoneRange);
+    return HFE_OK;
+}
+
+/*
+ * Widens the ranges of a zone map entry to take in the record in
+ * slot "slotNum" of a slotted page: its fields that are numbers, or
+ * anything at all for a long record. Free slots and forwarding
+ * stubs change nothing.
+ */
+static void HF_ZoneWiden(HF_ZoneRoot *zones, HF_ZoneRange *entry, char *pageBuf, int slotNum) {
+    char *record;
+    int recLen;
+    int error = HF_Page_GetRec(pageBuf, slotNum, &record, &recLen);
+
+    for (int f = 0; f < zones->numFields; f++) {
+        const char *value;
+        int len;
+        double v;
+        if (error == HFE_LONGREC) {
+            entry[f].min = -HUGE_VAL;
+            entry[f].max = HUGE_VAL;
+        } else if (error == HFE_OK &&
+                (len = HF_FindField(record, recLen, zones->fields[f], &value)) >= 0 &&
+                HF_ParseNumber(value, len, &v)) {
+            if (v < entry[f].min)
+                entry[f].min = v;
+            if (v > entry[f].max)
+                entry[f].max = v;
+        }
+    }
+}
+
+/* Works out a zone map entry afresh from the records of a page */
+static void HF_ZoneSummarize(HF_ZoneRoot *zones, HF_ZoneRange *entry, char *pageBuf) {
+    for (int f = 0; f < zones->numFields; f++) {
+        entry[f].min = HUGE_VAL;
+        entry[f].max = -HUGE_VAL;
+    }
+    if (!HF_IsSlottedPage(pageBuf))
+        return;
+    for (int i = 0; i < HF_NumSlots(pageBuf); i++)
+        HF_ZoneWiden(zones, entry, pageBuf, i);
+}
+
+/*
+ * Brings the zone map entry of page "pagenum", fixed in pageBuf, up
+ * to date: widened to take in the record in slot "slotNum", or, if
+ * slotNum is -1, worked out afresh from all of the page's records.
+ * Does nothing for files without a zone map.
+ */
+static int HF_ZoneUpdate(int fd, HF_ZoneRoot *zones, int pagenum, char *pageBuf, int slotNum) {
+    HF_ZoneRange ranges[HF_ZONE_MAX_FIELDS];
+    int size = zones->numFields * sizeof(HF_ZoneRange);
+    char *entry;
+    int zonePage;
+    int error;
+
+    if (zones->numFields == 0)
+        return HFE_OK;
+    if ((error = HF_ZoneEntry(fd, zones, pagenum, TRUE, &zonePage, &entry)) != HFE_OK)
+        return error;
+    memcpy(ranges, entry, size);
+    if (slotNum < 0)
+        HF_ZoneSummarize(zones, ranges, pageBuf);
+    else
+        HF_ZoneWiden(zones, ranges, pageBuf, slotNum);
+    memcpy(entry, ranges, size);
+    return PF_UnfixPage(fd, zonePage, TRUE);
+}
+
+/*
+ * Tells whether the record in slot "slotNum" of page "pagenum",
+ * fixed in pageBuf, holds one of the bounds of the page's ranges in
+ * the zone map, so that deleting it may narrow them.
+ * Returns TRUE, FALSE or a PF error code.
+ */
+static int HF_ZoneOnBound(int fd, HF_ZoneRoot *zones, int pagenum, char *pageBuf, int slotNum) {
+    HF_ZoneRange own[HF_ZONE_MAX_FIELDS], ranges[HF_ZONE_MAX_FIELDS];
+    char *entry;
+    int zonePage;
+    int onBound = FALSE;
+    int error;
+
+    if (zones->numFields == 0)
+        return FALSE;
+    if ((error = HF_ZoneEntry(fd, zones, pagenum, FALSE, &zonePage, &entry)) != HFE_OK)
+        return error;
+    if (zonePage == -1)
+        return FALSE;
+    memcpy(ranges, entry, zones->numFields * sizeof(HF_ZoneRange));
+    for (int f = 0; f < zones->numFields; f++) {
+        own[f].min = HUGE_VAL;
+        own[f].max = -HUGE_VAL;
+    }
+    HF_ZoneWiden(zones, own, pageBuf, slotNum);
+    for (int f = 0; f < zones->numFields; f++) {
+        if (own[f].min <= own[f].max &&
+                (own[f].min <= ranges[f].min || own[f].max >= ranges[f].max))
+            onBound = TRUE;
+    }
+    if ((error = PF_UnfixPage(fd, zonePage, FALSE)) != PFE_OK)
+        return error;
+    return onBound;
+}
+
+/*
+ * Tells whether a page whose zone map entry is "entry" may hold
+ * records matching all the predicates. It cannot if, for some
+ * HF_OP_NUM predicate on a field of the zone map, no number in the
+ * page's range of the field satisfies it.
+ */
+static int HF_ZoneMayMatch(HF_ZoneRoot *zones, HF_ZoneRange *entry,
+                           HF_Pred *preds, int numPreds) {
+    for (int i = 0; i < numPreds; i++) {
+        if (!(preds[i].op & HF_OP_NUM))
+            continue;
+        for (int f = 0; f < zones->numFields; f++) {
+            if (zones->fields[f] != preds[i].field)
+                continue;
+            double min = entry[f].min, max = entry[f].max, num = preds[i].num;
+            int may;
+            switch (preds[i].op & ~HF_OP_NUM) {
+            case HF_OP_EQ: may = (min <= num && num <= max); break;
+            case HF_OP_NE: may = (min < num || max > num); break;
+            case HF_OP_LT: may = (min < num); break;
+            case HF_OP_LE: may = (min <= num); break;
+            case HF_OP_GT: may = (max > num); break;
+            default:       may = (max >= num); break;
+            }
+            if (!may)
+                return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/*
+ * Sets *zones to the zone map of file fd if it has one that can
+ * rule out pages for the predicates, that is, one with the field of
+ * an HF_OP_NUM predicate, or zones->numFields to 0 if not.
+ */
+static int HF_ZoneForPreds(int fd, HF_Pred *preds, int numPreds, HF_ZoneRoot *zones) {
+    HF_Layout layout;
+    int error;
+
+    zones->numFields = 0;
+    if ((error = HF_GetLayout(fd, &layout)) != HFE_OK)
+        return error;
+    for (int i = 0; i < numPreds; i++) {
+        for (int f = 0; f < layout.zones.numFields; f++) {
+            if ((preds[i].op & HF_OP_NUM) && layout.zones.fields[f] == preds[i].field) {
+                *zones = layout.zones;
+                return HFE_OK;
+            }
+        }
+    }
+    return HFE_OK;
+}
+
+/*
+ * Sets *next to the first page after page "after" that the zone map
+ * says may hold records matching the predicates. Pages past those
+ * the zone map has entries for may.
+ */
+static int HF_ZoneNextPage(int fd, HF_ZoneRoot *zones, HF_Pred *preds, int numPreds,
+                           int after, int *next) {
+    int perZone = HF_ZoneEntries(PF_GetPageSize(fd), zones->numFields);
+    int size = zones->numFields * sizeof(HF_ZoneRange);
+    HF_ZoneRange ranges[HF_ZONE_MAX_FIELDS];
+    int page = after + 1;
+    int zonePage = zones->firstPage;
+    char *zoneBuf;
+    int error;
+
+    for (int k = 0; zonePage != -1; k++) {
+        if ((error = PF_GetThisPage(fd, zonePage, &zoneBuf)) != PFE_OK)
+            return error;
+        for (; page < (k + 1) * perZone; page++) {
+            memcpy(ranges, zoneBuf + sizeof(HF_ZoneHeader) + (page - k * perZone) * size, size);
+            if (HF_ZoneMayMatch(zones, ranges, preds, numPreds))
+                break;
+        }
+        int nextZone = ((HF_ZoneHeader*)zoneBuf)->nextZonePage;
+        if ((error = PF_UnfixPage(fd, zonePage, FALSE)) != PFE_OK)
+            return error;
+        if (page < (k + 1) * perZone)
+            break;
+        zonePage = nextZone;
+    }
+    *next = page;
+    return HFE_OK;
+}
+
+/*
+ * ======================================================
+ * Long Records
+ * ======================================================
  */
-void HF_InitPage(char *pageBuf) {
-    HF_PageHeader *header = HF_GetPageHeader(pageBuf);
+
+/* Bytes of a long record that an overflow page of pageSize bytes holds */
+#define HF_OverflowBytes(pageSize) ((pageSize) - (int)sizeof(HF_OverflowHeader))
+
+/* Tells whether the slot of a page holds a long record */
+static int HF_SlotIsLong(char *pageBuf, int slotNum) {
+    if (HF_IsFixedPage(pageBuf)) {
+        return FALSE;
+    }
+    int length = HF_SlotLength(pageBuf, slotNum);
+    return length != HF_SLOT_FREE && length != HF_SLOT_FORWARD &&
+        (length & HF_SLOT_LONG);
+}
+
+/*
+ * Gives back the overflow pages of a long record, from firstPage on.
+ */
+static int HF_LongFree(int fd, int firstPage) {
+    char *pageBuf;
+    int error;
+
+    for (int pagenum = firstPage; pagenum != -1; ) {
+        if ((error = PF_GetThisPage(fd, pagenum, &pageBuf)) != PFE_OK) {
+            return error;
+        }
+        int next = ((HF_OverflowHeader*)pageBuf)->nextPage;
+        if ((error = PF_UnfixPage(fd, pagenum, FALSE)) != PFE_OK ||
+                (error = PF_DisposePage(fd, pagenum)) != PFE_OK) {
+            return error;
+        }
+        pagenum = next;
+    }
+    return HFE_OK;
+}
+
+/*
+ * Writes a long record to a chain of new overflow pages, and sets
+ * *lr to say where it is. The pages are allocated in the order they
+ * are read in, and each one is kept fixed until the next one's
+ * number is on it. Nothing is left allocated on error.
+ *
+ * Overflow pages are never in the FSM: their entries stay 0.
+ */
+static int HF_LongWrite(int fd, char *record, int recLen, HF_LongRec *lr) {
+    int perPage = HF_OverflowBytes(PF_GetPageSize(fd));
+    int prevPage = -1, pagenum;
+    char *prevBuf = NULL, *pageBuf;
+    int error = PFE_OK;
+
+    lr->recLen = recLen;
+    lr->firstPage = -1;
+    for (int done = 0; done < recLen; done += perPage) {
+        if ((error = PF_AllocPage(fd, &pagenum, &pageBuf)) != PFE_OK) {
+            break;
+        }
+        HF_OverflowHeader *ov = (HF_OverflowHeader*)pageBuf;
+        ov->numSlots = HF_OVERFLOW_PAGE;
+        ov->nextPage = -1;
+        ov->length = (recLen - done < perPage) ? recLen - done : perPage;
+        memcpy(pageBuf + sizeof(HF_OverflowHeader), record + done, ov->length);
+
+        // Link it to the page before, which is then done with
+        if (prevPage == -1) {
+            lr->firstPage = pagenum;
+        } else {
+            ((HF_OverflowHeader*)prevBuf)->nextPage = pagenum;
+        }
+        int donePage = prevPage;
+        prevPage = pagenum;
+        prevBuf = pageBuf;
+        if (donePage != -1 && (error = PF_UnfixPage(fd, donePage, TRUE)) != PFE_OK) {
+            break;
+        }
+    }
+    if (prevPage != -1) {
+        int unfixError = PF_UnfixPage(fd, prevPage, TRUE);
+        if (error == PFE_OK) {
+            error = unfixError;
+        }
+    }
+    if (error != PFE_OK && lr->firstPage != -1) {
+        HF_LongFree(fd, lr->firstPage);
+    }
+    return error;
+}
+
+/*
+ * ======================================================
+ * Bulk Append Implementation
+ * ======================================================
+ */
+
+/* Pages built in memory before they are written out together */
+#define HF_BULK_RUN 32
+
+/* A file in bulk-append mode */
+typedef struct HF_Bulk {
+    int fd;
+    int pageSize;
+    int hasFsm;             // FALSE for files without FSM pages
+    HF_Layout layout;       // how its data pages are laid out
+    int maxRecLen;          // longest record an empty page takes
+    int firstPage;          // page number of the first page of the run
+    int npages;             // pages in the run; the last one is being filled
+    char *run;              // HF_BULK_RUN pages
+    struct HF_Bulk *next;
+} HF_Bulk;
+
+static HF_Bulk *HF_bulkList = NULL;    // files in bulk-append mode
+
+static HF_Bulk* HF_BulkFind(int fd) {
+    HF_Bulk *bulk;
+
+    for (bulk = HF_bulkList; bulk != NULL; bulk = bulk->next)
+        if (bulk->fd == fd)
+            return bulk;
+    return NULL;
+}
+
+/*
+ * Writes the pages of the run straight to the file and records
+ * their free space in the FSM, and their ranges in the zone map.
+ */
+static int HF_BulkFlush(HF_Bulk *bulk) {
+    char *pageBufs[HF_BULK_RUN];
+    int error;
+
+    for (int i = 0; i < bulk->npages; i++)
+        pageBufs[i] = bulk->run + i * bulk->pageSize;
+    if (bulk->npages > 0 &&
+            (error = PF_WritePages(bulk->fd, bulk->firstPage,
+                                   bulk->npages, pageBufs)) != PFE_OK)
+        return error;
+    for (int i = 0; bulk->hasFsm && i < bulk->npages; i++)
+        if ((error = HF_FsmUpdate(bulk->fd, bulk->firstPage + i,
+                HF_Page_FreeBytes(pageBufs[i], bulk->pageSize))) != HFE_OK)
+            return error;
+    for (int i = 0; i < bulk->npages; i++)
+        if ((error = HF_ZoneUpdate(bulk->fd, &bulk->layout.zones, bulk->firstPage + i,
+                                   pageBufs[i], -1)) != HFE_OK)
+            return error;
+    bulk->npages = 0;
+    return HFE_OK;
+}
+
+/*
+ * Appends a record to the last page of the run, or to a new page
+ * if it does not fit, or'ing "flags" into the length in its slot.
+ * A full run is written out first.
+ */
+static int HF_BulkPut(HF_Bulk *bulk, char *record, int recLen, int flags, RID *rid) {
+    int slotNum = HFE_PAGENOFREE;
+    int pagenum;
+    char *pageBuf;
+    int error;
+
+    if (bulk->layout.recLen > 0 && recLen != bulk->layout.recLen)
+        return HFE_RECLEN;
+    if (recLen > bulk->maxRecLen)
+        return HFE_PAGENOFREE;      // would not fit on any page
+    if (bulk->npages > 0)
+        slotNum = HF_PageInsert(bulk->run + (bulk->npages - 1) * bulk->pageSize,
+                                bulk->pageSize, record, recLen, flags, FALSE);
+    if (slotNum < 0) {
+        // --- Start a new page ---
+        if ((error = PF_AllocPages(bulk->fd, 1, &pagenum)) != PFE_OK)
+            return error;
+        if (bulk->npages == HF_BULK_RUN ||
+                (bulk->npages > 0 && pagenum != bulk->firstPage + bulk->npages)) {
+            if ((error = HF_BulkFlush(bulk)) != HFE_OK)
+                return error;
+        }
+        if (bulk->npages == 0)
+            bulk->firstPage = pagenum;
+        pageBuf = bulk->run + bulk->npages++ * bulk->pageSize;
+        HF_InitDataPage(pageBuf, bulk->pageSize, &bulk->layout);
+        slotNum = HF_PageInsert(pageBuf, bulk->pageSize, record, recLen, flags, FALSE);
+    }
+
+    if (rid != NULL) {
+        rid->pageNum = bulk->firstPage + bulk->npages - 1;
+        rid->slotNum = slotNum;
+    }
+    return HFE_OK;
+}
+
+/*
+ * Appends a record to the run. A long record goes on overflow pages
+ * through the buffer pool, and only its HF_LongRec on the run.
+ */
+static int HF_BulkAppend(HF_Bulk *bulk, char *record, int recLen, RID *rid) {
+    HF_LongRec lr;
+    int error;
+
+    if (bulk->layout.recLen > 0 || recLen <= HF_LayoutMaxInline(&bulk->layout, bulk->pageSize)) {
+        return HF_BulkPut(bulk, record, recLen, 0, rid);
+    }
+    if ((error = HF_LongWrite(bulk->fd, record, recLen, &lr)) != HFE_OK) {
+        return error;
+    }
+    if ((error = HF_BulkPut(bulk, (char*)&lr, sizeof(lr), HF_SLOT_LONG, rid)) != HFE_OK) {
+        HF_LongFree(bulk->fd, lr.firstPage);
+    }
+    return error;
+}
+
+/*
+ * Puts file fd in bulk-append mode.
+ */
+int HF_BeginBulkAppend(int fd) {
+    HF_Bulk *bulk;
+    HF_Layout layout;
+    int pageSize, hasFsm, error;
+
+    if (HF_BulkFind(fd) != NULL)
+        return HFE_OK;
+    if ((pageSize = PF_GetPageSize(fd)) < 0)
+        return pageSize;
+    if ((hasFsm = HF_FsmPresent(fd)) < 0)
+        return hasFsm;
+    if ((error = HF_GetLayout(fd, &layout)) != HFE_OK)
+        return error;
+    if ((bulk = malloc(sizeof(HF_Bulk))) == NULL ||
+            (bulk->run = malloc((size_t)HF_BULK_RUN * pageSize)) == NULL) {
+        free(bulk);
+        PFerrno = PFE_NOMEM;
+        return PFerrno;
+    }
+    bulk->fd = fd;
+    bulk->pageSize = pageSize;
+    bulk->hasFsm = hasFsm;
+    bulk->layout = layout;
+    bulk->npages = 0;
+
+    // What an empty page of the file's format takes, less a slot
+    HF_InitDataPage(bulk->run, pageSize, &layout);
+    bulk->maxRecLen = HF_Page_FreeBytes(bulk->run, pageSize);
+    if (!HF_IsFixedPage(bulk->run))
+        bulk->maxRecLen -= HF_SlotSize(bulk->run);
+    bulk->next = HF_bulkList;
+    HF_bulkList = bulk;
+    return HFE_OK;
+}
+
+/*
+ * Takes file fd out of bulk-append mode, writing out the pages
+ * still in memory.
+ */
+int HF_EndBulkAppend(int fd) {
+    HF_Bulk **bp;
+
+    for (bp = &HF_bulkList; *bp != NULL; bp = &(*bp)->next) {
+        if ((*bp)->fd == fd) {
+            HF_Bulk *bulk = *bp;
+            int error = HF_BulkFlush(bulk);
+            *bp = bulk->next;
+            free(bulk->run);
+            free(bulk);
+            return error;
+        }
+    }
+    return HFE_OK;  // was not in bulk-append mode
+}
+
+/*
+ * ======================================================
+ * Pinned Pages
+ * ======================================================
+ */
+
+/*
+ * The data pages fixed through the HF layer, by descriptor, with
+ * the number of fixes of each. The PF layer fixes a page only once
+ * per descriptor, so the count is kept here: a page a record handle
+ * or a scan keeps fixed can still be fixed by an insert, update or
+ * delete through the same descriptor. Other descriptors of the same
+ * file fix the page on their own. Few pages are fixed at a time, so
+ * a list does.
+ *
+ * "held" counts the fixes kept between calls (record handles and
+ * scans), which have pointers into the page: records on a held page
+ * must stay where they are, so it is not compacted.
+ */
+typedef struct {
+    int fd;
+    int pageNum;
+    int pins;
+    int held;
+    int dirty;
+    char *pageBuf;
+} HF_PinnedPage;
+
+static HF_PinnedPage *HF_pinned = NULL;
+static int HF_numPinned = 0;
+static int HF_maxPinned = 0;
+
+/* Finds a page in HF_pinned; returns its index, or -1 */
+static int HF_FindPinned(int fd, int pageNum) {
+    for (int i = 0; i < HF_numPinned; i++) {
+        if (HF_pinned[i].pageNum == pageNum && HF_pinned[i].fd == fd) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* Adds a page just fixed through the PF layer to HF_pinned */
+static int HF_AddPinned(int fd, int pageNum, char *pageBuf) {
+    if (HF_numPinned == HF_maxPinned) {
+        int max = (HF_maxPinned == 0) ? 16 : 2 * HF_maxPinned;
+        HF_PinnedPage *pinned = realloc(HF_pinned, max * sizeof(HF_PinnedPage));
+        if (pinned == NULL) {
+            PF_UnfixPage(fd, pageNum, FALSE);
+            PFerrno = PFE_NOMEM;
+            return PFerrno;
+        }
+        HF_pinned = pinned;
+        HF_maxPinned = max;
+    }
+    HF_pinned[HF_numPinned].fd = fd;
+    HF_pinned[HF_numPinned].pageNum = pageNum;
+    HF_pinned[HF_numPinned].pins = 1;
+    HF_pinned[HF_numPinned].held = 0;
+    HF_pinned[HF_numPinned].dirty = FALSE;
+    HF_pinned[HF_numPinned].pageBuf = pageBuf;
+    HF_numPinned++;
+    return PFE_OK;
+}
+
+/*
+ * Fixes a data page, or counts one more fix of it if it is fixed
+ * through the HF layer already.
+ */
+static int HF_PinPage(int fd, int pageNum, char **pageBuf) {
+    int i = HF_FindPinned(fd, pageNum);
+    int error;
+
+    if (i >= 0) {
+        HF_pinned[i].pins++;
+        *pageBuf = HF_pinned[i].pageBuf;
+        return PFE_OK;
+    }
+    if ((error = PF_GetThisPage(fd, pageNum, pageBuf)) != PFE_OK) {
+        return error;
+    }
+    return HF_AddPinned(fd, pageNum, *pageBuf);
+}
+
+/*
+ * Fixes the next used page after *pageNum, as PF_GetNextPage does,
+ * or counts one more fix of it if it is fixed through the HF layer
+ * already.
+ */
+static int HF_PinNextPage(int fd, int *pageNum, char **pageBuf) {
+    int next = *pageNum;
+    char *buf;
+    int error = PF_GetNextPage(fd, &next, &buf);
+
+    if (error == PFE_PAGEFIXED) {
+        int i = HF_FindPinned(fd, next);
+        if (i < 0) {
+            return error;
+        }
+        HF_pinned[i].pins++;
+    } else if (error != PFE_OK) {
+        return error;
+    } else if ((error = HF_AddPinned(fd, next, buf)) != PFE_OK) {
+        return error;
+    }
+    *pageNum = next;
+    *pageBuf = buf;
+    return PFE_OK;
+}
+
+/*
+ * Unpins a page, dirty if "dirty": it is unfixed, and written out
+ * if any fix dirtied it, once no one has it fixed any more.
+ */
+static int HF_UnpinPage(int fd, int pageNum, int dirty) {
+    int i = HF_FindPinned(fd, pageNum);
+
+    if (i < 0) {
+        PFerrno = PFE_PAGENOTINBUF;
+        return PFerrno;
+    }
+    HF_pinned[i].dirty |= dirty;
+    if (--HF_pinned[i].pins > 0) {
+        return PFE_OK;
+    }
+    dirty = HF_pinned[i].dirty;
+    HF_pinned[i] = HF_pinned[--HF_numPinned];
+    return PF_UnfixPage(fd, pageNum, dirty);
+}
+
+/*
+ * Marks a pinned page as kept fixed between calls ("delta" 1), or no
+ * longer ("delta" -1): see HF_PinnedPage.
+ */
+static void HF_HoldPage(int fd, int pageNum, int delta) {
+    int i = HF_FindPinned(fd, pageNum);
+
+    if (i >= 0) {
+        HF_pinned[i].held += delta;
+    }
+}
+
+/* Tells whether a page is held, so that its records must not move */
+static int HF_PageHeld(int fd, int pageNum) {
+    int i = HF_FindPinned(fd, pageNum);
+
+    return i >= 0 && HF_pinned[i].held > 0;
+}
+
+/*
+ * Free bytes of a page that an insert can use: all of them, but on
+ * a held page only those between the slot array and the data heap.
+ */
+static int HF_PageRoom(char *pageBuf, int pageSize, int held) {
+    if (held && !HF_IsFixedPage(pageBuf) && HF_IsSlottedPage(pageBuf)) {
+        return HF_DataStart(pageBuf) - HF_SlotsEnd(pageBuf, HF_NumSlots(pageBuf));
+    }
+    return HF_Page_FreeBytes(pageBuf, pageSize);
+}
+
+/*
+ * ======================================================
+ * File-level HF Layer Function Implementations
+ * ======================================================
+ */
+
+/*
+ * Gives a just created heap file its first FSM page, page 0, which
+ * also records the layout of its data pages.
+ */
+static int HF_InitFile(char *fileName, HF_Layout *layout) {
+    int fd, pagenum;
+    char *pageBuf;
+
+    if ((fd = PF_OpenFile(fileName)) < 0)
+        return PFerrno;
+    if (PF_AllocPage(fd, &pagenum, &pageBuf) != PFE_OK) {
+        PF_CloseFile(fd);
+        return PFerrno;
+    }
+    HF_FsmInitPage(pageBuf, PF_GetPageSize(fd));
+    ((HF_FsmHeader*)pageBuf)->recLen = layout->recLen;
+    ((HF_FsmHeader*)pageBuf)->pax = layout->pax;
+    if (PF_UnfixPage(fd, pagenum, TRUE) != PFE_OK ||
+            PF_CloseFile(fd) != PFE_OK)
+        return PFerrno;
+    return HFE_OK;
+}
+
+/*
+ * Creates a new, empty heap file.
+ * This is just a wrapper for the PF layer.
+ */
+int HF_CreateFile(char *fileName) {
+    return HF_CreateFileOpt(fileName, PF_PAGE_SIZE, 0);
+}
+
+/*
+ * Creates a new, empty heap file with pages of pageSize bytes.
+ * This is just a wrapper for the PF layer.
+ */
+int HF_CreateFileSized(char *fileName, int pageSize) {
+    return HF_CreateFileOpt(fileName, pageSize, 0);
+}
+
+/*
+ * Creates a new, empty heap file with PF storage options
+ * (PF_FILE_xxx, see PF_CreateFileOpt).
+ */
+int HF_CreateFileOpt(char *fileName, int pageSize, int pfFlags) {
+    if (PF_CreateFileOpt(fileName, pageSize, pfFlags) != PFE_OK) {
+        return PFerrno; // Return PF layer's error code
+    }
+    HF_Layout layout;
+
+    memset(&layout, 0, sizeof(layout));
+    return HF_InitFile(fileName, &layout);
+}
+
+/*
+ * Creates a new, empty heap file of fixed pages for records of
+ * recLen bytes, with PF storage options.
+ */
+int HF_CreateFileFixed(char *fileName, int pageSize, int pfFlags, int recLen) {
+    HF_Layout layout;
+
+    // At least one row must fit on a page
+    if (recLen <= 0 ||
+            (int)sizeof(HF_FixedHeader) + 1 + recLen > pageSize) {
+        return HFE_RECLEN;
+    }
+    if (PF_CreateFileOpt(fileName, pageSize, pfFlags) != PFE_OK) {
+        return PFerrno; // Return PF layer's error code
+    }
+    memset(&layout, 0, sizeof(layout));
+    layout.recLen = recLen;
+    return HF_InitFile(fileName, &layout);
+}
+
+/*
+ * Creates a new, empty heap file of PAX pages for records of the
+ * given fields, with PF storage options.
+ */
+int HF_CreateFilePax(char *fileName, int pageSize, int pfFlags,
+                     int numFields, int widths[]) {
+    HF_Layout layout;
+
+    if (numFields <= 0 || numFields > HF_PAX_MAX_FIELDS) {
+        return HFE_NOFIELDS;
+    }
+    memset(&layout, 0, sizeof(layout));
+    layout.pax.numFields = numFields;
+    for (int f = 0; f < numFields; f++) {
+        if (widths[f] <= 0 || widths[f] > pageSize) {
+            return HFE_NOFIELDS;
+        }
+        layout.pax.width[f] = widths[f];
+        layout.recLen += widths[f];
+    }
+    // At least one row must fit on a page
+    if ((int)sizeof(HF_PaxHeader) + 1 + layout.recLen > pageSize) {
+        return HFE_RECLEN;
+    }
+    if (PF_CreateFileOpt(fileName, pageSize, pfFlags) != PFE_OK) {
+        return PFerrno; // Return PF layer's error code
+    }
+    return HF_InitFile(fileName, &layout);
+}
+
+/*
+ * Creates a new, empty heap file of dictionary pages, with PF
+ * storage options. Pages are at most HF_DICT_MAX_SIZE bytes.
+ */
+int HF_CreateFileDict(char *fileName, int pageSize, int pfFlags) {
+    HF_Layout layout;
+
+    if (pageSize > HF_DICT_MAX_SIZE) {
+        return PFE_PAGESIZE;
+    }
+    if (PF_CreateFileOpt(fileName, pageSize, pfFlags) != PFE_OK) {
+        return PFerrno; // Return PF layer's error code
+    }
+    memset(&layout, 0, sizeof(layout));
+    layout.recLen = HF_DICT_FILE;
+    return HF_InitFile(fileName, &layout);
+}
+
+/*
+ * Opens an existing heap file.
+ * This is just a wrapper for the PF layer.
+ * Returns a file descriptor (fd) from the PF layer.
+ */
+int HF_OpenFile(char *fileName) {
+    // Call the PF layer to open the file
+    int fd = PF_OpenFile(fileName);
+    if (fd < 0) {
+        return PFerrno; // Return PF layer's error code
+    }
+    return fd; // Return the file descriptor
+}
+
+/*
+ * Closes a heap file.
+ * This is just a wrapper for the PF layer.
+ */
+int HF_CloseFile(int fd) {
+    int error;
+
+    // Write out any pages of a bulk append
+    if ((error = HF_EndBulkAppend(fd)) != HFE_OK) {
+        return error;
+    }
+
+    // Call the PF layer to close the file
+    if (PF_CloseFile(fd) != PFE_OK) {
+        return PFerrno; // Return PF layer's error code
+    }
+    return HFE_OK;
+}
+
+/*
+ * Inserts a record into a file that has no FSM page.
+ *
+ * This function scans the file page by page to find one
+ * with enough free space. If no page has space, it
+ * allocates a new page and inserts the record there.
+ * "flags" are or'ed into the length in the record's slot.
+ */
+static int HF_InsertRecScan(int fd, char *record, int recLen, int flags, RID *rid) {
+    int pageSize = PF_GetPageSize(fd);
+    int pagenum = -1; // Start scan from the beginning
+    char *pageBuf;
+    int error;
+    int slotNum;
+
+    // 1. Scan the file for a page with free space
+    while ((error = HF_PinNextPage(fd, &pagenum, &pageBuf)) == PFE_OK) {
+        
+        // Try to insert the record on this page
+        slotNum = HF_PageInsert(pageBuf, pageSize, record, recLen, flags,
+                                HF_PageHeld(fd, pagenum));
+        
+        if (slotNum == HFE_PAGENOFREE) {
+            // This page is full, unfix it and try the next one
+            if ((error = HF_UnpinPage(fd, pagenum, FALSE)) != PFE_OK) {
+                return error; // Propagate PF error
+            }
+            continue; // Go to the next page
+        }
+        
+        // --- Success! We found space and inserted the record ---
+        
+        // Set the output RID
+        rid->pageNum = pagenum;
+        rid->slotNum = slotNum;
+        
+        // Mark the page as dirty (it was modified) and unfix it
+        if ((error = HF_UnpinPage(fd, pagenum, TRUE)) != PFE_OK) {
+            return error;
+        }
+        
+        // Return success
+        return HFE_OK;
+    }
     
-    // This page has no records yet
-    header->numSlots = 0; 
+    // 2. We reached here, so HF_PinNextPage failed.
+    // Check if it was because we reached the End Of File (EOF).
+    if (error != PFE_EOF) {
+        return error; // It was a real error
+    }
     
-    // The data heap starts at the very end of the page
-    // and grows "backward" (towards the front)
-    header->dataStartPtr = PF_PAGE_SIZE;
+    // 3. --- No page had free space, so we must allocate a new one ---
+    
+    // Allocate a new page
+    if ((error = PF_AllocPage(fd, &pagenum, &pageBuf)) != PFE_OK) {
+        return error; // Propagate PF error
+    }
+    
+    // Initialize the new page
+    HF_InitPage(pageBuf, PF_GetPageSize(fd));
+    
+    // Insert the record (this *must* succeed on a new page)
+    slotNum = HF_Page_InsertRec(pageBuf, record, recLen);
+    HF_SlotAddFlags(pageBuf, slotNum, flags);
+    
+    // Set the output RID
+    rid->pageNum = pagenum;
+    rid->slotNum = slotNum;
+    
+    // Mark the new page as dirty and unfix it
+    if ((error = PF_UnfixPage(fd, pagenum, TRUE)) != PFE_OK) {
+        return error;
+    }
+
+    return HFE_OK;
 }
 
 /*
- * Inserts a new record onto the page.
- * Returns the new slot number if successful.
- * Returns an error code if it fails.
+ * Inserts a record into the file, or'ing "flags" into the length
+ * in its slot.
+ *
+ * The FSM gives a page with enough free space, if there is one,
+ * in a few page fetches. Otherwise a new page is allocated.
+ * Either way the page's FSM entry is brought up to date.
+ * Records of fixed-length files go in any page with a free row.
+ * A long record goes on overflow pages, and its HF_LongRec in a slot.
  */
-int HF_Page_InsertRec(char *pageBuf, char *record, int recLen) {
-    HF_PageHeader *header = HF_GetPageHeader(pageBuf);
-    HF_SlotEntry *slotArray = HF_GetSlotArray(pageBuf);
+static int HF_InsertRecFlags(int fd, char *record, int recLen, int flags, RID *rid) {
+    int pageSize = PF_GetPageSize(fd);
+    int want;
+    HF_Layout layout;
+    int pagenum;
+    char *pageBuf;
+    int error;
+    int slotNum;
+
+    if ((error = HF_GetLayout(fd, &layout)) != HFE_OK) {
+        return error;
+    }
+    if (layout.recLen > 0) {
+        if (recLen != layout.recLen) {
+            return HFE_RECLEN;
+        }
+    } else if (recLen > HF_LayoutMaxInline(&layout, pageSize) && !(flags & HF_SLOT_MOVED)) {
+        // (A moved record, its home RID in front, is never too long for a page)
+        HF_LongRec lr;
+        if ((error = HF_LongWrite(fd, record, recLen, &lr)) != HFE_OK) {
+            return error;
+        }
+        error = HF_InsertRecFlags(fd, (char*)&lr, sizeof(lr), flags | HF_SLOT_LONG, rid);
+        if (error != HFE_OK) {
+            HF_LongFree(fd, lr.firstPage);
+        }
+        return error;
+    }
+    want = HF_FsmWant(&layout, pageSize, recLen);
+
+    // 1. Ask the FSM for a page with room
+    while ((error = HF_FsmFind(fd, want, &pagenum)) == HFE_OK &&
+            pagenum >= 0) {
+        if ((error = HF_PinPage(fd, pagenum, &pageBuf)) != PFE_OK)
+            return error;
+        int held = HF_PageHeld(fd, pagenum);
+        slotNum = HF_PageInsert(pageBuf, pageSize, record, recLen, flags, held);
+        int freeBytes = HF_PageRoom(pageBuf, pageSize, held);
+        if (slotNum < 0 && freeBytes >= want * HF_FsmUnit(pageSize)) {
+            // A page of the first format, whose slots are bigger than
+            // want counts on: keep the FSM from giving it again
+            freeBytes = want * HF_FsmUnit(pageSize) - 1;
+        }
+        int zoneError = (slotNum >= 0) ?
+            HF_ZoneUpdate(fd, &layout.zones, pagenum, pageBuf, slotNum) : HFE_OK;
+        if ((error = HF_UnpinPage(fd, pagenum, slotNum >= 0)) != PFE_OK)
+            return error;
+        if (zoneError != HFE_OK)
+            return zoneError;
+        if ((error = HF_FsmUpdate(fd, pagenum, freeBytes)) != HFE_OK)
+            return error;
+        if (slotNum >= 0) {
+            rid->pageNum = pagenum;
+            rid->slotNum = slotNum;
+            return HFE_OK;
+        }
+        if (held) {
+            break;  // its room is only in deleted records, which stay put
+        }
+        // The FSM was wrong about this page; it is right now, so ask again
+    }
+    if (error == HF_NOFSM)
+        return HF_InsertRecScan(fd, record, recLen, flags, rid);
+    if (error != HFE_OK)
+        return error;
+
+    // 2. --- No page has room, so allocate a new one ---
+    if ((error = PF_AllocPage(fd, &pagenum, &pageBuf)) != PFE_OK) {
+        return error; // Propagate PF error
+    }
+    HF_InitDataPage(pageBuf, pageSize, &layout);
+
+    // Insert the record (this *must* succeed on a new page)
+    slotNum = HF_PageInsert(pageBuf, pageSize, record, recLen, flags, FALSE);
+    int freeBytes = HF_Page_FreeBytes(pageBuf, pageSize);
+    int zoneError = HF_ZoneUpdate(fd, &layout.zones, pagenum, pageBuf, slotNum);
+
+    // Set the output RID
+    rid->pageNum = pagenum;
+    rid->slotNum = slotNum;
+
+    // Mark the new page as dirty and unfix it
+    if ((error = PF_UnfixPage(fd, pagenum, TRUE)) != PFE_OK) {
+        return error;
+    }
+    if (zoneError != HFE_OK) {
+        return zoneError;
+    }
+    return HF_FsmUpdate(fd, pagenum, freeBytes);
+}
+
+/*
+ * Inserts a record into the file.
+ */
+int HF_InsertRec(int fd, char *record, int recLen, RID *rid) {
+    HF_Bulk *bulk;
+
+    // In bulk-append mode, the record just goes on the run
+    if ((bulk = HF_BulkFind(fd)) != NULL) {
+        return HF_BulkAppend(bulk, record, recLen, rid);
+    }
+    return HF_InsertRecFlags(fd, record, recLen, 0, rid);
+}
+
+/*
+ * Puts the first records of a batch on the page the FSM finds room
+ * on for the first one, as many as fit there, and sets *done to how
+ * many that was. Records that would not go in a slot of their own
+ * (long records, or records of the wrong length) are left to the
+ * bulk append.
+ */
+static int HF_BatchSeed(int fd, char *records[], int lens[], int n, RID rids[], int *done) {
+    int pageSize = PF_GetPageSize(fd);
+    HF_Layout layout;
+    int pagenum;
+    char *pageBuf;
+    int error;
+    int i;
+
+    *done = 0;
+    if ((error = HF_GetLayout(fd, &layout)) != HFE_OK) {
+        return error;
+    }
+    error = (n > 0) ? HF_FsmFind(fd, HF_FsmWant(&layout, pageSize, lens[0]), &pagenum)
+                    : HF_NOFSM;
+    if (error == HF_NOFSM || (error == HFE_OK && pagenum < 0)) {
+        return HFE_OK;
+    }
+    if (error != HFE_OK) {
+        return error;
+    }
+    if ((error = HF_PinPage(fd, pagenum, &pageBuf)) != PFE_OK) {
+        return error;
+    }
+    int held = HF_PageHeld(fd, pagenum);
+    int zoneError = HFE_OK;
+    for (i = 0; i < n && zoneError == HFE_OK; i++) {
+        if ((layout.recLen > 0) ? lens[i] != layout.recLen
+                                : lens[i] > HF_LayoutMaxInline(&layout, pageSize)) {
+            break;
+        }
+        int slotNum = HF_PageInsert(pageBuf, pageSize, records[i], lens[i], 0, held);
+        if (slotNum < 0) {
+            break;
+        }
+        zoneError = HF_ZoneUpdate(fd, &layout.zones, pagenum, pageBuf, slotNum);
+        if (rids != NULL) {
+            rids[i].pageNum = pagenum;
+            rids[i].slotNum = slotNum;
+        }
+    }
+    int freeBytes = HF_PageRoom(pageBuf, pageSize, held);
+    if ((error = HF_UnpinPage(fd, pagenum, i > 0)) != PFE_OK) {
+        return error;
+    }
+    if (zoneError != HFE_OK) {
+        return zoneError;
+    }
+    *done = i;
+    return HF_FsmUpdate(fd, pagenum, freeBytes);
+}
+
+/*
+ * Inserts n records, filling new pages in order.
+ * Unless the file is in bulk-append mode already, the batch starts
+ * on a page the FSM finds room on, and the file is put in bulk-append
+ * mode for the rest of it, so the last page is written out at the end.
+ */
+int HF_InsertBatch(int fd, char *records[], int lens[], int n, RID rids[]) {
+    HF_Bulk *bulk = HF_BulkFind(fd);
+    int inBulk = (bulk != NULL);
+    int error = HFE_OK;
+    int i = 0;
+
+    if (!inBulk) {
+        if ((error = HF_BatchSeed(fd, records, lens, n, rids, &i)) != HFE_OK) {
+            return error;
+        }
+        if (i == n) {
+            return HFE_OK;
+        }
+        if ((error = HF_BeginBulkAppend(fd)) != HFE_OK) {
+            return error;
+        }
+        bulk = HF_BulkFind(fd);
+    }
+    for (; i < n && error == HFE_OK; i++) {
+        error = HF_BulkAppend(bulk, records[i], lens[i],
+                              rids != NULL ? &rids[i] : NULL);
+    }
+    if (!inBulk) {
+        int endError = HF_EndBulkAppend(fd);
+        if (error == HFE_OK) {
+            error = endError;
+        }
+    }
+    return error;
+}
+
+/*
+ * Deletes the record in a slot, given its RID, whatever it is:
+ * a record, a forwarding stub, or a moved record.
+ */
+static int HF_DeleteSlot(int fd, RID rid) {
+    HF_Layout layout;
+    char *pageBuf;
+    int error;
     
-    // 1. Calculate the end of the slot array
-    int slotArrayEnd = sizeof(HF_PageHeader) + (header->numSlots * sizeof(HF_SlotEntry));
+    // 1. Get the specific page the record is on
+    if ((error = HF_GetLayout(fd, &layout)) != HFE_OK) {
+        return error;
+    }
+    if ((error = HF_PinPage(fd, rid.pageNum, &pageBuf)) != PFE_OK) {
+        return error;
+    }
     
-    // 2. Calculate the available free space
-    //    (Space between the data heap and the slot array)
-    int freeSpace = header->dataStartPtr - slotArrayEnd;
+    // 2. Call our page-level delete function. If the record held a
+    //    bound of the page's zone map ranges, they may narrow.
+    int onBound = HF_ZoneOnBound(fd, &layout.zones, rid.pageNum, pageBuf, rid.slotNum);
+    error = (onBound < 0) ? onBound : HF_Page_DeleteRec(pageBuf, rid.slotNum);
+    int deleted = (error == HFE_OK);
+    if (deleted && onBound) {
+        error = HF_ZoneUpdate(fd, &layout.zones, rid.pageNum, pageBuf, -1);
+    }
+    int freeBytes = HF_PageRoom(pageBuf, PF_GetPageSize(fd), HF_PageHeld(fd, rid.pageNum));
     
-    // 3. Calculate space needed for this new record
-    //    (The record's data + one new slot entry)
-    int spaceNeeded = recLen + sizeof(HF_SlotEntry);
+    // 3. Mark the page as dirty and unfix it
+    if (HF_UnpinPage(fd, rid.pageNum, deleted) != PFE_OK) {
+        return PFE_UNIX; // Return a generic error if unfix fails
+    }
 
-    // 4. Check if there is enough space
-    if (freeSpace < spaceNeeded) {
-        // Not enough free space on this page
-        return HFE_PAGENOFREE;
+    // 4. The record's space can be reused: tell the FSM
+    if (error == HFE_OK) {
+        error = HF_FsmUpdate(fd, rid.pageNum, freeBytes);
+    }
+    
+    return error; // Return result of HF_DeleteRec
+}
+
+/*
+ * Sets *lr to the HF_LongRec in the slot of RID "rid", or its
+ * firstPage to -1 if the slot holds no long record.
+ */
+static int HF_GetLong(int fd, RID rid, HF_LongRec *lr) {
+    char *pageBuf, *record;
+    int recLen;
+    int error;
+
+    if ((error = HF_PinPage(fd, rid.pageNum, &pageBuf)) != PFE_OK) {
+        return error;
+    }
+    lr->firstPage = -1;
+    if (HF_Page_GetRec(pageBuf, rid.slotNum, &record, &recLen) == HFE_LONGREC) {
+        memcpy(lr, record, sizeof(HF_LongRec));
+    }
+    return HF_UnpinPage(fd, rid.pageNum, FALSE);
+}
+
+/*
+ * Finds the record of RID "rid": sets *where to the RID of the
+ * slot that holds it, which is rid itself unless the record was
+ * moved by HF_UpdateRec, and *lr to its HF_LongRec if it is a long
+ * record (lr->firstPage is -1 if not).
+ */
+static int HF_Locate(int fd, RID rid, RID *where, HF_LongRec *lr) {
+    char *pageBuf, *record;
+    int recLen;
+    int error;
+    RID home;
+
+    if ((error = HF_PinPage(fd, rid.pageNum, &pageBuf)) != PFE_OK) {
+        return error;
+    }
+    lr->firstPage = -1;
+    error = HF_Page_GetRec(pageBuf, rid.slotNum, &record, &recLen);
+    int forwarded = (error == HFE_FORWARDED);
+    if (forwarded) {
+        memcpy(where, record, sizeof(RID));
+        error = HFE_OK;
+    } else if (error == HFE_OK || error == HFE_LONGREC) {
+        // A moved record is only found through its home RID
+        if (HF_PageHomeRID(pageBuf, rid.slotNum, &home)) {
+            error = HFE_INVALIDSLOT;
+        } else if (error == HFE_LONGREC) {
+            memcpy(lr, record, sizeof(HF_LongRec));
+            error = HFE_OK;
+        }
+        *where = rid;
+    }
+    if (HF_UnpinPage(fd, rid.pageNum, FALSE) != PFE_OK) {
+        return PFE_UNIX;
+    }
+    if (error == HFE_OK && forwarded) {
+        error = HF_GetLong(fd, *where, lr);
+    }
+    return error;
+}
+
+/*
+ * Deletes a record from the file, given its RID.
+ * A moved record goes together with its forwarding stub, and a
+ * long record with its overflow pages.
+ */
+int HF_DeleteRec(int fd, RID rid) {
+    RID where;
+    HF_LongRec lr;
+    int error;
+
+    if ((error = HF_Locate(fd, rid, &where, &lr)) != HFE_OK) {
+        return error;
+    }
+    if ((where.pageNum != rid.pageNum || where.slotNum != rid.slotNum) &&
+            (error = HF_DeleteSlot(fd, where)) != HFE_OK) {
+        return error;
+    }
+    if ((error = HF_DeleteSlot(fd, rid)) != HFE_OK) {
+        return error;
+    }
+    return (lr.firstPage != -1) ? HF_LongFree(fd, lr.firstPage) : HFE_OK;
+}
+
+/*
+ * Rewrites the record with RID "rid" in a slot of page "pagenum",
+ * fixed in pageBuf, and unfixes the page. "moved" is TRUE if the
+ * slot holds a moved record, which then starts with "rid". "flags"
+ * are or'ed into the length in the slot.
+ *
+ * Returns HFE_OK, HFE_PAGENOFREE if it does not fit, or an error.
+ */
+static int HF_UpdateSlot(int fd, int pagenum, char *pageBuf, int slotNum,
+                         RID rid, int moved, char *record, int recLen, int flags) {
+    int pageSize = PF_GetPageSize(fd);
+    int held = HF_PageHeld(fd, pagenum);
+    HF_Layout layout;
+    int error;
+
+    if ((error = HF_GetLayout(fd, &layout)) != HFE_OK) {
+        HF_UnpinPage(fd, pagenum, FALSE);
+        return error;
+    }
+    if (moved) {
+        char buf[sizeof(RID) + recLen];
+        memcpy(buf, &rid, sizeof(RID));
+        memcpy(buf + sizeof(RID), record, recLen);
+        error = HF_PageUpdate(pageBuf, pageSize, slotNum, buf, sizeof(buf), held);
+    } else {
+        error = HF_PageUpdate(pageBuf, pageSize, slotNum, record, recLen, held);
+    }
+    if (error == HFE_OK && flags) {
+        HF_SlotAddFlags(pageBuf, slotNum, flags);
+    }
+    int updated = (error == HFE_OK);
+    if (updated) {
+        error = HF_ZoneUpdate(fd, &layout.zones, pagenum, pageBuf, slotNum);
+    }
+    int freeBytes = HF_PageRoom(pageBuf, pageSize, held);
+    if (HF_UnpinPage(fd, pagenum, updated) != PFE_OK) {
+        return PFE_UNIX;
+    }
+    if (error == HFE_OK) {
+        error = HF_FsmUpdate(fd, pagenum, freeBytes);
+    }
+    return error;
+}
+
+/*
+ * Stores a record moved away from its home slot "rid" on some
+ * other page, with "flags" in its slot, and sets *where to its new
+ * RID.
+ */
+static int HF_InsertMoved(int fd, RID rid, char *record, int recLen, int flags,
+                          RID *where) {
+    char buf[sizeof(RID) + recLen];
+
+    memcpy(buf, &rid, sizeof(RID));
+    memcpy(buf + sizeof(RID), record, recLen);
+    return HF_InsertRecFlags(fd, buf, sizeof(buf), HF_SLOT_MOVED | flags, where);
+}
+
+/*
+ * Replaces the record with RID "rid" by "record", recLen bytes,
+ * with "flags" in its slot, and sets *old to the HF_LongRec of the
+ * record replaced (old->firstPage is -1 if it was not long).
+ *
+ * The record is rewritten in its own slot if it fits on its page.
+ * Otherwise it is moved to another page and its slot becomes a
+ * forwarding stub, so that the RID stays valid. A moved record that
+ * fits back on its home page goes back there.
+ */
+static int HF_UpdateRecFlags(int fd, RID rid, char *record, int recLen, int flags,
+                             HF_LongRec *old) {
+    int pageSize = PF_GetPageSize(fd);
+    char *pageBuf;
+    RID where, newWhere;
+    int error;
+
+    if (recLen + (int)(sizeof(HF_PageHeader) + sizeof(HF_SlotEntry) + sizeof(RID)) >
+            pageSize) {
+        return HFE_PAGENOFREE;  // would not fit on any page once moved
+    }
+
+    // The new record may come from a buffer page that is about to
+    // change, or be a PAX record that HF_Locate is about to overwrite
+    char copy[recLen];
+    memcpy(copy, record, recLen);
+    record = copy;
+
+    if ((error = HF_Locate(fd, rid, &where, old)) != HFE_OK) {
+        return error;
+    }
+
+    int forwarded = (where.pageNum != rid.pageNum || where.slotNum != rid.slotNum);
+
+    // 1. Try the home slot
+    if ((error = HF_PinPage(fd, rid.pageNum, &pageBuf)) != PFE_OK) {
+        return error;
+    }
+    error = HF_UpdateSlot(fd, rid.pageNum, pageBuf, rid.slotNum, rid, FALSE,
+                          record, recLen, flags);
+    if (error != HFE_PAGENOFREE) {
+        // Done, unless a moved record has just come home
+        if (error == HFE_OK && forwarded) {
+            error = HF_DeleteSlot(fd, where);
+        }
+        return error;
+    }
+
+    // 2. Try where the record was moved to before
+    if (forwarded) {
+        if ((error = HF_PinPage(fd, where.pageNum, &pageBuf)) != PFE_OK) {
+            return error;
+        }
+        error = HF_UpdateSlot(fd, where.pageNum, pageBuf, where.slotNum, rid, TRUE,
+                              record, recLen, flags);
+        if (error != HFE_PAGENOFREE) {
+            return error;
+        }
+    }
+
+    // 3. Move it to a page with room, and point the home slot at it
+    if ((error = HF_InsertMoved(fd, rid, record, recLen, flags, &newWhere)) != HFE_OK) {
+        return error;
+    }
+    if ((error = HF_PinPage(fd, rid.pageNum, &pageBuf)) != PFE_OK) {
+        return error;
+    }
+    int held = HF_PageHeld(fd, rid.pageNum);
+    error = HF_PageSetForward(pageBuf, pageSize, rid.slotNum, newWhere, held);
+    int freeBytes = HF_PageRoom(pageBuf, pageSize, held);
+    if (HF_UnpinPage(fd, rid.pageNum, error == HFE_OK) != PFE_OK) {
+        return PFE_UNIX;
     }
-    
-    // --- We have enough space, so let's insert ---
-
-    // 5. Find the new record's destination
-    //    (Move the data pointer "back" by recLen)
-    header->dataStartPtr -= recLen;
-    
-    // 6. Copy the record data into the data heap
-    memcpy(pageBuf + header->dataStartPtr, record, recLen);
-    
-    // 7. Get the new slot for this record
-    //    (It's the next available slot in the array)
-    HF_SlotEntry *newSlot = &slotArray[header->numSlots];
-    
-    // 8. Update the new slot's info
-    newSlot->offset = header->dataStartPtr;
-    newSlot->length = recLen;
-    
-    // 9. Update the header
-    int newSlotNum = header->numSlots;
-    header->numSlots++;
-    
-    // Return the slot number where we inserted the record
-    return newSlotNum;
+    if (error != HFE_OK) {
+        // No room even for the stub: leave the record as it was
+        HF_DeleteSlot(fd, newWhere);
+        return error;
+    }
+    if ((error = HF_FsmUpdate(fd, rid.pageNum, freeBytes)) != HFE_OK) {
+        return error;
+    }
+    return forwarded ? HF_DeleteSlot(fd, where) : HFE_OK;
 }
 
 /*
- * Deletes a record from the page, given its slot number.
+ * Replaces the record with RID "rid" by "record", recLen bytes.
  *
- * This is a "lazy" delete: it just marks the slot as free
- * by setting its length to -1. It does not reclaim the space
- * or compact the page.
+ * A long record is written to overflow pages first, and its
+ * HF_LongRec replaces the record; the overflow pages of the record
+ * replaced are given back once it is.
  */
-int HF_Page_DeleteRec(char *pageBuf, int slotNum) {
-    HF_PageHeader *header = HF_GetPageHeader(pageBuf);
-    HF_SlotEntry *slotArray = HF_GetSlotArray(pageBuf);
+int HF_UpdateRec(int fd, RID rid, char *record, int recLen) {
+    HF_Layout layout;
+    HF_LongRec old, lr;
+    int flags = 0;
+    int error;
 
-    // 1. Check if the slot number is valid
-    if (slotNum < 0 || slotNum >= header->numSlots) {
-        return HFE_INVALIDSLOT;
+    if ((error = HF_GetLayout(fd, &layout)) != HFE_OK) {
+        return error;
     }
+    lr.firstPage = -1;
+    if (layout.recLen <= 0 && recLen > HF_LayoutMaxInline(&layout, PF_GetPageSize(fd))) {
+        if ((error = HF_LongWrite(fd, record, recLen, &lr)) != HFE_OK) {
+            return error;
+        }
+        record = (char*)&lr;
+        recLen = sizeof(lr);
+        flags = HF_SLOT_LONG;
+    }
+    if ((error = HF_UpdateRecFlags(fd, rid, record, recLen, flags, &old)) != HFE_OK) {
+        if (lr.firstPage != -1) {
+            HF_LongFree(fd, lr.firstPage);
+        }
+        return error;
+    }
+    return (old.firstPage != -1) ? HF_LongFree(fd, old.firstPage) : HFE_OK;
+}
+
+/*
+ * Compacts the pages where deleted records take up at least
+ * 1/HF_VACUUM_FRACTION of the page. RIDs do not change.
+ */
+int HF_Vacuum(int fd, long *bytesReclaimed) {
+    int pageSize = PF_GetPageSize(fd);
+    int pagenum = -1;
+    char *pageBuf;
+    int error;
 
-    HF_SlotEntry *slot = &slotArray[slotNum];
+    *bytesReclaimed = 0;
 
-    // 2. Check if it's already deleted
-    if (slot->length == -1) {
-        return HFE_INVALIDSLOT;
+    // Pages of a bulk append must be on disk before they are read
+    if ((error = HF_EndBulkAppend(fd)) != HFE_OK) {
+        return error;
     }
 
-    // 3. "Delete" the record by invalidating its slot
-    slot->length = -1;
+    while ((error = HF_PinNextPage(fd, &pagenum, &pageBuf)) == PFE_OK) {
+        int gained = 0;
 
-    return HFE_OK;
+        // (A held page's records stay put until it is let go)
+        if (HF_IsSlottedPage(pageBuf) && !HF_PageHeld(fd, pagenum)) {
+            // Dead bytes (slotted pages only): the free bytes that are not in the middle gap
+            int gap = HF_DataStart(pageBuf) - HF_SlotsEnd(pageBuf, HF_NumSlots(pageBuf));
+            int dead = HF_Page_FreeBytes(pageBuf, pageSize) - gap;
+            if (dead > 0 && dead >= pageSize / HF_VACUUM_FRACTION) {
+                gained = HF_Page_Compact(pageBuf, pageSize);
+            }
+        }
+        int freeBytes = (gained > 0) ? HF_Page_FreeBytes(pageBuf, pageSize) : 0;
+        if ((error = HF_UnpinPage(fd, pagenum, gained > 0)) != PFE_OK) {
+            return error;
+        }
+        if (gained > 0) {
+            *bytesReclaimed += gained;
+            if ((error = HF_FsmUpdate(fd, pagenum, freeBytes)) != HFE_OK) {
+                return error;
+            }
+        }
+    }
+    return (error == PFE_EOF) ? HFE_OK : error;
 }
 
 /*
- * Retrieves a specific record from a page.
- *
- * Inputs:
- * pageBuf: Pointer to the page data
- * slotNum: The slot of the record to retrieve
- *
- * Outputs:
- * record: A pointer to the record data *within the page buffer*
- * recLen: The length of the record
- *
- * Returns:
- * HFE_OK if successful
- * HFE_INVALIDSLOT if the slot is invalid or deleted
+ * Adds a zone map on the given fields to a slotted or dictionary file.
  */
-int HF_Page_GetRec(char *pageBuf, int slotNum, char **record, int *recLen) {
-    HF_PageHeader *header = HF_GetPageHeader(pageBuf);
-    HF_SlotEntry *slotArray = HF_GetSlotArray(pageBuf);
+int HF_CreateZoneMap(int fd, int numFields, int fields[]) {
+    int pageSize = PF_GetPageSize(fd);
+    HF_Layout layout;
+    HF_ZoneRoot zones;
+    int pagenum = -1;
+    char *pageBuf;
+    int hasFsm, error;
 
-    // 1. Check if the slot number is valid
-    if (slotNum < 0 || slotNum >= header->numSlots) {
-        return HFE_INVALIDSLOT;
+    if (numFields < 1 || numFields > HF_ZONE_MAX_FIELDS) {
+        return HFE_NOFIELDS;
+    }
+    for (int f = 0; f < numFields; f++) {
+        if (fields[f] < 0) {
+            return HFE_NOFIELDS;
+        }
+    }
+    if ((hasFsm = HF_FsmPresent(fd)) < 0) {
+        return hasFsm;
+    }
+    if ((error = HF_GetLayout(fd, &layout)) != HFE_OK) {
+        return error;
+    }
+    if (!hasFsm || layout.recLen > 0 || layout.pax.numFields > 0 ||
+            layout.zones.numFields > 0) {
+        return HFE_NOZONEMAP;
     }
 
-    HF_SlotEntry *slot = &slotArray[slotNum];
+    // Pages of a bulk append must be on disk before they are read
+    if ((error = HF_EndBulkAppend(fd)) != HFE_OK) {
+        return error;
+    }
 
-    // 2. Check if the slot is deleted
-    if (slot->length == -1) {
-        return HFE_INVALIDSLOT;
+    // 1. The first zone map page
+    memset(&zones, 0, sizeof(zones));
+    zones.numFields = numFields;
+    memcpy(zones.fields, fields, numFields * sizeof(int));
+    if ((error = PF_AllocPage(fd, &zones.firstPage, &pageBuf)) != PFE_OK) {
+        return error;
+    }
+    HF_ZoneInitPage(pageBuf, pageSize, numFields);
+    if ((error = PF_UnfixPage(fd, zones.firstPage, TRUE)) != PFE_OK) {
+        return error;
     }
 
-    // 3. Set the output pointers
-    *record = pageBuf + slot->offset;
-    *recLen = slot->length;
+    // 2. The entries of the pages there are
+    while ((error = HF_PinNextPage(fd, &pagenum, &pageBuf)) == PFE_OK) {
+        int zoneError = HF_IsSlottedPage(pageBuf) ?
+            HF_ZoneUpdate(fd, &zones, pagenum, pageBuf, -1) : HFE_OK;
+        if ((error = HF_UnpinPage(fd, pagenum, FALSE)) != PFE_OK) {
+            return error;
+        }
+        if (zoneError != HFE_OK) {
+            return zoneError;
+        }
+    }
+    if (error != PFE_EOF) {
+        return error;
+    }
 
-    return HFE_OK;
+    // 3. Only now that they are right does the root go in page 0
+    if ((error = PF_GetThisPage(fd, 0, &pageBuf)) != PFE_OK) {
+        return error;
+    }
+    ((HF_FsmHeader*)pageBuf)->zones = zones;
+    return PF_UnfixPage(fd, 0, TRUE);
 }
 
-
 /*
- * Scans the page for the next valid record.
- *
- * Inputs:
- * pageBuf: Pointer to the page data
- * currentSlotNum: The slot number to *start scanning from*
- * (pass -1 to start from the beginning)
- *
- * Outputs:
- * record: A pointer to the next record's data
- * recLen: The length of the next record
- *
- * Returns:
- * The slot number of the record found.
- * HFE_EOF if no more valid records are found.
+ * Gets the range of a field on a page from the zone map.
  */
-int HF_Page_GetNextRec(char *pageBuf, int currentSlotNum, char **record, int *recLen) {
-    HF_PageHeader *header = HF_GetPageHeader(pageBuf);
-    HF_SlotEntry *slotArray = HF_GetSlotArray(pageBuf);
+int HF_GetZone(int fd, int pagenum, int field, double *min, double *max) {
+    HF_Layout layout;
+    HF_ZoneRange range;
+    char *entry;
+    int zonePage;
+    int error;
 
-    // 1. Start scanning from the *next* slot
-    for (int i = currentSlotNum + 1; i < header->numSlots; i++) {
-        
-        // 2. Check if this slot is valid (not deleted)
-        if (slotArray[i].length != -1) {
-            
-            // 3. Found a valid record. Set output pointers.
-            *record = pageBuf + slotArray[i].offset;
-            *recLen = slotArray[i].length;
-            
-            // 4. Return the slot number we found it in
-            return i;
+    if ((error = HF_GetLayout(fd, &layout)) != HFE_OK) {
+        return error;
+    }
+    for (int f = 0; f < layout.zones.numFields; f++) {
+        if (layout.zones.fields[f] != field) {
+            continue;
+        }
+        if ((error = HF_ZoneEntry(fd, &layout.zones, pagenum, FALSE,
+                                  &zonePage, &entry)) != HFE_OK) {
+            return error;
+        }
+        if (zonePage == -1) {
+            // Past the zone map pages: no records were put there
+            *min = HUGE_VAL;
+            *max = -HUGE_VAL;
+            return HFE_OK;
         }
+        memcpy(&range, entry + f * sizeof(HF_ZoneRange), sizeof(range));
+        *min = range.min;
+        *max = range.max;
+        return PF_UnfixPage(fd, zonePage, FALSE);
     }
-
-    // 5. No more valid records were found on this page
-    return HFE_EOF;
+    return HFE_NOZONEMAP;
 }
 
 /*
  * ======================================================
- * File-level HF Layer Function Implementations
+ * Pinned Records
  * ======================================================
  */
 
+/* Memory that long records are put together in, grown as needed */
+typedef struct {
+    char *buf;
+    int size;
+    int lock;       // TRUE to take PF_Lock around PF calls
+} HF_LongBuf;
+
+static HF_LongBuf HF_longRec = { NULL, 0, FALSE };     // for HF_GetRec
+static HF_LongBuf HF_longScan = { NULL, 0, FALSE };    // for scans
+
 /*
- * Creates a new, empty heap file.
- * This is just a wrapper for the PF layer.
+ * Puts the long record *lr together in lb, an overflow page at a
+ * time, and sets *record to it. An overflow page fixed by someone
+ * else (a worker of a parallel scan going over it) is read all the
+ * same, as it is in the buffer pool.
  */
-int HF_CreateFile(char *fileName) {
-    // Call the PF layer to create the file
-    if (PF_CreateFile(fileName) != PFE_OK) {
-        return PFerrno; // Return PF layer's error code
+static int HF_LongRead(int fd, HF_LongRec *lr, HF_LongBuf *lb, char **record) {
+    char *pageBuf;
+    int done = 0;
+    int error = HFE_OK;
+
+    if (lr->recLen > lb->size) {
+        char *buf = realloc(lb->buf, lr->recLen);
+        if (buf == NULL) {
+            PFerrno = PFE_NOMEM;
+            return PFerrno;
+        }
+        lb->buf = buf;
+        lb->size = lr->recLen;
     }
-    return HFE_OK;
+    for (int pagenum = lr->firstPage; pagenum != -1 && error == HFE_OK; ) {
+        if (lb->lock) {
+            PF_Lock();
+        }
+        int pinError = HF_PinPage(fd, pagenum, &pageBuf);
+        if (pinError == PFE_OK || pinError == PFE_PAGEFIXED) {
+            HF_OverflowHeader *ov = (HF_OverflowHeader*)pageBuf;
+            int next = ov->nextPage;
+            if (ov->numSlots != HF_OVERFLOW_PAGE || ov->length > lr->recLen - done) {
+                error = HFE_INVALIDSLOT;
+            } else {
+                memcpy(lb->buf + done, pageBuf + sizeof(HF_OverflowHeader), ov->length);
+                done += ov->length;
+            }
+            if (pinError == PFE_OK && HF_UnpinPage(fd, pagenum, FALSE) != PFE_OK) {
+                error = PFE_UNIX;
+            }
+            pagenum = next;
+        } else {
+            error = pinError;
+        }
+        if (lb->lock) {
+            PF_Unlock();
+        }
+    }
+    if (error == HFE_OK && done != lr->recLen) {
+        error = HFE_INVALIDSLOT;
+    }
+    *record = lb->buf;
+    return error;
 }
 
 /*
- * Opens an existing heap file.
- * This is just a wrapper for the PF layer.
- * Returns a file descriptor (fd) from the PF layer.
+ * Retrieves a record from the file, given its RID.
+ *
+ * Outputs:
+ * record: Pointer to the record data *within the buffer page*
+ * recLen: Length of the record
+ *
+ * WARNING: The 'record' pointer is only valid until the page
+ * is unfixed. The caller must copy the data if needed, or pin
+ * the record instead (see HF_PinRec). A long record is put together
+ * in HF_longRec, which the next call overwrites.
  */
-int HF_OpenFile(char *fileName) {
-    // Call the PF layer to open the file
-    int fd = PF_OpenFile(fileName);
-    if (fd < 0) {
-        return PFerrno; // Return PF layer's error code
+int HF_GetRec(int fd, RID rid, char **record, int *recLen) {
+    char *pageBuf;
+    HF_LongRec lr;
+    int error;
+
+    // 1. Get the specific page the record is on (it may be pinned
+    //    by a record handle, see HF_PinRec)
+    if ((error = HF_PinPage(fd, rid.pageNum, &pageBuf)) != PFE_OK) {
+        return error;
     }
-    return fd; // Return the file descriptor
-}
 
-/*
- * Closes a heap file.
- * This is just a wrapper for the PF layer.
- */
-int HF_CloseFile(int fd) {
-    // Call the PF layer to close the file
-    if (PF_CloseFile(fd) != PFE_OK) {
-        return PFerrno; // Return PF layer's error code
+    // 2. Call our page-level get function
+    error = HF_Page_GetRec(pageBuf, rid.slotNum, record, recLen);
+    RID where, home;
+    if (error == HFE_FORWARDED) {
+        memcpy(&where, *record, sizeof(RID));
+    } else if ((error == HFE_OK || error == HFE_LONGREC) &&
+               HF_PageHomeRID(pageBuf, rid.slotNum, &home)) {
+        error = HFE_INVALIDSLOT;    // only found through its home RID
+    } else if (error == HFE_LONGREC) {
+        memcpy(&lr, *record, sizeof(HF_LongRec));
     }
-    return HFE_OK;
+
+    // 3. Unfix the page (it wasn't modified), unless a handle pins it
+    if (HF_UnpinPage(fd, rid.pageNum, FALSE) != PFE_OK) {
+        return PFE_UNIX;
+    }
+
+    // 4. The record was moved by HF_UpdateRec: follow the stub
+    if (error == HFE_FORWARDED) {
+        if ((error = HF_PinPage(fd, where.pageNum, &pageBuf)) != PFE_OK) {
+            return error;
+        }
+        error = HF_Page_GetRec(pageBuf, where.slotNum, record, recLen);
+        if (error == HFE_LONGREC) {
+            memcpy(&lr, *record, sizeof(HF_LongRec));
+        }
+        if (HF_UnpinPage(fd, where.pageNum, FALSE) != PFE_OK) {
+            return PFE_UNIX;
+        }
+    }
+
+    // 5. A long record is put together from its overflow pages
+    if (error == HFE_LONGREC) {
+        *recLen = lr.recLen;
+        error = HF_LongRead(fd, &lr, &HF_longRec, record);
+    }
+    return error; // Return result of HF_Page_GetRec
 }
 
 /*
- * Inserts a record into the file.
+ * Pins a record, as HF_PinRec does, unless it is a long record: then
+ * nothing is pinned, *lr is set to its HF_LongRec and HFE_LONGREC is
+ * returned.
  *
- * This function scans the file page by page to find one
- * with enough free space. If no page has space, it
- * allocates a new page and inserts the record there.
+ * As in HF_GetRec, a forwarding stub is followed to the page the
+ * record was moved to, and that page is the one pinned.
  */
-int HF_InsertRec(int fd, char *record, int recLen, RID *rid) {
-    int pagenum = -1; // Start scan from the beginning
+static int HF_PinRecord(int fd, RID rid, HF_RecHandle *handle, HF_LongRec *lr) {
     char *pageBuf;
     int error;
-    int slotNum;
 
-    // 1. Scan the file for a page with free space
-    while ((error = PF_GetNextPage(fd, &pagenum, &pageBuf)) == PFE_OK) {
-        
-        // Try to insert the record on this page
-        // (We call our old page-level insert function)
-        slotNum = HF_Page_InsertRec(pageBuf, record, recLen);
-        
-        if (slotNum == HFE_PAGENOFREE) {
-            // This page is full, unfix it and try the next one
-            if ((error = PF_UnfixPage(fd, pagenum, FALSE)) != PFE_OK) {
-                return error; // Propagate PF error
-            }
-            continue; // Go to the next page
-        }
-        
-        // --- Success! We found space and inserted the record ---
-        
-        // Set the output RID
-        rid->pageNum = pagenum;
-        rid->slotNum = slotNum;
-        
-        // Mark the page as dirty (it was modified) and unfix it
-        if ((error = PF_UnfixPage(fd, pagenum, TRUE)) != PFE_OK) {
+    handle->fd = fd;
+    handle->pageNum = -1;
+    handle->record = NULL;
+    handle->copy = NULL;
+
+    // 1. Pin the record's home page
+    if ((error = HF_PinPage(fd, rid.pageNum, &pageBuf)) != PFE_OK) {
+        return error;
+    }
+    error = HF_Page_GetRec(pageBuf, rid.slotNum, &handle->record, &handle->recLen);
+    RID where, home;
+    if (error == HFE_FORWARDED) {
+        memcpy(&where, handle->record, sizeof(RID));
+    } else if ((error == HFE_OK || error == HFE_LONGREC) &&
+               HF_PageHomeRID(pageBuf, rid.slotNum, &home)) {
+        error = HFE_INVALIDSLOT;    // only found through its home RID
+    }
+
+    // 2. Or the page it was moved to
+    if (error == HFE_FORWARDED) {
+        HF_UnpinPage(fd, rid.pageNum, FALSE);
+        if ((error = HF_PinPage(fd, where.pageNum, &pageBuf)) != PFE_OK) {
             return error;
         }
-        
-        // Return success
-        return HFE_OK;
-    }
-    
-    // 2. We reached here, so PF_GetNextPage failed.
-    // Check if it was because we reached the End Of File (EOF).
-    if (error != PFE_EOF) {
-        return error; // It was a real error
+        rid = where;
+        error = HF_Page_GetRec(pageBuf, rid.slotNum, &handle->record, &handle->recLen);
     }
-    
-    // 3. --- No page had free space, so we must allocate a new one ---
-    
-    // Allocate a new page
-    if ((error = PF_AllocPage(fd, &pagenum, &pageBuf)) != PFE_OK) {
-        return error; // Propagate PF error
+    if (error == HFE_LONGREC) {
+        memcpy(lr, handle->record, sizeof(HF_LongRec));
     }
-    
-    // Initialize the new page
-    HF_InitPage(pageBuf);
-    
-    // Insert the record (this *must* succeed on a new page)
-    slotNum = HF_Page_InsertRec(pageBuf, record, recLen);
-    
-    // Set the output RID
-    rid->pageNum = pagenum;
-    rid->slotNum = slotNum;
-    
-    // Mark the new page as dirty and unfix it
-    if ((error = PF_UnfixPage(fd, pagenum, TRUE)) != PFE_OK) {
+    if (error != HFE_OK) {
+        HF_UnpinPage(fd, rid.pageNum, FALSE);
+        handle->record = NULL;
         return error;
     }
 
+    // 3. A PAX record was put together in HF_paxRec, and an encoded one
+    //    decoded in HF_dictRec: it needs a copy of its own, and then
+    //    not its page
+    if (HF_IsPaxPage(pageBuf) || handle->record == HF_dictRec) {
+        if ((handle->copy = malloc(handle->recLen)) == NULL) {
+            HF_UnpinPage(fd, rid.pageNum, FALSE);
+            PFerrno = PFE_NOMEM;
+            return PFerrno;
+        }
+        memcpy(handle->copy, handle->record, handle->recLen);
+        handle->record = handle->copy;
+        return HF_UnpinPage(fd, rid.pageNum, FALSE);
+    }
+    handle->pageNum = rid.pageNum;
+    HF_HoldPage(fd, rid.pageNum, 1);
+    return HFE_OK;
+}
+
+/*
+ * Pins a record. A long record is put together in a copy of the
+ * handle's own, as a PAX record is.
+ */
+int HF_PinRec(int fd, RID rid, HF_RecHandle *handle) {
+    HF_LongRec lr;
+    int error = HF_PinRecord(fd, rid, handle, &lr);
+
+    if (error != HFE_LONGREC) {
+        return error;
+    }
+    if ((handle->copy = malloc(lr.recLen)) == NULL) {
+        PFerrno = PFE_NOMEM;
+        return PFerrno;
+    }
+    HF_LongBuf lb = { handle->copy, lr.recLen, FALSE };
+    if ((error = HF_LongRead(fd, &lr, &lb, &handle->record)) != HFE_OK) {
+        free(handle->copy);
+        handle->record = handle->copy = NULL;
+        return error;
+    }
+    handle->recLen = lr.recLen;
     return HFE_OK;
 }
 
 /*
- * Deletes a record from the file, given its RID.
+ * Releases a pinned record.
  */
-int HF_DeleteRec(int fd, RID rid) {
-    char *pageBuf;
+int HF_ReleaseRec(HF_RecHandle *handle) {
+    int error = HFE_OK;
+
+    if (handle->pageNum >= 0) {
+        HF_HoldPage(handle->fd, handle->pageNum, -1);
+        error = HF_UnpinPage(handle->fd, handle->pageNum, FALSE);
+    }
+    free(handle->copy);
+    handle->pageNum = -1;
+    handle->record = handle->copy = NULL;
+    return error;
+}
+
+/*
+ * Pins several records, releasing those pinned so far if one fails.
+ */
+int HF_PinRecs(int fd, RID rids[], int n, HF_RecHandle handles[]) {
     int error;
-    
-    // 1. Get the specific page the record is on
-    if ((error = PF_GetThisPage(fd, rid.pageNum, &pageBuf)) != PFE_OK) {
-        return error;
+
+    for (int i = 0; i < n; i++) {
+        if ((error = HF_PinRec(fd, rids[i], &handles[i])) != HFE_OK) {
+            HF_ReleaseRecs(handles, i);
+            return error;
+        }
     }
-    
-    // 2. Call our page-level delete function
-    error = HF_Page_DeleteRec(pageBuf, rid.slotNum);
-    
-    // 3. Mark the page as dirty and unfix it
-    if (PF_UnfixPage(fd, rid.pageNum, TRUE) != PFE_OK) {
-        return PFE_UNIX; // Return a generic error if unfix fails
+    return HFE_OK;
+}
+
+int HF_ReleaseRecs(HF_RecHandle handles[], int n) {
+    int error = HFE_OK;
+
+    for (int i = 0; i < n; i++) {
+        int e = HF_ReleaseRec(&handles[i]);
+        if (error == HFE_OK) {
+            error = e;
+        }
     }
-    
-    return error; // Return result of HF_DeleteRec
+    return error;
 }
 
 /*
- * Retrieves a record from the file, given its RID.
- *
- * Outputs:
- * record: Pointer to the record data *within the buffer page*
- * recLen: Length of the record
- *
- * WARNING: The 'record' pointer is only valid until the page
- * is unfixed. The caller must copy the data if needed.
+ * Opens a stream on a record. A record in one piece is pinned with
+ * the stream's handle; a long record is only found, and its overflow
+ * pages are pinned one at a time as they are read.
  */
-int HF_GetRec(int fd, RID rid, char **record, int *recLen) {
+int HF_OpenRecStream(int fd, RID rid, HF_RecStream *stream) {
+    HF_LongRec lr;
+    int error = HF_PinRecord(fd, rid, &stream->whole, &lr);
+
+    stream->fd = fd;
+    stream->pageNum = -1;
+    stream->nextPage = -1;
+    stream->pieces = 0;
+    if (error == HFE_LONGREC) {
+        stream->recLen = lr.recLen;
+        stream->nextPage = lr.firstPage;
+        return HFE_OK;
+    }
+    stream->recLen = stream->whole.recLen;
+    return error;
+}
+
+/*
+ * Gives the next piece of a record: the whole of a record in one
+ * piece, or the bytes of the next overflow page of a long record,
+ * in place on the page.
+ */
+int HF_ReadRecStream(HF_RecStream *stream, char **chunk, int *len) {
     char *pageBuf;
     int error;
 
-    // 1. Get the specific page the record is on
-    if ((error = PF_GetThisPage(fd, rid.pageNum, &pageBuf)) != PFE_OK) {
+    // 1. A record in one piece
+    if (stream->whole.record != NULL) {
+        if (stream->pieces > 0) {
+            return HFE_EOF;
+        }
+        *chunk = stream->whole.record;
+        *len = stream->whole.recLen;
+        stream->pieces++;
+        return HFE_OK;
+    }
+
+    // 2. A long record: the page of the last piece is done with
+    if (stream->pageNum != -1) {
+        error = HF_UnpinPage(stream->fd, stream->pageNum, FALSE);
+        stream->pageNum = -1;
+        if (error != PFE_OK) {
+            return error;
+        }
+    }
+    if (stream->nextPage == -1) {
+        return HFE_EOF;
+    }
+    if ((error = HF_PinPage(stream->fd, stream->nextPage, &pageBuf)) != PFE_OK) {
         return error;
     }
+    stream->pageNum = stream->nextPage;
+    HF_OverflowHeader *ov = (HF_OverflowHeader*)pageBuf;
+    if (ov->numSlots != HF_OVERFLOW_PAGE) {
+        return HFE_INVALIDSLOT;     // unpinned by HF_CloseRecStream
+    }
+    *chunk = pageBuf + sizeof(HF_OverflowHeader);
+    *len = ov->length;
+    stream->nextPage = ov->nextPage;
+    stream->pieces++;
+    return HFE_OK;
+}
 
-    // 2. Call our page-level get function
-    error = HF_Page_GetRec(pageBuf, rid.slotNum, record, recLen);
+/*
+ * Closes a stream: releases its handle, or unpins the overflow page
+ * of the last piece.
+ */
+int HF_CloseRecStream(HF_RecStream *stream) {
+    int error = HF_ReleaseRec(&stream->whole);
 
-    // 3. Unfix the page (it wasn't modified)
-    if (PF_UnfixPage(fd, rid.pageNum, FALSE) != PFE_OK) {
-        return PFE_UNIX;
+    if (stream->pageNum != -1) {
+        int unpinError = HF_UnpinPage(stream->fd, stream->pageNum, FALSE);
+        if (error == HFE_OK) {
+            error = unpinError;
+        }
+        stream->pageNum = -1;
     }
-
-    return error; // Return result of HF_Page_GetRec
+    return error;
 }
 
 /*
@@ -367,6 +3631,149 @@ int HF_GetRec(int fd, RID rid, char **record, int *recLen) {
  * ======================================================
  */
 
+/* Tells whether a field, len bytes at "value", satisfies a predicate */
+static int HF_PredTest(HF_Pred *pred, const char *value, int len) {
+    int cmp;
+
+    if (pred->op & HF_OP_NUM) {
+        double v;
+        if (!HF_ParseNumber(value, len, &v)) {
+            return FALSE;
+        }
+        cmp = (v > pred->num) - (v < pred->num);
+    } else if (pred->op == HF_OP_EQ || pred->op == HF_OP_NE) {
+        cmp = (len != pred->len || memcmp(value, pred->value, len) != 0);
+    } else {
+        cmp = memcmp(value, pred->value, len < pred->len ? len : pred->len);
+        if (cmp == 0) {
+            cmp = len - pred->len;
+        }
+    }
+    switch (pred->op & ~HF_OP_NUM) {
+    case HF_OP_EQ: return cmp == 0;
+    case HF_OP_NE: return cmp != 0;
+    case HF_OP_LT: return cmp < 0;
+    case HF_OP_LE: return cmp <= 0;
+    case HF_OP_GT: return cmp > 0;
+    default:       return cmp >= 0;
+    }
+}
+
+/*
+ * Works out the scan's dictCodes for a dictionary page: for each of
+ * its first HF_DICT_PREDS predicates, the code of the value that an
+ * HF_OP_EQ or HF_OP_NE predicate compares with (-1 if it is not in
+ * the page's dictionary), or -2 for one that compares otherwise.
+ * This is done once a page, as the scan starts on it.
+ */
+static void HF_ScanDictCodes(HF_Scan *scan, char *pageBuf) {
+    for (int p = 0; p < scan->numPreds && p < HF_DICT_PREDS; p++) {
+        HF_Pred *pred = &scan->preds[p];
+        scan->dictCodes[p] = (pred->op == HF_OP_EQ || pred->op == HF_OP_NE) ?
+            HF_DictCode(pageBuf, pred->value, pred->len) : -2;
+    }
+}
+
+/*
+ * Tells whether the record in a slot of a page matches the scan's
+ * predicates. Records of slotted and fixed pages are tested in
+ * place, given as rec and len; those of PAX pages field by field in
+ * their minipages, so rec is not needed. Nor is it for an encoded
+ * record of a dictionary page, which is tested as it is: a field
+ * that is a code against the code of the value of a predicate in
+ * dictCodes, which HF_ScanDictCodes has worked out for the page.
+ */
+static int HF_ScanMatch(HF_Scan *scan, char *pageBuf, int slot, const char *rec, int len) {
+    int pax = HF_IsPaxPage(pageBuf);
+    int encoded = (!pax && rec == NULL);
+
+    if (encoded) {
+        rec = pageBuf + HF_SlotOffset(pageBuf, slot);
+        len = HF_SlotBytes(HF_SlotLength(pageBuf, slot));
+    }
+    for (int p = 0; p < scan->numPreds; p++) {
+        HF_Pred *pred = &scan->preds[p];
+        const char *value;
+        int valueLen, code;
+        if (encoded) {
+            if ((valueLen = HF_DictField(pageBuf, rec, len, pred->field, &value, &code)) < 0) {
+                return FALSE;
+            }
+            int want = (p < HF_DICT_PREDS) ? scan->dictCodes[p] : -2;
+            if (want >= -1 && (code >= 0 || want >= 0)) {
+                // A value of the dictionary is always a code in an encoded record
+                if ((code == want) != (pred->op == HF_OP_EQ)) {
+                    return FALSE;
+                }
+                continue;
+            }
+        } else if (pax) {
+            char *v;
+            if (HF_Page_GetField(pageBuf, slot, pred->field, &v, &valueLen) != HFE_OK) {
+                return FALSE;
+            }
+            while (valueLen > 0 && (v[valueLen - 1] == ' ' || v[valueLen - 1] == '\0')) {
+                valueLen--;
+            }
+            value = v;
+        } else if ((valueLen = HF_FindField(rec, len, pred->field, &value)) < 0) {
+            return FALSE;
+        }
+        if (!HF_PredTest(pred, value, valueLen)) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/*
+ * Finds the next record on the scan's page after its current slot
+ * that matches the scan's predicates. Records of PAX pages are put
+ * together only if they match, and encoded records of dictionary
+ * pages decoded; long records are left to be tested once they are
+ * put together. Returns the slot, or HFE_EOF.
+ */
+static int HF_ScanNextMatch(HF_Scan *scan, char **record, int *recLen) {
+    char *pageBuf = scan->currentPageBuf;
+    int slot = scan->currentSlotNum;
+
+    if (scan->numPreds == 0) {
+        return HF_Page_GetNextRec(pageBuf, slot, record, recLen);
+    }
+    if (HF_IsPaxPage(pageBuf)) {
+        while ((slot = HF_FixedNextRow(pageBuf, slot)) >= 0) {
+            if (HF_ScanMatch(scan, pageBuf, slot, NULL, 0)) {
+                return HF_FixedGetRec(pageBuf, slot, record, recLen) == HFE_OK ? slot : HFE_EOF;
+            }
+        }
+        return HFE_EOF;
+    }
+    if (HF_IsDictPage(pageBuf)) {
+        // Encoded records are only decoded if they match
+        if (slot < 0) {
+            HF_ScanDictCodes(scan, pageBuf);
+        }
+        for (slot++; slot < HF_NumSlots(pageBuf); slot++) {
+            int length = HF_SlotLength(pageBuf, slot);
+            if (length == HF_SLOT_FREE || length == HF_SLOT_FORWARD ||
+                    ((length & HF_SLOT_DICT) && !HF_ScanMatch(scan, pageBuf, slot, NULL, 0))) {
+                continue;
+            }
+            HF_Page_GetRec(pageBuf, slot, record, recLen);
+            if ((length & (HF_SLOT_DICT | HF_SLOT_LONG)) ||
+                    HF_ScanMatch(scan, pageBuf, slot, *record, *recLen)) {
+                return slot;
+            }
+        }
+        return HFE_EOF;
+    }
+    while ((slot = HF_Page_GetNextRec(pageBuf, slot, record, recLen)) >= 0 &&
+           !HF_SlotIsLong(pageBuf, slot) &&
+           !HF_ScanMatch(scan, pageBuf, slot, *record, *recLen)) {
+    }
+    return slot;
+}
+
 /*
  * Opens a new file scan.
  *
@@ -385,10 +3792,51 @@ int HF_OpenFileScan(int fd, HF_Scan *scan) {
     
     // No page is pinned in the buffer yet
     scan->currentPageBuf = NULL;
+
+    // Every record matches
+    scan->preds = NULL;
+    scan->numPreds = 0;
+
+    // ... so no page can be skipped
+    scan->zones.numFields = 0;
     
     return HFE_OK;
 }
 
+/*
+ * Opens a new file scan that gives only the records matching preds.
+ *
+ * The predicates are checked, and their values worked out, here,
+ * so that the scan only has to compare.
+ */
+int HF_OpenFileScanWhere(int fd, HF_Scan *scan, HF_Pred *preds, int numPreds) {
+    for (int p = 0; p < numPreds; p++) {
+        HF_Pred *pred = &preds[p];
+        int op = pred->op & ~HF_OP_NUM;
+        if (pred->field < 0 || op < HF_OP_EQ || op > HF_OP_GE ||
+                (pred->op & ~(HF_OP_NUM | 0xf)) != 0 || pred->value == NULL) {
+            return HFE_BADPRED;
+        }
+        pred->len = strlen(pred->value);
+        if ((pred->op & HF_OP_NUM) &&
+                !HF_ParseNumber(pred->value, pred->len, &pred->num)) {
+            return HFE_BADPRED;
+        }
+    }
+    HF_OpenFileScan(fd, scan);
+    scan->preds = preds;
+    scan->numPreds = numPreds;
+    return HF_ZoneForPreds(fd, preds, numPreds, &scan->zones);
+}
+
+/*
+ * Unpins the scan's current page, which it held (see HF_HoldPage).
+ */
+static int HF_ScanUnpin(HF_Scan *scan) {
+    HF_HoldPage(scan->fd, scan->currentPageNum, -1);
+    return HF_UnpinPage(scan->fd, scan->currentPageNum, FALSE);
+}
+
 /*
  * Closes a file scan.
  *
@@ -401,7 +3849,7 @@ int HF_CloseFileScan(HF_Scan *scan) {
     // Check if a page is still pinned in the buffer
     if (scan->currentPageBuf != NULL) {
         // Unfix it (it wasn't modified)
-        error = PF_UnfixPage(scan->fd, scan->currentPageNum, FALSE);
+        error = HF_ScanUnpin(scan);
         if (error != PFE_OK) {
             return error;
         }
@@ -415,12 +3863,42 @@ int HF_CloseFileScan(HF_Scan *scan) {
 }
 
 /*
- * Retrieves the next valid record in the file scan.
+ * Fixes the page after the scan's current one, skipping those the
+ * zone map says hold no match. Returns PFE_OK, PFE_EOF or an error.
  */
+static int HF_ScanNextPage(HF_Scan *scan) {
+    int error;
+
+    while (TRUE) {
+        int next = scan->currentPageNum + 1;
+        if (scan->zones.numFields > 0 &&
+                (error = HF_ZoneNextPage(scan->fd, &scan->zones, scan->preds,
+                                         scan->numPreds, scan->currentPageNum, &next)) != HFE_OK) {
+            return error;
+        }
+        scan->currentPageNum = next - 1;
+        error = HF_PinNextPage(scan->fd, &scan->currentPageNum, &scan->currentPageBuf);
+        if (error != PFE_OK) {
+            return error;
+        }
+        HF_HoldPage(scan->fd, scan->currentPageNum, 1);
+        if (scan->currentPageNum == next || scan->zones.numFields == 0) {
+            return PFE_OK;
+        }
+        // Page "next" is not in the file: the one after it gets checked too
+        if ((error = HF_ScanUnpin(scan)) != PFE_OK) {
+            return error;
+        }
+        scan->currentPageBuf = NULL;
+        scan->currentPageNum--;
+    }
+}
+
 /*
- * Retrieves the next valid record in the file scan.
+ * Retrieves the next valid record in the file scan: the whole of
+ * it, or only field "field" if that is not -1.
  */
-int HF_GetNextRec(int fd, HF_Scan *scan, RID *rid, char **record, int *recLen) {
+static int HF_ScanNext(HF_Scan *scan, int field, RID *rid, char **record, int *recLen) {
     int error;
 
     // This is the main scanner loop
@@ -432,10 +3910,39 @@ int HF_GetNextRec(int fd, HF_Scan *scan, RID *rid, char **record, int *recLen) {
         if (scan->currentPageBuf != NULL) {
             
             // Call our page-level scanner. It returns the slot number.
-            int slot = HF_Page_GetNextRec(scan->currentPageBuf, 
-                                        scan->currentSlotNum, 
-                                        record, 
-                                        recLen);
+            int slot;
+            if (field < 0) {
+                slot = HF_ScanNextMatch(scan, record, recLen);
+            } else if (HF_IsPaxPage(scan->currentPageBuf)) {
+                // Only the field's minipage is read (and those of the predicates)
+                slot = scan->currentSlotNum;
+                while ((slot = HF_FixedNextRow(scan->currentPageBuf, slot)) >= 0 &&
+                       !HF_ScanMatch(scan, scan->currentPageBuf, slot, NULL, 0)) {
+                }
+                if (slot >= 0 && (error = HF_Page_GetField(scan->currentPageBuf,
+                        slot, field, record, recLen)) != HFE_OK) {
+                    return error;
+                }
+            } else if (HF_GetPageHeader(scan->currentPageBuf)->numSlots == HF_FSM_PAGE) {
+                slot = HFE_EOF;
+            } else {
+                return HFE_NOFIELDS;    // records of other pages have no fields
+            }
+
+            if (slot >= 0 && field < 0 && HF_SlotIsLong(scan->currentPageBuf, slot)) {
+                // A long record is put together, and only then tested
+                HF_LongRec lr;
+                memcpy(&lr, *record, sizeof(HF_LongRec));
+                scan->currentSlotNum = slot;
+                if ((error = HF_LongRead(scan->fd, &lr, &HF_longScan, record)) != HFE_OK) {
+                    return error;
+                }
+                *recLen = lr.recLen;
+                if (scan->numPreds > 0 &&
+                        !HF_ScanMatch(scan, scan->currentPageBuf, slot, *record, *recLen)) {
+                    continue;
+                }
+            }
             
             if (slot >= 0) { // HFE_OK is 0, but this is safer
                 // --- Success! Found a record on this page ---
@@ -443,16 +3950,18 @@ int HF_GetNextRec(int fd, HF_Scan *scan, RID *rid, char **record, int *recLen) {
                 // Update the scanner's state
                 scan->currentSlotNum = slot;
                 
-                // Set the output RID
-                rid->pageNum = scan->currentPageNum;
-                rid->slotNum = scan->currentSlotNum;
+                // Set the output RID (a moved record's is its home RID)
+                if (!HF_PageHomeRID(scan->currentPageBuf, slot, rid)) {
+                    rid->pageNum = scan->currentPageNum;
+                    rid->slotNum = scan->currentSlotNum;
+                }
                 
                 return HFE_OK;
             }
             
             // If we're here, the result was HFE_EOF (no more records on this page)
             // Unfix the current page
-            if ((error = PF_UnfixPage(scan->fd, scan->currentPageNum, FALSE)) != PFE_OK) {
+            if ((error = HF_ScanUnpin(scan)) != PFE_OK) {
                 return error; // Propagate error
             }
             scan->currentPageBuf = NULL;
@@ -460,8 +3969,8 @@ int HF_GetNextRec(int fd, HF_Scan *scan, RID *rid, char **record, int *recLen) {
 
         // --- 2. Get the next page in the file ---
         
-        // PF_GetNextPage gets the page *after* scan->currentPageNum
-        error = PF_GetNextPage(scan->fd, &scan->currentPageNum, &scan->currentPageBuf);
+        // This gets the page *after* scan->currentPageNum
+        error = HF_ScanNextPage(scan);
         
         if (error == PFE_EOF) {
             // --- End of File ---
@@ -480,4 +3989,424 @@ int HF_GetNextRec(int fd, HF_Scan *scan, RID *rid, char **record, int *recLen) {
         // from the beginning in the next loop iteration.
         scan->currentSlotNum = -1;
     }
-}
\ No newline at end of file
+}
+
+/*
+ * Retrieves the next valid record in the file scan.
+ */
+int HF_GetNextRec(int fd, HF_Scan *scan, RID *rid, char **record, int *recLen) {
+    return HF_ScanNext(scan, -1, rid, record, recLen);
+}
+
+/*
+ * Retrieves field "field" of the next valid record of a PAX file.
+ */
+int HF_GetNextField(int fd, HF_Scan *scan, int field,
+                    RID *rid, char **value, int *len) {
+    if (fd != scan->fd) {
+        PFerrno = PFE_FD;
+        return PFerrno;
+    }
+    return HF_ScanNext(scan, field, rid, value, len);
+}
+
+/*
+ * Puts the records of the scan's page after its current slot into
+ * the arrays, at most max of them, and moves the scan past them.
+ * Records that do not match the scan's predicates are passed over.
+ * Returns how many there were, or an error. Slotted pages are walked
+ * through their slot array, fixed pages through their bitmap, without
+ * a call per record; the records of a PAX page are put together in
+ * paxBuf. So are the encoded records of a dictionary page, decoded,
+ * the batch ending at one that paxBuf has no room left for. A long
+ * record is put together in longBuf, and makes a batch on its own.
+ */
+static int HF_PageBatch(HF_Scan *scan, RID rids[], char *records[], int lens[], int max,
+                        char *paxBuf, HF_LongBuf *longBuf) {
+    char *pageBuf = scan->currentPageBuf;
+    int slot = scan->currentSlotNum;
+    int n = 0;
+
+    if (HF_GetPageHeader(pageBuf)->numSlots == HF_FSM_PAGE) {
+        return 0;
+    }
+    if (HF_IsFixedPage(pageBuf)) {
+        int recLen = ((HF_FixedHeader*)pageBuf)->recLen;
+        int pax = HF_IsPaxPage(pageBuf);
+        while (n < max && (slot = HF_FixedNextRow(pageBuf, slot)) >= 0) {
+            scan->currentSlotNum = slot;
+            if (scan->numPreds > 0 &&
+                    !HF_ScanMatch(scan, pageBuf, slot, HF_FixedRow(pageBuf, slot), recLen)) {
+                continue;
+            }
+            records[n] = pax ? HF_PaxGather(pageBuf, slot, paxBuf + n * recLen)
+                             : HF_FixedRow(pageBuf, slot);
+            lens[n] = recLen;
+            rids[n].pageNum = scan->currentPageNum;
+            rids[n].slotNum = slot;
+            n++;
+        }
+        return n;
+    }
+
+    int numSlots = HF_NumSlots(pageBuf);
+    int used = 0;   // bytes of paxBuf holding decoded records
+    if (HF_IsDictPage(pageBuf) && scan->numPreds > 0 && slot < 0) {
+        HF_ScanDictCodes(scan, pageBuf);
+    }
+    for (slot++; n < max && slot < numSlots; slot++) {
+        int length = HF_SlotLength(pageBuf, slot);
+        if (length == HF_SLOT_FREE || length == HF_SLOT_FORWARD) {
+            continue;   // forwarded records are found where they are
+        }
+        if ((length & HF_SLOT_LONG) && n > 0) {
+            break;      // it goes in the next batch
+        }
+        if (length & HF_SLOT_DICT) {
+            if (scan->numPreds == 0 || HF_ScanMatch(scan, pageBuf, slot, NULL, 0)) {
+                int len = HF_DictDecode(pageBuf, pageBuf + HF_SlotOffset(pageBuf, slot),
+                                        HF_SlotBytes(length), paxBuf + used,
+                                        PF_MAX_PAGE_SIZE - used);
+                if (len < 0) {
+                    break;  // it goes in the next batch
+                }
+                records[n] = paxBuf + used;
+                lens[n] = len;
+                rids[n].pageNum = scan->currentPageNum;
+                rids[n].slotNum = slot;
+                used += len;
+                n++;
+            }
+            scan->currentSlotNum = slot;
+            continue;
+        }
+        records[n] = pageBuf + HF_SlotOffset(pageBuf, slot);
+        lens[n] = HF_SlotBytes(length);
+        rids[n].pageNum = scan->currentPageNum;
+        rids[n].slotNum = slot;
+        if (length & HF_SLOT_MOVED) {
+            // A moved record has its home RID in front of it
+            memcpy(&rids[n], records[n], sizeof(RID));
+            records[n] += sizeof(RID);
+            lens[n] -= sizeof(RID);
+        }
+        scan->currentSlotNum = slot;
+        if (length & HF_SLOT_LONG) {
+            HF_LongRec lr;
+            memcpy(&lr, records[0], sizeof(HF_LongRec));
+            int error = HF_LongRead(scan->fd, &lr, longBuf, &records[0]);
+            if (error != HFE_OK) {
+                return error;
+            }
+            lens[0] = lr.recLen;
+            if (scan->numPreds == 0 || HF_ScanMatch(scan, pageBuf, slot, records[0], lens[0])) {
+                return 1;
+            }
+            continue;
+        }
+        if (scan->numPreds == 0 || HF_ScanMatch(scan, pageBuf, slot, records[n], lens[n])) {
+            n++;
+        }
+    }
+    return n;
+}
+
+/*
+ * Retrieves the next records of the file scan, a page's worth at most.
+ */
+int HF_GetNextBatch(int fd, HF_Scan *scan, RID rids[], char *records[], int lens[], int max) {
+    int error;
+
+    if (fd != scan->fd) {
+        PFerrno = PFE_FD;
+        return PFerrno;
+    }
+    while (TRUE) {
+        // 1. The records left on the current page, if there are any
+        if (scan->currentPageBuf != NULL) {
+            int n = HF_PageBatch(scan, rids, records, lens, max, HF_paxBatch, &HF_longScan);
+            if (n != 0) {
+                return n;   // records, or an error
+            }
+            if ((error = HF_ScanUnpin(scan)) != PFE_OK) {
+                return error;
+            }
+            scan->currentPageBuf = NULL;
+        }
+
+        // 2. Otherwise the next page, from its first slot
+        error = HF_ScanNextPage(scan);
+        if (error == PFE_EOF) {
+            return HFE_EOF;
+        }
+        if (error != PFE_OK) {
+            return error;
+        }
+        scan->currentSlotNum = -1;
+    }
+}
+
+/*
+ * ======================================================
+ * Parallel Scan
+ * ======================================================
+ */
+
+#define HF_WORKER_BATCH 1024    // records handed to the callback at a time
+
+/* The morsels a worker has left: next to end - 1 */
+typedef struct {
+    pthread_mutex_t lock;
+    int next;
+    int end;
+} HF_MorselQueue;
+
+/* What the workers of a parallel scan share */
+typedef struct {
+    int fd;
+    int numPages;
+    int morselPages;
+    int numWorkers;
+    HF_Pred *preds;
+    int numPreds;
+    HF_ZoneRoot zones;          // zone map to skip pages by, as in HF_Scan
+    HF_ScanFn fn;
+    void *arg;
+    HF_MorselQueue *queues;     // one per worker
+    int error;                  // the first error, under PF_Lock
+} HF_ParScan;
+
+typedef struct {
+    HF_ParScan *ps;
+    int worker;
+} HF_Worker;
+
+/*
+ * Claims a morsel for worker w: the next one of its own queue, or
+ * else it steals the back half of another worker's queue, looking
+ * at them in turn from w + 1 on. Returns the morsel, or -1 if none
+ * are left.
+ */
+static int HF_ClaimMorsel(HF_ParScan *ps, int w) {
+    HF_MorselQueue *own = &ps->queues[w];
+    int morsel = -1;
+
+    pthread_mutex_lock(&own->lock);
+    if (own->next < own->end) {
+        morsel = own->next++;
+    }
+    pthread_mutex_unlock(&own->lock);
+
+    for (int k = 1; morsel < 0 && k < ps->numWorkers; k++) {
+        HF_MorselQueue *victim = &ps->queues[(w + k) % ps->numWorkers];
+        int first = 0, end = 0;
+        pthread_mutex_lock(&victim->lock);
+        if (victim->next < victim->end) {
+            end = victim->end;
+            first = end - (victim->end - victim->next + 1) / 2;
+            victim->end = first;
+        }
+        pthread_mutex_unlock(&victim->lock);
+        if (first < end) {
+            // The first stolen morsel is ours now, the rest go in our queue
+            morsel = first;
+            pthread_mutex_lock(&own->lock);
+            own->next = first + 1;
+            own->end = end;
+            pthread_mutex_unlock(&own->lock);
+        }
+    }
+    return morsel;
+}
+
+/* Records the first error of a parallel scan */
+static void HF_ParScanFail(HF_ParScan *ps, int error) {
+    PF_Lock();
+    if (ps->error == HFE_OK) {
+        ps->error = error;
+    }
+    PF_Unlock();
+}
+
+/*
+ * A worker of a parallel scan: scans the pages of the morsels it
+ * claims, with a cursor on one page, and hands their records to the
+ * callback. PF calls are made under PF_Lock, the rest (finding the
+ * records and the callback) without it.
+ */
+static void *HF_ScanWorker(void *p) {
+    HF_Worker *worker = (HF_Worker*)p;
+    HF_ParScan *ps = worker->ps;
+    RID *rids = malloc(HF_WORKER_BATCH * sizeof(RID));
+    char **records = malloc(HF_WORKER_BATCH * sizeof(char*));
+    int *lens = malloc(HF_WORKER_BATCH * sizeof(int));
+    char *paxBuf = malloc(PF_MAX_PAGE_SIZE);
+    HF_LongBuf longBuf = { NULL, 0, TRUE };     // long records, read under PF_Lock
+    int morsel, error;
+
+    if (rids == NULL || records == NULL || lens == NULL || paxBuf == NULL) {
+        HF_ParScanFail(ps, PFE_NOMEM);
+        morsel = -1;
+    } else {
+        morsel = HF_ClaimMorsel(ps, worker->worker);
+    }
+    for (; morsel >= 0; morsel = HF_ClaimMorsel(ps, worker->worker)) {
+        int last = (morsel + 1) * ps->morselPages;
+        if (last > ps->numPages) {
+            last = ps->numPages;
+        }
+        for (int page = morsel * ps->morselPages; page < last; page++) {
+            HF_Scan scan;
+            char *pageBuf;
+
+            // 1. Pin the page, unless the scan has failed or the zone
+            //    map says no page before page "next" holds a match
+            int next = page;
+            PF_Lock();
+            error = ps->error;
+            if (error == HFE_OK && ps->zones.numFields > 0 &&
+                    (error = HF_ZoneNextPage(ps->fd, &ps->zones, ps->preds, ps->numPreds,
+                                             page - 1, &next)) != HFE_OK) {
+                ps->error = error;
+            }
+            if (error == HFE_OK && next == page) {
+                error = PF_GetThisPage(ps->fd, page, &pageBuf);
+            }
+            PF_Unlock();
+            if (error == HFE_OK && next != page) {
+                page = next - 1;
+                continue;
+            }
+            if (error == PFE_INVALIDPAGE) {
+                continue;   // a free page
+            }
+            if (error != PFE_OK && error != PFE_PAGEFIXED) {
+                goto done;
+            }
+
+            // 2. Hand its records to the callback, a batch at a time
+            HF_OpenFileScan(ps->fd, &scan);
+            scan.currentPageNum = page;
+            scan.currentPageBuf = pageBuf;
+            scan.preds = ps->preds;
+            scan.numPreds = ps->numPreds;
+            int n, fnError = HFE_OK;
+            while (fnError == HFE_OK &&
+                   (n = HF_PageBatch(&scan, rids, records, lens, HF_WORKER_BATCH, paxBuf,
+                                     &longBuf)) != 0) {
+                fnError = (n < 0) ? n : ps->fn(ps->arg, worker->worker, rids, records, lens, n);
+            }
+
+            // 3. Unpin it (a page fixed before the scan stays fixed)
+            if (error != PFE_PAGEFIXED) {
+                PF_Lock();
+                error = PF_UnfixPage(ps->fd, page, FALSE);
+                PF_Unlock();
+                if (error != PFE_OK) {
+                    HF_ParScanFail(ps, error);
+                    goto done;
+                }
+            }
+            if (fnError != HFE_OK) {
+                HF_ParScanFail(ps, fnError);
+                goto done;
+            }
+        }
+    }
+done:
+    free(rids);
+    free(records);
+    free(lens);
+    free(paxBuf);
+    free(longBuf.buf);
+    return NULL;
+}
+
+/*
+ * Scans a file with numWorkers threads, the calling thread being
+ * worker 0.
+ *
+ * The pages are cut into morsels of morselPages pages, and each
+ * worker starts with an equal run of them. A worker that runs out
+ * steals half of what another has left, so that the workers finish
+ * together even if some pages take longer than others.
+ */
+int HF_ParallelScan(int fd, int numWorkers, int morselPages,
+                    HF_Pred *preds, int numPreds, HF_ScanFn fn, void *arg) {
+    HF_ParScan ps;
+    HF_Scan check;
+    int error;
+
+    // 1. Check the arguments: predicates as for HF_OpenFileScanWhere
+    if (numWorkers < 1 || morselPages < 1 || fn == NULL) {
+        return HFE_BADARG;
+    }
+    // Each worker keeps its page fixed, and an overflow page too while
+    // it puts a long record together: no more workers than there are
+    // buffer pages for
+    if (numWorkers > PF_MAX_BUFS / 2) {
+        numWorkers = (PF_MAX_BUFS / 2 > 0) ? PF_MAX_BUFS / 2 : 1;
+    }
+    PF_Lock();
+    error = HF_OpenFileScanWhere(fd, &check, preds, numPreds);
+    ps.numPages = PF_NumPages(fd);
+    PF_Unlock();
+    if (error != HFE_OK) {
+        return error;
+    }
+    if (ps.numPages < 0) {
+        return ps.numPages;
+    }
+    ps.fd = fd;
+    ps.morselPages = morselPages;
+    ps.numWorkers = numWorkers;
+    ps.preds = preds;
+    ps.numPreds = numPreds;
+    ps.zones = check.zones;
+    ps.fn = fn;
+    ps.arg = arg;
+    ps.error = HFE_OK;
+
+    // 2. Deal the morsels out evenly
+    int numMorsels = (ps.numPages + morselPages - 1) / morselPages;
+    HF_Worker *workers = malloc(numWorkers * sizeof(HF_Worker));
+    pthread_t *threads = malloc(numWorkers * sizeof(pthread_t));
+    int *started = calloc(numWorkers, sizeof(int));
+    ps.queues = malloc(numWorkers * sizeof(HF_MorselQueue));
+    if (workers == NULL || threads == NULL || started == NULL || ps.queues == NULL) {
+        free(workers);
+        free(threads);
+        free(started);
+        free(ps.queues);
+        PFerrno = PFE_NOMEM;
+        return PFerrno;
+    }
+    for (int w = 0; w < numWorkers; w++) {
+        pthread_mutex_init(&ps.queues[w].lock, NULL);
+        ps.queues[w].next = (int)((long)numMorsels * w / numWorkers);
+        ps.queues[w].end = (int)((long)numMorsels * (w + 1) / numWorkers);
+        workers[w].ps = &ps;
+        workers[w].worker = w;
+    }
+
+    // 3. Run them. The morsels of a thread that does not start get
+    //    stolen by the others, worker 0 (this thread) at least.
+    for (int w = 1; w < numWorkers; w++) {
+        started[w] = (pthread_create(&threads[w], NULL, HF_ScanWorker, &workers[w]) == 0);
+    }
+    HF_ScanWorker(&workers[0]);
+    for (int w = 1; w < numWorkers; w++) {
+        if (started[w]) {
+            pthread_join(threads[w], NULL);
+        }
+    }
+
+    for (int w = 0; w < numWorkers; w++) {
+        pthread_mutex_destroy(&ps.queues[w].lock);
+    }
+    free(workers);
+    free(threads);
+    free(started);
+    free(ps.queues);
+    return ps.error;
+}
@@ -4,8 +4,8 @@
 #include "pf.h" // We need this for PF_PAGE_SIZE
 
 /*
- * The HF_PageHeader is the first thing on a slotted page.
- * It sits at offset 0.
+ * The HF_PageHeader is the first thing on a slotted page of the
+ * first format (see HF_PAGE2 for format 2). It sits at offset 0.
  */
 typedef struct {
     int numSlots;       /* Number of slots on this page */
@@ -19,10 +19,223 @@ typedef struct {
  */
 typedef struct {
     int offset;         /* Offset from page start to the record's data */
-    int length;         /* Length of the record */
-                        /* If length == -1, the slot is free (deleted) */
+    int length;         /* Length of the record, or HF_SLOT_xxx */
 } HF_SlotEntry;
 
+/*
+ * Slot lengths with a special meaning. A record that HF_UpdateRec
+ * has to move off its page leaves a forwarding stub, a RID giving
+ * its new place, so that its RID stays valid. The moved record
+ * starts with the RID of its home slot.
+ */
+#define HF_SLOT_FREE     -1           /* the slot is free (deleted) */
+#define HF_SLOT_FORWARD  -2           /* forwarding stub */
+#define HF_SLOT_MOVED    0x40000000   /* or'ed into a moved record's length */
+#define HF_SLOT_LONG     0x20000000   /* or'ed in: the slot holds an HF_LongRec */
+#define HF_SLOT_DICT     0x10000000   /* or'ed in: the record is encoded (see HF_DICT_PAGE) */
+
+/*
+ * Slotted pages of format 2, the format of new slotted pages of files
+ * with pages of up to HF_PAGE2_MAX_SIZE bytes, keep their header and
+ * slots in shorts: a slot takes 4 bytes instead of 8. The header also
+ * keeps the page's free bytes (as HF_Page_FreeBytes counts them) and
+ * its number of slots in use, so that neither takes a walk over the
+ * slots. numSlots of the first format's header is HF_PAGE2 instead.
+ * Pages of the first format, in files written before format 2, are
+ * still read and written as they are.
+ */
+#define HF_PAGE2           -5
+#define HF_PAGE2_MAX_SIZE  16384
+
+typedef struct {
+    int kind;                   /* HF_PAGE2 */
+    unsigned short numSlots;    /* Number of slots on this page */
+    unsigned short dataStart;   /* Offset from page start where data heap begins */
+    unsigned short freeBytes;   /* Free bytes, the space of deleted records too */
+    unsigned short numRecs;     /* Slots in use: records and forwarding stubs */
+} HF_PageHeader2;
+
+typedef struct {
+    unsigned short offset;      /* Offset from page start to the record's data */
+    unsigned short length;      /* Length of the record, or HF_SLOT2_xxx */
+} HF_SlotEntry2;
+
+/* Format 2 slot lengths: records are shorter than 16K bytes */
+#define HF_SLOT2_FREE     0xffff
+#define HF_SLOT2_FORWARD  0xfffe
+#define HF_SLOT2_MOVED    0x8000
+#define HF_SLOT2_LONG     0x4000
+#define HF_SLOT2_BYTES    0x3fff
+
+/*
+ * Dictionary pages (see HF_CreateFileDict) are format 2 pages with a
+ * dictionary of the field values that repeat on the page. A record
+ * whose slot has HF_SLOT_DICT is encoded: a field that is a value of
+ * the dictionary is HF_DICT_ESC and the value's code, one byte, the
+ * others are as they were. Records are stored as they are, and the
+ * page's records encoded with a dictionary made from them when the
+ * page fills up; the dictionary is made anew each time. Records with a
+ * field starting with HF_DICT_ESC, and moved and long records, are
+ * never encoded. The dictionary is in the data heap, dictLen bytes
+ * at dictOffset: the number of values n, then n + 1 offsets from the
+ * dictionary's start, value i being the bytes from offset i to offset
+ * i + 1, all unsigned shorts, then the values, in byte order (the
+ * codes of two values compare as the values do). It does not count in
+ * the free bytes. Records on these pages are shorter than 8K, so that
+ * HF_SLOT2_DICT fits in the slot length.
+ */
+#define HF_DICT_PAGE        -6
+#define HF_DICT_MAX_SIZE    8192
+#define HF_DICT_ESC         0x1b
+#define HF_DICT_MAX_VALUES  255
+#define HF_SLOT2_DICT       0x2000
+
+typedef struct {
+    HF_PageHeader2 page;        /* page.kind is HF_DICT_PAGE */
+    unsigned short dictOffset;  /* Offset of the dictionary, or 0 if there is none */
+    unsigned short dictLen;     /* Its length in bytes */
+} HF_DictHeader;
+
+/*
+ * Records longer than HF_MaxInline(pageSize) bytes, which would not
+ * fit on an empty slotted page once moved (with a RID in front), are
+ * long records: their bytes go on a chain of overflow pages, and
+ * their slot holds an HF_LongRec that says where the chain starts.
+ * An overflow page holds the next HF_OverflowHeader.length bytes of
+ * the record after its header; numSlots is HF_OVERFLOW_PAGE, so that
+ * scans find no records on it.
+ */
+#define HF_MaxInline(pageSize) ((pageSize) - \
+    (int)(sizeof(HF_PageHeader) + sizeof(HF_SlotEntry) + sizeof(RID)))
+
+/* The same for a file of dictionary pages, whose header is longer */
+#define HF_DictMaxInline(pageSize) (HF_MaxInline(pageSize) - \
+    (int)(sizeof(HF_DictHeader) + sizeof(HF_SlotEntry2) - \
+          sizeof(HF_PageHeader) - sizeof(HF_SlotEntry)))
+
+typedef struct {
+    int recLen;         /* Length of the whole record */
+    int firstPage;      /* First overflow page of the chain */
+} HF_LongRec;
+
+#define HF_OVERFLOW_PAGE  -4
+
+typedef struct {
+    int numSlots;       /* HF_OVERFLOW_PAGE */
+    int nextPage;       /* Next overflow page of the record, or -1 */
+    int length;         /* Bytes of the record on this page */
+} HF_OverflowHeader;
+
+
+/*
+ * Files of fixed-length records (see HF_CreateFileFixed) have fixed
+ * pages instead of slotted pages. The header is followed by an
+ * occupancy bitmap, bit i (bit i%8 of byte i/8) set if row i holds a
+ * record, and then by the rows, recLen bytes each, packed one after
+ * the other. A record's slot number is its row number. numSlots is
+ * HF_FIXED_PAGE. In the FSM, a fixed page with a free row has at
+ * least one unit of free space.
+ */
+typedef struct {
+    int numSlots;       /* HF_FIXED_PAGE */
+    int recLen;         /* Length of every record on the page */
+    int capacity;       /* Number of rows on the page */
+    int numRecs;        /* Number of rows that hold a record */
+} HF_FixedHeader;
+
+#define HF_FIXED_PAGE  -2
+#define HF_FixedBitmap(pageBuf) \
+    ((unsigned char*)(pageBuf) + \
+     (((HF_FixedHeader*)(pageBuf))->numSlots == HF_PAX_PAGE ? \
+      sizeof(HF_PaxHeader) : sizeof(HF_FixedHeader)))
+#define HF_FixedRow(pageBuf, i) \
+    ((char*)HF_FixedBitmap(pageBuf) + \
+     (((HF_FixedHeader*)(pageBuf))->capacity + 7) / 8 + \
+     (i) * ((HF_FixedHeader*)(pageBuf))->recLen)
+
+/*
+ * PAX pages (see HF_CreateFilePax) are fixed pages that keep each
+ * field of the records in a minipage of its own: after the bitmap,
+ * the values of field 0 for all the rows of the page, then those of
+ * field 1, and so on, so that a scan of one field only touches that
+ * field's bytes. A record is its fields one after the other; fields
+ * have a fixed width. The header is an HF_PaxHeader and numSlots is
+ * HF_PAX_PAGE.
+ */
+#define HF_PAX_PAGE        -3
+#define HF_PAX_MAX_FIELDS  32
+
+typedef struct {
+    int numFields;                          /* 0 if not a PAX file */
+    unsigned short width[HF_PAX_MAX_FIELDS];    /* bytes of each field */
+} HF_PaxFields;
+
+typedef struct {
+    HF_FixedHeader fixed;   /* fixed.numSlots is HF_PAX_PAGE */
+    HF_PaxFields fields;
+} HF_PaxHeader;
+
+/*
+ * A zone map keeps, for each data page of a slotted file, the least
+ * and greatest value of each of up to HF_ZONE_MAX_FIELDS fields on the
+ * page, counting the values that are numbers, so that a scan for
+ * HF_OP_NUM predicates on those fields can skip the pages that cannot
+ * hold a match. Its root is in page 0 (the FSM page, in place of the
+ * PAX fields, which a slotted file has none of) and its entries are
+ * on a chain of zone map pages, the k-th one holding those of the
+ * pages from k*HF_ZoneEntries(pageSize, numFields) on, numFields
+ * HF_ZoneRanges for each. A page with no numbers in a field has
+ * min > max there; one with a long record has -HUGE_VAL..HUGE_VAL.
+ * Inserts and updates widen a page's ranges; deletes work them out
+ * again from the page if the record held one of the bounds.
+ */
+#define HF_ZONE_PAGE       -7
+#define HF_ZONE_MAX_FIELDS 4
+
+typedef struct {
+    int numPaxFields;   /* 0: where HF_PaxFields has numFields */
+    int numFields;      /* fields in the zone map, 0 if there is none */
+    int fields[HF_ZONE_MAX_FIELDS];     /* their numbers, from 0 */
+    int firstPage;      /* first zone map page */
+} HF_ZoneRoot;
+
+typedef struct {
+    int numSlots;       /* HF_ZONE_PAGE */
+    int nextZonePage;   /* page number of the next zone map page, or -1 */
+} HF_ZoneHeader;
+
+typedef struct {
+    double min, max;
+} HF_ZoneRange;
+
+#define HF_ZoneEntries(pageSize, numFields) \
+    (((pageSize) - (int)sizeof(HF_ZoneHeader)) / ((numFields) * (int)sizeof(HF_ZoneRange)))
+
+/*
+ * Page 0 of a heap file is a free-space map (FSM) page. It has one
+ * byte per page of the file, numbered from 0: the free bytes on the
+ * page in units of HF_FsmUnit(pageSize), rounded down, or 0 for pages
+ * that hold no records. Files with more pages than one FSM page
+ * covers chain further FSM pages, the k-th one covering the pages from
+ * k*HF_FsmEntries(pageSize) on. numSlots is HF_FSM_PAGE, so that scans
+ * find no records on FSM pages.
+ */
+typedef struct {
+    int numSlots;       /* HF_FSM_PAGE */
+    int nextFsmPage;    /* page number of the next FSM page, or -1 */
+    int hint;           /* entries before this one are all 0 */
+    int recLen;         /* page 0: record length of a fixed-length file,
+                           HF_DICT_FILE, or 0 */
+    union {
+        HF_PaxFields pax;   /* page 0: the fields of a PAX file */
+        HF_ZoneRoot zones;  /* ... or the zone map of a slotted one */
+    };
+} HF_FsmHeader;
+
+#define HF_FSM_PAGE  -1
+#define HF_DICT_FILE -1   /* recLen of a file of dictionary pages */
+#define HF_FsmEntries(pageSize) ((pageSize) - (int)sizeof(HF_FsmHeader))
+#define HF_FsmUnit(pageSize)    ((pageSize) / 256)
 
 /* A Record ID (RID) uniquely identifies a record in the file.
  * It consists of the page number and the slot number.
@@ -33,18 +246,40 @@ typedef struct {
 } RID;
 /*
  * Define some error codes for the HF layer
+ * (numbered well clear of the PF error codes, which HF calls pass through)
  */
 #define HFE_OK            0    /* OK */
-#define HFE_PAGENOFREE    -20   /* Page has no free space */
-#define HFE_INVALIDSLOT   -21   /* Invalid slot number */
-#define HFE_EOF           -22   /* End of file */
+#define HFE_PAGENOFREE    -50   /* Page has no free space */
+#define HFE_INVALIDSLOT   -51   /* Invalid slot number */
+#define HFE_EOF           -52   /* End of file */
+#define HFE_FORWARDED     -53   /* Slot is a forwarding stub (page level) */
+#define HFE_RECLEN        -54   /* Wrong record length for a fixed-length file */
+#define HFE_NOFIELDS      -55   /* Not a PAX page or file, or no such field */
+#define HFE_SCHEMA        -56   /* Bad schema declaration, or no such table */
+#define HFE_BADVALUE      -57   /* Value does not fit the type of its column */
+#define HFE_BADPRED       -58   /* Bad scan predicate */
+#define HFE_LONGREC       -59   /* Slot holds a long record (page level) */
+#define HFE_NOZONEMAP     -60   /* File cannot have (or has) a zone map */
+#define HFE_BADARG        -61   /* Bad argument (a count or size out of range) */
 
 /*
  * Function prototypes for the HF layer
  */
 
-// Initializes a new slotted page
-void HF_InitPage(char *pageBuf);
+// Initializes a new slotted page of pageSize bytes (of format 2 if it can be)
+void HF_InitPage(char *pageBuf, int pageSize);
+
+// Initializes a new slotted page of the first format, with int slots
+void HF_InitPage1(char *pageBuf, int pageSize);
+
+// Initializes a new fixed page for records of recLen bytes
+void HF_InitFixedPage(char *pageBuf, int pageSize, int recLen);
+
+// Initializes a new PAX page for records of numFields fields
+void HF_InitPaxPage(char *pageBuf, int pageSize, int numFields, int widths[]);
+
+// Initializes a new dictionary page (of at most HF_DICT_MAX_SIZE bytes)
+void HF_InitDictPage(char *pageBuf, int pageSize);
 
 // Inserts a new record
 int HF_Page_InsertRec(char *pageBuf, char *record, int recLen);
@@ -58,11 +293,72 @@ int HF_Page_GetRec(char *pageBuf, int slotNum, char **record, int *recLen);
 // Gets the next valid record
 int HF_Page_GetNextRec(char *pageBuf, int currentSlotNum, char **record, int *recLen);
 
+// Gets one field of a record of a PAX page, in its minipage
+int HF_Page_GetField(char *pageBuf, int slotNum, int field,
+                     char **value, int *len);
+
+// Gets the minipage of a field of a PAX page; returns its number of rows
+int HF_Page_GetColumn(char *pageBuf, int field, char **values, int *width);
+
+// Free bytes on a page, including the space of deleted records
+int HF_Page_FreeBytes(char *pageBuf, int pageSize);
+
+// Moves the live records together; returns the bytes of free space gained
+int HF_Page_Compact(char *pageBuf, int pageSize);
+
+// Encodes the records of a dictionary page; returns the bytes of free space gained
+int HF_Page_Encode(char *pageBuf, int pageSize);
+
+// Rewrites the record in a slot, if it fits on the page
+int HF_Page_UpdateRec(char *pageBuf, int pageSize, int slotNum,
+                      char *record, int recLen);
+
 /*
  * Creates a new, empty heap file.
  */
 int HF_CreateFile(char *fileName);
 
+/*
+ * Creates a new, empty heap file with pages of pageSize bytes
+ * (see PF_CreateFileSized). Large pages suit files that are
+ * mostly scanned.
+ */
+int HF_CreateFileSized(char *fileName, int pageSize);
+
+/*
+ * Creates a new, empty heap file with PF storage options such as
+ * PF_FILE_COMPRESSED (see PF_CreateFileOpt).
+ */
+int HF_CreateFileOpt(char *fileName, int pageSize, int pfFlags);
+
+/*
+ * Creates a new, empty heap file for records that are all recLen
+ * bytes long, on fixed pages: no slot entry per record, and rows at
+ * computed offsets. Inserting or updating a record of another length
+ * gives HFE_RECLEN. Records never move, so HF_UpdateRec always
+ * rewrites them in place.
+ */
+int HF_CreateFileFixed(char *fileName, int pageSize, int pfFlags, int recLen);
+
+/*
+ * Creates a new, empty heap file of PAX pages for records made of
+ * numFields fields (at most HF_PAX_MAX_FIELDS), field i widths[i]
+ * bytes wide. Records are the fields one after the other, and are
+ * handled like those of HF_CreateFileFixed. HF_GetNextField scans
+ * one field of the records.
+ */
+int HF_CreateFilePax(char *fileName, int pageSize, int pfFlags,
+                     int numFields, int widths[]);
+
+/*
+ * Creates a new, empty heap file of dictionary pages (see
+ * HF_DICT_PAGE), whose records are text, fields separated by
+ * HF_FIELD_SEP: values repeated on a page are stored once on it.
+ * pageSize must be at most HF_DICT_MAX_SIZE. Scan predicates
+ * comparing a field for equality compare dictionary codes.
+ */
+int HF_CreateFileDict(char *fileName, int pageSize, int pfFlags);
+
 /*
  * Opens an existing heap file.
  * Returns a file descriptor (fd) from the PF layer.
@@ -85,37 +381,231 @@ int HF_CloseFile(int fd);
  * Outputs:
  * rid: The RID of the newly inserted record
  *
+ * A record longer than HF_MaxInline(page size) is stored on overflow
+ * pages of its own, and only a small HF_LongRec on a slotted page.
+ *
  * Returns:
  * HFE_OK on success, or an error code
  */
 int HF_InsertRec(int fd, char *record, int recLen, RID *rid);
 
+/*
+ * Inserts n records at once, the i-th one records[i], lens[i]
+ * bytes long, and sets rids[i] to its RID (rids may be NULL).
+ *
+ * Outside bulk-append mode, the first records go on a page the FSM
+ * finds room on, as many as fit there. The others fill new pages in
+ * order, which are written straight to the file, skipping the buffer
+ * pool. The last page is written partly filled, unless the file is
+ * in bulk-append mode.
+ *
+ * Returns:
+ * HFE_OK on success, or an error code
+ */
+int HF_InsertBatch(int fd, char *records[], int lens[], int n, RID rids[]);
+
+/*
+ * Bulk-append mode, for loading a file.
+ *
+ * Between HF_BeginBulkAppend and HF_EndBulkAppend (or HF_CloseFile),
+ * HF_InsertRec and HF_InsertBatch append records to new pages that
+ * are built in memory and written straight to the file in runs.
+ * Until a record's page has been written it cannot be read, deleted
+ * or scanned: only HF_EndBulkAppend makes sure all of them are.
+ */
+int HF_BeginBulkAppend(int fd);
+int HF_EndBulkAppend(int fd);
+
 /*
  * Deletes a record from the file, given its RID.
  */
 int HF_DeleteRec(int fd, RID rid);
 
+/*
+ * Replaces the record with RID "rid" by "record", recLen bytes.
+ *
+ * The record is rewritten in place if it fits on its page. If not,
+ * it moves to another page, leaving a forwarding stub behind, so
+ * its RID stays the same and indexes on it need no change. Fetching
+ * a moved record by its RID then takes one more page. The overflow
+ * pages of a long record are given back once it is replaced.
+ *
+ * Returns:
+ * HFE_OK on success, or an error code
+ */
+int HF_UpdateRec(int fd, RID rid, char *record, int recLen);
+
+/*
+ * Compacts the pages of the file where deleted records waste at
+ * least 1/HF_VACUUM_FRACTION of the page. Inserts compact a page
+ * anyway when they need the space, so this is for files with many
+ * deletes whose pages are scanned more than inserted into.
+ *
+ * Outputs:
+ * bytesReclaimed: Bytes of dead space turned into free space
+ */
+#define HF_VACUUM_FRACTION 4
+int HF_Vacuum(int fd, long *bytesReclaimed);
+
+/*
+ * Adds a zone map (see HF_ZONE_PAGE) to a slotted or dictionary file
+ * with an FSM, on the numFields fields (at most HF_ZONE_MAX_FIELDS)
+ * numbered in fields[], worked out from the records already in it.
+ * Scans with HF_OP_NUM predicates on those fields then skip the pages
+ * it says hold no match.
+ *
+ * Returns:
+ * HFE_OK, HFE_NOZONEMAP if the file cannot have one or has one
+ * already, HFE_NOFIELDS for a bad field list, or a PF error code
+ */
+int HF_CreateZoneMap(int fd, int numFields, int fields[]);
+
+/*
+ * Gets the range of field "field" on page "pagenum" in the zone map:
+ * *min > *max if the page has no numbers there.
+ * Returns HFE_OK, HFE_NOZONEMAP if the field is not in one, or a PF
+ * error code.
+ */
+int HF_GetZone(int fd, int pagenum, int field, double *min, double *max);
+
 /*
  * Retrieves a record from the file, given its RID.
  *
  * Outputs:
  * record: Pointer to the record data *within the buffer page*
+ * (for PAX files, encoded records of dictionary pages and long
+ * records, to a copy that the next call overwrites)
  * recLen: Length of the record
  */
 int HF_GetRec(int fd, RID rid, char **record, int *recLen);
 
+/*
+ * A pinned record: its page stays fixed in the buffer pool until the
+ * handle is released, so "record" can be used in place, without a
+ * copy. Handles count their pins per page, so any number of records
+ * of the same page, or the same record, can be pinned at once.
+ */
+typedef struct {
+    int   fd;             // The file descriptor
+    int   pageNum;        // The page kept fixed, or -1 if none
+    char *record;         // The record's data
+    int   recLen;         // Length of the record
+    char *copy;           // A PAX, encoded or long record, put together in memory of its own
+} HF_RecHandle;
+
+/*
+ * Like HF_GetRec, but keeps the record's page fixed until
+ * HF_ReleaseRec(handle): handle->record stays good until then. A
+ * PAX record or a long record, which is not in one piece on a page,
+ * is copied into memory of the handle's own instead.
+ *
+ * Returns HFE_OK or an error of HF_GetRec. On error, nothing is
+ * left pinned.
+ */
+int HF_PinRec(int fd, RID rid, HF_RecHandle *handle);
+
+/*
+ * Pins the n records with RIDs rids[] into handles[]. Either all of
+ * them are pinned, or (on error) none.
+ */
+int HF_PinRecs(int fd, RID rids[], int n, HF_RecHandle handles[]);
+
+/*
+ * Releases a pinned record: its page is unfixed once no handle pins
+ * it any more. Handles must be released before the file is closed.
+ * While a page is pinned, reads, scans, inserts, updates and deletes
+ * through fd share it with the handles, and other opens of the same
+ * file read it in the buffer pool. Its records stay where they are:
+ * the page is not compacted, so the space of records deleted from
+ * it is only used again once it is released (or by HF_Vacuum), and
+ * a record grown past the room left moves to another page as in
+ * HF_UpdateRec. Updating or deleting the pinned record itself
+ * changes what handle->record points to.
+ */
+int HF_ReleaseRec(HF_RecHandle *handle);
+
+// Releases the n handles of HF_PinRecs
+int HF_ReleaseRecs(HF_RecHandle handles[], int n);
+
+/*
+ * Reads a record a piece at a time, without putting it together in
+ * memory: a long record an overflow page at a time, any other in one
+ * piece. Between HF_ReadRecStream calls the stream keeps the page of
+ * the last piece pinned (see HF_PinRec).
+ */
+typedef struct {
+    int   fd;             // The file descriptor
+    int   recLen;         // Length of the whole record
+    int   pageNum;        // Overflow page pinned for the last piece, or -1
+    int   nextPage;       // Next overflow page to read, or -1
+    int   pieces;         // Pieces given so far
+    HF_RecHandle whole;   // A record in one piece, pinned
+} HF_RecStream;
+
+/*
+ * Opens a stream on the record with RID "rid"; stream->recLen is
+ * its length. Returns HFE_OK or an error of HF_GetRec.
+ */
+int HF_OpenRecStream(int fd, RID rid, HF_RecStream *stream);
+
+/*
+ * Gives the next piece of the record: *len bytes at *chunk, good
+ * until the next call on the stream.
+ *
+ * Returns:
+ * HFE_OK on success
+ * HFE_EOF once the whole record has been given
+ */
+int HF_ReadRecStream(HF_RecStream *stream, char **chunk, int *len);
+
+// Closes a stream, unpinning its page
+int HF_CloseRecStream(HF_RecStream *stream);
+
 /*
  * ======================================================
  * File Scan Function Prototypes
  * ======================================================
  */
 
+/*
+ * A scan predicate: "field op value". The field of a record is its
+ * field-th value (from 0) when split at HF_FIELD_SEP; that of a PAX
+ * record is its field-th field, without the blanks or '\0's padding
+ * it. Fields are compared as bytes, or as numbers if op has HF_OP_NUM
+ * in it; a record without the field, or whose field is not a number,
+ * does not match.
+ */
+#define HF_FIELD_SEP  ';'
+
+#define HF_OP_EQ   1
+#define HF_OP_NE   2
+#define HF_OP_LT   3
+#define HF_OP_LE   4
+#define HF_OP_GT   5
+#define HF_OP_GE   6
+#define HF_OP_NUM  0x10   /* or'ed in: compare as numbers */
+
+typedef struct {
+    int         field;    // Field number, from 0
+    int         op;       // HF_OP_xxx
+    const char *value;    // The constant, '\0'-terminated
+    int         len;      // Set by HF_OpenFileScanWhere: strlen(value)
+    double      num;      // ... and its value, for HF_OP_NUM
+} HF_Pred;
+
+// Predicates past the first HF_DICT_PREDS compare decoded values
+#define HF_DICT_PREDS 8
+
 // This struct will keep track of the scanner's state
 typedef struct {
     int   fd;             // The file descriptor
     int   currentPageNum; // Page number of the current page
     int   currentSlotNum; // Slot number of the last record found
     char *currentPageBuf; // Pinned buffer for the current page
+    HF_Pred *preds;       // Predicates records must match, or NULL
+    int   numPreds;       // Number of them
+    short dictCodes[HF_DICT_PREDS]; // On a dictionary page, codes of the predicates' values
+    HF_ZoneRoot zones;    // Zone map to skip pages by (numFields 0 if none)
 } HF_Scan;
 
 
@@ -134,6 +624,21 @@ typedef struct {
  */
 int HF_OpenFileScan(int fd, HF_Scan *scan);
 
+/*
+ * Opens a file scan that gives only the records matching all of the
+ * numPreds predicates in preds. They are tested in the scan, on the
+ * bytes of the pinned page, so records that do not match are neither
+ * copied nor handed back. preds is kept by the scan, and must last
+ * until it is closed. If the file has a zone map on the field of an
+ * HF_OP_NUM predicate, the pages it rules out are not read at all.
+ *
+ * Returns:
+ * HFE_OK on success
+ * HFE_BADPRED if a predicate has no field, operator or value, or
+ * compares as numbers with a value that is not one
+ */
+int HF_OpenFileScanWhere(int fd, HF_Scan *scan, HF_Pred *preds, int numPreds);
+
 /*
  * Retrieves the next valid record in the file scan.
  *
@@ -142,7 +647,8 @@ int HF_OpenFileScan(int fd, HF_Scan *scan);
  *
  * Outputs:
  * rid: The RID of the next record
- * record: Pointer to the record's data
+ * record: Pointer to the record's data (see HF_GetRec; a long record
+ * is put together in memory that the next scan call overwrites)
  * recLen: Length of the record
  *
  * Returns:
@@ -151,9 +657,72 @@ int HF_OpenFileScan(int fd, HF_Scan *scan);
  */
 int HF_GetNextRec(int fd, HF_Scan *scan, RID *rid, char **record, int *recLen);
 
+/*
+ * Like HF_GetNextRec, but gives only field "field" of the record,
+ * straight from its minipage. Files other than PAX files give
+ * HFE_NOFIELDS, and an fd other than the scan's file PFE_FD.
+ */
+int HF_GetNextField(int fd, HF_Scan *scan, int field,
+                    RID *rid, char **value, int *len);
+
+/*
+ * Retrieves the next records in the file scan, as many as are left
+ * on the scan's current page (or on the next page that has any), up
+ * to max, so that they can be worked on in a loop without a call per
+ * record. Record i is records[i], lens[i] bytes, with RID rids[i].
+ * The records are those HF_GetNextRec would give, and the two can be
+ * mixed; the pointers are good until the next call on the scan (in a
+ * PAX file, until the next HF_GetNextBatch of any scan). A long
+ * record comes in a batch of its own, put together like those of
+ * HF_GetNextRec.
+ *
+ * Returns:
+ * The number of records (at least 1)
+ * HFE_EOF when no more records are found
+ * PFE_FD when fd is not the file the scan was opened on
+ */
+int HF_GetNextBatch(int fd, HF_Scan *scan, RID rids[], char *records[], int lens[], int max);
+
 /*
  * Closes a file scan.
  */
 int HF_CloseFileScan(HF_Scan *scan);
 
+/*
+ * Called by HF_ParallelScan with the records it finds, n at a time,
+ * all from one page: record i is records[i], lens[i] bytes, with RID
+ * rids[i]. The pointers are good until the call returns. "worker"
+ * (0 to numWorkers - 1) tells which thread is calling, so that each
+ * can add to results of its own, to be merged once the scan is over.
+ * Returns HFE_OK to go on; anything else stops the scan.
+ */
+typedef int (*HF_ScanFn)(void *arg, int worker, RID rids[], char *records[],
+                         int lens[], int n);
+
+/*
+ * Scans a file with numWorkers threads (the calling thread and
+ * numWorkers - 1 more), giving every record that matches the
+ * numPreds predicates in preds (see HF_OpenFileScanWhere) to fn,
+ * once each and in no particular order. The pages are split into
+ * morsels of morselPages pages, which the threads claim as they go,
+ * taking from each other when their own run out.
+ *
+ * The threads call the PF layer under PF_Lock, so the calling thread
+ * must not hold it, and other threads can go on using the PF layer.
+ * Each thread keeps up to two buffer pages fixed, so at most
+ * PF_MAX_BUFS / 2 workers run (half the buffer pool's pages; see
+ * PF_SetBufferSize): a larger numWorkers is cut down to that, not
+ * refused, and the workers then still number from 0. The pages fixed
+ * by others count against the same buffer pool, and if too few are
+ * left, the scan stops with PFE_NOBUF.
+ *
+ * Returns:
+ * HFE_OK on success
+ * HFE_BADARG if numWorkers or morselPages is below 1, or fn is NULL
+ * HFE_BADPRED if a predicate is bad
+ * the error returned by fn, or a PF error code, if the scan stopped
+ */
+int HF_ParallelScan(int fd, int numWorkers, int morselPages,
+                    HF_Pred *preds, int numPreds, HF_ScanFn fn, void *arg);
+
 #endif // HF_H
\ No newline at end of file
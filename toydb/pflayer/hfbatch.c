@@ -0,0 +1,62 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "bench.h"
+
+#define BATCH_FILE "batch.hf"
+
+/*
+ * Batch scan benchmark: loads each table given (by default gradsum
+ * and studregn) into a file of 64K slotted pages, as its text rows,
+ * and into one of fixed pages, as rows padded to the longest, and
+ * scans both with HF_GetNextRec and with HF_GetNextBatch.
+ */
+int main(int argc, char *argv[]) {
+    const char *defaults[] = { "../../data/gradsum.txt", "../../data/studregn.txt" };
+    const char **files = (argc > 1) ? (const char **)argv + 1 : defaults;
+    int nfiles = (argc > 1) ? argc - 1 : 2;
+
+    PF_Init();
+    PF_SetBufferSize(100);
+
+    for (int f = 0; f < nfiles; f++) {
+        int n, *lens, maxLen = 0, count;
+        char **rows = read_rows(files[f], &n, &lens);
+        for (int i = 0; i < n; i++)
+            if (lens[i] > maxLen)
+                maxLen = lens[i];
+
+        printf("%s: %d rows\n", files[f], n);
+        printf("  %-8s %8s %14s %14s %8s\n", "layout", "pages", "rec rows/s",
+               "batch rows/s", "speedup");
+        for (int fixed = 0; fixed <= 1; fixed++) {
+            int fd, error;
+            PF_DestroyFile(BATCH_FILE);
+            if (fixed) {
+                for (int i = 0; i < n; i++) {
+                    rows[i] = realloc(rows[i], maxLen);
+                    memset(rows[i] + lens[i], ' ', maxLen - lens[i]);
+                    lens[i] = maxLen;
+                }
+                error = HF_CreateFileFixed(BATCH_FILE, PF_MAX_PAGE_SIZE, 0, maxLen);
+            } else {
+                error = HF_CreateFileOpt(BATCH_FILE, PF_MAX_PAGE_SIZE, 0);
+            }
+            if (error != HFE_OK || (fd = HF_OpenFile(BATCH_FILE)) < 0 ||
+                    HF_InsertBatch(fd, rows, lens, n, NULL) != HFE_OK) {
+                PF_PrintError("load " BATCH_FILE);
+                return 1;
+            }
+            long s1, s2;
+            double ms1 = scan_file(fd, NULL, 0, FALSE, &count, &s1);
+            double ms2 = scan_file(fd, NULL, 0, TRUE, &count, &s2);
+            printf("  %-8s %8d %14.0f %14.0f %7.2fx%s\n", fixed ? "fixed" : "slotted",
+                   PF_NumUsedPages(fd), n / (ms1 / 1000.0), n / (ms2 / 1000.0),
+                   ms1 / ms2, (s1 == s2) ? "" : " (different sums!)");
+            HF_CloseFile(fd);
+            PF_DestroyFile(BATCH_FILE);
+        }
+        free_rows(rows, lens, n);
+    }
+    return 0;
+}
@@ -0,0 +1,229 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <limits.h>
+#include "schema.h"
+
+#define MAX_LINE 65536
+#define MAX_TABLES 64
+#define SHORT_VALUE 8   // no longer than this: char, as a varchar's slot is 4 bytes
+
+/* What the values of a column seen so far look like */
+typedef struct {
+    int numeric;        // all are numbers of the form HF_EncodeTuple takes
+    int scale;          // ... with this many digits after the point (-1: none seen)
+    int minLen, maxLen;
+} ColStats;
+
+/*
+ * Tells whether len bytes of text are a number as HF_DecodeTuple
+ * writes it, and sets *scale to its digits after the point.
+ */
+static int is_num(const char *s, int len, int *scale) {
+    int i = (len > 0 && s[0] == '-');
+    int start = i, zero = TRUE;
+    long long v = 0;
+
+    while (i < len && isdigit((unsigned char)s[i])) {
+        v = v * 10 + (s[i] - '0');
+        zero = zero && s[i] == '0';
+        if (v > INT_MAX || i - start > 10)
+            return FALSE;
+        i++;
+    }
+    if (i == start || (s[start] == '0' && i - start > 1))
+        return FALSE;
+    *scale = 0;
+    if (i < len && s[i] == '.') {
+        for (i++; i < len && isdigit((unsigned char)s[i]); i++) {
+            v = v * 10 + (s[i] - '0');
+            zero = zero && s[i] == '0';
+            if (v > INT_MAX || ++*scale > 9)
+                return FALSE;
+        }
+        if (*scale == 0)
+            return FALSE;
+    }
+    return i == len && !(start == 1 && zero);
+}
+
+/* Number of ';'-separated values in a row */
+static int count_fields(const char *s) {
+    int n = 1;
+    for (; *s; s++)
+        if (*s == ';')
+            n++;
+    return n;
+}
+
+/*
+ * Works out the schema of a table from its rows: as many columns as
+ * most rows have values; int or dec(s) for columns of numbers, char(n)
+ * for values that are all n bytes long or short, and varchar(n) for
+ * the rest.
+ * The columns are called c1, c2, ..., as the data has no names.
+ */
+static void infer(const char *table, char **rows, int n, HF_Schema *schema) {
+    int count[HF_MAX_COLS + 2] = {0};
+    ColStats st[HF_MAX_COLS];
+    char decl[MAX_LINE];
+    int numCols = 1;
+
+    for (int i = 0; i < n; i++) {
+        int f = count_fields(rows[i]);
+        count[f <= HF_MAX_COLS ? f : HF_MAX_COLS + 1]++;
+    }
+    for (int f = 1; f <= HF_MAX_COLS; f++)
+        if (count[f] > count[numCols])
+            numCols = f;
+
+    for (int c = 0; c < numCols; c++) {
+        st[c].numeric = TRUE;
+        st[c].scale = -1;
+        st[c].minLen = INT_MAX;
+        st[c].maxLen = 0;
+    }
+    for (int i = 0; i < n; i++) {
+        if (count_fields(rows[i]) > numCols)
+            continue;   // will not encode anyway
+        const char *p = rows[i];
+        for (int c = 0; c < numCols && p != NULL; c++) {
+            const char *semi = strchr(p, ';');
+            int len = semi ? (int)(semi - p) : (int)strlen(p);
+            int scale;
+            if (len > 0) {
+                if (!is_num(p, len, &scale) ||
+                        (st[c].scale >= 0 && st[c].scale != scale))
+                    st[c].numeric = FALSE;
+                else
+                    st[c].scale = scale;
+                if (len < st[c].minLen)
+                    st[c].minLen = len;
+                if (len > st[c].maxLen)
+                    st[c].maxLen = len;
+            }
+            p = semi ? semi + 1 : NULL;
+        }
+    }
+
+    int k = snprintf(decl, sizeof(decl), "%s", table);
+    for (int c = 0; c < numCols; c++) {
+        if (st[c].maxLen == 0)
+            k += snprintf(decl + k, sizeof(decl) - k, " c%d:char(1)", c + 1);
+        else if (st[c].numeric && st[c].scale == 0)
+            k += snprintf(decl + k, sizeof(decl) - k, " c%d:int", c + 1);
+        else if (st[c].numeric)
+            k += snprintf(decl + k, sizeof(decl) - k, " c%d:dec(%d)", c + 1, st[c].scale);
+        else if (st[c].minLen == st[c].maxLen || st[c].maxLen <= SHORT_VALUE)
+            k += snprintf(decl + k, sizeof(decl) - k, " c%d:char(%d)", c + 1, st[c].maxLen);
+        else
+            k += snprintf(decl + k, sizeof(decl) - k, " c%d:varchar(%d)", c + 1, st[c].maxLen);
+    }
+    if (HF_ParseSchema(decl, schema) != HFE_OK) {
+        fprintf(stderr, "bad schema for %s: %s\n", table, decl);
+        exit(1);
+    }
+}
+
+static int cmp_name(const void *a, const void *b) {
+    return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+/*
+ * Schema catalog generator: works out a schema for every table in
+ * data/ and prints the catalog (see schema.h). On stderr, for each
+ * table: the rows that do not encode (more values than columns),
+ * those whose text does not come back the same (fewer values), and
+ * the bytes of the rows as text and as tuples.
+ *
+ *     hfcatalog ../../data > ../../data/schema.cat
+ */
+int main(int argc, char *argv[]) {
+    const char *dataDir = (argc > 1) ? argv[1] : "../../data";
+    static char line[MAX_LINE];
+    char *names[MAX_TABLES];
+    int ntables = 0;
+
+    DIR *dir = opendir(dataDir);
+    if (!dir) {
+        perror(dataDir);
+        fprintf(stderr, "Usage: %s [data_dir]\n", argv[0]);
+        return 1;
+    }
+    struct dirent *de;
+    while ((de = readdir(dir)) != NULL && ntables < MAX_TABLES) {
+        size_t n = strlen(de->d_name);
+        if (n > 4 && strcmp(de->d_name + n - 4, ".txt") == 0)
+            names[ntables++] = strdup(de->d_name);
+    }
+    closedir(dir);
+    qsort(names, ntables, sizeof(char *), cmp_name);
+
+    printf("# Schema catalog of the tables in data/, made by hfcatalog.\n");
+    printf("# The data has no column names, so columns are numbered.\n");
+    fprintf(stderr, "%-14s %7s %7s %7s %10s %10s %7s\n", "table", "rows",
+            "reject", "short", "text B", "tuple B", "ratio");
+    long totText = 0, totTuple = 0;
+    for (int t = 0; t < ntables; t++) {
+        char path[1024], table[HF_NAME_LEN];
+        snprintf(path, sizeof(path), "%s/%s", dataDir, names[t]);
+        snprintf(table, sizeof(table), "%.*s", (int)strlen(names[t]) - 4, names[t]);
+
+        // The rows: lines with a ';' (others are titles or run-on text)
+        FILE *fp = fopen(path, "r");
+        if (!fp) {
+            perror(path);
+            return 1;
+        }
+        int n = 0, cap = 1024;
+        char **rows = malloc(cap * sizeof(char*));
+        while (fgets(line, sizeof(line), fp)) {
+            line[strcspn(line, "\r\n")] = '\0';
+            if (strchr(line, ';') == NULL)
+                continue;
+            if (n == cap)
+                rows = realloc(rows, (cap *= 2) * sizeof(char*));
+            rows[n++] = strdup(line);
+        }
+        fclose(fp);
+
+        HF_Schema schema;
+        infer(table, rows, n, &schema);
+        HF_FormatSchema(&schema, line, sizeof(line));
+        printf("%s\n", line);
+
+        // Encode every row and decode it again
+        char *tuple = malloc(schema.maxLen);
+        char *text = malloc(schema.maxText + 1);
+        int rejected = 0, changed = 0;
+        long textBytes = 0, tupleBytes = 0;
+        for (int i = 0; i < n; i++) {
+            int len = strlen(rows[i]);
+            int tlen = HF_EncodeTuple(&schema, rows[i], len, tuple);
+            if (tlen < 0) {
+                rejected++;
+            } else {
+                if (HF_DecodeTuple(&schema, tuple, text) != len ||
+                        memcmp(text, rows[i], len) != 0)
+                    changed++;
+                textBytes += len;
+                tupleBytes += tlen;
+            }
+            free(rows[i]);
+        }
+        fprintf(stderr, "%-14s %7d %7d %7d %10ld %10ld %6.2fx\n", table, n,
+                rejected, changed, textBytes, tupleBytes,
+                tupleBytes ? (double)textBytes / tupleBytes : 0.0);
+        totText += textBytes;
+        totTuple += tupleBytes;
+        free(rows);
+        free(tuple);
+        free(text);
+        free(names[t]);
+    }
+    fprintf(stderr, "%-14s %7s %7s %7s %10ld %10ld %6.2fx\n", "total", "", "", "",
+            totText, totTuple, totTuple ? (double)totText / totTuple : 0.0);
+    return 0;
+}
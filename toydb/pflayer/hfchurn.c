@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "bench.h"
+
+#define CHURN_FILE "churn.hf"
+#define SEED 12345
+
+/* Pages of the file, and the fraction of their bytes that hold records */
+static void report(const char *what, int fd, long liveBytes, double ms) {
+    int pages = PF_NumUsedPages(fd);
+    long total = (long)pages * PF_GetPageSize(fd);
+    printf("%-10s %8d %9.1f%% %10.2f\n", what, pages,
+           total ? 100.0 * liveBytes / total : 0.0, ms);
+}
+
+/*
+ * Churn benchmark: load one data/ table, then for a number of rounds
+ * delete a random deletePct% of the records and insert them again,
+ * the way updates that move records would. Reports how many pages
+ * the file takes and how full they are after each round, then runs
+ * HF_Vacuum on the file with half its records deleted and reports
+ * the bytes it reclaimed.
+ */
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr,
+            "Usage: %s <data_txt_path> [rounds] [deletePct]\n"
+            "Example: %s ../../data/feecoll.txt 10 20\n",
+            argv[0], argv[0]);
+        return 1;
+    }
+    const char *dataFile = argv[1];
+    int rounds = (argc > 2) ? atoi(argv[2]) : 10;
+    int deletePct = (argc > 3) ? atoi(argv[3]) : 20;
+
+    // Read the table
+    int n, *lens;
+    char **recs = read_rows(dataFile, &n, &lens);
+    long liveBytes = 0;
+    for (int i = 0; i < n; i++)
+        liveBytes += lens[i];
+    RID *rids = malloc(n * sizeof(RID));
+    int *victims = malloc(n * sizeof(int));
+
+    PF_Init();
+    PF_SetBufferSize(20);
+    PF_DestroyFile(CHURN_FILE);
+    int fd;
+    if (HF_CreateFile(CHURN_FILE) != HFE_OK ||
+            (fd = HF_OpenFile(CHURN_FILE)) < 0) {
+        PF_PrintError("create " CHURN_FILE);
+        return 1;
+    }
+    for (int i = 0; i < n; i++) {
+        if (HF_InsertRec(fd, recs[i], lens[i], &rids[i]) != HFE_OK) {
+            PF_PrintError("HF_InsertRec");
+            return 1;
+        }
+    }
+
+    printf("%s: %d records, %d rounds of deleting and reinserting %d%%\n",
+           dataFile, n, rounds, deletePct);
+    printf("%-10s %8s %10s %10s\n", "round", "pages", "full", "ms");
+    report("load", fd, liveBytes, 0);
+
+    srand(SEED);
+    int ndel = (int)((long)n * deletePct / 100);
+    for (int r = 1; r <= rounds; r++) {
+        struct timeval t1, t2;
+        gettimeofday(&t1, NULL);
+
+        // pick ndel distinct records
+        for (int i = 0; i < n; i++)
+            victims[i] = i;
+        for (int i = 0; i < ndel; i++) {
+            int j = i + rand() % (n - i);
+            int t = victims[i]; victims[i] = victims[j]; victims[j] = t;
+        }
+        for (int i = 0; i < ndel; i++) {
+            if (HF_DeleteRec(fd, rids[victims[i]]) != HFE_OK) {
+                PF_PrintError("HF_DeleteRec");
+                return 1;
+            }
+        }
+        for (int i = 0; i < ndel; i++) {
+            int k = victims[i];
+            if (HF_InsertRec(fd, recs[k], lens[k], &rids[k]) != HFE_OK) {
+                PF_PrintError("HF_InsertRec");
+                return 1;
+            }
+        }
+
+        gettimeofday(&t2, NULL);
+        char what[16];
+        sprintf(what, "%d", r);
+        report(what, fd, liveBytes, elapsed_ms(t1, t2));
+    }
+
+    // Leave dead space behind: delete half the records, then vacuum
+    int nvac = n / 2;
+    for (int i = 0; i < nvac; i++)
+        HF_DeleteRec(fd, rids[victims[i]]);
+    long reclaimed;
+    struct timeval t1, t2;
+    gettimeofday(&t1, NULL);
+    if (HF_Vacuum(fd, &reclaimed) != HFE_OK) {
+        PF_PrintError("HF_Vacuum");
+        return 1;
+    }
+    gettimeofday(&t2, NULL);
+    printf("HF_Vacuum after deleting %d records: %ld bytes reclaimed in %.2f ms\n",
+           nvac, reclaimed, elapsed_ms(t1, t2));
+
+    HF_CloseFile(fd);
+    PF_DestroyFile(CHURN_FILE);
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "bench.h"
+
+#define DICT_FILE "dict.hf"
+
+/*
+ * Dictionary page benchmark: loads each table given as file:field
+ * (by default studregn on its course code and student on its
+ * program) into a file of 4K pages of format 2 and into one of 4K
+ * dictionary pages, as its text rows, and reports the pages each
+ * takes, the speed of a batch scan, and that of one for the rows
+ * whose field equals the middle row's.
+ */
+int main(int argc, char *argv[]) {
+    const char *defaults[] = { "../../data/studregn.txt:2", "../../data/student.txt:12" };
+    const char **tables = (argc > 1) ? (const char **)argv + 1 : defaults;
+    int ntables = (argc > 1) ? argc - 1 : 2;
+
+    PF_Init();
+    PF_SetBufferSize(2000);
+
+    for (int t = 0; t < ntables; t++) {
+        char file[BENCH_MAX_LINE];
+        int field = 0;
+        if (sscanf(tables[t], "%[^:]:%d", file, &field) < 1) {
+            fprintf(stderr, "%s: not file:field\n", tables[t]);
+            return 1;
+        }
+        int n, *lens;
+        char **rows = read_rows(file, &n, &lens);
+        long bytes = 0;
+        for (int i = 0; i < n; i++)
+            bytes += lens[i];
+
+        // The predicate: the field equal to the middle row's
+        char value[BENCH_MAX_LINE];
+        const char *p = rows[n / 2];
+        for (int f = 0; f < field && p != NULL; f++)
+            if ((p = strchr(p, ';')) != NULL)
+                p++;
+        int valueLen = (p != NULL) ? (int)strcspn(p, ";") : 0;
+        memcpy(value, p != NULL ? p : "", valueLen);
+        value[valueLen] = '\0';
+        HF_Pred pred = { field, HF_OP_EQ, value };
+
+        printf("%s: %d rows, %.1f bytes a row; field %d = \"%s\"\n",
+               file, n, (double)bytes / n, field, value);
+        printf("  %-8s %8s %10s %14s %14s %8s\n", "layout", "pages", "rows/page",
+               "scan rows/s", "where rows/s", "matches");
+        for (int dict = 0; dict <= 1; dict++) {
+            int fd, all, matches;
+            RID *rids = malloc(n * sizeof(RID));
+            PF_DestroyFile(DICT_FILE);
+            int error = dict ? HF_CreateFileDict(DICT_FILE, PF_PAGE_SIZE, 0)
+                             : HF_CreateFileOpt(DICT_FILE, PF_PAGE_SIZE, 0);
+            if (error != HFE_OK || (fd = HF_OpenFile(DICT_FILE)) < 0 ||
+                    HF_InsertBatch(fd, rows, lens, n, rids) != HFE_OK) {
+                PF_PrintError("load " DICT_FILE);
+                return 1;
+            }
+            int pages = PF_NumUsedPages(fd) - 1;    // not the FSM page
+            double allMs = scan_file(fd, NULL, 0, TRUE, &all, NULL);
+            double whereMs = scan_file(fd, &pred, 1, TRUE, &matches, NULL);
+            printf("  %-8s %8d %10.1f %14.0f %14.0f %8d%s\n", dict ? "dict" : "format 2",
+                   pages, (double)n / pages, all / (allMs / 1000.0), n / (whereMs / 1000.0),
+                   matches, all == n ? "" : " (rows missing!)");
+            HF_CloseFile(fd);
+            PF_DestroyFile(DICT_FILE);
+            free(rids);
+        }
+        free_rows(rows, lens, n);
+    }
+    return 0;
+}
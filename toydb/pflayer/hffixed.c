@@ -0,0 +1,119 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "bench.h"
+
+#define MAX_FIELDS 64
+#define FIXED_FILE "fixed.hf"
+
+/*
+ * Reads a ';'-separated table (lines without a ';' are skipped) and
+ * turns its rows into fixed-width ones: each field padded with blanks
+ * to the widest value it has. Returns the rows and sets *n and the
+ * row length.
+ */
+static char **load(const char *dataFile, int *n, int *rowLen) {
+    int width[MAX_FIELDS] = {0};
+    int count;
+    char **lines = read_rows(dataFile, &count, NULL);
+
+    for (int i = 0; i < count; i++) {
+        int f = 0;
+        for (char *p = lines[i]; f < MAX_FIELDS; f++) {
+            int len = strcspn(p, ";");
+            if (len > width[f])
+                width[f] = len;
+            if (p[len] == '\0')
+                break;
+            p += len + 1;
+        }
+    }
+
+    *rowLen = 0;
+    for (int f = 0; f < MAX_FIELDS; f++)
+        *rowLen += width[f];
+    for (int i = 0; i < count; i++) {
+        char *row = malloc(*rowLen);
+        char *out = row;
+        char *p = lines[i];
+        for (int f = 0; f < MAX_FIELDS && width[f] > 0; f++) {
+            int len = strcspn(p, ";");
+            memcpy(out, p, len);
+            memset(out + len, ' ', width[f] - len);
+            out += width[f];
+            p += len + (p[len] != '\0');
+        }
+        memset(out, ' ', row + *rowLen - out);
+        free(lines[i]);
+        lines[i] = row;
+    }
+    *n = count;
+    return lines;
+}
+
+/*
+ * Loads the rows into a new file of slotted pages, or of fixed pages,
+ * and scans it BENCH_PASSES times. Prints the pages, the rows per page
+ * and the scan rate.
+ */
+static void run(const char *what, char **rows, int n, int rowLen, int fixed) {
+    int *lens = malloc(n * sizeof(int));
+    int fd;
+
+    for (int i = 0; i < n; i++)
+        lens[i] = rowLen;
+    PF_DestroyFile(FIXED_FILE);
+    if ((fixed ? HF_CreateFileFixed(FIXED_FILE, PF_PAGE_SIZE, 0, rowLen)
+               : HF_CreateFile(FIXED_FILE)) != HFE_OK ||
+            (fd = HF_OpenFile(FIXED_FILE)) < 0) {
+        PF_PrintError("create " FIXED_FILE);
+        exit(1);
+    }
+    if (HF_InsertBatch(fd, rows, lens, n, NULL) != HFE_OK) {
+        PF_PrintError("HF_InsertBatch");
+        exit(1);
+    }
+    int pages = PF_NumUsedPages(fd) - 1;    // not counting the FSM page
+
+    int count;
+    double ms = scan_file(fd, NULL, 0, FALSE, &count, NULL);
+    if (count != n) {
+        printf("scan found %d rows, expected %d\n", count, n);
+        exit(1);
+    }
+    printf("  %-8s %8d %10.1f %10.2f %12.0f\n", what, pages,
+           (double)n / pages, ms, n / (ms / 1000.0));
+    HF_CloseFile(fd);
+    PF_DestroyFile(FIXED_FILE);
+    free(lens);
+}
+
+/*
+ * Fixed-length record benchmark: turns each table given (by default
+ * gradsum, feecoll and studregn) into fixed-width rows and stores
+ * them on slotted pages and on fixed pages, comparing the pages
+ * taken and the speed of a full scan.
+ */
+int main(int argc, char *argv[]) {
+    const char *defaults[] = { "../../data/gradsum.txt",
+                               "../../data/feecoll.txt",
+                               "../../data/studregn.txt" };
+    const char **tables = (argc > 1) ? (const char **)argv + 1 : defaults;
+    int ntables = (argc > 1) ? argc - 1 : 3;
+
+    PF_Init();
+    PF_SetBufferSize(100);
+
+    for (int t = 0; t < ntables; t++) {
+        int n, rowLen;
+        char **rows = load(tables[t], &n, &rowLen);
+
+        printf("%s: %d rows of %d bytes\n", tables[t], n, rowLen);
+        printf("  %-8s %8s %10s %10s %12s\n",
+               "format", "pages", "rows/page", "scan ms", "rows/s");
+        run("slotted", rows, n, rowLen, FALSE);
+        run("fixed", rows, n, rowLen, TRUE);
+        free_rows(rows, NULL, n);
+    }
+    return 0;
+}
@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include "bench.h"
+
+/*
+ * Load-time benchmark: bulk-load one data/ table into a heap file
+ * and report throughput. Run `filefrag <heapFile>` afterwards to
+ * see how many extents the file ended up in. With a batch size, the
+ * file is loaded in bulk-append mode with HF_InsertBatch, batch
+ * records at a time; otherwise with one HF_InsertRec per record.
+ */
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        fprintf(stderr,
+            "Usage: %s <data_txt_path> <heap_file> [extentPages] [pageSize] [compress] [batch]\n"
+            "Example: %s ../../data/studregn.txt studregn.hf 64 16384 1 1024\n",
+            argv[0], argv[0]);
+        return 1;
+    }
+
+    const char *dataFile = argv[1];
+    const char *heapFile = argv[2];
+    int pageSize = (argc > 4) ? atoi(argv[4]) : PF_PAGE_SIZE;
+    int pfFlags = (argc > 5 && atoi(argv[5])) ? PF_FILE_COMPRESSED : 0;
+    int batch = (argc > 6) ? atoi(argv[6]) : 0;
+
+    PF_Init();
+    PF_SetBufferSize(20);
+    PF_SetReplacementPolicy(PF_REPL_LRU);
+    if (argc > 3)
+        PF_SetExtentSize(atoi(argv[3]));
+
+    // (Re)create HF file
+    PF_DestroyFile((char*)heapFile);  // ignore error if not exists
+    if (HF_CreateFileOpt((char*)heapFile, pageSize, pfFlags) != HFE_OK) {
+        PF_PrintError("HF_CreateFileOpt");
+        return 1;
+    }
+
+    int fd = HF_OpenFile((char*)heapFile);
+    if (fd < 0) {
+        PF_PrintError("HF_OpenFile");
+        return 1;
+    }
+
+    FILE *fp = fopen(dataFile, "r");
+    if (!fp) {
+        perror("fopen");
+        return 1;
+    }
+
+    struct timeval t1, t2;
+    char line[BENCH_MAX_LINE];
+    long count = 0;
+    long bytes = 0;
+
+    // batch buffers: the lines of a batch are packed in pool
+    char *pool = NULL, **recs = NULL;
+    int *lens = NULL, n = 0, used = 0;
+    if (batch > 0) {
+        pool = malloc((size_t)batch * BENCH_MAX_LINE);
+        recs = malloc(batch * sizeof(char*));
+        lens = malloc(batch * sizeof(int));
+        if (!pool || !recs || !lens) {
+            perror("malloc");
+            return 1;
+        }
+    }
+
+    PF_ResetStats();
+    gettimeofday(&t1, NULL);
+    if (batch > 0 && HF_BeginBulkAppend(fd) != HFE_OK) {
+        PF_PrintError("HF_BeginBulkAppend");
+        return 1;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        // strip trailing newline
+        size_t len = strlen(line);
+        if (len > 0 && (line[len-1] == '\n' || line[len-1] == '\r'))
+            line[--len] = '\0';
+
+        if (batch > 0) {
+            recs[n] = memcpy(pool + used, line, len);
+            lens[n++] = (int)len;
+            used += (int)len;
+            if (n == batch) {
+                int err = HF_InsertBatch(fd, recs, lens, n, NULL);
+                if (err != HFE_OK) {
+                    printf("HF_InsertBatch error %d at record %ld\n", err, count);
+                    return 1;
+                }
+                n = used = 0;
+            }
+        } else {
+            RID rid;
+            int err = HF_InsertRec(fd, line, (int)len, &rid);
+            if (err != HFE_OK) {
+                printf("HF_InsertRec error %d at record %ld\n", err, count);
+                return 1;
+            }
+        }
+        count++;
+        bytes += (long)len;
+    }
+    if (n > 0 && HF_InsertBatch(fd, recs, lens, n, NULL) != HFE_OK) {
+        printf("HF_InsertBatch error at record %ld\n", count);
+        return 1;
+    }
+    if (HF_CloseFile(fd) != HFE_OK) {
+        PF_PrintError("HF_CloseFile");
+        return 1;
+    }
+    gettimeofday(&t2, NULL);
+    fclose(fp);
+
+    double ms = elapsed_ms(t1, t2);
+    struct stat st;
+    if (stat(heapFile, &st) != 0)
+        st.st_size = 0;
+    printf("Loaded %ld records (%ld bytes) from %s into %s (%d-byte pages%s%s)\n",
+           count, bytes, dataFile, heapFile, pageSize,
+           pfFlags ? ", compressed" : "", batch > 0 ? ", bulk append" : "");
+    printf("File size: %lld bytes\n", (long long)st.st_size);
+    printf("Load time: %.2f ms, %.0f records/s, %.2f MB/s\n",
+           ms, count / (ms / 1000.0), bytes / (ms / 1000.0) / 1e6);
+    printf("File write rate: %.2f MB/s\n", st.st_size / (ms / 1000.0) / 1e6);
+    PF_PrintStats();
+    free(pool);
+    free(recs);
+    free(lens);
+    return 0;
+}
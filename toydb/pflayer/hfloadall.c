@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <dirent.h>
+#include "bench.h"
+
+#define MAX_TABLES 64
+#define LOAD_FILE "loadall.hf"
+
+/*
+ * Loads one table, into a heap file made with the free-space map
+ * (useFsm) or without one, so HF_InsertRec falls back to scanning the
+ * file for a page with room. Returns the load time in ms and sets
+ * the record and page counts and the pages fetched.
+ */
+static double load(const char *dataFile, int pageSize, int useFsm,
+                   long *count, int *pages, long *fetches) {
+    char line[BENCH_MAX_LINE];
+    struct timeval t1, t2;
+    int fd;
+
+    PF_DestroyFile(LOAD_FILE);
+    if ((useFsm ? HF_CreateFileOpt(LOAD_FILE, pageSize, 0)
+                : PF_CreateFileOpt(LOAD_FILE, pageSize, 0)) != HFE_OK ||
+            (fd = HF_OpenFile(LOAD_FILE)) < 0) {
+        PF_PrintError("create " LOAD_FILE);
+        exit(1);
+    }
+    FILE *fp = fopen(dataFile, "r");
+    if (!fp) {
+        perror(dataFile);
+        exit(1);
+    }
+
+    *count = 0;
+    PF_ResetStats();
+    gettimeofday(&t1, NULL);
+    while (fgets(line, sizeof(line), fp)) {
+        size_t len = strlen(line);
+        if (len > 0 && (line[len-1] == '\n' || line[len-1] == '\r'))
+            line[--len] = '\0';
+
+        RID rid;
+        int err = HF_InsertRec(fd, line, (int)len, &rid);
+        if (err != HFE_OK) {
+            printf("HF_InsertRec error %d at record %ld of %s\n",
+                   err, *count, dataFile);
+            exit(1);
+        }
+        (*count)++;
+    }
+    *pages = PF_NumUsedPages(fd);
+    if (HF_CloseFile(fd) != HFE_OK) {
+        PF_PrintError("HF_CloseFile");
+        exit(1);
+    }
+    gettimeofday(&t2, NULL);
+    fclose(fp);
+    *fetches = PF_stats.logicalReads;
+    PF_DestroyFile(LOAD_FILE);
+    return elapsed_ms(t1, t2);
+}
+
+static int cmp_name(const void *a, const void *b) {
+    return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+/*
+ * Load benchmark over every table in data/: loads each one with and
+ * without the free-space map and reports the load time and the pages
+ * fetched from the buffer pool per record.
+ */
+int main(int argc, char *argv[]) {
+    const char *dataDir = (argc > 1) ? argv[1] : "../../data";
+    int pageSize = (argc > 2) ? atoi(argv[2]) : PF_PAGE_SIZE;
+    char *names[MAX_TABLES];
+    int ntables = 0;
+
+    DIR *dir = opendir(dataDir);
+    if (!dir) {
+        perror(dataDir);
+        fprintf(stderr, "Usage: %s [data_dir] [pageSize]\n", argv[0]);
+        return 1;
+    }
+    struct dirent *de;
+    while ((de = readdir(dir)) != NULL && ntables < MAX_TABLES) {
+        size_t n = strlen(de->d_name);
+        if (n > 4 && strcmp(de->d_name + n - 4, ".txt") == 0)
+            names[ntables++] = strdup(de->d_name);
+    }
+    closedir(dir);
+    qsort(names, ntables, sizeof(char *), cmp_name);
+
+    PF_Init();
+    PF_SetBufferSize(20);
+    PF_SetReplacementPolicy(PF_REPL_LRU);
+
+    printf("%-16s %8s %6s | %10s %10s | %10s %10s %6s | %8s\n",
+           "table", "records", "pages", "scan ms", "fetch/rec",
+           "fsm ms", "fetch/rec", "pages", "speedup");
+    long totCount = 0;
+    double totScan = 0, totFsm = 0;
+    for (int i = 0; i < ntables; i++) {
+        char path[1024];
+        long count, fetchScan, fetchFsm;
+        int pagesScan, pagesFsm;
+
+        snprintf(path, sizeof(path), "%s/%s", dataDir, names[i]);
+        double msScan = load(path, pageSize, FALSE,
+                             &count, &pagesScan, &fetchScan);
+        double msFsm = load(path, pageSize, TRUE,
+                            &count, &pagesFsm, &fetchFsm);
+        printf("%-16s %8ld %6d | %10.2f %10.2f | %10.2f %10.2f %6d | %7.1fx\n",
+               names[i], count, pagesScan,
+               msScan, count ? (double)fetchScan / count : 0.0,
+               msFsm, count ? (double)fetchFsm / count : 0.0,
+               pagesFsm, msFsm > 0 ? msScan / msFsm : 0.0);
+        totCount += count;
+        totScan += msScan;
+        totFsm += msFsm;
+        free(names[i]);
+    }
+    printf("%-16s %8ld %6s | %10.2f %10s | %10.2f %10s %6s | %7.1fx\n",
+           "total", totCount, "", totScan, "", totFsm, "", "",
+           totFsm > 0 ? totScan / totFsm : 0.0);
+    return 0;
+}
@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "bench.h"
+
+#define MAX_LINE 8192
+#define LONG_FILE "long.hf"
+#define MAX_DEPTS 64
+#define ROUNDS 20
+
+/* A department's syllabus: the descriptions of all of its courses */
+typedef struct {
+    char dept[8];
+    char *text;
+    int len, cap;
+    RID rid;
+} Syllabus;
+
+static void append(Syllabus *s, const char *line) {
+    int n = strlen(line);
+    if (s->len + n + 1 > s->cap) {
+        s->cap = 2 * (s->len + n + 1);
+        s->text = realloc(s->text, s->cap);
+    }
+    memcpy(s->text + s->len, line, n);
+    s->len += n;
+    s->text[s->len++] = '\n';
+}
+
+/*
+ * Long record benchmark: puts the course descriptions of crsedetails
+ * together into one record per department, most of them far longer
+ * than a 4K page, stores them, then reads them all ROUNDS times, put
+ * together by HF_GetRec or a page at a time by a record stream.
+ */
+int main() {
+    const char *dataFile = "../../data/crsedetails.txt";
+    static Syllabus depts[MAX_DEPTS];
+    char line[MAX_LINE];
+    int fd, n = 0, cur = -1;
+
+    FILE *fp = fopen(dataFile, "r");
+    if (!fp) {
+        perror(dataFile);
+        return 1;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        // "AE 210;..." starts a course; other lines go on the one before
+        char dept[8];
+        int num;
+        if (sscanf(line, "%7[A-Z] %d", dept, &num) == 2 && strchr(line, ';') != NULL) {
+            for (cur = 0; cur < n && strcmp(depts[cur].dept, dept) != 0; cur++)
+                ;
+            if (cur == n && n < MAX_DEPTS)
+                strcpy(depts[n++].dept, dept);
+        }
+        if (cur >= 0 && cur < n)
+            append(&depts[cur], line);
+    }
+    fclose(fp);
+
+    PF_Init();
+    PF_DestroyFile(LONG_FILE);
+    if (HF_CreateFile(LONG_FILE) != HFE_OK || (fd = HF_OpenFile(LONG_FILE)) < 0) {
+        PF_PrintError("create " LONG_FILE);
+        return 1;
+    }
+    long bytes = 0;
+    int longRecs = 0, maxLen = 0;
+    for (int i = 0; i < n; i++) {
+        int error = HF_InsertRec(fd, depts[i].text, depts[i].len, &depts[i].rid);
+        if (error != HFE_OK) {
+            printf("%s: %d bytes not stored (code %d)\n", depts[i].dept, depts[i].len, error);
+            return 1;
+        }
+        bytes += depts[i].len;
+        longRecs += (depts[i].len > HF_MaxInline(PF_PAGE_SIZE));
+        if (depts[i].len > maxLen)
+            maxLen = depts[i].len;
+    }
+    printf("%s: %d syllabi, %d of them long, %ld bytes (largest %d) on %d pages of 4K\n",
+           dataFile, n, longRecs, bytes, maxLen, PF_NumUsedPages(fd));
+
+    // Read them all back: whole, and as a stream
+    struct timeval t1, t2;
+    long s1 = 0, s2 = 0;
+    char *rec;
+    int len;
+    gettimeofday(&t1, NULL);
+    for (int r = 0; r < ROUNDS; r++)
+        for (int i = 0; i < n; i++)
+            if (HF_GetRec(fd, depts[i].rid, &rec, &len) == HFE_OK)
+                s1 += sum_bytes(rec, len);
+    gettimeofday(&t2, NULL);
+    double getMs = elapsed_ms(t1, t2);
+
+    gettimeofday(&t1, NULL);
+    for (int r = 0; r < ROUNDS; r++) {
+        for (int i = 0; i < n; i++) {
+            HF_RecStream stream;
+            if (HF_OpenRecStream(fd, depts[i].rid, &stream) != HFE_OK)
+                continue;
+            while (HF_ReadRecStream(&stream, &rec, &len) == HFE_OK)
+                s2 += sum_bytes(rec, len);
+            HF_CloseRecStream(&stream);
+        }
+    }
+    gettimeofday(&t2, NULL);
+    double streamMs = elapsed_ms(t1, t2);
+
+    printf("  %-10s %10s %12s\n", "read", "ms", "MB/s");
+    printf("  %-10s %10.1f %12.1f\n", "GetRec", getMs, ROUNDS * bytes / 1e3 / getMs);
+    printf("  %-10s %10.1f %12.1f%s\n", "stream", streamMs, ROUNDS * bytes / 1e3 / streamMs,
+           s1 == s2 ? "" : " (different sum!)");
+
+    HF_CloseFile(fd);
+    PF_DestroyFile(LONG_FILE);
+    for (int i = 0; i < n; i++)
+        free(depts[i].text);
+    return 0;
+}
@@ -0,0 +1,109 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "bench.h"
+
+#define PAR_FILE "parscan.hf"
+#define SCAN_PASSES 10
+#define MAX_WORKERS 64
+#define MORSEL_PAGES 4
+
+/* Per-worker results, padded so that workers do not share cache lines */
+typedef struct {
+    long rows;
+    long bytes;
+    char pad[48];
+} Partial;
+
+static Partial partials[MAX_WORKERS];
+
+static int add(void *arg, int worker, RID rids[], char *records[], int lens[], int n) {
+    Partial *part = &partials[worker];
+    for (int i = 0; i < n; i++)
+        part->bytes += lens[i];
+    part->rows += n;
+    return HFE_OK;
+}
+
+/*
+ * Parallel scan benchmark: loads studregn "scale" times over into a
+ * file of 64K pages and scans it with HF_ParallelScan, for 1, 2, 4
+ * ... up to maxWorkers workers, counting the rows with grade (field
+ * 3) AA (tested in the workers) and adding up their lengths. The
+ * workers' results are merged at the end of each scan.
+ *
+ *     hfparscan [scale] [maxWorkers]
+ */
+int main(int argc, char *argv[]) {
+    int scale = (argc > 1) ? atoi(argv[1]) : 8;
+    int maxWorkers = (argc > 2) ? atoi(argv[2]) : 8;
+    const char *dataFile = "../../data/studregn.txt";
+    char line[BENCH_MAX_LINE];
+    int fd;
+
+    if (scale < 1 || maxWorkers < 1 || maxWorkers > MAX_WORKERS) {
+        fprintf(stderr, "Usage: %s [scale] [maxWorkers (1 to %d)]\n", argv[0], MAX_WORKERS);
+        return 1;
+    }
+    PF_Init();
+    PF_SetBufferSize(100);
+    PF_DestroyFile(PAR_FILE);
+    if (HF_CreateFileOpt(PAR_FILE, PF_MAX_PAGE_SIZE, 0) != HFE_OK ||
+            (fd = HF_OpenFile(PAR_FILE)) < 0) {
+        PF_PrintError("create " PAR_FILE);
+        return 1;
+    }
+    HF_BeginBulkAppend(fd);
+    long rows = 0;
+    for (int s = 0; s < scale; s++) {
+        FILE *fp = fopen(dataFile, "r");
+        if (!fp) {
+            perror(dataFile);
+            return 1;
+        }
+        while (fgets(line, sizeof(line), fp)) {
+            RID rid;
+            line[strcspn(line, "\r\n")] = '\0';
+            if (strchr(line, ';') == NULL)
+                continue;
+            HF_InsertRec(fd, line, strlen(line), &rid);
+            rows++;
+        }
+        fclose(fp);
+    }
+    HF_EndBulkAppend(fd);
+
+    HF_Pred pred[] = { { 3, HF_OP_EQ, "AA" } };
+    printf("%s x %d: %ld rows on %d pages, %ld cores online\n", dataFile, scale, rows,
+           PF_NumUsedPages(fd), sysconf(_SC_NPROCESSORS_ONLN));
+    printf("  %-8s %8s %10s %12s %8s\n", "workers", "matches", "scan ms", "rows/s", "speedup");
+    double ms1 = 0;
+    for (int workers = 1; workers <= maxWorkers; workers *= 2) {
+        struct timeval t1, t2;
+        long matches = 0, bytes = 0;
+        for (int p = 0; p <= SCAN_PASSES; p++) {
+            if (p == 1)
+                gettimeofday(&t1, NULL);
+            memset(partials, 0, sizeof(partials));
+            if (HF_ParallelScan(fd, workers, MORSEL_PAGES, pred, 1, add, NULL) != HFE_OK) {
+                PF_PrintError("HF_ParallelScan");
+                return 1;
+            }
+            matches = bytes = 0;
+            for (int w = 0; w < workers; w++) {
+                matches += partials[w].rows;
+                bytes += partials[w].bytes;
+            }
+        }
+        gettimeofday(&t2, NULL);
+        double ms = elapsed_ms(t1, t2) / SCAN_PASSES;
+        if (workers == 1)
+            ms1 = ms;
+        printf("  %-8d %8ld %10.2f %12.0f %7.2fx\n", workers, matches, ms,
+               rows / (ms / 1000.0), ms1 / ms);
+    }
+    HF_CloseFile(fd);
+    PF_DestroyFile(PAR_FILE);
+    return 0;
+}
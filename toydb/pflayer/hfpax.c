@@ -0,0 +1,204 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "bench.h"
+
+#define PAX_FILE "pax.hf"
+
+/* A table, as ';'-separated text rows and as fixed-width rows */
+typedef struct {
+    int n;
+    char **text;
+    char **fixed;
+    int numFields;
+    int widths[HF_PAX_MAX_FIELDS];
+    int rowLen;
+} Table;
+
+/*
+ * Reads a ';'-separated table (lines without a ';' are skipped), and
+ * makes fixed-width rows of it: each field padded with blanks to the
+ * widest value it has.
+ */
+static void load(const char *dataFile, Table *t) {
+    memset(t, 0, sizeof(Table));
+    t->text = read_rows(dataFile, &t->n, NULL);
+    for (int i = 0; i < t->n; i++) {
+        int f = 0;
+        for (char *p = t->text[i]; f < HF_PAX_MAX_FIELDS; f++) {
+            int len = strcspn(p, ";");
+            if (len > t->widths[f])
+                t->widths[f] = len;
+            if (p[len] == '\0')
+                break;
+            p += len + 1;
+        }
+        if (f + 1 > t->numFields)
+            t->numFields = f + 1;
+    }
+
+    // Empty fields still take a byte, as PAX fields must have a width
+    for (int f = 0; f < t->numFields; f++) {
+        if (t->widths[f] == 0)
+            t->widths[f] = 1;
+        t->rowLen += t->widths[f];
+    }
+    t->fixed = malloc(t->n * sizeof(char*));
+    for (int i = 0; i < t->n; i++) {
+        char *out = t->fixed[i] = malloc(t->rowLen);
+        char *p = t->text[i];
+        for (int f = 0; f < t->numFields; f++) {
+            int len = strcspn(p, ";");
+            memcpy(out, p, len);
+            memset(out + len, ' ', t->widths[f] - len);
+            out += t->widths[f];
+            p += len + (p[len] != '\0');
+        }
+    }
+}
+
+/* Adds up the non-blank bytes of a value */
+static long sum(const char *value, int len) {
+    long s = 0;
+    for (int i = 0; i < len; i++)
+        if (value[i] != ' ')
+            s += (unsigned char)value[i];
+    return s;
+}
+
+enum { SLOTTED, FIXED, PAX, PAXPAGE };
+
+/*
+ * Loads the table into a new file of the given layout, then scans
+ * it, BENCH_PASSES times after one pass to bring it into the buffer
+ * pool, adding up the bytes of field "field": found in each text
+ * row by its ';'s, at its offset in each fixed-width row, or from its
+ * minipage with HF_GetNextField, or a page at a time with
+ * HF_Page_GetColumn. Prints the scan rate; *check gets the sum, to
+ * compare across layouts.
+ */
+static void run(const char *what, Table *t, int layout, int pageSize,
+                int field, long *check) {
+    int *lens = malloc(t->n * sizeof(int));
+    struct timeval t1, t2;
+    int fd, error;
+
+    PF_DestroyFile(PAX_FILE);
+    if (layout == SLOTTED)
+        error = HF_CreateFileOpt(PAX_FILE, pageSize, 0);
+    else if (layout == FIXED)
+        error = HF_CreateFileFixed(PAX_FILE, pageSize, 0, t->rowLen);
+    else    // PAX or PAXPAGE
+        error = HF_CreateFilePax(PAX_FILE, pageSize, 0, t->numFields, t->widths);
+    if (error != HFE_OK || (fd = HF_OpenFile(PAX_FILE)) < 0) {
+        PF_PrintError("create " PAX_FILE);
+        exit(1);
+    }
+    for (int i = 0; i < t->n; i++)
+        lens[i] = (layout == SLOTTED) ? (int)strlen(t->text[i]) : t->rowLen;
+    if (HF_InsertBatch(fd, (layout == SLOTTED) ? t->text : t->fixed,
+                       lens, t->n, NULL) != HFE_OK) {
+        PF_PrintError("HF_InsertBatch");
+        exit(1);
+    }
+    int offset = 0;
+    for (int f = 0; f < field; f++)
+        offset += t->widths[f];
+
+    long s = 0;
+    for (int p = 0; p <= BENCH_PASSES; p++) {
+        HF_Scan scan;
+        RID rid;
+        char *rec;
+        int len;
+        if (p == 1)
+            gettimeofday(&t1, NULL);
+        s = 0;
+        HF_OpenFileScan(fd, &scan);
+        if (layout == PAXPAGE) {
+            int pagenum = -1;
+            char *pageBuf;
+            while (PF_GetNextPage(fd, &pagenum, &pageBuf) == PFE_OK) {
+                unsigned char *bitmap = HF_FixedBitmap(pageBuf);
+                int rows = HF_Page_GetColumn(pageBuf, field, &rec, &len);
+                for (int i = 0; i < rows; i++)
+                    if (bitmap[i / 8] & (1 << (i % 8)))
+                        s += sum(rec + i * len, len);
+                PF_UnfixPage(fd, pagenum, FALSE);
+            }
+        } else if (layout == PAX) {
+            while (HF_GetNextField(fd, &scan, field, &rid, &rec, &len) == HFE_OK)
+                s += sum(rec, len);
+        } else if (layout == FIXED) {
+            while (HF_GetNextRec(fd, &scan, &rid, &rec, &len) == HFE_OK)
+                s += sum(rec + offset, t->widths[field]);
+        } else {
+            while (HF_GetNextRec(fd, &scan, &rid, &rec, &len) == HFE_OK) {
+                int f = 0, i = 0;
+                while (f < field && i < len)
+                    if (rec[i++] == ';')
+                        f++;
+                int start = i;
+                while (i < len && rec[i] != ';')
+                    i++;
+                s += sum(rec + start, i - start);
+            }
+        }
+        HF_CloseFileScan(&scan);
+    }
+    gettimeofday(&t2, NULL);
+    double ms = elapsed_ms(t1, t2) / BENCH_PASSES;
+    printf("  %-8s %8d %10.2f %12.0f %s\n", what, PF_NumUsedPages(fd), ms,
+           t->n / (ms / 1000.0),
+           (*check < 0 || *check == s) ? "" : "(wrong sum!)");
+    *check = s;
+    HF_CloseFile(fd);
+    PF_DestroyFile(PAX_FILE);
+    free(lens);
+}
+
+/*
+ * PAX scan benchmark: for each table and field given (by default
+ * field 6 of gradsum, a grade point average, and field 2 of studregn,
+ * the course code), scans that one field of every row on slotted
+ * pages (the ';'-separated rows), fixed pages (fixed-width rows) and
+ * PAX pages, a record or a page at a time. Pages are 64K so that
+ * the files fit in the buffer pool, and the scans measure only the
+ * work of getting at the field.
+ */
+int main(int argc, char *argv[]) {
+    const char *defaults[] = { "../../data/gradsum.txt", "6",
+                               "../../data/studregn.txt", "2" };
+    const char **args = (argc > 2) ? (const char **)argv + 1 : defaults;
+    int nargs = (argc > 2) ? argc - 1 : 4;
+    int pageSize = PF_MAX_PAGE_SIZE;
+
+    PF_Init();
+    PF_SetBufferSize(100);
+
+    for (int a = 0; a + 1 < nargs; a += 2) {
+        Table t;
+        int field = atoi(args[a + 1]);
+        long check = -1;
+
+        load(args[a], &t);
+        if (field < 0 || field >= t.numFields) {
+            fprintf(stderr, "%s has fields 0 to %d\n", args[a], t.numFields - 1);
+            return 1;
+        }
+        printf("%s: %d rows of %d fields, scanning field %d (%d bytes of %d)\n",
+               args[a], t.n, t.numFields, field, t.widths[field], t.rowLen);
+        printf("  %-8s %8s %10s %12s\n", "layout", "pages", "scan ms", "rows/s");
+        run("slotted", &t, SLOTTED, pageSize, field, &check);
+        run("fixed", &t, FIXED, pageSize, field, &check);
+        run("PAX", &t, PAX, pageSize, field, &check);
+        run("PAX page", &t, PAXPAGE, pageSize, field, &check);
+        for (int i = 0; i < t.n; i++) {
+            free(t.text[i]);
+            free(t.fixed[i]);
+        }
+        free(t.text);
+        free(t.fixed);
+    }
+    return 0;
+}
@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "bench.h"
+
+#define PIN_FILE "pin.hf"
+#define LOOKUPS 1000000
+#define GROUP 16
+
+enum { COPY, PIN, PINGROUP };
+
+/*
+ * Looks up the records with RIDs order[0..LOOKUPS-1]: with HF_GetRec
+ * and a copy of each (as callers must, the page being unfixed), with
+ * HF_PinRec and HF_ReleaseRec, or GROUP at a time with HF_PinRecs, as
+ * a join would hold the matches of a key. Returns ms.
+ */
+static double run(int fd, RID *order, int how, long *check) {
+    static char copy[BENCH_MAX_LINE];
+    HF_RecHandle handles[GROUP];
+    struct timeval t1, t2;
+    long s = 0;
+
+    gettimeofday(&t1, NULL);
+    for (int i = 0; i < LOOKUPS; i += (how == PINGROUP) ? GROUP : 1) {
+        char *rec;
+        int len;
+        if (how == COPY) {
+            HF_GetRec(fd, order[i], &rec, &len);
+            memcpy(copy, rec, len);
+            s += sum_bytes(copy, len);
+        } else if (how == PIN) {
+            HF_PinRec(fd, order[i], &handles[0]);
+            s += sum_bytes(handles[0].record, handles[0].recLen);
+            HF_ReleaseRec(&handles[0]);
+        } else {
+            HF_PinRecs(fd, &order[i], GROUP, handles);
+            for (int k = 0; k < GROUP; k++)
+                s += sum_bytes(handles[k].record, handles[k].recLen);
+            HF_ReleaseRecs(handles, GROUP);
+        }
+    }
+    gettimeofday(&t2, NULL);
+    *check = s;
+    return elapsed_ms(t1, t2);
+}
+
+/*
+ * Record lookup benchmark: loads student into a heap file of 64K
+ * pages that fits in the buffer pool, then looks up LOOKUPS records
+ * at random, copying them or pinning them, one or GROUP at a time
+ * (GROUP records of the same page and its neighbours).
+ */
+int main() {
+    const char *dataFile = "../../data/student.txt";
+    int fd, n;
+    char **rows = read_rows(dataFile, &n, NULL);
+    RID *rids = malloc(n * sizeof(RID));
+
+    PF_Init();
+    PF_SetBufferSize(100);
+    PF_DestroyFile(PIN_FILE);
+    if (HF_CreateFileSized(PIN_FILE, PF_MAX_PAGE_SIZE) != HFE_OK || (fd = HF_OpenFile(PIN_FILE)) < 0) {
+        PF_PrintError("create " PIN_FILE);
+        return 1;
+    }
+    for (int i = 0; i < n; i++)
+        HF_InsertRec(fd, rows[i], strlen(rows[i]), &rids[i]);
+    free_rows(rows, NULL, n);
+
+    // Random RIDs; for the groups, runs of GROUP neighbouring records
+    RID *order = malloc(LOOKUPS * sizeof(RID));
+    srand(42);
+    for (int i = 0; i < LOOKUPS; i += GROUP) {
+        int first = rand() % (n - GROUP);
+        for (int k = 0; k < GROUP && i + k < LOOKUPS; k++)
+            order[i + k] = rids[first + k];
+    }
+
+    printf("%s: %d records on %d pages of 64K, %d lookups\n", dataFile, n,
+           PF_NumUsedPages(fd), LOOKUPS);
+    printf("  %-14s %10s %14s\n", "lookup", "ms", "lookups/s");
+    const char *names[] = { "GetRec + copy", "PinRec", "PinRecs x16" };
+    long check = -1;
+    for (int how = COPY; how <= PINGROUP; how++) {
+        long s;
+        double ms = run(fd, order, how, &s);
+        printf("  %-14s %10.1f %14.0f%s\n", names[how], ms, LOOKUPS / (ms / 1000.0),
+               (check < 0 || check == s) ? "" : " (different sum!)");
+        check = s;
+    }
+    HF_CloseFile(fd);
+    PF_DestroyFile(PIN_FILE);
+    free(rids);
+    free(order);
+    return 0;
+}
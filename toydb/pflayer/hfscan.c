@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include "bench.h"
+
+/*
+ * Scan benchmark: run full sequential scans over a heap file built
+ * by hfload and report scan throughput. The file is reopened for
+ * each pass so every page is read through PFreadfcn again (the OS
+ * page cache stays warm, so this measures the CPU cost of a scan,
+ * including decompression for compressed files). With a compressed
+ * page cache budget (zcacheBytes), the file instead stays open for
+ * all passes, since the cache forgets a file's pages when it closes.
+ */
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr,
+            "Usage: %s <heap_file> [passes] [bufPages] [zcacheBytes]\n"
+            "Example: %s studregn.hf 5 20 1048576\n",
+            argv[0], argv[0]);
+        return 1;
+    }
+
+    const char *heapFile = argv[1];
+    int passes = (argc > 2) ? atoi(argv[2]) : 5;
+    if (passes < 1)
+        passes = 1;
+
+    PF_Init();
+    PF_SetBufferSize((argc > 3) ? atoi(argv[3]) : 20);
+    PF_SetReplacementPolicy(PF_REPL_LRU);
+    long zcacheBytes = (argc > 4) ? atol(argv[4]) : 0;
+    PF_SetZCacheSize(zcacheBytes);
+
+    struct stat st;
+    if (stat(heapFile, &st) != 0) {
+        perror("stat");
+        return 1;
+    }
+
+    struct timeval t1, t2;
+    long count = 0;
+    long bytes = 0;
+    int pages = 0;
+    int pageSize = 0;
+    int fd = -1;
+
+    PF_ResetStats();
+    gettimeofday(&t1, NULL);
+    for (int p = 0; p < passes; p++) {
+        if (fd < 0 && (fd = HF_OpenFile((char*)heapFile)) < 0) {
+            PF_PrintError("HF_OpenFile");
+            return 1;
+        }
+        pages = PF_NumUsedPages(fd);
+        pageSize = PF_GetPageSize(fd);
+
+        HF_Scan scan;
+        RID rid;
+        char *rec;
+        int len;
+        if (HF_OpenFileScan(fd, &scan) != HFE_OK) {
+            PF_PrintError("HF_OpenFileScan");
+            return 1;
+        }
+        count = bytes = 0;
+        while (HF_GetNextRec(fd, &scan, &rid, &rec, &len) == HFE_OK) {
+            count++;
+            bytes += len;
+        }
+        HF_CloseFileScan(&scan);
+        if (zcacheBytes > 0 && p < passes - 1)
+            continue;
+        if (HF_CloseFile(fd) != HFE_OK) {
+            PF_PrintError("HF_CloseFile");
+            return 1;
+        }
+        fd = -1;
+    }
+    gettimeofday(&t2, NULL);
+
+    double ms = elapsed_ms(t1, t2) / passes;
+    printf("Scanned %s: %ld records (%ld bytes), %d pages of %d bytes\n",
+           heapFile, count, bytes, pages, pageSize);
+    printf("File size: %lld bytes (%.1f%% of pages x page size)\n",
+           (long long)st.st_size,
+           pages ? 100.0 * st.st_size / ((double)pages * pageSize) : 0.0);
+    printf("Scan time: %.2f ms/pass over %d passes, %.0f records/s, %.2f MB/s\n",
+           ms, passes, count / (ms / 1000.0), bytes / (ms / 1000.0) / 1e6);
+    PF_PrintStats();
+    return 0;
+}
@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "bench.h"
+
+#define SLOTS_FILE "slots.hf"
+#define FREE_PASSES 200
+
+/*
+ * Fills the pages of a new heap file with the rows, in order, each
+ * page set up by HF_InitPage1 (format 1) or HF_InitPage (format 2),
+ * the way a file written before format 2 looks.
+ */
+static int load(int fd, int format, char **rows, int *lens, int n) {
+    int pagenum = -1;
+    char *pageBuf = NULL;
+
+    for (int i = 0; i < n; i++) {
+        if (pageBuf != NULL && HF_Page_InsertRec(pageBuf, rows[i], lens[i]) >= 0)
+            continue;
+        if ((pageBuf != NULL && PF_UnfixPage(fd, pagenum, TRUE) != PFE_OK) ||
+                PF_AllocPage(fd, &pagenum, &pageBuf) != PFE_OK)
+            return -1;
+        if (format == 1)
+            HF_InitPage1(pageBuf, PF_PAGE_SIZE);
+        else
+            HF_InitPage(pageBuf, PF_PAGE_SIZE);
+        HF_Page_InsertRec(pageBuf, rows[i], lens[i]);
+    }
+    return (pageBuf != NULL) ? PF_UnfixPage(fd, pagenum, TRUE) : PFE_OK;
+}
+
+/*
+ * Works out the free bytes of every page FREE_PASSES times, as each
+ * insert, delete and update does for its page. Returns ns per page.
+ */
+static double freeBytes(int fd, long *check) {
+    int pages = PF_NumUsedPages(fd);
+    char *bufs[pages];
+    int nums[pages];
+    int pagenum = -1, k = 0;
+    struct timeval t1, t2;
+
+    // Page 0 is the FSM page
+    while (k < pages && PF_GetNextPage(fd, &pagenum, &bufs[k]) == PFE_OK)
+        nums[k++] = pagenum;
+    gettimeofday(&t1, NULL);
+    for (int p = 0; p < FREE_PASSES; p++)
+        for (int i = 1; i < k; i++)
+            *check += HF_Page_FreeBytes(bufs[i], PF_PAGE_SIZE);
+    gettimeofday(&t2, NULL);
+    for (int i = 0; i < k; i++)
+        PF_UnfixPage(fd, nums[i], FALSE);
+    return elapsed_ms(t1, t2) * 1e6 / FREE_PASSES / (k > 1 ? k - 1 : 1);
+}
+
+/*
+ * Slotted page format benchmark: loads each table given (by default
+ * studregn and gradsum) into a file of 4K slotted pages of the first
+ * format and into one of format 2, as its text rows, and reports the
+ * pages each takes, the speed of a batch scan, and the cost of
+ * working out a page's free bytes.
+ */
+int main(int argc, char *argv[]) {
+    const char *defaults[] = { "../../data/studregn.txt", "../../data/gradsum.txt" };
+    const char **files = (argc > 1) ? (const char **)argv + 1 : defaults;
+    int nfiles = (argc > 1) ? argc - 1 : 2;
+
+    PF_Init();
+    PF_SetBufferSize(2000);
+
+    for (int f = 0; f < nfiles; f++) {
+        int n, *lens;
+        char **rows = read_rows(files[f], &n, &lens);
+        long bytes = 0;
+        for (int i = 0; i < n; i++)
+            bytes += lens[i];
+
+        printf("%s: %d rows, %.1f bytes a row\n", files[f], n, (double)bytes / n);
+        printf("  %-8s %8s %10s %14s %14s\n", "format", "pages", "rows/page",
+               "scan rows/s", "free ns/page");
+        for (int format = 1; format <= 2; format++) {
+            int fd, count;
+            long s1 = 0, s2 = 0;
+            PF_DestroyFile(SLOTS_FILE);
+            if (HF_CreateFile(SLOTS_FILE) != HFE_OK || (fd = HF_OpenFile(SLOTS_FILE)) < 0 ||
+                    load(fd, format, rows, lens, n) != PFE_OK) {
+                PF_PrintError("load " SLOTS_FILE);
+                return 1;
+            }
+            int pages = PF_NumUsedPages(fd) - 1;    // not the FSM page
+            double ms = scan_file(fd, NULL, 0, TRUE, &count, &s1);
+            double ns = freeBytes(fd, &s2);
+            printf("  %-8d %8d %10.1f %14.0f %14.1f\n", format, pages,
+                   (double)n / pages, n / (ms / 1000.0), ns);
+            HF_CloseFile(fd);
+            PF_DestroyFile(SLOTS_FILE);
+        }
+        free_rows(rows, lens, n);
+    }
+    return 0;
+}
@@ -1,7 +1,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
-#include "hf.h"
+#include "schema.h"
 
 #define MAX_LINE 4096
 
@@ -11,12 +11,20 @@ int main() {
     PF_SetReplacementPolicy(PF_REPL_LRU);
 
     const char *dataFile = "../../data/student.txt";
+    const char *catalog = "../../data/schema.cat";
     const char *heapFile = "student.hf";
 
+    // The rows are stored as tuples of the student schema (see hfcatalog)
+    HF_Schema schema;
+    if (HF_LoadSchema(catalog, "student", &schema) != HFE_OK) {
+        fprintf(stderr, "no table student in %s\n", catalog);
+        return 1;
+    }
+
     // (Re)create HF file
     PF_DestroyFile((char*)heapFile);  // ignore error if not exists
-    if (HF_CreateFile((char*)heapFile) != HFE_OK) {
-        PF_PrintError("HF_CreateFile");
+    if (HF_CreateFileSchema((char*)heapFile, PF_PAGE_SIZE, 0, &schema) != HFE_OK) {
+        PF_PrintError("HF_CreateFileSchema");
         return 1;
     }
 
@@ -33,15 +41,24 @@ int main() {
     }
 
     char line[MAX_LINE];
-    int count = 0;
+    char tuple[schema.maxLen];
+    int count = 0, skipped = 0;
     while (fgets(line, sizeof(line), fp)) {
         // strip trailing newline
         size_t len = strlen(line);
         if (len > 0 && (line[len-1] == '\n' || line[len-1] == '\r'))
             line[--len] = '\0';
 
+        // the title line, and any other that is not a row, is skipped
+        int tupleLen;
+        if (strchr(line, ';') == NULL ||
+                (tupleLen = HF_EncodeTuple(&schema, line, (int)len, tuple)) < 0) {
+            skipped++;
+            continue;
+        }
+
         RID rid;
-        int err = HF_InsertRec(fd, line, (int)len, &rid);
+        int err = HF_InsertRec(fd, tuple, tupleLen, &rid);
         if (err != HFE_OK) {
             printf("HF_InsertRec error %d at record %d\n", err, count);
             return 1;
@@ -50,7 +67,8 @@ int main() {
     }
     fclose(fp);
 
-    printf("Inserted %d student records into heap file %s\n", count, heapFile);
+    printf("Inserted %d student records into heap file %s (%d lines skipped)\n",
+           count, heapFile, skipped);
 
     // sanity check: sequential scan
     HF_Scan scan;
@@ -60,6 +78,7 @@ int main() {
     RID rid;
     char *rec;
     int recLen;
+    char text[schema.maxText + 1];
 
     while (1) {
         int err = HF_GetNextRec(fd, &scan, &rid, &rec, &recLen);
@@ -71,8 +90,8 @@ int main() {
 
         // print first 3 records only for sanity
         if (scanned < 3) {
-            printf("RID(page=%d, slot=%d): %.*s\n",
-                   rid.pageNum, rid.slotNum, recLen, rec);
+            HF_DecodeTuple(&schema, rec, text);
+            printf("RID(page=%d, slot=%d): %s\n", rid.pageNum, rid.slotNum, text);
         }
         scanned++;
     }
@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "schema.h"
+#include "bench.h"
+
+#define TUPLE_FILE "tuple.hf"
+
+/*
+ * Loads the rows into a new file, as text or as tuples, then scans it
+ * BENCH_PASSES times (after one pass to bring it into the buffer pool)
+ * adding up the bytes of column "col": found by splitting a copy of
+ * each text row with strtok, as the AM layer's loaders do, or read
+ * from its slot with HF_DecodeTuple's field access. Prints the pages
+ * and the scan rate; *check gets the sum.
+ */
+static void run(const char *what, HF_Schema *schema, char **rows, int n,
+                int tuples, int col, long *check) {
+    char **recs = malloc(n * sizeof(char*));
+    int *lens = malloc(n * sizeof(int));
+    struct timeval t1, t2;
+    int fd, error, stored = 0;
+
+    PF_DestroyFile(TUPLE_FILE);
+    error = tuples ? HF_CreateFileSchema(TUPLE_FILE, PF_MAX_PAGE_SIZE, 0, schema)
+                   : HF_CreateFileOpt(TUPLE_FILE, PF_MAX_PAGE_SIZE, 0);
+    if (error != HFE_OK || (fd = HF_OpenFile(TUPLE_FILE)) < 0) {
+        PF_PrintError("create " TUPLE_FILE);
+        exit(1);
+    }
+    for (int i = 0; i < n; i++) {
+        int len = strlen(rows[i]);
+        if (!tuples) {
+            recs[stored] = rows[i];
+            lens[stored++] = len;
+            continue;
+        }
+        recs[stored] = malloc(schema->maxLen);
+        if ((lens[stored] = HF_EncodeTuple(schema, rows[i], len, recs[stored])) < 0)
+            free(recs[stored]);     // does not fit the schema
+        else
+            stored++;
+    }
+    if (HF_InsertBatch(fd, recs, lens, stored, NULL) != HFE_OK) {
+        PF_PrintError("HF_InsertBatch");
+        exit(1);
+    }
+
+    long s = 0;
+    for (int p = 0; p <= BENCH_PASSES; p++) {
+        HF_Scan scan;
+        RID rid;
+        char *rec, buf[BENCH_MAX_LINE];
+        int len;
+        if (p == 1)
+            gettimeofday(&t1, NULL);
+        s = 0;
+        HF_OpenFileScan(fd, &scan);
+        while (HF_GetNextRec(fd, &scan, &rid, &rec, &len) == HFE_OK) {
+            if (tuples) {
+                if (!HF_TupleIsNull(schema, rec, col)) {
+                    const char *value = HF_TupleChar(schema, rec, col, &len);
+                    s += sum_bytes(value, len);
+                }
+            } else {
+                memcpy(buf, rec, len);
+                buf[len] = '\0';
+                char *tok = strtok(buf, ";");
+                for (int c = 0; c < col && tok != NULL; c++)
+                    tok = strtok(NULL, ";");
+                if (tok != NULL)
+                    s += sum_bytes(tok, strlen(tok));
+            }
+        }
+        HF_CloseFileScan(&scan);
+    }
+    gettimeofday(&t2, NULL);
+    double ms = elapsed_ms(t1, t2) / BENCH_PASSES;
+    printf("  %-8s %8d %8d %10.2f %12.0f %s\n", what, stored, PF_NumUsedPages(fd),
+           ms, stored / (ms / 1000.0),
+           (*check < 0 || *check == s) ? "" : "(different sum)");
+    *check = s;
+    HF_CloseFile(fd);
+    PF_DestroyFile(TUPLE_FILE);
+    if (tuples)
+        for (int i = 0; i < stored; i++)
+            free(recs[i]);
+    free(recs);
+    free(lens);
+}
+
+/*
+ * Tuple benchmark: loads a table (by default student, from the
+ * catalog hfcatalog makes) as text rows and as tuples, and scans one
+ * char or varchar column (by default c2, the roll number) of each.
+ *
+ *     hftuple [catalog table column]
+ */
+int main(int argc, char *argv[]) {
+    const char *catalog = (argc > 3) ? argv[1] : "../../data/schema.cat";
+    const char *table = (argc > 3) ? argv[2] : "student";
+    const char *column = (argc > 3) ? argv[3] : "c2";
+    char path[1024];
+    HF_Schema schema;
+    int col;
+
+    if (HF_LoadSchema(catalog, table, &schema) != HFE_OK ||
+            (col = HF_ColumnNum(&schema, column)) < 0 ||
+            schema.cols[col].type < HF_TYPE_CHAR) {
+        fprintf(stderr, "no char column %s.%s in %s\n", table, column, catalog);
+        fprintf(stderr, "Usage: %s [catalog table column]\n", argv[0]);
+        return 1;
+    }
+
+    // The rows, as hfcatalog sees them
+    snprintf(path, sizeof(path), "%s/%s.txt", "../../data", table);
+    int n;
+    char **rows = read_rows(path, &n, NULL);
+
+    PF_Init();
+    PF_SetBufferSize(100);
+
+    long check = -1;
+    printf("%s: %d rows, scanning %s (64K pages)\n", table, n, column);
+    printf("  %-8s %8s %8s %10s %12s\n", "format", "rows", "pages", "scan ms", "rows/s");
+    run("text", &schema, rows, n, FALSE, col, &check);
+    run("tuple", &schema, rows, n, TRUE, col, &check);
+    free_rows(rows, NULL, n);
+    return 0;
+}
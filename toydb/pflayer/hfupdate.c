@@ -0,0 +1,143 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "bench.h"
+
+#define UPDATE_FILE "update.hf"
+#define SEED 12345
+#define STATUS_FIELD 7      /* 0-based: the empty field after the roll number */
+
+/*
+ * Writes into out the feecoll row "rec" with its status field set
+ * to "status", and returns the new length.
+ */
+static int set_status(const char *rec, int len, const char *status, char *out) {
+    int f = 0, i = 0, n = 0;
+
+    // copy up to the status field
+    while (i < len && f < STATUS_FIELD) {
+        if (rec[i] == ';')
+            f++;
+        out[n++] = rec[i++];
+    }
+    // replace the old status
+    while (i < len && rec[i] != ';')
+        i++;
+    n += sprintf(out + n, "%s", status);
+    memcpy(out + n, rec + i, len - i);
+    return n + (len - i);
+}
+
+/*
+ * Runs the workload on a freshly loaded file: each pass sets the fee
+ * status of every row, in random order, with HF_UpdateRec (inPlace)
+ * or with HF_DeleteRec + HF_InsertRec. Then reads every row back by
+ * its RID.
+ */
+static void run(const char *name, char **recs, int n, int inPlace,
+                const char **statuses, int npasses) {
+    RID *rids = malloc(n * sizeof(RID));
+    int *order = malloc(n * sizeof(int));
+    char buf[BENCH_MAX_LINE + 64];
+    int fd;
+
+    PF_DestroyFile(UPDATE_FILE);
+    if (HF_CreateFile(UPDATE_FILE) != HFE_OK ||
+            (fd = HF_OpenFile(UPDATE_FILE)) < 0) {
+        PF_PrintError("create " UPDATE_FILE);
+        exit(1);
+    }
+    for (int i = 0; i < n; i++) {
+        if (HF_InsertRec(fd, recs[i], strlen(recs[i]), &rids[i]) != HFE_OK) {
+            PF_PrintError("HF_InsertRec");
+            exit(1);
+        }
+    }
+    srand(SEED);
+    for (int i = 0; i < n; i++)
+        order[i] = i;
+
+    for (int p = 0; p < npasses; p++) {
+        for (int i = n - 1; i > 0; i--) {
+            int j = rand() % (i + 1);
+            int t = order[i]; order[i] = order[j]; order[j] = t;
+        }
+        long ridChanges = 0;
+        struct timeval t1, t2;
+        PF_ResetStats();
+        gettimeofday(&t1, NULL);
+        for (int i = 0; i < n; i++) {
+            int k = order[i];
+            char *old;
+            int oldLen;
+            if (HF_GetRec(fd, rids[k], &old, &oldLen) != HFE_OK) {
+                printf("HF_GetRec failed for row %d\n", k);
+                exit(1);
+            }
+            int len = set_status(old, oldLen, statuses[p], buf);
+            if (inPlace) {
+                if (HF_UpdateRec(fd, rids[k], buf, len) != HFE_OK) {
+                    PF_PrintError("HF_UpdateRec");
+                    exit(1);
+                }
+            } else {
+                RID rid;
+                if (HF_DeleteRec(fd, rids[k]) != HFE_OK ||
+                        HF_InsertRec(fd, buf, len, &rid) != HFE_OK) {
+                    PF_PrintError("HF_DeleteRec/HF_InsertRec");
+                    exit(1);
+                }
+                if (rid.pageNum != rids[k].pageNum || rid.slotNum != rids[k].slotNum)
+                    ridChanges++;
+                rids[k] = rid;
+            }
+        }
+        gettimeofday(&t2, NULL);
+        double ms = elapsed_ms(t1, t2);
+        int fetches = PF_stats.logicalReads;
+
+        // read every row back by RID: moved rows take a second fetch
+        PF_ResetStats();
+        for (int i = 0; i < n; i++) {
+            char *rec;
+            int len;
+            if (HF_GetRec(fd, rids[i], &rec, &len) != HFE_OK) {
+                printf("HF_GetRec failed for row %d\n", i);
+                exit(1);
+            }
+        }
+        printf("%-14s %-20s %10.0f %10.2f %10ld %8d %10.3f\n", name, statuses[p],
+               n / (ms / 1000.0), (double)fetches / n, ridChanges,
+               PF_NumUsedPages(fd), (double)PF_stats.logicalReads / n);
+    }
+    HF_CloseFile(fd);
+    PF_DestroyFile(UPDATE_FILE);
+    free(rids);
+    free(order);
+}
+
+/*
+ * Update benchmark on feecoll: sets the (empty) status field of every
+ * fee collection row, first to a short status and then to a longer
+ * one, comparing HF_UpdateRec with a delete and reinsert. Reports
+ * updates/s, page fetches per update, how many RIDs changed (each an
+ * index update), the file's pages, and page fetches per lookup by RID
+ * afterwards.
+ */
+int main(int argc, char *argv[]) {
+    const char *dataFile = (argc > 1) ? argv[1] : "../../data/feecoll.txt";
+    const char *statuses[] = { "PAID", "PAID 2002-01-15 BANK", "OK" };
+    int n;
+    char **recs = read_rows(dataFile, &n, NULL);
+
+    PF_Init();
+    PF_SetBufferSize(20);
+
+    printf("%s: %d rows\n", dataFile, n);
+    printf("%-14s %-20s %10s %10s %10s %8s %10s\n", "method", "status",
+           "updates/s", "fetch/upd", "RIDs moved", "pages", "fetch/get");
+    run("HF_UpdateRec", recs, n, TRUE, statuses, 3);
+    run("delete+insert", recs, n, FALSE, statuses, 3);
+    free_rows(recs, NULL, n);
+    return 0;
+}
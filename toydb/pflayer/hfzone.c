@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "bench.h"
+
+#define ZONE_FILE "zone.hf"
+
+/*
+ * Zone map benchmark: loads each table given as file:field:lo:hi (by
+ * default gradsum and studregn on their year) into a file of 4K
+ * slotted pages, as its text rows, and scans it for the rows whose
+ * field is a number from lo to hi, without a zone map and with one
+ * on the field. Reports the pages the zone map leaves to be read and
+ * the speed of both scans.
+ */
+int main(int argc, char *argv[]) {
+    const char *defaults[] = { "../../data/gradsum.txt:1:1995:1997",
+                               "../../data/studregn.txt:0:1996:1997" };
+    const char **tables = (argc > 1) ? (const char **)argv + 1 : defaults;
+    int ntables = (argc > 1) ? argc - 1 : 2;
+
+    PF_Init();
+    PF_SetBufferSize(2000);
+
+    for (int t = 0; t < ntables; t++) {
+        char file[BENCH_MAX_LINE], lo[32], hi[32];
+        int field = 0;
+        if (sscanf(tables[t], "%[^:]:%d:%31[^:]:%31s", file, &field, lo, hi) != 4) {
+            fprintf(stderr, "%s: not file:field:lo:hi\n", tables[t]);
+            return 1;
+        }
+        int n, *lens;
+        char **rows = read_rows(file, &n, &lens);
+
+        int fd;
+        PF_DestroyFile(ZONE_FILE);
+        if (HF_CreateFile(ZONE_FILE) != HFE_OK || (fd = HF_OpenFile(ZONE_FILE)) < 0 ||
+                HF_InsertBatch(fd, rows, lens, n, NULL) != HFE_OK) {
+            PF_PrintError("load " ZONE_FILE);
+            return 1;
+        }
+        HF_Pred preds[] = {
+            { field, HF_OP_GE | HF_OP_NUM, lo },
+            { field, HF_OP_LE | HF_OP_NUM, hi },
+        };
+        int pages = PF_NumUsedPages(fd) - 1;    // not the FSM page
+        int plain, zoned;
+        double plainMs = scan_file(fd, preds, 2, TRUE, &plain, NULL);
+
+        if (HF_CreateZoneMap(fd, 1, &field) != HFE_OK) {
+            PF_PrintError("zone map");
+            return 1;
+        }
+        int numPages = PF_NumPages(fd), read = 0;
+        for (int p = 0; p < numPages; p++) {
+            double min, max;
+            if (HF_GetZone(fd, p, field, &min, &max) == HFE_OK && min <= max &&
+                    max >= atof(lo) && min <= atof(hi))
+                read++;
+        }
+        double zonedMs = scan_file(fd, preds, 2, TRUE, &zoned, NULL);
+
+        printf("%s: %d rows on %d pages; field %d from %s to %s: %d rows\n",
+               file, n, pages, field, lo, hi, plain);
+        printf("  %-10s %8s %12s %14s %8s\n", "scan", "pages", "ms/scan", "rows/s", "speedup");
+        printf("  %-10s %8d %12.3f %14.0f %8s\n", "no map", pages, plainMs,
+               n / (plainMs / 1000.0), "");
+        printf("  %-10s %8d %12.3f %14.0f %7.1fx%s\n", "zone map", read, zonedMs,
+               n / (zonedMs / 1000.0), plainMs / zonedMs,
+               zoned == plain ? "" : " (rows missing!)");
+        HF_CloseFile(fd);
+        PF_DestroyFile(ZONE_FILE);
+        free_rows(rows, lens, n);
+    }
+    return 0;
+}
@@ -0,0 +1,181 @@
+/* lz.c: a small LZ77 page codec used for compressed paged files.
+The interface routines are PFlzCompress() and PFlzDecompress().
+
+The encoded stream is a sequence of items, each starting with a
+control byte "c":
+	c < 32		a run of c+1 literal bytes follows.
+	c >= 32		a back reference: length L = (c >> 5) + 2, with
+			one more length byte added to L if (c >> 5) == 7,
+			then one byte that together with the low 5 bits
+			of c gives the distance D-1 (13 bits). L bytes
+			are copied from D bytes back in the output.
+*/
+#include <string.h>
+#include "pf.h"
+#include "pftypes.h"
+
+#define PFLZ_HASH_BITS	12
+#define PFLZ_HASH_SIZE	(1 << PFLZ_HASH_BITS)
+#define PFLZ_MAX_LIT	32		/* longest literal run */
+#define PFLZ_MAX_OFF	(1 << 13)	/* farthest back reference */
+#define PFLZ_MAX_REF	(264)		/* longest back reference */
+
+/* hash of the 3 bytes at p */
+#define PFlzHash(p) \
+	((((p)[0] << 16 | (p)[1] << 8 | (p)[2]) * 2654435761U) \
+		>> (32 - PFLZ_HASH_BITS))
+
+
+int PFlzCompress(src,srclen,dst,dstlen)
+unsigned char *src;	/* data to compress */
+int srclen;		/* # of bytes in src */
+unsigned char *dst;	/* buffer for the compressed data */
+int dstlen;		/* # of bytes available in dst */
+/****************************************************************************
+SPECIFICATIONS:
+	Compress "srclen" bytes at "src" into "dst". Matches are found
+	with a single-entry hash table of 3-byte prefixes, so the
+	cost is one pass over the input.
+
+RETURN VALUE:
+	The # of bytes of compressed data, or
+	0	if the data does not fit into "dstlen" bytes, in which
+		case the caller should store it uncompressed.
+*****************************************************************************/
+{
+unsigned char *htab[PFLZ_HASH_SIZE];	/* last position of each prefix */
+unsigned char *ip = src;		/* input position */
+unsigned char *iend = src + srclen;
+unsigned char *op = dst;		/* output position */
+unsigned char *oend = dst + dstlen;
+unsigned char *lit;			/* control byte of the literal run */
+unsigned char *ref;			/* candidate match */
+int len, maxlen, off;
+
+	memset((char *)htab,0,sizeof(htab));
+
+	/* start a literal run */
+	lit = op++;
+	*lit = (unsigned char)-1;
+
+	while (ip < iend){
+		if (ip + 2 < iend){
+			unsigned int h = PFlzHash(ip);
+			ref = htab[h];
+			htab[h] = ip;
+			if (ref != NULL && (off=(int)(ip - ref) - 1) < PFLZ_MAX_OFF
+					&& ref[0] == ip[0] && ref[1] == ip[1]
+					&& ref[2] == ip[2]){
+				/* found a match: see how long it is */
+				maxlen = (int)(iend - ip);
+				if (maxlen > PFLZ_MAX_REF)
+					maxlen = PFLZ_MAX_REF;
+				for (len = 3; len < maxlen && ref[len] == ip[len];
+						len++)
+					;
+
+				if (op + 3 + 1 > oend)
+					return(0);
+
+				/* close an empty literal run */
+				if (*lit == (unsigned char)-1)
+					op--;
+
+				len -= 2;
+				if (len < 7)
+					*op++ = (unsigned char)((len << 5) + (off >> 8));
+				else {
+					*op++ = (unsigned char)((7 << 5) + (off >> 8));
+					*op++ = (unsigned char)(len - 7);
+				}
+				*op++ = (unsigned char)off;
+				ip += len + 2;
+
+				/* start a new literal run */
+				lit = op++;
+				*lit = (unsigned char)-1;
+				continue;
+			}
+		}
+
+		/* emit a literal byte */
+		if (op + 1 > oend)
+			return(0);
+		*op++ = *ip++;
+		if (++*lit == PFLZ_MAX_LIT - 1){
+			/* run is full */
+			if (op + 1 > oend)
+				return(0);
+			lit = op++;
+			*lit = (unsigned char)-1;
+		}
+	}
+
+	/* drop an empty trailing literal run */
+	if (*lit == (unsigned char)-1)
+		op--;
+
+	return((int)(op - dst));
+}
+
+
+int PFlzDecompress(src,srclen,dst,dstlen)
+unsigned char *src;	/* compressed data */
+int srclen;		/* # of bytes in src */
+unsigned char *dst;	/* buffer for the decompressed data */
+int dstlen;		/* # of bytes available in dst */
+/****************************************************************************
+SPECIFICATIONS:
+	Decompress "srclen" bytes produced by PFlzCompress() into "dst".
+
+RETURN VALUE:
+	The # of bytes of decompressed data, or
+	-1	if the compressed data is corrupt or does not fit
+		into "dstlen" bytes.
+*****************************************************************************/
+{
+unsigned char *ip = src;
+unsigned char *iend = src + srclen;
+unsigned char *op = dst;
+unsigned char *oend = dst + dstlen;
+unsigned char *ref;
+int c, len;
+
+	while (ip < iend){
+		c = *ip++;
+		if (c < 32){
+			/* literal run */
+			len = c + 1;
+			if (ip + len > iend || op + len > oend)
+				return(-1);
+			memcpy(op,ip,len);
+			ip += len;
+			op += len;
+		}
+		else {
+			/* back reference */
+			len = c >> 5;
+			if (len == 7){
+				if (ip >= iend)
+					return(-1);
+				len += *ip++;
+			}
+			len += 2;
+			if (ip >= iend)
+				return(-1);
+			ref = op - ((c & 0x1f) << 8) - *ip++ - 1;
+			if (ref < dst || op + len > oend)
+				return(-1);
+			if (ref + len <= op){
+				memcpy(op,ref,len);
+				op += len;
+			}
+			else {
+				/* overlaps, so copy forwards byte by byte */
+				while (len-- > 0)
+					*op++ = *ref++;
+			}
+		}
+	}
+	return((int)(op - dst));
+}
@@ -1,4 +1,5 @@
 /* pf.c: Paged File Interface Routines+ support routines */
+#define _GNU_SOURCE	/* for fallocate() and pwritev() */
 #include <stdio.h>
 #include <sys/types.h>
 #include <fcntl.h>
@@ -9,10 +10,15 @@
 #include <string.h>     /* strlen, strcpy, strcmp */
 #include <unistd.h>     /* lseek, read, write, close, unlink */
 #include <sys/stat.h>
+#include <sys/uio.h>
+#include <errno.h>
+#include <pthread.h>
+#include <limits.h>
 int PF_GetNextPage();      /* old-style prototype, no arg types */
 /* remove the PFbufUsed prototype here */
 
 int PF_MAX_BUFS = 20;   /* default; can be changed at runtime */
+int PF_extentPages = PF_DEFAULT_EXTENT; /* pages preallocated per file growth */
 
 /* To keep system V and PC users happy */
 #ifndef L_SET
@@ -20,14 +26,45 @@ int PF_MAX_BUFS = 20;   /* default; can be changed at runtime */
 #endif
 
 int PFerrno = PFE_OK;	/* last error message */
-PF_Stats PF_stats = {0, 0, 0, 0}; /* initialize stats */
+PF_Stats PF_stats = {0}; /* initialize stats */
 /* default replacement policy = LRU */
 int PF_replacementPolicy = PF_REPL_LRU;
-static PFftab_ele PFftab[PF_FTAB_SIZE]; /* table of opened files */
+int PF_cflruWindow = 0;	/* 0: half the buffer pool */
+int PF_swizzle = TRUE;	/* keep swizzled references to child pages */
+static PFftab_ele *PFftab = NULL; /* table of opened files */
+static int PFftabsize = 0;	/* # of entries in PFftab[] */
+static int *PFfhash = NULL;	/* PFftab[] hash chains by device/inode,
+				PFftabsize of them */
+static int *PFdtab = NULL;	/* PFftab[] index of each descriptor,
+				or -1 if the descriptor is not used */
+static int PFdtabsize = 0;	/* # of entries in PFdtab[] */
+
+/* PF_Lock() lock, and the condition flushes wait on for a group
+commit to finish */
+static pthread_mutex_t PFmutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t PFsynccond = PTHREAD_COND_INITIALIZER;
 
 /* true if file descriptor fd is invaild */
-#define PFinvalidFd(fd) ((fd) < 0 || (fd) >= PF_FTAB_SIZE \
-				|| PFftab[fd].fname == NULL)
+#define PFinvalidFd(fd) ((fd) < 0 || (fd) >= PFdtabsize || PFdtab[fd] < 0)
+
+/* hash chain of PFftab[] for a unix file */
+#define PFfhashOf(dev,ino) \
+	((int)(((unsigned long)(ino) ^ (unsigned long)(dev)*31) % PFftabsize))
+
+/* page size of file "fd", and the size on disk of one of its pages */
+#define PFpagesize(fd) (PFftab[fd].hdr.pagesize)
+#define PFdiskPageSize(fd) ((int)PFfpageSize(PFpagesize(fd)))
+
+/* offset of the header slot written by commit "seq" of a shadow file */
+#define PFhdrSlot(seq)	(((seq) & 1)? 0 : PF_HDR_SIZE)
+
+/* bytes of header before the pages of file "fd" */
+#define PFhdrSize(fd) ((PFftab[fd].hdr.flags & PF_FILE_OLDHDR)? \
+				PF_OLD_HDR_SIZE : PF_HDR_SIZE)
+
+/* byte offset of page "pagenum" of file "fd" in the unix file */
+#define PFpageOffset(fd,pagenum) \
+	((off_t)(pagenum)*PFdiskPageSize(fd)+PFhdrSize(fd))
 
 /* true if page number "pagenum" of file "fd" is invalid in the
 sense that it's <0 or >= # of pages in the file */
@@ -51,14 +88,13 @@ char *s;
 	return(s);
 }
 
-static int  PFtabFindFname(fname)
-char *fname;		/* file name to find */
+static int  PFftabFind(dev,ino)
+dev_t dev;		/* device of the unix file */
+ino_t ino;		/* inode of the unix file */
 /****************************************************************************
 SPECIFICATIONS:
-	Find the index to PFftab[] entry whose "fname" field is the
-	same as "fname". 
-
-AUTHOR: clc
+	Find the index to the PFftab[] entry of the unix file with
+	device "dev" and inode "ino".
 
 RETURN VALUE:
 	The desired index, or 
@@ -68,119 +104,1424 @@ RETURN VALUE:
 {
 int i;
 
-	for (i=0; i < PF_FTAB_SIZE; i++){
-		if(PFftab[i].fname != NULL&& strcmp(PFftab[i].fname,fname) == 0)
+	if (PFftabsize == 0)
+		return(-1);
+	for (i=PFfhash[PFfhashOf(dev,ino)]; i != -1; i=PFftab[i].hashnext){
+		if (PFftab[i].dev == dev && PFftab[i].ino == ino)
 			/* found it */
 			return(i);
 	}
 	return(-1);
 }
 
+static void PFftabUnlink(fd)
+int fd;		/* PFftab[] index */
+/****************************************************************************
+SPECIFICATIONS:
+	Remove entry "fd" from its hash chain.
+*****************************************************************************/
+{
+int *ip;
+
+	for (ip = &PFfhash[PFfhashOf(PFftab[fd].dev,PFftab[fd].ino)];
+			*ip != fd; ip = &PFftab[*ip].hashnext)
+		;
+	*ip = PFftab[fd].hashnext;
+}
+
+static int PFmapNextUsed(fd,pagenum)
+int fd;		/* file descriptor */
+int pagenum;	/* page number to start the search from */
+/****************************************************************************
+SPECIFICATIONS:
+	Find the first used page numbered "pagenum" or higher in file
+	"fd", using the occupancy map of the file. Whole bytes of free
+	pages are skipped at a time.
+
+RETURN VALUE:
+	The page number of the used page, or
+	-1	if there is no used page at or after "pagenum".
+*****************************************************************************/
+{
+int numpages = PFftab[fd].hdr.numpages;
+
+	while (pagenum < numpages){
+		if ((pagenum & 7) == 0 && PFmapByte(PFftab[fd],pagenum) == 0){
+			/* 8 free pages in a row */
+			pagenum += 8;
+			continue;
+		}
+		if (PFmapIsUsed(PFftab[fd],pagenum))
+			return(pagenum);
+		pagenum++;
+	}
+	return(-1);
+}
+
+static int PFmapGrow(fd,npages)
+int fd;		/* file descriptor */
+int npages;	/* # of pages the map must cover */
+/****************************************************************************
+SPECIFICATIONS:
+	Make the occupancy map of file "fd" large enough for "npages"
+	pages, growing the part of it past the file header. The pages
+	added to it are free.
+
+RETURN VALUE:
+	PFE_OK	if ok
+	PFE_NOMEM if no memory.
+*****************************************************************************/
+{
+unsigned char *tail;
+int need = PFmapTailSize(npages);
+int size;
+
+	if (need <= PFftab[fd].maptailsize)
+		return(PFE_OK);
+
+	/* double it so that growing a page at a time stays cheap */
+	for (size = (PFftab[fd].maptailsize > 0)? PFftab[fd].maptailsize :
+			PF_MAP_SIZE; size < need; size *= 2)
+		;
+	if ((tail=(unsigned char *)realloc((char *)PFftab[fd].maptail,size))
+			== NULL){
+		PFerrno = PFE_NOMEM;
+		return(PFerrno);
+	}
+	memset((char *)(tail+PFftab[fd].maptailsize),0,
+		size-PFftab[fd].maptailsize);
+	PFftab[fd].maptail = tail;
+	PFftab[fd].maptailsize = size;
+	return(PFE_OK);
+}
+
+static int PFmapRead(fd)
+int fd;		/* file descriptor */
+/****************************************************************************
+SPECIFICATIONS:
+	Read the occupancy map of file "fd" past the file header, if
+	the file has more than PF_MAP_PAGES pages, into memory. That of
+	a file of the format without a magic number is built when its
+	header is read.
+
+RETURN VALUE:
+	PFE_OK	if ok
+	PF error code if not ok.
+*****************************************************************************/
+{
+int len = PFmapTailSize(PFftab[fd].hdr.numpages);
+int count;	/* # of bytes read */
+
+	if (len == 0 || (PFftab[fd].hdr.flags & PF_FILE_OLDHDR))
+		return(PFE_OK);
+	if (PFmapGrow(fd,PFftab[fd].hdr.numpages) != PFE_OK)
+		return(PFerrno);
+	if ((count=pread(PFftab[fd].unixfd,(char *)PFftab[fd].maptail,len,
+			(off_t)PFftab[fd].hdr.mapoff)) != len){
+		if (count < 0)
+			PFerrno = PFE_UNIX;
+		else	PFerrno = PFE_HDRREAD;
+		return(PFerrno);
+	}
+	return(PFE_OK);
+}
+
+static int PFmapWrite(fd,off)
+int fd;		/* file descriptor */
+long long off;	/* where it goes */
+/****************************************************************************
+SPECIFICATIONS:
+	Write the occupancy map of file "fd" past the file header, if
+	the file has more than PF_MAP_PAGES pages, to offset "off", and
+	point the file header at it. The caller writes out the header.
+
+RETURN VALUE:
+	PFE_OK	if ok
+	PF error code if not ok.
+*****************************************************************************/
+{
+int len = PFmapTailSize(PFftab[fd].hdr.numpages);
+int count;	/* # of bytes written */
+
+	PFftab[fd].hdr.mapoff = (len > 0)? off : 0;
+	if (len == 0)
+		return(PFE_OK);
+	if ((count=pwrite(PFftab[fd].unixfd,(char *)PFftab[fd].maptail,len,
+			(off_t)off)) != len){
+		if (count < 0)
+			PFerrno = PFE_UNIX;
+		else	PFerrno = PFE_HDRWRITE;
+		return(PFerrno);
+	}
+	return(PFE_OK);
+}
+
+static void PFmapFree(fd)
+int fd;		/* file descriptor */
+/****************************************************************************
+SPECIFICATIONS:
+	Free the occupancy map of file "fd" past the file header.
+*****************************************************************************/
+{
+	free((char *)PFftab[fd].maptail);
+	PFftab[fd].maptail = NULL;
+	PFftab[fd].maptailsize = 0;
+}
+
+static int PFextendFile(fd)
+int fd;		/* file descriptor */
+/****************************************************************************
+SPECIFICATIONS:
+	Reserve disk space for the next extent of PF_extentPages pages
+	past the allocated end of file "fd", so that pages written back
+	in any order land in one contiguous run on disk. With an extent
+	of 1 page no space is reserved, and the file grows as its pages
+	are written, the way it always did.
+
+RETURN VALUE:
+	PFE_OK	if ok
+	PFE_UNIX if the space cannot be allocated.
+*****************************************************************************/
+{
+int npages;	/* # of pages in this extent */
+
+	npages = PF_extentPages;
+	if (PFftab[fd].hdr.flags & PF_FILE_OLDHDR)
+		/* such a file must end with its last page, or it is not
+		recognised when it is opened again */
+		npages = 1;
+
+#ifdef __linux__
+	if (npages > 1 && fallocate(PFftab[fd].unixfd,0,
+			PFpageOffset(fd,PFftab[fd].hdr.allocpages),
+			(off_t)npages*PFdiskPageSize(fd)) == -1
+			&& errno != EOPNOTSUPP){
+		/* file system does support it, but it failed */
+		PFerrno = PFE_UNIX;
+		return(PFerrno);
+	}
+#endif
+
+	PFftab[fd].hdr.allocpages += npages;
+	PFftab[fd].hdrchanged = TRUE;
+	return(PFE_OK);
+}
+
 static int PFftabFindFree()
 /****************************************************************************
 SPECIFICATIONS:
 	Find a free entry in the open file table "PFtab", and return its
-	index.
+	index. The table is doubled if it is full, and the hash chains
+	are rebuilt for the new size.
 
 AUTHOR: clc
 
 RETURN VALUE:
 	If >=0, the index of the free entry.
-	Otherwise, none can be found.
+	Otherwise, none can be found (no memory).
 
 *****************************************************************************/
 {
-int i;
+PFftab_ele *ftab;
+int *fhash;
+int i, size;
 
-	for (i=0; i < PF_FTAB_SIZE; i++)
+	for (i=0; i < PFftabsize; i++)
 		if (PFftab[i].fname == NULL)
 			return(i);
-	return(-1);
+
+	size = (PFftabsize > 0)? 2*PFftabsize : PF_FTAB_SIZE;
+	if ((fhash=(int *)malloc(size*sizeof(int))) == NULL)
+		return(-1);
+	if ((ftab=(PFftab_ele *)realloc((char *)PFftab,
+			size*sizeof(PFftab_ele))) == NULL){
+		free((char *)fhash);
+		return(-1);
+	}
+	memset((char *)(ftab+PFftabsize),0,
+		(size-PFftabsize)*sizeof(PFftab_ele));
+	free((char *)PFfhash);
+	PFftab = ftab;
+	PFfhash = fhash;
+	PFftabsize = size;
+
+	/* rehash the open files */
+	for (i=0; i < size; i++)
+		PFfhash[i] = -1;
+	for (i=0; i < size; i++)
+		if (PFftab[i].fname != NULL){
+			int h = PFfhashOf(PFftab[i].dev,PFftab[i].ino);
+			PFftab[i].hashnext = PFfhash[h];
+			PFfhash[h] = i;
+		}
+
+	return(PFftabFindFree());
 }
 
-int PFreadfcn(fd,pagenum,buf)
-int fd;	/* file descriptor */
-int pagenum; /* page number */
-PFfpage *buf;
+static int PFdtabFindFree()
 /****************************************************************************
 SPECIFICATIONS:
-	Read the paged numbered "pagenum" from the file indexed by "fd"
-	into the page buffer "buf".
+	Find a free file descriptor in PFdtab[], doubling the table if
+	it is full.
 
-AUTHOR: clc
+RETURN VALUE:
+	If >=0, the free descriptor.
+	Otherwise, none can be found (no memory).
+*****************************************************************************/
+{
+int *dtab;
+int i, size;
+
+	for (i=0; i < PFdtabsize; i++)
+		if (PFdtab[i] < 0)
+			return(i);
+
+	size = (PFdtabsize > 0)? 2*PFdtabsize : PF_FTAB_SIZE;
+	if ((dtab=(int *)realloc((char *)PFdtab,size*sizeof(int))) == NULL)
+		return(-1);
+	for (i=PFdtabsize; i < size; i++)
+		dtab[i] = -1;
+	PFdtab = dtab;
+	PFdtabsize = size;
+	return(PFdtabFindFree());
+}
+
+/* scratch space for compressing and decompressing one page */
+static unsigned char PFzbuf[PFfpageSize(PF_MAX_PAGE_SIZE)];
+
+static int PFptmapGrow(fd,npages)
+int fd;		/* file descriptor */
+int npages;	/* # of pages the map must cover */
+/****************************************************************************
+SPECIFICATIONS:
+	Make the page translation map of compressed or shadow file "fd"
+	large enough for "npages" pages. New entries are set to "never
+	written".
 
 RETURN VALUE:
 	PFE_OK	if ok
-	PF error code if not OK.
+	PFE_NOMEM if no memory.
 *****************************************************************************/
 {
-int error;
+PFpgloc *map;
+unsigned char *fresh;
+int size;
 
-	/* seek to the appropriate place */
-	if ((error=lseek(PFftab[fd].unixfd,pagenum*sizeof(PFfpage)+PF_HDR_SIZE,
-				L_SET)) == -1){
-		PFerrno = PFE_UNIX;
+	if (npages <= PFftab[fd].ptmapsize)
+		return(PFE_OK);
+
+	/* double the map so that growing a page at a time stays cheap */
+	for (size = (PFftab[fd].ptmapsize > 0)? PFftab[fd].ptmapsize : 64;
+			size < npages; size *= 2)
+		;
+	if ((map=(PFpgloc *)realloc((char *)PFftab[fd].ptmap,
+			size*sizeof(PFpgloc))) == NULL){
+		PFerrno = PFE_NOMEM;
 		return(PFerrno);
 	}
+	memset((char *)(map+PFftab[fd].ptmapsize),0,
+		(size-PFftab[fd].ptmapsize)*sizeof(PFpgloc));
+	PFftab[fd].ptmap = map;
+
+	if (PFftab[fd].hdr.flags & PF_FILE_SHADOW){
+		if ((fresh=(unsigned char *)realloc((char *)PFftab[fd].fresh,
+				size)) == NULL){
+			PFerrno = PFE_NOMEM;
+			return(PFerrno);
+		}
+		memset((char *)(fresh+PFftab[fd].ptmapsize),0,
+			size-PFftab[fd].ptmapsize);
+		PFftab[fd].fresh = fresh;
+	}
+	PFftab[fd].ptmapsize = size;
+	return(PFE_OK);
+}
 
-	/* read the data */
-	if((error=read(PFftab[fd].unixfd,(char *)buf,sizeof(PFfpage)))
-			!=sizeof(PFfpage)){
-		if (error <0)
-			PFerrno = PFE_UNIX;
-		else	PFerrno = PFE_INCOMPLETEREAD;
-		return(PFerrno);
+static int PFlocAdd(locs,nlocs,size,off,cap)
+PFpgloc **locs;	/* list to add to */
+int *nlocs;	/* # of entries used in *locs */
+int *size;	/* # of entries allocated in *locs */
+long long off;	/* offset of the space */
+int cap;	/* # of bytes of space */
+/****************************************************************************
+SPECIFICATIONS:
+	Add the "cap" bytes at "off" to the list of spaces "*locs",
+	growing it if it is full.
+
+RETURN VALUE:
+	PFE_OK	if ok
+	PFE_NOMEM if no memory.
+*****************************************************************************/
+{
+PFpgloc *list;
+int n;
+
+	if (*nlocs == *size){
+		n = (*size > 0)? 2* *size : 16;
+		if ((list=(PFpgloc *)realloc((char *)*locs,n*sizeof(PFpgloc)))
+				== NULL){
+			PFerrno = PFE_NOMEM;
+			return(PFerrno);
+		}
+		*locs = list;
+		*size = n;
 	}
-     /* one physical page read from disk */
-    PF_stats.physicalReads++;
+	list = &(*locs)[(*nlocs)++];
+	list->off = off;
+	list->len = 0;
+	list->cap = cap;
 	return(PFE_OK);
 }
 
-void PF_SetBufferSize(int n)
+static int PFholeAdd(fd,off,cap)
+int fd;		/* file descriptor */
+long long off;	/* offset of the space given up */
+int cap;	/* # of bytes given up */
+/****************************************************************************
+SPECIFICATIONS:
+	Record that "cap" bytes at "off" in compressed file "fd" are
+	no longer used by any page. Space at the end of the page data
+	is given back by moving hdr.dataend instead.
+
+RETURN VALUE:
+	PFE_OK	if ok
+	PFE_NOMEM if no memory.
+*****************************************************************************/
 {
-    if (n > 0 && n <= PF_MAX_BUFS_LIMIT) {
-        PF_MAX_BUFS = n;
-    }
+	if (off + cap == PFftab[fd].hdr.dataend){
+		PFftab[fd].hdr.dataend = off;
+		return(PFE_OK);
+	}
+	return(PFlocAdd(&PFftab[fd].holes,&PFftab[fd].nholes,
+		&PFftab[fd].holesize,off,cap));
 }
 
-int PFwritefcn(fd,pagenum,buf)
+static int PFspaceFree(fd,pagenum)
 int fd;		/* file descriptor */
-int pagenum;	/* page to read */
-PFfpage *buf;	/* buffer where to read the page */
+int pagenum;	/* page being moved */
 /****************************************************************************
 SPECIFICATIONS:
-	Write the page numbered "pagenum" from the buffer indexed
-	by "buf" into the file indexed by "fd".
+	Give up the space of page "pagenum" of compressed or shadow
+	file "fd", which is about to be written somewhere else. If the
+	last commit of a shadow file points to it, it is kept until
+	the next commit.
 
-AUTHOR: clc
+RETURN VALUE:
+	PFE_OK	if ok
+	PFE_NOMEM if no memory.
+*****************************************************************************/
+{
+PFpgloc *loc = &PFftab[fd].ptmap[pagenum];
+int error;
+
+	if (loc->cap == 0)
+		return(PFE_OK);
+	if ((PFftab[fd].hdr.flags & PF_FILE_SHADOW) && !PFftab[fd].fresh[pagenum])
+		error = PFlocAdd(&PFftab[fd].pending,&PFftab[fd].npending,
+			&PFftab[fd].pendingsize,loc->off,loc->cap);
+	else	error = PFholeAdd(fd,loc->off,loc->cap);
+	loc->cap = 0;
+	return(error);
+}
+
+static long long PFholeFind(fd,cap)
+int fd;		/* file descriptor */
+int cap;	/* # of bytes wanted */
+/****************************************************************************
+SPECIFICATIONS:
+	Find "cap" bytes of unused space in compressed file "fd",
+	taking it from the first hole that is large enough, or from
+	the end of the page data if there is none. Holes keep their
+	order, so that space taken a bit at a time is taken in order.
 
 RETURN VALUE:
-	PFE_OK	if ok.
-	PF errod code if not OK.
+	The offset of the space found.
+*****************************************************************************/
+{
+PFpgloc *hole;
+long long off;
+int i;
 
+	for (i=0; i < PFftab[fd].nholes; i++){
+		hole = &PFftab[fd].holes[i];
+		if (hole->cap >= cap){
+			off = hole->off;
+			hole->off += cap;
+			if ((hole->cap -= cap) == 0)
+				memmove((char *)hole,(char *)(hole+1),
+					(--PFftab[fd].nholes-i)*sizeof(PFpgloc));
+			return(off);
+		}
+	}
+
+	off = PFftab[fd].hdr.dataend;
+	PFftab[fd].hdr.dataend += cap;
+	return(off);
+}
+
+/* order page locations by offset, for qsort() */
+static int PFpglocCmp(a,b)
+const void *a;
+const void *b;
+{
+long long d = ((PFpgloc *)a)->off - ((PFpgloc *)b)->off;
+
+	return((d > 0) - (d < 0));
+}
+
+static void PFholeMerge(fd)
+int fd;		/* file descriptor */
+/****************************************************************************
+SPECIFICATIONS:
+	Sort the holes of file "fd" by offset and join the ones next
+	to each other. A hole at the end of the page data is given
+	back by moving hdr.dataend.
 *****************************************************************************/
 {
-int error;
+PFpgloc *holes = PFftab[fd].holes;
+int n, i;
+
+	if (PFftab[fd].nholes == 0)
+		return;
+	qsort((char *)holes,PFftab[fd].nholes,sizeof(PFpgloc),PFpglocCmp);
+	for (i=1, n=0; i < PFftab[fd].nholes; i++)
+		if (holes[n].off + holes[n].cap == holes[i].off)
+			holes[n].cap += holes[i].cap;
+		else	holes[++n] = holes[i];
+	PFftab[fd].nholes = n+1;
+	if (holes[n].off + holes[n].cap == PFftab[fd].hdr.dataend){
+		PFftab[fd].hdr.dataend = holes[n].off;
+		PFftab[fd].nholes--;
+	}
+}
 
-	/* seek to the right place */
-	if ((error=lseek(PFftab[fd].unixfd,pagenum*sizeof(PFfpage)+PF_HDR_SIZE,
-				L_SET)) == -1){
-		PFerrno = PFE_UNIX;
+static int PFholeRebuild(fd)
+int fd;		/* file descriptor */
+/****************************************************************************
+SPECIFICATIONS:
+	Find the holes of compressed or shadow file "fd" from its page
+	translation map: any space before hdr.dataend not allocated
+	to a page, or to the map of a shadow file, is a hole.
+
+RETURN VALUE:
+	PFE_OK	if ok
+	PFE_NOMEM if no memory.
+*****************************************************************************/
+{
+PFpgloc *locs;	/* allocated space, sorted by offset */
+long long end;	/* end of the space seen so far */
+int n, i;
+
+	PFftab[fd].holes = NULL;
+	PFftab[fd].nholes = PFftab[fd].holesize = 0;
+	if (PFftab[fd].hdr.numpages == 0)
+		return(PFE_OK);
+
+	if ((locs=(PFpgloc *)malloc((PFftab[fd].hdr.numpages+1)*
+			sizeof(PFpgloc))) == NULL){
+		PFerrno = PFE_NOMEM;
 		return(PFerrno);
 	}
+	for (i=n=0; i < PFftab[fd].hdr.numpages; i++)
+		if (PFftab[fd].ptmap[i].cap > 0)
+			locs[n++] = PFftab[fd].ptmap[i];
+	if (PFftab[fd].hdr.ptmapcap > 0){
+		/* the map of a shadow file is not overwritten either */
+		locs[n].off = PFftab[fd].hdr.ptmapoff;
+		locs[n++].cap = PFftab[fd].hdr.ptmapcap;
+	}
+	qsort((char *)locs,n,sizeof(PFpgloc),PFpglocCmp);
 
-	/* write out the page */
-	if((error=write(PFftab[fd].unixfd,(char *)buf,sizeof(PFfpage)))
-			!=sizeof(PFfpage)){
-		if (error <0)
+	end = PFdataStart(PFftab[fd].hdr.flags);
+	for (i=0; i < n; i++){
+		if (locs[i].off > end &&
+				PFholeAdd(fd,end,(int)(locs[i].off-end)) != PFE_OK){
+			free((char *)locs);
+			return(PFerrno);
+		}
+		end = locs[i].off + locs[i].cap;
+	}
+	free((char *)locs);
+	return(PFE_OK);
+}
+
+static int PFptmapRead(fd)
+int fd;		/* file descriptor */
+/****************************************************************************
+SPECIFICATIONS:
+	Read the page translation map of compressed or shadow file
+	"fd", as pointed to by the file header, into memory.
+
+RETURN VALUE:
+	PFE_OK	if ok
+	PF error code if not ok.
+*****************************************************************************/
+{
+int count;	/* # of bytes read */
+int len;	/* # of bytes in the map */
+
+	PFftab[fd].ptmap = NULL;
+	PFftab[fd].ptmapsize = 0;
+	PFftab[fd].holes = NULL;
+	PFftab[fd].nholes = PFftab[fd].holesize = 0;
+	PFftab[fd].pending = NULL;
+	PFftab[fd].npending = PFftab[fd].pendingsize = 0;
+	PFftab[fd].fresh = NULL;
+	if (PFptmapGrow(fd,PFftab[fd].hdr.numpages) != PFE_OK)
+		return(PFerrno);
+
+	len = PFftab[fd].hdr.numpages*sizeof(PFpgloc);
+	if (len == 0)
+		return(PFE_OK);
+	if (lseek(PFftab[fd].unixfd,PFftab[fd].hdr.ptmapoff,L_SET) == -1){
+		PFerrno = PFE_UNIX;
+		return(PFerrno);
+	}
+	if ((count=read(PFftab[fd].unixfd,(char *)PFftab[fd].ptmap,len))!=len){
+		if (count < 0)
 			PFerrno = PFE_UNIX;
-		else	PFerrno = PFE_INCOMPLETEWRITE;
+		else	PFerrno = PFE_HDRREAD;
 		return(PFerrno);
 	}
-     /* one physical page written to disk */
-    PF_stats.physicalWrites++;
-	return(PFE_OK);
+	return(PFholeRebuild(fd));
+}
+
+static void PFptmapFree(fd)
+int fd;		/* file descriptor */
+/****************************************************************************
+SPECIFICATIONS:
+	Free the page translation map of file "fd", and the lists of
+	space kept with it.
+*****************************************************************************/
+{
+	free((char *)PFftab[fd].ptmap);
+	PFftab[fd].ptmap = NULL;
+	PFftab[fd].ptmapsize = 0;
+	free((char *)PFftab[fd].holes);
+	PFftab[fd].holes = NULL;
+	PFftab[fd].nholes = PFftab[fd].holesize = 0;
+	free((char *)PFftab[fd].pending);
+	PFftab[fd].pending = NULL;
+	PFftab[fd].npending = PFftab[fd].pendingsize = 0;
+	free((char *)PFftab[fd].fresh);
+	PFftab[fd].fresh = NULL;
+}
+
+static int PFptmapWrite(fd)
+int fd;		/* file descriptor */
+/****************************************************************************
+SPECIFICATIONS:
+	Write the page translation map of compressed file "fd" after
+	the page data, followed by the occupancy map past the header,
+	and point the file header at them. The caller writes out the
+	header. Pages written later go where the maps are now, and the
+	maps are written again when the file is closed. The file is cut
+	off after them.
+
+RETURN VALUE:
+	PFE_OK	if ok
+	PF error code if not ok.
+*****************************************************************************/
+{
+int count;	/* # of bytes written */
+int len;	/* # of bytes in the map */
+
+	len = PFftab[fd].hdr.numpages*sizeof(PFpgloc);
+	if (lseek(PFftab[fd].unixfd,PFftab[fd].hdr.dataend,L_SET) == -1){
+		PFerrno = PFE_UNIX;
+		return(PFerrno);
+	}
+	if ((count=write(PFftab[fd].unixfd,(char *)PFftab[fd].ptmap,len))
+			!=len){
+		if (count < 0)
+			PFerrno = PFE_UNIX;
+		else	PFerrno = PFE_HDRWRITE;
+		return(PFerrno);
+	}
+	PFftab[fd].hdr.ptmapoff = PFftab[fd].hdr.dataend;
+	if (PFmapWrite(fd,PFftab[fd].hdr.dataend+len) != PFE_OK)
+		return(PFerrno);
+
+	/* drop anything left past the maps by an earlier, longer file */
+	if (ftruncate(PFftab[fd].unixfd,(off_t)PFftab[fd].hdr.dataend+len+
+			PFmapTailSize(PFftab[fd].hdr.numpages)) == -1){
+		PFerrno = PFE_UNIX;
+		return(PFerrno);
+	}
+	return(PFE_OK);
+}
+
+static int PFzreadfcn(fd,pagenum,buf)
+int fd;	/* file descriptor */
+int pagenum; /* page number */
+PFfpage *buf;
+/****************************************************************************
+SPECIFICATIONS:
+	PFreadfcn() for compressed and shadow files: find page "pagenum"
+	in the page translation map, read the bytes stored for it and
+	decompress them into "buf".
+
+RETURN VALUE:
+	PFE_OK	if ok
+	PF error code if not OK.
+*****************************************************************************/
+{
+PFpgloc *loc = &PFftab[fd].ptmap[pagenum];
+int disksize = PFdiskPageSize(fd);
+char *dst;	/* where to read the stored bytes */
+int error;
+
+	if (loc->len == 0){
+		/* page was never written out */
+		PFerrno = PFE_INCOMPLETEREAD;
+		return(PFerrno);
+	}
+
+	/* pages that did not compress are read in place */
+	dst = (loc->len == disksize)? (char *)buf : (char *)PFzbuf;
+	if (lseek(PFftab[fd].unixfd,loc->off,L_SET) == -1){
+		PFerrno = PFE_UNIX;
+		return(PFerrno);
+	}
+	if ((error=read(PFftab[fd].unixfd,dst,loc->len)) != loc->len){
+		if (error <0)
+			PFerrno = PFE_UNIX;
+		else	PFerrno = PFE_INCOMPLETEREAD;
+		return(PFerrno);
+	}
+
+	if (dst != (char *)buf && PFlzDecompress(PFzbuf,loc->len,
+			(unsigned char *)buf,disksize) != disksize){
+		PFerrno = PFE_CORRUPT;
+		return(PFerrno);
+	}
+
+	PF_stats.physicalReads++;
+	return(PFE_OK);
+}
+
+static int PFzwritefcn(fd,pagenum,buf)
+int fd;		/* file descriptor */
+int pagenum;	/* page to write */
+PFfpage *buf;	/* buffer holding the page */
+/****************************************************************************
+SPECIFICATIONS:
+	PFwritefcn() for compressed and shadow files: compress the page
+	in "buf" and write it where it was stored before if it still
+	fits. Otherwise, give it new space at the end of the page data and
+	update the page translation map. Pages that do not compress
+	are stored as they are, as are all pages of a shadow file that
+	is not also compressed.
+
+	A shadow file page the last commit points to is never written
+	over: it gets new space, and the old space is freed by the next
+	commit.
+
+RETURN VALUE:
+	PFE_OK	if ok.
+	PF error code if not OK.
+*****************************************************************************/
+{
+PFpgloc *loc;
+int disksize = PFdiskPageSize(fd);
+char *src;	/* bytes to be stored */
+int len;	/* # of bytes to be stored */
+int cap;	/* space needed for them */
+int error;
+
+	if ((PFftab[fd].hdr.flags & PF_FILE_COMPRESSED) &&
+			(len=PFlzCompress((unsigned char *)buf,disksize,PFzbuf,
+			disksize-1)) > 0)
+		src = (char *)PFzbuf;
+	else {
+		/* incompressible, or not compressed */
+		src = (char *)buf;
+		len = disksize;
+	}
+
+	if ((error=PFptmapGrow(fd,pagenum+1)) != PFE_OK)
+		return(error);
+	loc = &PFftab[fd].ptmap[pagenum];
+	if ((PFftab[fd].hdr.flags & PF_FILE_SHADOW) && !PFftab[fd].fresh[pagenum]){
+		/* copy on write */
+		if ((error=PFspaceFree(fd,pagenum)) != PFE_OK)
+			return(error);
+		PFftab[fd].fresh[pagenum] = TRUE;
+	}
+	if (len > loc->cap){
+		/* does not fit in its old space */
+		if (PFftab[fd].hdr.flags & PF_FILE_COMPRESSED)
+			cap = (len + PF_ZALIGN - 1)/PF_ZALIGN*PF_ZALIGN;
+		else	cap = len;
+		if (loc->cap > 0 && loc->off + loc->cap == PFftab[fd].hdr.dataend)
+			/* last in the file: just grow it */
+			PFftab[fd].hdr.dataend += cap - loc->cap;
+		else {
+			if ((error=PFspaceFree(fd,pagenum)) != PFE_OK)
+				return(error);
+			loc->off = PFholeFind(fd,cap);
+		}
+		loc->cap = cap;
+	}
+	loc->len = len;
+	PFftab[fd].hdrchanged = TRUE;
+
+	if (lseek(PFftab[fd].unixfd,loc->off,L_SET) == -1){
+		PFerrno = PFE_UNIX;
+		return(PFerrno);
+	}
+	if ((error=write(PFftab[fd].unixfd,src,len)) != len){
+		if (error <0)
+			PFerrno = PFE_UNIX;
+		else	PFerrno = PFE_INCOMPLETEWRITE;
+		return(PFerrno);
+	}
+
+	PF_stats.physicalWrites++;
+	PF_stats.writeCalls++;
+	return(PFE_OK);
+}
+
+int PFreadfcn(fd,pagenum,buf)
+int fd;	/* file descriptor */
+int pagenum; /* page number */
+PFfpage *buf;
+/****************************************************************************
+SPECIFICATIONS:
+	Read the paged numbered "pagenum" from the file indexed by "fd"
+	into the page buffer "buf".
+
+AUTHOR: clc
+
+RETURN VALUE:
+	PFE_OK	if ok
+	PF error code if not OK.
+*****************************************************************************/
+{
+int error;
+
+	if (PFftab[fd].hdr.flags & PF_FILE_MAPPED)
+		return(PFzreadfcn(fd,pagenum,buf));
+
+	/* seek to the appropriate place */
+	if (lseek(PFftab[fd].unixfd,PFpageOffset(fd,pagenum),L_SET) == -1){
+		PFerrno = PFE_UNIX;
+		return(PFerrno);
+	}
+
+	/* read the data */
+	if((error=read(PFftab[fd].unixfd,(char *)buf,PFdiskPageSize(fd)))
+			!=PFdiskPageSize(fd)){
+		if (error <0)
+			PFerrno = PFE_UNIX;
+		else	PFerrno = PFE_INCOMPLETEREAD;
+		return(PFerrno);
+	}
+     /* one physical page read from disk */
+    PF_stats.physicalReads++;
+	return(PFE_OK);
+}
+
+void PF_SetBufferSize(int n)
+{
+    if (n > 0 && n <= PF_MAX_BUFS_LIMIT) {
+        PF_MAX_BUFS = n;
+    }
+}
+
+// # of pages reserved on disk each time a file outgrows its allocation
+void PF_SetExtentSize(int n)
+{
+    if (n > 0 && n <= PF_MAX_EXTENT) {
+        PF_extentPages = n;
+    }
+}
+
+int PFwritefcn(fd,pagenum,buf)
+int fd;		/* file descriptor */
+int pagenum;	/* page to read */
+PFfpage *buf;	/* buffer where to read the page */
+/****************************************************************************
+SPECIFICATIONS:
+	Write the page numbered "pagenum" from the buffer indexed
+	by "buf" into the file indexed by "fd".
+
+AUTHOR: clc
+
+RETURN VALUE:
+	PFE_OK	if ok.
+	PF errod code if not OK.
+
+*****************************************************************************/
+{
+int error;
+
+	if (PFftab[fd].hdr.flags & PF_FILE_MAPPED)
+		return(PFzwritefcn(fd,pagenum,buf));
+
+	/* seek to the right place */
+	if (lseek(PFftab[fd].unixfd,PFpageOffset(fd,pagenum),L_SET) == -1){
+		PFerrno = PFE_UNIX;
+		return(PFerrno);
+	}
+
+	/* write out the page */
+	if((error=write(PFftab[fd].unixfd,(char *)buf,PFdiskPageSize(fd)))
+			!=PFdiskPageSize(fd)){
+		if (error <0)
+			PFerrno = PFE_UNIX;
+		else	PFerrno = PFE_INCOMPLETEWRITE;
+		return(PFerrno);
+	}
+     /* one physical page written to disk */
+    PF_stats.physicalWrites++;
+    PF_stats.writeCalls++;
+	return(PFE_OK);
+
+}
+
+static int PFpwritev(fd,fpages,n,off)
+int fd;		/* file descriptor */
+PFfpage *fpages[];	/* buffers holding the pages */
+int n;		/* # of pages */
+off_t off;	/* where the first page goes */
+/****************************************************************************
+SPECIFICATIONS:
+	Write the "n" pages in "fpages" uncompressed, one after the
+	other from offset "off" of the file indexed by "fd", with one
+	system call.
+
+RETURN VALUE:
+	PFE_OK	if ok.
+	PF error code if not OK.
+*****************************************************************************/
+{
+struct iovec iov[PF_MAX_BUFS_LIMIT];
+ssize_t len;	/* # of bytes to write */
+int i;
+int error;
+
+	for (i=0; i < n; i++){
+		iov[i].iov_base = (char *)fpages[i];
+		iov[i].iov_len = PFdiskPageSize(fd);
+	}
+	len = (ssize_t)n*PFdiskPageSize(fd);
+	if ((error=pwritev(PFftab[fd].unixfd,iov,n,off)) != len){
+		if (error <0)
+			PFerrno = PFE_UNIX;
+		else	PFerrno = PFE_INCOMPLETEWRITE;
+		return(PFerrno);
+	}
+	PF_stats.physicalWrites += n;
+	PF_stats.writeCalls++;
+	return(PFE_OK);
+}
+
+static int PFwritevfcn(fd,pagenums,fpages,n)
+int fd;		/* file descriptor */
+int pagenums[];	/* pages to write, in increasing order */
+PFfpage *fpages[];	/* buffers holding them */
+int n;		/* # of pages */
+/****************************************************************************
+SPECIFICATIONS:
+	Write the "n" pages "pagenums" to the file indexed by "fd",
+	with one system call for each run of pages that are next to
+	each other on disk.
+
+	The pages of a shadow file that is not compressed all go to new
+	space, next to each other where possible, so that pages updated
+	all over the file are written with a few large writes rather
+	than many small ones.
+
+RETURN VALUE:
+	PFE_OK	if ok.
+	PF error code if not OK.
+*****************************************************************************/
+{
+PFpgloc *loc;
+int disksize = PFdiskPageSize(fd);
+long long free;	/* # of bytes in holes */
+long long off;	/* extent for all the pages, or -1 */
+int i, k;
+int error;
+
+	if (PFftab[fd].hdr.flags & PF_FILE_COMPRESSED){
+		/* pages are not next to each other */
+		for (i=0; i < n; i++)
+			if ((error=PFzwritefcn(fd,pagenums[i],fpages[i]))!= PFE_OK)
+				return(error);
+		return(PFE_OK);
+	}
+
+	if (PFftab[fd].hdr.flags & PF_FILE_SHADOW){
+		if ((error=PFptmapGrow(fd,pagenums[n-1]+1)) != PFE_OK)
+			return(error);
+
+		/* give up the old space first, so that it can be reused */
+		for (i=0; i < n; i++)
+			if ((error=PFspaceFree(fd,pagenums[i])) != PFE_OK)
+				return(error);
+
+		/* Take one extent for all the pages while the holes are
+		less than half the file. Otherwise fill the holes in order,
+		so that the file does not keep growing. */
+		for (i=0, free=0; i < PFftab[fd].nholes; i++)
+			free += PFftab[fd].holes[i].cap;
+		off = (2*free < PFftab[fd].hdr.dataend)?
+			PFholeFind(fd,n*disksize) : -1;
+		for (i=0; i < n; i++){
+			loc = &PFftab[fd].ptmap[pagenums[i]];
+			loc->off = (off >= 0)? off + (long long)i*disksize :
+				PFholeFind(fd,disksize);
+			loc->len = loc->cap = disksize;
+			PFftab[fd].fresh[pagenums[i]] = TRUE;
+		}
+		PFftab[fd].hdrchanged = TRUE;
+
+		for (i=0; i < n; i += k){
+			loc = &PFftab[fd].ptmap[pagenums[i]];
+			for (k=1; i+k < n && PFftab[fd].ptmap[pagenums[i+k]].off
+					== loc->off + (long long)k*disksize; k++)
+				;
+			if ((error=PFpwritev(fd,fpages+i,k,(off_t)loc->off))
+					!= PFE_OK)
+				return(error);
+		}
+		return(PFE_OK);
+	}
+
+	for (i=0; i < n; i += k){
+		for (k=1; i+k < n && pagenums[i+k] == pagenums[i]+k; k++)
+			;
+		if ((error=PFpwritev(fd,fpages+i,k,PFpageOffset(fd,pagenums[i])))
+				!= PFE_OK)
+			return(error);
+	}
+	return(PFE_OK);
+}
+
+static unsigned int PFhdrCksum(hdr)
+PFhdr_str *hdr;	/* header to check */
+/****************************************************************************
+SPECIFICATIONS:
+	Compute the checksum of shadow file header "hdr", an FNV-1a
+	hash of all of it, with hdr->cksum taken as 0.
+*****************************************************************************/
+{
+unsigned char *p = (unsigned char *)hdr;
+unsigned int saved = hdr->cksum;
+unsigned int h = 2166136261u;
+size_t i;
+
+	hdr->cksum = 0;
+	for (i=0; i < sizeof(PFhdr_str); i++)
+		h = (h ^ p[i]) * 16777619u;
+	hdr->cksum = saved;
+	return(h);
+}
+
+/* true if "hdr" is an intact shadow file header */
+#define PFhdrValid(hdr) ((hdr)->magic == PF_HDR_MAGIC && \
+	((hdr)->flags & PF_FILE_SHADOW) && (hdr)->cksum == PFhdrCksum(hdr))
+
+static int PFoldHdrRead(fd)
+int fd;		/* file table entry */
+/****************************************************************************
+SPECIFICATIONS:
+	Set up the header of the file indexed by "fd", if it is a file
+	written before the header had a magic number and an occupancy
+	map (see PF_OLD_HDR_SIZE). Its firstfree and numpages have been
+	read into the header. Such a file is exactly as long as its
+	pages, and the occupancy map is built by reading the free list
+	field at the start of each page.
+
+RETURN VALUE:
+	PFE_OK	if ok.
+	PFE_NOTPF if the file is not of that format either.
+	other PF error code if not OK.
+*****************************************************************************/
+{
+PFhdr_str *hdr = &PFftab[fd].hdr;
+struct stat st;
+int firstfree, numpages;
+int nextfree;	/* free list field of a page */
+int i;
+
+	if (fstat(PFftab[fd].unixfd,&st) == -1){
+		PFerrno = PFE_UNIX;
+		return(PFerrno);
+	}
+	firstfree = hdr->firstfree;
+	numpages = hdr->numpages;
+	if (numpages < 0 ||
+			firstfree < PF_PAGE_LIST_END || firstfree >= numpages ||
+			st.st_size != (off_t)PF_OLD_HDR_SIZE +
+			(off_t)numpages*(off_t)PFfpageSize(PF_PAGE_SIZE)){
+		PFerrno = PFE_NOTPF;
+		return(PFerrno);
+	}
+
+	memset((char *)hdr,0,sizeof(PFhdr_str));
+	hdr->firstfree = firstfree;
+	hdr->numpages = hdr->allocpages = numpages;
+	hdr->magic = PF_HDR_MAGIC;
+	hdr->pagesize = PF_PAGE_SIZE;
+	hdr->flags = PF_FILE_OLDHDR;
+	if (PFmapGrow(fd,numpages) != PFE_OK)
+		return(PFerrno);
+	for (i=0; i < numpages; i++){
+		if (pread(PFftab[fd].unixfd,(char *)&nextfree,sizeof(int),
+				PFpageOffset(fd,i)) != (int)sizeof(int)){
+			PFerrno = PFE_INCOMPLETEREAD;
+			return(PFerrno);
+		}
+		if (nextfree == PF_PAGE_USED){
+			PFmapSetUsed(PFftab[fd],i);
+			hdr->numused++;
+		}
+	}
+	return(PFE_OK);
+}
+
+static int PFhdrRead(fd)
+int fd;		/* file table entry */
+/****************************************************************************
+SPECIFICATIONS:
+	Read the header of the file indexed by "fd". For a shadow file,
+	this is the one of the two header slots with the last complete
+	commit. A file written before the header had a magic number is
+	recognised, and its header set up by PFoldHdrRead().
+
+RETURN VALUE:
+	PFE_OK	if ok.
+	PF error code if not OK.
+*****************************************************************************/
+{
+PFhdr_str *hdr = &PFftab[fd].hdr;
+PFhdr_str alt;	/* the other header slot */
+int count;	/* # of bytes read */
+int valid;	/* TRUE if *hdr is good */
+
+	PFftab[fd].maptail = NULL;
+	PFftab[fd].maptailsize = 0;
+	memset((char *)hdr,0,sizeof(PFhdr_str));
+	if ((count=pread(PFftab[fd].unixfd,(char *)hdr,sizeof(PFhdr_str),0))
+			< (int)PF_OLD_HDR_SIZE){
+		if (count < 0)
+			/* unix error */
+			PFerrno = PFE_UNIX;
+		else	/* not enough bytes in file */
+			PFerrno = PFE_HDRREAD;
+		return(PFerrno);
+	}
+	if (count == (int)sizeof(PFhdr_str) && hdr->magic == PF_HDR_MAGIC &&
+			!(hdr->flags & PF_FILE_SHADOW))
+		return(PFE_OK);
+
+	/* shadow file, or a header torn by a crash: take the newer
+	of the two slots that are intact */
+	valid = (count == (int)sizeof(PFhdr_str) && PFhdrValid(hdr));
+	if (pread(PFftab[fd].unixfd,(char *)&alt,sizeof(PFhdr_str),
+			PF_HDR_SIZE) == sizeof(PFhdr_str) && PFhdrValid(&alt)
+			&& (!valid || alt.seq > hdr->seq)){
+		*hdr = alt;
+		valid = TRUE;
+	}
+	if (!valid){
+		if (hdr->magic != PF_HDR_MAGIC)
+			/* not a paged file, or one written before the
+			header had a magic number */
+			return(PFoldHdrRead(fd));
+		PFerrno = (count == (int)sizeof(PFhdr_str))? PFE_CORRUPT :
+			PFE_HDRREAD;
+		return(PFerrno);
+	}
+	return(PFE_OK);
+}
+
+static int PFshadowCommit(fd)
+int fd;		/* file table entry */
+/****************************************************************************
+SPECIFICATIONS:
+	Commit shadow file "fd", whose dirty pages have been written:
+	write the page translation map, and the occupancy map past the
+	header, to free space, make them durable,
+	then write the header, with the next commit number, to the
+	header slot the last commit did not use, and make that durable.
+	A crash at any point leaves one of the two slots pointing at a
+	complete map and pages. Space that only the last commit used is
+	free afterwards.
+
+RETURN VALUE:
+	PFE_OK	if ok.
+	PF error code if not OK.
+*****************************************************************************/
+{
+PFhdr_str *hdr = &PFftab[fd].hdr;
+PFpgloc oldmap;	/* space of the last commit's maps */
+long long oldmapoff;	/* where its occupancy map was */
+long long off;	/* where the maps go */
+struct iovec iov[2];	/* the page map, then the occupancy map */
+int len;	/* # of bytes in the maps */
+int error;
+int i;
+
+	iov[0].iov_base = (char *)PFftab[fd].ptmap;
+	iov[0].iov_len = hdr->numpages*sizeof(PFpgloc);
+	iov[1].iov_base = (char *)PFftab[fd].maptail;
+	iov[1].iov_len = PFmapTailSize(hdr->numpages);
+	len = iov[0].iov_len + iov[1].iov_len;
+	off = (len > 0)? PFholeFind(fd,len) : 0;
+	if (len > 0 && (error=pwritev(PFftab[fd].unixfd,iov,2,(off_t)off))
+			!= len){
+		if (error < 0)
+			PFerrno = PFE_UNIX;
+		else	PFerrno = PFE_HDRWRITE;
+		PFholeAdd(fd,off,len);
+		return(PFerrno);
+	}
+	if (fdatasync(PFftab[fd].unixfd) == -1){
+		PFerrno = PFE_UNIX;
+		if (len > 0)
+			PFholeAdd(fd,off,len);
+		return(PFerrno);
+	}
+	PF_stats.syncs++;
+
+	oldmap.off = hdr->ptmapoff;
+	oldmap.cap = hdr->ptmapcap;
+	oldmapoff = hdr->mapoff;
+	hdr->ptmapoff = off;
+	hdr->ptmapcap = len;
+	hdr->mapoff = (iov[1].iov_len > 0)? off+iov[0].iov_len : 0;
+	hdr->seq++;
+	hdr->cksum = PFhdrCksum(hdr);
+	if ((error=pwrite(PFftab[fd].unixfd,(char *)hdr,sizeof(PFhdr_str),
+			PFhdrSlot(hdr->seq))) != sizeof(PFhdr_str)){
+		/* the last commit still stands */
+		if (error < 0)
+			PFerrno = PFE_UNIX;
+		else	PFerrno = PFE_HDRWRITE;
+		hdr->seq--;
+		hdr->ptmapoff = oldmap.off;
+		hdr->ptmapcap = oldmap.cap;
+		hdr->mapoff = oldmapoff;
+		if (len > 0)
+			PFholeAdd(fd,off,len);
+		return(PFerrno);
+	}
+	if (fdatasync(PFftab[fd].unixfd) == -1){
+		/* not known which commit stands: keep the space of both */
+		PFerrno = PFE_UNIX;
+		return(PFerrno);
+	}
+	PF_stats.syncs++;
+
+	/* free what only the last commit pointed to */
+	if (oldmap.cap > 0 && (error=PFholeAdd(fd,oldmap.off,oldmap.cap))
+			!= PFE_OK)
+		return(error);
+	for (i=0; i < PFftab[fd].npending; i++)
+		if ((error=PFholeAdd(fd,PFftab[fd].pending[i].off,
+				PFftab[fd].pending[i].cap)) != PFE_OK)
+			return(error);
+	PFftab[fd].npending = 0;
+	PFholeMerge(fd);
+	memset((char *)PFftab[fd].fresh,0,PFftab[fd].ptmapsize);
+	PFftab[fd].hdrchanged = FALSE;
+	return(PFE_OK);
+}
+
+static int PFhdrWrite(fd)
+int fd;		/* file descriptor */
+/****************************************************************************
+SPECIFICATIONS:
+	Write the header of the file indexed by "fd" back to the file,
+	and, for a compressed file, its page translation map first.
+	For a shadow file, this commits the pages written so far.
+
+RETURN VALUE:
+	PFE_OK	if ok.
+	PF error code if not OK.
+*****************************************************************************/
+{
+int error;
+int len;	/* # of bytes of header */
+
+	if (PFftab[fd].hdr.flags & PF_FILE_SHADOW)
+		return(PFshadowCommit(fd));
+
+	/* a compressed file stores its page map first, and the
+	occupancy map past the header along with it; any other file
+	stores the latter after its pages */
+	if (PFftab[fd].hdr.flags & PF_FILE_COMPRESSED){
+		if ((error=PFptmapWrite(fd)) != PFE_OK)
+			return(error);
+	}
+	else if (!(PFftab[fd].hdr.flags & PF_FILE_OLDHDR) &&
+			(error=PFmapWrite(fd,PFpageOffset(fd,
+			PFftab[fd].hdr.allocpages))) != PFE_OK)
+		return(error);
+
+	/* First seek to the appropriate place */
+	if ((error=lseek(PFftab[fd].unixfd,(unsigned)0,L_SET)) == -1){
+		/* seek error */
+		PFerrno = PFE_UNIX;
+		return(PFerrno);
+	}
+
+	/* write header, just its first fields for a file of the
+	format without a magic number */
+	len = (PFftab[fd].hdr.flags & PF_FILE_OLDHDR)? PF_OLD_HDR_SIZE :
+		sizeof(PFhdr_str);
+	if((error=write(PFftab[fd].unixfd, (char *)&PFftab[fd].hdr,
+			len))!=len){
+		if (error <0)
+			PFerrno = PFE_UNIX;
+		else	PFerrno = PFE_HDRWRITE;
+		return(PFerrno);
+	}
+	PFftab[fd].hdrchanged = FALSE;
+	return(PFE_OK);
+}
+
+static int PFflush(fd)
+int fd;		/* file table entry */
+/****************************************************************************
+SPECIFICATIONS:
+	Write the dirty pages and the header of the file indexed by
+	"fd", then make them durable with fdatasync(). Called with
+	PFmutex held. For a shadow file, writing the header is an
+	atomic commit that makes itself durable.
+
+	Flushes of the same file from several threads are merged into
+	group commits: each flush, once its writes are done, takes a
+	ticket. If no fdatasync() is running, it starts one for all
+	tickets handed out so far, releasing PFmutex while the call
+	runs. Otherwise it waits for the running one to finish, and
+	starts the next one if its ticket was not covered. While any
+	flush waits here, PF_CloseFile() waits for it, so that the file
+	is not closed under a running fdatasync().
+
+RETURN VALUE:
+	PFE_OK	if ok.
+	PF error code if not OK.
+*****************************************************************************/
+{
+long ticket;	/* our ticket */
+long target;	/* tickets covered by the fdatasync() we run */
+int unixfd;
+int error;
+
+	/* write out dirty pages in runs of consecutive pages */
+	if ((error=PFbufFlushFile(fd,PFwritevfcn)) != PFE_OK)
+		return(error);
+	if (PFftab[fd].hdrchanged && (error=PFhdrWrite(fd)) != PFE_OK)
+		return(error);
+	if (PFftab[fd].hdr.flags & PF_FILE_SHADOW)
+		/* nothing left to sync */
+		return(PFE_OK);
+
+	ticket = ++PFftab[fd].syncticket;
+	PFftab[fd].flushers++;
+	while (PFftab[fd].syncdone < ticket){
+		if (PFftab[fd].syncing){
+			/* wait for the running group commit */
+			pthread_cond_wait(&PFsynccond,&PFmutex);
+			continue;
+		}
+
+		/* lead the next group commit */
+		target = PFftab[fd].syncticket;
+		unixfd = PFftab[fd].unixfd;
+		PFftab[fd].syncing = TRUE;
+		pthread_mutex_unlock(&PFmutex);
+		error = fdatasync(unixfd);
+		pthread_mutex_lock(&PFmutex);
+		PFftab[fd].syncing = FALSE;
+		if (error == -1){
+			PFerrno = error = PFE_UNIX;
+			break;
+		}
+		PF_stats.syncs++;
+		if (PFftab[fd].syncdone < target)
+			PFftab[fd].syncdone = target;
+	}
+	/* wake the other flushes, and any close waiting for them */
+	PFftab[fd].flushers--;
+	pthread_cond_broadcast(&PFsynccond);
+	return((error == PFE_UNIX)? error : PFE_OK);
+}
+
+void PF_Lock()
+/****************************************************************************
+SPECIFICATIONS:
+	Lock the PF layer. The PF layer is not reentrant: programs that
+	call it from several threads hold this lock around every PF
+	call except PF_FlushFile(), PF_Sync() and PF_CloseFile(), which
+	take the lock themselves and must be called without it.
+*****************************************************************************/
+{
+	pthread_mutex_lock(&PFmutex);
+}
+
+void PF_Unlock()
+/****************************************************************************
+SPECIFICATIONS:
+	Unlock the PF layer locked with PF_Lock().
+*****************************************************************************/
+{
+	pthread_mutex_unlock(&PFmutex);
+}
+
+int PF_FlushFile(fd)
+int fd;		/* file descriptor */
+/****************************************************************************
+SPECIFICATIONS:
+	Make every page of file "fd" written so far, and its header,
+	durable on disk. Dirty pages are written out in page order and
+	stay in the buffer. Concurrent flushes of the same file share
+	one fdatasync().
+
+RETURN VALUE:
+	PFE_OK	if ok.
+	PF error code if not OK.
+*****************************************************************************/
+{
+int error;
+
+	pthread_mutex_lock(&PFmutex);
+	if (PFinvalidFd(fd)){
+		pthread_mutex_unlock(&PFmutex);
+		PFerrno = PFE_FD;
+		return(PFerrno);
+	}
+	error = PFflush(PFdtab[fd]);
+	pthread_mutex_unlock(&PFmutex);
+	return(error);
+}
+
+int PF_Sync()
+/****************************************************************************
+SPECIFICATIONS:
+	PF_FlushFile() every open file.
+
+RETURN VALUE:
+	PFE_OK	if ok.
+	PF error code if not OK.
+*****************************************************************************/
+{
+int fd;
+int error;
 
+	pthread_mutex_lock(&PFmutex);
+	for (fd=0; fd < PFftabsize; fd++)
+		if (PFftab[fd].fname != NULL && (error=PFflush(fd)) != PFE_OK){
+			pthread_mutex_unlock(&PFmutex);
+			return(error);
+		}
+	pthread_mutex_unlock(&PFmutex);
+	return(PFE_OK);
 }
 
 void PF_ResetStats()
@@ -189,6 +1530,10 @@ void PF_ResetStats()
     PF_stats.logicalWrites = 0;
     PF_stats.physicalReads = 0;
     PF_stats.physicalWrites= 0;
+    PF_stats.syncs         = 0;
+    PF_stats.zcacheHits    = 0;
+    PF_stats.writeCalls    = 0;
+    PF_stats.swizzleHits   = 0;
 }
 
 void PF_PrintStats()
@@ -198,17 +1543,38 @@ void PF_PrintStats()
     printf("  logicalWrites  = %d\n", PF_stats.logicalWrites);
     printf("  physicalReads  = %d\n", PF_stats.physicalReads);
     printf("  physicalWrites = %d\n", PF_stats.physicalWrites);
+    printf("  writeCalls     = %d\n", PF_stats.writeCalls);
+    printf("  syncs          = %d\n", PF_stats.syncs);
+    if (PF_zcacheBytes > 0)
+        printf("  zcacheHits     = %d\n", PF_stats.zcacheHits);
+    if (PF_stats.swizzleHits > 0)
+        printf("  swizzleHits    = %d\n", PF_stats.swizzleHits);
 }
 
-// global switch between lru or mru
+// global switch between lru, mru and clean-first lru
 void PF_SetReplacementPolicy(int policy)
 {
-    if (policy == PF_REPL_LRU || policy == PF_REPL_MRU) {
+    if (policy == PF_REPL_LRU || policy == PF_REPL_MRU ||
+        policy == PF_REPL_CFLRU) {
         PF_replacementPolicy = policy;
     }
     /* if someone passes garbage, we just ignore it and keep old policy */
 }
 
+// size of the clean-first window at the cold end of the LRU list
+void PF_SetCFLRUWindow(int n)
+{
+    if (n >= 0 && n <= PF_MAX_BUFS_LIMIT) {
+        PF_cflruWindow = n;
+    }
+}
+
+// turn the swizzled references of PF_GetChildPage() on or off
+void PF_SetSwizzle(int on)
+{
+    PF_swizzle = on ? TRUE : FALSE;
+}
+
 /************************* Interface Routines ****************************/
 
 void PF_Init()
@@ -222,7 +1588,7 @@ AUTHOR: clc
 RETURN VALUE: none
 
 GLOBAL VARIABLES MODIFIED:
-	PFftab
+	PFftab, PFdtab
 *****************************************************************************/
 {
 int i;
@@ -230,17 +1596,20 @@ int i;
 	PFhashInit();
 
 	/* init the file table to be not used*/
-	for (i=0; i < PF_FTAB_SIZE; i++){
+	for (i=0; i < PFftabsize; i++){
 		PFftab[i].fname = NULL;
+		PFfhash[i] = -1;
 	}
+	for (i=0; i < PFdtabsize; i++)
+		PFdtab[i] = -1;
 }
 
 int PF_CreateFile(fname)
 char *fname;	/* name of file to create */
 /****************************************************************************
 SPECIFICATIONS:
-	Create a paged file called "fname". The file should not have
-	already existed before.
+	Create a paged file called "fname" with pages of PF_PAGE_SIZE
+	bytes. The file should not have already existed before.
 
 AUTHOR: clc
 
@@ -248,11 +1617,67 @@ RETURN VALUE:
 	PFE_OK	if OK
 	PF error code if error.
 *****************************************************************************/
+{
+	return(PF_CreateFileSized(fname,PF_PAGE_SIZE));
+}
+
+int PF_CreateFileSized(fname,pagesize)
+char *fname;	/* name of file to create */
+int pagesize;	/* # of bytes of data in each page of the file */
+/****************************************************************************
+SPECIFICATIONS:
+	Create a paged file called "fname" whose pages hold "pagesize"
+	bytes. The page size is recorded in the file header and used
+	for the life of the file. It must be a power of 2 between
+	PF_MIN_PAGE_SIZE and PF_MAX_PAGE_SIZE. The file should not have
+	already existed before.
+
+RETURN VALUE:
+	PFE_OK	if OK
+	PFE_PAGESIZE if the page size is invalid.
+	other PF error code if error.
+*****************************************************************************/
+{
+	return(PF_CreateFileOpt(fname,pagesize,0));
+}
+
+int PF_CreateFileOpt(fname,pagesize,flags)
+char *fname;	/* name of file to create */
+int pagesize;	/* # of bytes of data in each page of the file */
+int flags;	/* PF_FILE_xxx storage options */
+/****************************************************************************
+SPECIFICATIONS:
+	Like PF_CreateFileSized(), with storage options for the file.
+	If "flags" has PF_FILE_COMPRESSED, each page is compressed when
+	it is written out and decompressed when it is read in. Callers
+	still see pages of "pagesize" bytes. Pages are packed on disk
+	and found through a page translation map, which is kept in
+	memory while the file is open and stored after the page data.
+
+	If "flags" has PF_FILE_SHADOW, pages are copied on write and
+	found through the same map: a page on disk is never written
+	over while the last commit points to it. PF_FlushFile() and
+	PF_CloseFile() commit atomically, so that after a crash the file
+	is found as it was at the last commit. The two options can be
+	used together.
+
+RETURN VALUE:
+	PFE_OK	if OK
+	PFE_PAGESIZE if the page size or the options are invalid.
+	other PF error code if error.
+*****************************************************************************/
 {
 int fd;	/* unix file descripotr */
 PFhdr_str hdr;	/* file header */
 int error;
 
+	if (pagesize < PF_MIN_PAGE_SIZE || pagesize > PF_MAX_PAGE_SIZE
+			|| (pagesize & (pagesize-1)) != 0
+			|| (flags & ~PF_FILE_MAPPED) != 0){
+		PFerrno = PFE_PAGESIZE;
+		return(PFerrno);
+	}
+
 	/* create file for exclusive use */
 	if ((fd=open(fname,O_CREAT|O_EXCL|O_WRONLY,0664))<0){
 		/* unix error on open */
@@ -261,8 +1686,21 @@ int error;
 	}
 
 	/* write out the file header */
+	memset((char *)&hdr,0,sizeof(hdr));	/* no page used yet */
 	hdr.firstfree = PF_PAGE_LIST_END;	/* no free pag yet */
 	hdr.numpages = 0;
+	hdr.magic = PF_HDR_MAGIC;
+	hdr.numused = 0;
+	hdr.allocpages = 0;
+	hdr.pagesize = pagesize;
+	hdr.flags = flags;
+	hdr.dataend = PFdataStart(flags); /* mapped pages start here */
+	hdr.ptmapoff = 0;
+	if (flags & PF_FILE_SHADOW){
+		/* commit 1, in the first header slot */
+		hdr.seq = 1;
+		hdr.cksum = PFhdrCksum(&hdr);
+	}
 	if ((error=write(fd,(char *)&hdr,sizeof(hdr))) != sizeof(hdr)){
 		/* error while writing. Abort everything. */
 		if (error < 0)
@@ -298,8 +1736,9 @@ RETURN VALUE:
 *****************************************************************************/
 {
 int error;
+struct stat st;
 
-	if (PFtabFindFname(fname)!= -1){
+	if (stat(fname,&st) == 0 && PFftabFind(st.st_dev,st.st_ino) != -1){
 		/* file is open */
 		PFerrno = PFE_FILEOPEN;
 		return(PFerrno);
@@ -321,11 +1760,7 @@ char *fname;		/* name of the file to open */
 /****************************************************************************
 SPECIFICATIONS:
 	Open the paged file whose name is fname.  It is possible to open
-	a file more than once. Warning: Openinging a file more than once for 
-	write operations is not prevented. The possible consequence is
-	the corruption of the file structure, which will crash
-	the Paged File functions. On the other hand, opening a file
-	more than once for reading is OK.
+	a file more than once, under the same or another name.
 
 AUTHOR: clc
 
@@ -335,100 +1770,136 @@ RETURN VALUE:
 
 IMPLEMENTATION NOTES:
 	A file opened more than once will have different file descriptors
-	returned. Separate buffers are used.
+	returned. They share the file table entry and the buffer pages.
+	Each descriptor can fix a page once: a page stays in the buffer
+	until every descriptor that fixed it has unfixed it.
+	The file is closed when its last descriptor is closed.
 *****************************************************************************/
 {
-int count;	/* # of bytes in read */
-int fd; /* file descriptor */
+int desc;	/* file descriptor returned */
+int fd; /* file table entry */
+int unixfd;	/* unix file descriptor */
+struct stat st;
 
-	/* find a free entry in the file table */
-	if ((fd=PFftabFindFree())< 0){
-		/* file table full */
-		PFerrno = PFE_FTABFULL;
+	/* find a free file descriptor */
+	if ((desc=PFdtabFindFree())< 0){
+		PFerrno = PFE_NOMEM;
 		return(PFerrno);
 	}
 
 	/* open the file */
-	if ((PFftab[fd].unixfd = open(fname,O_RDWR))< 0){
+	if ((unixfd = open(fname,O_RDWR))< 0 || fstat(unixfd,&st) == -1){
 		/* can't open the file */
+		if (unixfd >= 0)
+			close(unixfd);
 		PFerrno = PFE_UNIX;
 		return(PFerrno);
 	}
 
+	if ((fd=PFftabFind(st.st_dev,st.st_ino)) != -1){
+		/* already open: share its entry */
+		close(unixfd);
+		PFftab[fd].refcnt++;
+		PFdtab[desc] = fd;
+		return(desc);
+	}
+
+	/* find a free entry in the file table */
+	if ((fd=PFftabFindFree())< 0){
+		/* no memory to grow the file table */
+		close(unixfd);
+		PFerrno = PFE_NOMEM;
+		return(PFerrno);
+	}
+	PFftab[fd].unixfd = unixfd;
+
 	/* Read the file header */
-	if ((count=read(PFftab[fd].unixfd,(char *)&PFftab[fd].hdr,PF_HDR_SIZE))
-				!= PF_HDR_SIZE){
-		if (count < 0)
-			/* unix error */
-			PFerrno = PFE_UNIX;
-		else	/* not enough bytes in file */
-			PFerrno = PFE_HDRREAD;
+	if (PFhdrRead(fd) != PFE_OK || PFmapRead(fd) != PFE_OK){
+		PFmapFree(fd);
 		close(PFftab[fd].unixfd);
 		return(PFerrno);
 	}
 	/* set file header to be not changed */
 	PFftab[fd].hdrchanged = FALSE;
+	PFftab[fd].syncticket = PFftab[fd].syncdone = 0;
+	PFftab[fd].syncing = FALSE;
+	PFftab[fd].flushers = 0;
+
+	if ((PFftab[fd].hdr.flags & PF_FILE_MAPPED) &&
+			PFptmapRead(fd) != PFE_OK){
+		/* can't read the page translation map */
+		PFptmapFree(fd);
+		PFmapFree(fd);
+		close(PFftab[fd].unixfd);
+		return(PFerrno);
+	}
 
 	/* save the file name */
 	if ((PFftab[fd].fname = savestr(fname)) == NULL){
 		/* no memory */
+		PFptmapFree(fd);
+		PFmapFree(fd);
 		close(PFftab[fd].unixfd);
 		PFerrno = PFE_NOMEM;
 		return(PFerrno);
 	}
 
-	return(fd);
+	/* enter it in the hash table */
+	PFftab[fd].dev = st.st_dev;
+	PFftab[fd].ino = st.st_ino;
+	PFftab[fd].refcnt = 1;
+	PFftab[fd].hashnext = PFfhash[PFfhashOf(st.st_dev,st.st_ino)];
+	PFfhash[PFfhashOf(st.st_dev,st.st_ino)] = fd;
+
+	PFdtab[desc] = fd;
+	return(desc);
 }
 
-int PF_CloseFile(fd)
+static int PFclose(fd)
 int fd;		/* file descriptor to close */
 /****************************************************************************
 SPECIFICATIONS:
-	Close the file indexed by file descriptor fd. The file should have
-	been opened with PFopen(). It is an error to close a file
-	with pages still fixed in the buffer.
-
-AUTHOR: clc
+	PF_CloseFile(), called with PFmutex held.
 
 RETURN VALUE:
 	PFE_OK	if OK
 	PF error code if error.
-
 *****************************************************************************/
 {
 int error;
+int desc = fd;	/* descriptor being closed */
 
 	if (PFinvalidFd(fd)){
 		/* invalid file descriptor */
 		PFerrno = PFE_FD;
 		return(PFerrno);
 	}
-	
-
-	/* Flush all buffers for this file */
-	if ( (error=PFbufReleaseFile(fd,PFwritefcn)) != PFE_OK)
-		return(error);
+	fd = PFdtab[desc];
 
-	if (PFftab[fd].hdrchanged){
-		/* write the header back to the file */
-		/* First seek to the appropriate place */
-		if ((error=lseek(PFftab[fd].unixfd,(unsigned)0,L_SET)) == -1){
-			/* seek error */
-			PFerrno = PFE_UNIX;
-			return(PFerrno);
-		}
+	/* let flushes of the file running in other threads finish */
+	while (PFftab[fd].flushers > 0)
+		pthread_cond_wait(&PFsynccond,&PFmutex);
 
-		/* write header*/
-		if((error=write(PFftab[fd].unixfd, (char *)&PFftab[fd].hdr,
-				PF_HDR_SIZE))!=PF_HDR_SIZE){
-			if (error <0)
-				PFerrno = PFE_UNIX;
-			else	PFerrno = PFE_HDRWRITE;
+	if (PFftab[fd].refcnt > 1){
+		/* file still open through other descriptors */
+		if (PFbufDescFixed(fd,desc)){
+			PFerrno = PFE_PAGEFIXED;
 			return(PFerrno);
 		}
-		PFftab[fd].hdrchanged = FALSE;
+		PFftab[fd].refcnt--;
+		PFdtab[desc] = -1;
+		return(PFE_OK);
 	}
 
+	/* Flush all buffers for this file */
+	if ( (error=PFbufReleaseFile(fd,PFwritefcn)) != PFE_OK)
+		return(error);
+
+	if (PFftab[fd].hdrchanged &&
+			/* write the header back to the file */
+			(error=PFhdrWrite(fd)) != PFE_OK)
+		return(error);
+
 
 		
 	/* close the file */
@@ -438,12 +1909,44 @@ int error;
 	}
 
 	/* free the file name space */
+	PFftabUnlink(fd);
+	PFftab[fd].refcnt = 0;
+	PFdtab[desc] = -1;
 	free((char *)PFftab[fd].fname);
 	PFftab[fd].fname = NULL;
+	PFptmapFree(fd);
+	PFmapFree(fd);
 
 	return(PFE_OK);
 }
 
+int PF_CloseFile(fd)
+int fd;		/* file descriptor to close */
+/****************************************************************************
+SPECIFICATIONS:
+	Close the file indexed by file descriptor fd. The file should have
+	been opened with PFopen(). It is an error to close a descriptor
+	with pages still fixed through it, or the last descriptor of a
+	file with pages still fixed in the buffer. Flushes of the file
+	running in other threads are waited for. Like PF_FlushFile(),
+	it takes the PF lock itself, and is called without PF_Lock().
+
+AUTHOR: clc
+
+RETURN VALUE:
+	PFE_OK	if OK
+	PF error code if error.
+
+*****************************************************************************/
+{
+int error;
+
+	pthread_mutex_lock(&PFmutex);
+	error = PFclose(fd);
+	pthread_mutex_unlock(&PFmutex);
+	return(error);
+}
+
 
 int PF_GetFirstPage(fd,pagenum,pagebuf)
 int fd;	/* file descriptor */
@@ -491,6 +1994,9 @@ RETURN VALUE:
 	PFE_EOF	if end of file reached without encountering
 		any used page data. 
 	PFE_INVALIDPAGE  if page number is invalid.
+	PFE_PAGEFIXED if the next page is already fixed in memory
+		through this descriptor. As in PF_GetThisPage(),
+		*pagenum and *pagebuf are still set.
 	other PF errors code for other error.
 
 *****************************************************************************/
@@ -498,11 +2004,13 @@ RETURN VALUE:
 int temppage;	/* page number to scan for next valid page */
 int error;	/* error code */
 PFfpage *fpage;	/* pointer to file page */
+int desc = fd;	/* descriptor to fix the page through */
 
 	if (PFinvalidFd(fd)){
 		PFerrno = PFE_FD;
 		return(PFerrno);
 	}
+	fd = PFdtab[fd];	/* from here on, the file table entry */
 
 
 	if (*pagenum < -1 || *pagenum >= PFftab[fd].hdr.numpages){
@@ -513,27 +2021,92 @@ PFfpage *fpage;	/* pointer to file page */
 	/* one logical read request (get-next-page) */
     PF_stats.logicalReads++;
 
-	/* scan the file until a valid used page is found */
-	for (temppage= *pagenum+1;temppage<PFftab[fd].hdr.numpages;temppage++){
-		if ( (error=PFbufGet(fd,temppage,&fpage,PFreadfcn,
-					PFwritefcn))!= PFE_OK)
-			return(error);
-		else if (fpage->nextfree == PF_PAGE_USED){
-			/* found a used page */
+	/* find the next used page from the occupancy map; free
+	pages are never brought into the buffer */
+	if ((temppage=PFmapNextUsed(fd,*pagenum+1)) < 0){
+		/* No valid used page found */
+		PFerrno = PFE_EOF;
+		return(PFerrno);
+	}
+
+	if ( (error=PFbufGet(fd,desc,temppage,PFpagesize(fd),&fpage,
+				PFreadfcn,PFwritefcn))!= PFE_OK){
+		if (error== PFE_PAGEFIXED){
 			*pagenum = temppage;
 			*pagebuf = (char *)fpage->pagebuf;
-			return(PFE_OK);
 		}
+		return(error);
+	}
 
-		/* page is free, unfix it */
-		if ((error=PFbufUnfix(fd,temppage,FALSE))!= PFE_OK)
-			return(error);
+	*pagenum = temppage;
+	*pagebuf = (char *)fpage->pagebuf;
+	return(PFE_OK);
+
+}
+
+int PF_NumUsedPages(fd)
+int fd;		/* file descriptor */
+/****************************************************************************
+SPECIFICATIONS:
+	Return the number of used pages in file "fd", i.e. the number
+	of pages a scan of the file will visit. Nothing is read from
+	the file; the count is kept in the file header.
+
+RETURN VALUE:
+	The # of used pages, which is >= 0, if no error.
+	PF error code otherwise.
+*****************************************************************************/
+{
+	if (PFinvalidFd(fd)){
+		PFerrno = PFE_FD;
+		return(PFerrno);
+	}
+	fd = PFdtab[fd];	/* from here on, the file table entry */
+
+	return(PFftab[fd].hdr.numused);
+}
+
+int PF_NumPages(fd)
+int fd;		/* file descriptor */
+/****************************************************************************
+SPECIFICATIONS:
+	Return the number of pages in file "fd", used or free: its
+	page numbers run from 0 to this number minus 1. Like
+	PF_NumUsedPages(), it is kept in the file header.
+
+RETURN VALUE:
+	The # of pages, which is >= 0, if no error.
+	PF error code otherwise.
+*****************************************************************************/
+{
+	if (PFinvalidFd(fd)){
+		PFerrno = PFE_FD;
+		return(PFerrno);
 	}
+	fd = PFdtab[fd];	/* from here on, the file table entry */
+
+	return(PFftab[fd].hdr.numpages);
+}
+
+int PF_GetPageSize(fd)
+int fd;		/* file descriptor */
+/****************************************************************************
+SPECIFICATIONS:
+	Return the # of bytes of data in a page of file "fd", as chosen
+	when the file was created.
 
-	/* No valid used page found */
-	PFerrno = PFE_EOF;
-	return(PFerrno);
+RETURN VALUE:
+	The page size, if no error.
+	PF error code otherwise.
+*****************************************************************************/
+{
+	if (PFinvalidFd(fd)){
+		PFerrno = PFE_FD;
+		return(PFerrno);
+	}
+	fd = PFdtab[fd];	/* from here on, the file table entry */
 
+	return(PFpagesize(fd));
 }
 
 int PF_GetThisPage(fd,pagenum,pagebuf)
@@ -550,7 +2123,8 @@ AUTHOR: clc
 RETURN VALUE:
 	PFE_OK	if no error.
 	PFE_INVALIDPAGE if invalid page number is specified.
-	PFE_PAGEFIXED if page already fixed in memory. In this case,
+	PFE_PAGEFIXED if page already fixed in memory through this
+		descriptor. In this case,
 		*pagebuf  is still set to point to the buffer that contains
 		the page data.
 	other PF error codes if other error encountered.
@@ -558,11 +2132,13 @@ RETURN VALUE:
 {
 int error;
 PFfpage *fpage;
+int desc = fd;	/* descriptor to fix the page through */
 
 	if (PFinvalidFd(fd)){
 		PFerrno = PFE_FD;
 		return(PFerrno);
 	}
+	fd = PFdtab[fd];	/* from here on, the file table entry */
 
 	if (PFinvalidPagenum(fd,pagenum)){
 		PFerrno = PFE_INVALIDPAGE;
@@ -572,7 +2148,14 @@ PFfpage *fpage;
     /* one logical read request (get-this-page) */
     PF_stats.logicalReads++;
 
-	if ( (error=PFbufGet(fd,pagenum,&fpage,PFreadfcn,PFwritefcn))!= PFE_OK){
+	if (!PFmapIsUsed(PFftab[fd],pagenum)){
+		/* free page: no need to read it to find out */
+		PFerrno = PFE_INVALIDPAGE;
+		return(PFerrno);
+	}
+
+	if ( (error=PFbufGet(fd,desc,pagenum,PFpagesize(fd),&fpage,
+				PFreadfcn,PFwritefcn))!= PFE_OK){
 		if (error== PFE_PAGEFIXED)
 			*pagebuf = fpage->pagebuf;
 		return(error);
@@ -585,7 +2168,7 @@ PFfpage *fpage;
 	}
 	else {
 		/* invalid page */
-		if (PFbufUnfix(fd,pagenum,FALSE)!= PFE_OK){
+		if (PFbufUnfix(fd,desc,pagenum,FALSE)!= PFE_OK){
 			printf("internal error:PFgetThis()\n");
 			exit(1);
 		}
@@ -615,11 +2198,13 @@ RETURN VALUE:
 {
 PFfpage *fpage;	/* pointer to file page */
 int error;
+int desc = fd;	/* descriptor to fix the page through */
 
 	if (PFinvalidFd(fd)){
 		PFerrno= PFE_FD;
 		return(PFerrno);
 	}
+	fd = PFdtab[fd];	/* from here on, the file table entry */
 
 	/* allocating a new logical page -> logical write */
     PF_stats.logicalWrites++;
@@ -627,7 +2212,7 @@ int error;
 	if (PFftab[fd].hdr.firstfree != PF_PAGE_LIST_END){
 		/* get a page from the free list */
 		*pagenum = PFftab[fd].hdr.firstfree;
-		if ((error=PFbufGet(fd,*pagenum,&fpage,PFreadfcn,
+		if ((error=PFbufGet(fd,desc,*pagenum,PFpagesize(fd),&fpage,PFreadfcn,
 					PFwritefcn))!= PFE_OK)
 			/* can't get the page */
 			return(error);
@@ -636,8 +2221,25 @@ int error;
 	}
 	else {
 		/* Free list empty, allocate one more page from the file */
+		if (PFftab[fd].hdr.numpages == INT_MAX){
+			/* no page number left */
+			PFerrno = PFE_FILEFULL;
+			return(PFerrno);
+		}
 		*pagenum = PFftab[fd].hdr.numpages;
-		if ((error=PFbufAlloc(fd,*pagenum,&fpage,PFwritefcn))!= PFE_OK)
+		if ((error=PFmapGrow(fd,*pagenum+1))!= PFE_OK)
+			return(error);
+		if (PFftab[fd].hdr.flags & PF_FILE_MAPPED){
+			/* space is found when the page is written out */
+			if ((error=PFptmapGrow(fd,*pagenum+1))!= PFE_OK)
+				return(error);
+		}
+		else if (*pagenum >= PFftab[fd].hdr.allocpages &&
+				(error=PFextendFile(fd))!= PFE_OK)
+			/* can't grow the file */
+			return(error);
+		if ((error=PFbufAlloc(fd,desc,*pagenum,PFpagesize(fd),&fpage,
+					PFwritefcn))!= PFE_OK)
 			/* can't allocate a page */
 			return(error);
 	
@@ -656,11 +2258,13 @@ int error;
 	/* zero out the page. Seems to be a nice thing to do,
 	at least for debugging. */
 	/*
-	bzero(fpage->pagebuf,PF_PAGE_SIZE);
+	bzero(fpage->pagebuf,PFpagesize(fd));
 	*/
 
 	/* Mark the new page used */
 	fpage->nextfree = PF_PAGE_USED;
+	PFmapSetUsed(PFftab[fd],*pagenum);
+	PFftab[fd].hdr.numused++;
 
 	/* set return value */
 	*pagebuf = fpage->pagebuf;
@@ -668,13 +2272,130 @@ int error;
 	return(PFE_OK);
 }
 
+int PF_AllocPages(fd,n,firstpage)
+int fd;		/* file descriptor */
+int n;		/* # of pages */
+int *firstpage;	/* page number of the first one */
+/****************************************************************************
+SPECIFICATIONS:
+	Allocate "n" new pages at the end of file "fd", numbered from
+	*firstpage on, without bringing them into the buffer pool. The
+	free list is not used, so the pages are always next to each
+	other. They are to be written with PF_WritePages(); until then
+	their contents are undefined.
+
+RETURN VALUE:
+	PFE_OK	if ok
+	PF error codes if not ok.
+*****************************************************************************/
+{
+int error;
+int i;
+
+	if (PFinvalidFd(fd)){
+		PFerrno= PFE_FD;
+		return(PFerrno);
+	}
+	fd = PFdtab[fd];	/* from here on, the file table entry */
+
+	if (n < 1 || n > INT_MAX - PFftab[fd].hdr.numpages){
+		/* no page numbers left */
+		PFerrno = PFE_FILEFULL;
+		return(PFerrno);
+	}
+	*firstpage = PFftab[fd].hdr.numpages;
+	if ((error=PFmapGrow(fd,*firstpage+n))!= PFE_OK)
+		return(error);
+	if (PFftab[fd].hdr.flags & PF_FILE_MAPPED){
+		if ((error=PFptmapGrow(fd,*firstpage+n))!= PFE_OK)
+			return(error);
+	}
+	else while (*firstpage + n > PFftab[fd].hdr.allocpages)
+		if ((error=PFextendFile(fd))!= PFE_OK)
+			return(error);
+
+	PF_stats.logicalWrites += n;
+	for (i=0; i < n; i++)
+		PFmapSetUsed(PFftab[fd],*firstpage+i);
+	PFftab[fd].hdr.numpages += n;
+	PFftab[fd].hdr.numused += n;
+	PFftab[fd].hdrchanged = TRUE;
+	return(PFE_OK);
+}
+
+int PF_WritePages(fd,pagenum,n,pagebufs)
+int fd;		/* file descriptor */
+int pagenum;	/* first page to write */
+int n;		/* # of pages */
+char *pagebufs[]; /* data of the pages, page size bytes each */
+/****************************************************************************
+SPECIFICATIONS:
+	Write pages "pagenum" to "pagenum"+n-1 of file "fd" straight
+	to the file from "pagebufs", without going through the buffer
+	pool, with one system call per PF_MAX_BUFS_LIMIT pages where
+	the file allows it. Meant for bulk loading pages allocated by
+	PF_AllocPages(); none of the pages may be in the buffer pool.
+
+RETURN VALUE:
+	PFE_OK	if ok
+	PF error codes if not ok.
+*****************************************************************************/
+{
+int size;	/* page size */
+char *stage;	/* the pages as they go to disk */
+PFfpage *fpages[PF_MAX_BUFS_LIMIT];
+int pagenums[PF_MAX_BUFS_LIMIT];
+int i, k, m;
+int error;
+
+	if (PFinvalidFd(fd)){
+		PFerrno= PFE_FD;
+		return(PFerrno);
+	}
+	fd = PFdtab[fd];	/* from here on, the file table entry */
+	size = PFpagesize(fd);
+
+	for (i=0; i < n; i++){
+		if (PFinvalidPagenum(fd,pagenum+i)){
+			PFerrno = PFE_INVALIDPAGE;
+			return(PFerrno);
+		}
+		if (PFhashFind(fd,pagenum+i) != NULL){
+			PFerrno = PFE_PAGEINBUF;
+			return(PFerrno);
+		}
+	}
+
+	m = (n < PF_MAX_BUFS_LIMIT)? n : PF_MAX_BUFS_LIMIT;
+	if ((stage=malloc((size_t)m*PFfpageSize(size))) == NULL){
+		PFerrno = PFE_NOMEM;
+		return(PFerrno);
+	}
+	for (i=0; i < n; i += k){
+		for (k=0; k < m && i+k < n; k++){
+			fpages[k] = (PFfpage *)(stage + k*PFfpageSize(size));
+			fpages[k]->nextfree = PF_PAGE_USED;
+			memcpy(fpages[k]->pagebuf,pagebufs[i+k],size);
+			pagenums[k] = pagenum+i+k;
+			PFzcacheDrop(fd,pagenum+i+k);
+		}
+		if ((error=PFwritevfcn(fd,pagenums,fpages,k)) != PFE_OK){
+			free(stage);
+			return(error);
+		}
+	}
+	free(stage);
+	return(PFE_OK);
+}
+
 int PF_DisposePage(fd,pagenum)
 int fd;		/* file descriptor */
 int pagenum;	/* page number */
 /****************************************************************************
 SPECIFICATIONS:
 	Dispose the page numbered "pagenum" of the file "fd".
-	Only a page that is not fixed in the buffer can be disposed.
+	Only a page that is not fixed in the buffer, through any
+	descriptor of the file, can be disposed.
 
 AUTHOR: clc
 
@@ -685,12 +2406,15 @@ RETURN VALUE:
 *****************************************************************************/
 {
 PFfpage *fpage;	/* pointer to file page */
+PFbpage *bpage;	/* its buffer page */
 int error;
+int desc = fd;	/* descriptor to fix the page through */
 
 	if (PFinvalidFd(fd)){
 		PFerrno = PFE_FD;
 		return(PFerrno);
 	}
+	fd = PFdtab[fd];	/* from here on, the file table entry */
 
 	if (PFinvalidPagenum(fd,pagenum)){
 		PFerrno = PFE_INVALIDPAGE;
@@ -700,13 +2424,20 @@ int error;
 	 /* disposing (logically deleting) a page -> logical write */
     PF_stats.logicalWrites++;
 
-	if ((error=PFbufGet(fd,pagenum,&fpage,PFreadfcn,PFwritefcn))!= PFE_OK)
+	if ((bpage=PFhashFind(fd,pagenum)) != NULL && bpage->fixcnt > 0){
+		/* fixed, maybe through another descriptor */
+		PFerrno = PFE_PAGEFIXED;
+		return(PFerrno);
+	}
+
+	if ((error=PFbufGet(fd,desc,pagenum,PFpagesize(fd),&fpage,
+				PFreadfcn,PFwritefcn))!= PFE_OK)
 		/* can't get this page */
 		return(error);
 	
 	if (fpage->nextfree != PF_PAGE_USED){
 		/* this page already freed */
-		if (PFbufUnfix(fd,pagenum,FALSE)!= PFE_OK){
+		if (PFbufUnfix(fd,desc,pagenum,FALSE)!= PFE_OK){
 			printf("internal error: PFdispose()\n");
 			exit(1);
 		}
@@ -717,10 +2448,12 @@ int error;
 	/* put this page into the free list */
 	fpage->nextfree = PFftab[fd].hdr.firstfree;
 	PFftab[fd].hdr.firstfree = pagenum;
+	PFmapSetFree(PFftab[fd],pagenum);
+	PFftab[fd].hdr.numused--;
 	PFftab[fd].hdrchanged = TRUE;
 
 	/* unfix this page */
-	return(PFbufUnfix(fd,pagenum,TRUE));
+	return(PFbufUnfix(fd,desc,pagenum,TRUE));
 }
 
 int PF_UnfixPage(fd,pagenum,dirty)
@@ -730,7 +2463,8 @@ int dirty;	/* true if file is dirty */
 /****************************************************************************
 SPECIFICATIONS:
 	Tell the Paged File Interface that the page numbered "pagenum"
-	of the file "fd" is no longer needed in the buffer.
+	of the file "fd" is no longer needed in the buffer. The page
+	stays fixed while other descriptors of the file have it fixed.
 	Set the variable "dirty" to TRUE if page has been modified.
 
 AUTHOR: clc
@@ -741,11 +2475,13 @@ RETURN VALUE:
 
 *****************************************************************************/
 {
+int desc = fd;	/* descriptor the page was fixed through */
 
 	if (PFinvalidFd(fd)){
 		PFerrno = PFE_FD;
 		return(PFerrno);
 	}
+	fd = PFdtab[fd];	/* from here on, the file table entry */
 
 	if (PFinvalidPagenum(fd,pagenum)){
 		PFerrno = PFE_INVALIDPAGE;
@@ -755,7 +2491,73 @@ RETURN VALUE:
         PF_stats.logicalWrites++;   // count a logical write: page modified by a query
     }
 
-	return(PFbufUnfix(fd,pagenum,dirty));
+	return(PFbufUnfix(fd,desc,pagenum,dirty));
+}
+
+int PF_GetChildPage(fd,pagenum,slot,childnum,pagebuf)
+int fd;		/* file descriptor */
+int pagenum;	/* fixed page to go down from */
+int slot;	/* # of the pointer to the child in page "pagenum" */
+int childnum;	/* page number of the child */
+char **pagebuf;	/* pointer to pointer to page data */
+/****************************************************************************
+SPECIFICATIONS:
+	Go down one level of a tree of pages: unfix page "pagenum",
+	which must not have been modified, and get page "childnum",
+	found through pointer number "slot" of page "pagenum", as
+	PF_GetThisPage() would. It is the same as PF_UnfixPage(fd,
+	pagenum,FALSE) followed by PF_GetThisPage(fd,childnum,pagebuf),
+	but while both pages stay in the buffer, later descents through
+	the same slot find the child through a swizzled reference kept
+	with the parent's buffer page, without a hash table lookup.
+
+RETURN VALUE:
+	As PF_GetThisPage(). Page "pagenum" is unfixed unless the
+	error is PFE_PAGENOTINBUF or PFE_PAGEUNFIXED.
+*****************************************************************************/
+{
+int error;
+PFfpage *fpage;
+int desc = fd;	/* descriptor the pages are fixed through */
+
+	if (PFinvalidFd(fd)){
+		PFerrno = PFE_FD;
+		return(PFerrno);
+	}
+	fd = PFdtab[fd];	/* from here on, the file table entry */
+
+	if (PFinvalidPagenum(fd,pagenum) || PFinvalidPagenum(fd,childnum)){
+		PFerrno = PFE_INVALIDPAGE;
+		return(PFerrno);
+	}
+	PF_stats.logicalReads++;
+
+	if (!PFmapIsUsed(PFftab[fd],childnum)){
+		/* free page: no need to read it to find out */
+		if ((error=PFbufUnfix(fd,desc,pagenum,FALSE)) != PFE_OK)
+			return(error);
+		PFerrno = PFE_INVALIDPAGE;
+		return(PFerrno);
+	}
+
+	if ((error=PFbufGetChild(fd,desc,pagenum,slot,childnum,PFpagesize(fd),
+			&fpage,PFreadfcn,PFwritefcn))!= PFE_OK){
+		if (error== PFE_PAGEFIXED)
+			*pagebuf = fpage->pagebuf;
+		return(error);
+	}
+
+	if (fpage->nextfree != PF_PAGE_USED){
+		/* invalid page */
+		if (PFbufUnfix(fd,desc,childnum,FALSE)!= PFE_OK){
+			printf("internal error:PF_GetChildPage()\n");
+			exit(1);
+		}
+		PFerrno = PFE_INVALIDPAGE;
+		return(PFerrno);
+	}
+	*pagebuf = (char *)fpage->pagebuf;
+	return(PFE_OK);
 }
 
 /* error messages */
@@ -779,7 +2581,11 @@ static char *PFerrormsg[]={
 "page already unfixed",
 "new page to be allocated already in buffer",
 "hash table entry not found",
-"page already in hash table"
+"page already in hash table",
+"file has as many pages as can be numbered",
+"not a paged file",
+"invalid page size",
+"page data on disk cannot be decoded"
 };
 
 void PF_PrintError(s)
@@ -32,13 +32,33 @@
 #define PFE_HASHNOTFOUND -18	/* hash table entry not found */
 #define PFE_HASHPAGEEXIST -19	/* page already exist in hash table */
 
+#define PFE_FILEFULL	-20	/* file has as many pages as can be numbered */
+#define PFE_NOTPF	-21	/* file header is not a paged file header */
+#define PFE_PAGESIZE	-22	/* invalid page size */
+#define PFE_CORRUPT	-23	/* page data on disk cannot be decoded */
 
-/* page size */
+
+/* page size: PF_PAGE_SIZE unless another is chosen when the file is
+created. Must be a power of 2 between PF_MIN_PAGE_SIZE and PF_MAX_PAGE_SIZE */
 #define PF_PAGE_SIZE	4096
+#define PF_MIN_PAGE_SIZE	4096
+#define PF_MAX_PAGE_SIZE	65536
+
+/* File options chosen at creation (PF_CreateFileOpt) */
+#define PF_FILE_COMPRESSED	1	/* pages are stored compressed */
+#define PF_FILE_SHADOW		2	/* pages are copied on write, and
+					PF_FlushFile() commits atomically */
 
 /* Replacement policies (we are using binaries to define the scheme) */
 #define PF_REPL_LRU 0
 #define PF_REPL_MRU 1
+#define PF_REPL_CFLRU 2	/* LRU, but evict clean pages first from the
+			PF_SetCFLRUWindow() least recently used pages */
+
+/* File growth: pages are reserved on disk PF_extentPages at a time
+(1 means no preallocation) */
+#define PF_DEFAULT_EXTENT 32
+#define PF_MAX_EXTENT 1024
 
 /* externs from the PF layer */
 extern int PFerrno;		/* error number of last error */
@@ -47,18 +67,50 @@ extern void PF_PrintError(char *s);
 
 /* Add these missing prototypes */
 int PF_CreateFile(char *fname);
+int PF_CreateFileSized(char *fname, int pagesize);
+int PF_CreateFileOpt(char *fname, int pagesize, int flags);
 int PF_DestroyFile(char *fname);
 int PF_OpenFile(char *fname);
 int PF_CloseFile(int fd);
 int PF_AllocPage(int fd, int *pagenum, char **pagebuf);
 int PF_DisposePage(int fd, int pagenum);
+/* Bulk loading: allocate a run of pages at the end of the file, and
+write pages straight to the file, bypassing the buffer pool */
+int PF_AllocPages(int fd, int n, int *firstpage);
+int PF_WritePages(int fd, int pagenum, int n, char *pagebufs[]);
 int PF_GetThisPage(int fd, int pagenum, char **pagebuf);
 int PF_UnfixPage(int fd, int pagenum, int dirty);
+int PF_GetChildPage(int fd, int pagenum, int slot, int childnum,
+                    char **pagebuf);
+int PF_GetFirstPage(int fd, int *pagenum, char **pagebuf);
 int PF_GetNextPage(int fd, int *pagenum, char **pagebuf);
+int PF_NumUsedPages(int fd);
+int PF_NumPages(int fd);
+int PF_GetPageSize(int fd);
 void PF_ResetStats();
 void PF_PrintStats();
 void PF_SetReplacementPolicy(int policy);
 void PF_SetBufferSize(int size);
+void PF_SetExtentSize(int npages);
+
+/* Byte budget of the compressed cache of pages evicted from the buffer
+pool (zcache.c); 0, the default, turns it off */
+extern long PF_zcacheBytes;
+void PF_SetZCacheSize(long bytes);
+
+/* TRUE (the default) if PF_GetChildPage() keeps swizzled references
+from a buffered page to its resident child pages */
+extern int PF_swizzle;
+void PF_SetSwizzle(int on);
+
+/* Durability: write back dirty pages and fdatasync(). Concurrent
+callers are merged into group commits. Threads hold PF_Lock() around
+all other PF calls but PF_CloseFile(), which waits for running
+flushes of the file. */
+int PF_FlushFile(int fd);
+int PF_Sync(void);
+void PF_Lock(void);
+void PF_Unlock(void);
 
 /* Statistics for PF layer */
 
@@ -70,6 +122,10 @@ typedef struct {
     int logicalWrites;
     int physicalReads;
     int physicalWrites;
+    int syncs;          /* fdatasync() calls made by PF_FlushFile/PF_Sync */
+    int zcacheHits;     /* reads served by the compressed page cache */
+    int writeCalls;     /* write system calls that wrote page data */
+    int swizzleHits;    /* PF_GetChildPage() calls that skipped the hash */
 } PF_Stats;
 
 /* global stats object */
@@ -81,6 +137,10 @@ extern PF_Stats PF_stats;
 extern int PF_replacementPolicy;
 /* API to change the replacement policy */
 void PF_SetReplacementPolicy(int policy);
+/* # of least recently used buffers PF_REPL_CFLRU looks in for a clean
+victim; 0 (the default) means half the buffer pool */
+extern int PF_cflruWindow;
+void PF_SetCFLRUWindow(int n);
 /* stats API */
 extern void PF_ResetStats();
 extern void PF_PrintStats();
@@ -14,7 +14,8 @@ with open("pf_stats.csv", newline="") as f:
         row["physicalWrites"] = int(row["physicalWrites"])
         stats.append(row)
 
-policies = sorted(set(r["policy"] for r in stats))
+# policies in the order pfbench ran them (LRU, MRU, CFLRU)
+policies = list(dict.fromkeys(r["policy"] for r in stats))
 
 def filter_policy(policy):
     return [r for r in stats if r["policy"] == policy]
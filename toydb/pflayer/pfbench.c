@@ -1,10 +1,14 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include "pf.h"
 
 #define NUM_PAGES 50       // how many pages we keep in the file
 #define NUM_OPS   1000     // how many operations per experiment
+#define CSV_FILE  "pf_stats.csv"  // input of pf_plot.py
+
+static FILE *csv;
 
 void run_experiment(const char *label, int policy, int writePercent);
 
@@ -14,6 +18,13 @@ int main() {
 
     srand(time(NULL));
 
+    if ((csv = fopen(CSV_FILE, "w")) == NULL) {
+        perror(CSV_FILE);
+        return 1;
+    }
+    fprintf(csv, "policy,write_pct,read_pct,logicalReads,logicalWrites,"
+                 "physicalReads,physicalWrites\n");
+
     // LRU experiments
     run_experiment("LRU 0W/100R",   PF_REPL_LRU, 0);
     run_experiment("LRU 25W/75R",   PF_REPL_LRU, 25);
@@ -28,6 +39,15 @@ int main() {
     run_experiment("MRU 75W/25R",   PF_REPL_MRU, 75);
     run_experiment("MRU 100W/0R",   PF_REPL_MRU, 100);
 
+    // CFLRU experiments (default window: half the pool)
+    run_experiment("CFLRU 0W/100R",   PF_REPL_CFLRU, 0);
+    run_experiment("CFLRU 25W/75R",   PF_REPL_CFLRU, 25);
+    run_experiment("CFLRU 50W/50R",   PF_REPL_CFLRU, 50);
+    run_experiment("CFLRU 75W/25R",   PF_REPL_CFLRU, 75);
+    run_experiment("CFLRU 100W/0R",   PF_REPL_CFLRU, 100);
+
+    fclose(csv);
+    printf("\nWrote %s\n", CSV_FILE);
     return 0;
 }
 
@@ -102,6 +122,12 @@ void run_experiment(const char *label, int policy, int writePercent) {
     printf("\n=== %s ===\n", label);
     PF_PrintStats();
 
+    // the policy name is the first word of the label
+    fprintf(csv, "%.*s,%d,%d,%d,%d,%d,%d\n",
+            (int)strcspn(label, " "), label, writePercent, 100 - writePercent,
+            PF_stats.logicalReads, PF_stats.logicalWrites,
+            PF_stats.physicalReads, PF_stats.physicalWrites);
+
     if (PF_CloseFile(fd) != PFE_OK) {
         PF_PrintError("PF_CloseFile");
         return;
@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include "pf.h"
+
+#define COMMIT_FILE "commit.pf"
+#define MAX_THREADS 64
+
+/*
+ * Commit benchmark: "nthreads" committers each update their own page
+ * of one file and call PF_FlushFile() to make the update durable, as
+ * a transaction commit would. Reports commit throughput, commit
+ * latency, and how many commits each fdatasync() covered.
+ */
+
+static int fd;
+static int commitsPerThread;
+static double *latencies;	/* ms, one per commit */
+
+static double now_ms(void) {
+    struct timeval t;
+    gettimeofday(&t, NULL);
+    return t.tv_sec * 1000.0 + t.tv_usec / 1000.0;
+}
+
+static void *committer(void *arg) {
+    int id = (int)(long)arg;
+    char *buf;
+
+    for (int i = 0; i < commitsPerThread; i++) {
+        PF_Lock();
+        if (PF_GetThisPage(fd, id, &buf) != PFE_OK) {
+            PF_PrintError("PF_GetThisPage");
+            exit(1);
+        }
+        sprintf(buf, "thread %d commit %d", id, i);
+        PF_UnfixPage(fd, id, TRUE);
+        PF_Unlock();
+
+        double t = now_ms();
+        if (PF_FlushFile(fd) != PFE_OK) {
+            PF_PrintError("PF_FlushFile");
+            exit(1);
+        }
+        latencies[id * commitsPerThread + i] = now_ms() - t;
+    }
+    return NULL;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double d = *(const double *)a - *(const double *)b;
+    return (d > 0) - (d < 0);
+}
+
+static void run(int nthreads) {
+    pthread_t tids[MAX_THREADS];
+    int n = nthreads * commitsPerThread;
+
+    latencies = malloc(n * sizeof(double));
+    PF_ResetStats();
+    double t1 = now_ms();
+    for (long i = 0; i < nthreads; i++)
+        pthread_create(&tids[i], NULL, committer, (void *)i);
+    for (int i = 0; i < nthreads; i++)
+        pthread_join(tids[i], NULL);
+    double ms = now_ms() - t1;
+
+    double sum = 0;
+    for (int i = 0; i < n; i++)
+        sum += latencies[i];
+    qsort(latencies, n, sizeof(double), cmp_double);
+    printf("%8d %8d %12.0f %10.3f %10.3f %10.3f %8d %10.1f\n",
+           nthreads, n, n / (ms / 1000.0), sum / n,
+           latencies[n / 2], latencies[(int)(n * 0.99)],
+           PF_stats.syncs, (double)n / PF_stats.syncs);
+    free(latencies);
+}
+
+int main(int argc, char *argv[]) {
+    char *buf;
+    int pagenum;
+
+    commitsPerThread = (argc > 1) ? atoi(argv[1]) : 50;
+
+    PF_Init();
+    PF_SetBufferSize(100);     /* the largest pool allowed */
+    PF_DestroyFile(COMMIT_FILE);
+    if (PF_CreateFile(COMMIT_FILE) != PFE_OK ||
+            (fd = PF_OpenFile(COMMIT_FILE)) < 0) {
+        PF_PrintError("create " COMMIT_FILE);
+        return 1;
+    }
+    /* one page per committer */
+    for (int i = 0; i < MAX_THREADS; i++) {
+        if (PF_AllocPage(fd, &pagenum, &buf) != PFE_OK) {
+            PF_PrintError("PF_AllocPage");
+            return 1;
+        }
+        memset(buf, 0, PF_PAGE_SIZE);
+        PF_UnfixPage(fd, pagenum, TRUE);
+    }
+    PF_FlushFile(fd);
+
+    printf("%d commits per committer\n", commitsPerThread);
+    printf("%8s %8s %12s %10s %10s %10s %8s %10s\n",
+           "threads", "commits", "commits/s", "avg ms", "p50 ms",
+           "p99 ms", "syncs", "per sync");
+    if (argc > 2) {
+        for (int i = 2; i < argc; i++) {
+            int n = atoi(argv[i]);
+            if (n >= 1 && n <= MAX_THREADS)
+                run(n);
+        }
+    } else {
+        for (int n = 1; n <= MAX_THREADS; n *= 2)
+            run(n);
+    }
+
+    PF_CloseFile(fd);
+    PF_DestroyFile(COMMIT_FILE);
+    return 0;
+}
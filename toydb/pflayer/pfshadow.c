@@ -0,0 +1,209 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include "pf.h"
+
+#define SHADOW_FILE "shadow.pf"
+#define SEED 12345
+
+/*
+ * Shadow paging benchmark. Each round ("commit") updates randomly
+ * chosen pages of a file and calls PF_FlushFile(). Compares an
+ * ordinary file, where the pages are written in place, with a
+ * PF_FILE_SHADOW file, where they are copied on write, reporting
+ * the time and the write calls per commit and the file size.
+ *
+ * Then checks crash consistency: a child process commits rounds on a
+ * shadow file until it is killed with SIGKILL at a random moment, and
+ * the file must then hold exactly the pages of the last commit the
+ * child reported, or of the one after it.
+ */
+
+static int npages, nrounds, nupdates;
+
+static double now_ms(void) {
+    struct timeval t;
+    gettimeofday(&t, NULL);
+    return t.tv_sec * 1000.0 + t.tv_usec / 1000.0;
+}
+
+/* page contents for version "v" of page "p" */
+static void fill(char *buf, int p, int v) {
+    memset(buf, (p + v) & 0xff, PF_PAGE_SIZE);
+    ((int *)buf)[0] = p;
+    ((int *)buf)[1] = v;
+}
+
+static int check(const char *buf, int p, int v) {
+    char expect[PF_PAGE_SIZE];
+    fill(expect, p, v);
+    return memcmp(buf, expect, PF_PAGE_SIZE) == 0;
+}
+
+static int create(int flags) {
+    int fd, pagenum;
+    char *buf;
+
+    PF_DestroyFile(SHADOW_FILE);
+    if (PF_CreateFileOpt(SHADOW_FILE, PF_PAGE_SIZE, flags) != PFE_OK ||
+            (fd = PF_OpenFile(SHADOW_FILE)) < 0) {
+        PF_PrintError("create " SHADOW_FILE);
+        exit(1);
+    }
+    for (int i = 0; i < npages; i++) {
+        if (PF_AllocPage(fd, &pagenum, &buf) != PFE_OK) {
+            PF_PrintError("PF_AllocPage");
+            exit(1);
+        }
+        fill(buf, pagenum, 0);
+        PF_UnfixPage(fd, pagenum, TRUE);
+    }
+    if (PF_FlushFile(fd) != PFE_OK) {
+        PF_PrintError("PF_FlushFile");
+        exit(1);
+    }
+    return fd;
+}
+
+/* commit "round": update the pages chosen by the rng, then flush */
+static void commit(int fd, int round, unsigned *seed, int *version) {
+    char *buf;
+
+    for (int i = 0; i < nupdates; i++) {
+        int p = rand_r(seed) % npages;
+        if (PF_GetThisPage(fd, p, &buf) != PFE_OK) {
+            PF_PrintError("PF_GetThisPage");
+            exit(1);
+        }
+        fill(buf, p, round);
+        PF_UnfixPage(fd, p, TRUE);
+        if (version)
+            version[p] = round;
+    }
+    if (PF_FlushFile(fd) != PFE_OK) {
+        PF_PrintError("PF_FlushFile");
+        exit(1);
+    }
+}
+
+static void bench(const char *name, int flags) {
+    unsigned seed = SEED;
+    struct stat st;
+    int fd = create(flags);
+
+    PF_ResetStats();
+    double t = now_ms();
+    for (int r = 1; r <= nrounds; r++)
+        commit(fd, r, &seed, NULL);
+    double ms = now_ms() - t;
+    int writeCalls = PF_stats.writeCalls, syncs = PF_stats.syncs;
+    PF_CloseFile(fd);
+    stat(SHADOW_FILE, &st);
+
+    printf("%-8s %12.3f %12.1f %12.1f %12.1f %10.2f\n", name, ms / nrounds,
+           (double)writeCalls / nrounds, (double)syncs / nrounds,
+           (double)PF_stats.physicalWrites / nrounds,
+           st.st_size / 1048576.0);
+    PF_DestroyFile(SHADOW_FILE);
+}
+
+/* kill a committing child at a random moment, then check the file */
+static int crash_test(int trial) {
+    int pipefd[2], c = 0, n;
+    pid_t pid;
+
+    PF_CloseFile(create(PF_FILE_SHADOW));
+    pipe(pipefd);
+    if ((pid = fork()) == 0) {
+        unsigned seed = SEED + trial;
+        int fd = PF_OpenFile(SHADOW_FILE);
+        close(pipefd[0]);
+        for (int r = 1; ; r++) {
+            commit(fd, r, &seed, NULL);
+            write(pipefd[1], &r, sizeof(r));
+        }
+    }
+    close(pipefd[1]);
+    read(pipefd[0], &c, sizeof(c));     /* let it get going */
+    usleep(rand() % 20000);
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+    while (read(pipefd[0], &n, sizeof(n)) == sizeof(n))
+        c = n;
+    close(pipefd[0]);
+
+    /* replay commits 1..c, and c+1 in a copy */
+    int *version = calloc(npages, sizeof(int));
+    int *next = malloc(npages * sizeof(int));
+    unsigned seed = SEED + trial;
+    int fd, bad = 0, badnext = 0;
+    char *buf;
+    for (int r = 1; r <= c + 1; r++) {
+        if (r == c + 1)
+            memcpy(next, version, npages * sizeof(int));
+        for (int i = 0; i < nupdates; i++) {
+            int p = rand_r(&seed) % npages;
+            (r <= c ? version : next)[p] = r;
+        }
+    }
+
+    if ((fd = PF_OpenFile(SHADOW_FILE)) < 0) {
+        PF_PrintError("reopen after crash");
+        return 0;
+    }
+    for (int p = 0; p < npages; p++) {
+        if (PF_GetThisPage(fd, p, &buf) != PFE_OK) {
+            PF_PrintError("PF_GetThisPage after crash");
+            return 0;
+        }
+        bad += !check(buf, p, version[p]);
+        badnext += !check(buf, p, next[p]);
+        PF_UnfixPage(fd, p, FALSE);
+    }
+    PF_CloseFile(fd);
+    PF_DestroyFile(SHADOW_FILE);
+    free(version);
+    free(next);
+
+    printf("crash %2d: killed after commit %d: %s\n", trial, c,
+           bad == 0 ? "file is at that commit" :
+           badnext == 0 ? "file is at the next commit" : "INCONSISTENT");
+    return bad == 0 || badnext == 0;
+}
+
+int main(int argc, char *argv[]) {
+    int trials;
+
+    npages = (argc > 1) ? atoi(argv[1]) : 2000;
+    nrounds = (argc > 2) ? atoi(argv[2]) : 50;
+    nupdates = (argc > 3) ? atoi(argv[3]) : 100;
+    trials = (argc > 4) ? atoi(argv[4]) : 10;
+    if (npages < 1 || nrounds < 1 || nupdates < 1) {
+        fprintf(stderr,
+            "Usage: %s [pages] [commits] [updatesPerCommit] [crashTrials]\n",
+            argv[0]);
+        return 1;
+    }
+
+    PF_Init();
+    PF_SetBufferSize(100);     /* the largest pool allowed */
+
+    printf("%d pages, %d commits of %d random page updates\n",
+           npages, nrounds, nupdates);
+    printf("%-8s %12s %12s %12s %12s %10s\n", "file", "ms/commit",
+           "writes/cmt", "syncs/cmt", "pages/cmt", "size MB");
+    bench("inplace", 0);
+    bench("shadow", PF_FILE_SHADOW);
+
+    int ok = 0;
+    srand(SEED);
+    for (int t = 1; t <= trials; t++)
+        ok += crash_test(t);
+    printf("%d of %d crashes left a consistent file\n", ok, trials);
+    return ok == trials ? 0 : 1;
+}
@@ -3,41 +3,147 @@
 #ifndef PFTYPES_H
 #define PFTYPES_H
 
+#include <sys/types.h>
+
 #ifndef PF_PAGE_SIZE
 #define PF_PAGE_SIZE 4096
 #endif
 
 /**************************** File Page Decls *********************/
-/* Each file contains a header, which is a integer pointing
-to the first free page, or -1 if no more free pages in the file.
-Followed by this header are the file pages as declared in struct PFfpage */
+/* Each file starts with a header, which holds a integer pointing
+to the first free page, or -1 if no more free pages in the file, and
+a bitmap recording which pages are in use. The header occupies the
+first PF_HDR_SIZE bytes of the file.
+Followed by this header are the file pages as declared in struct PFfpage.
+The bitmap in the header covers the first PF_MAP_PAGES pages. The rest
+of it, for a larger file, is kept in memory while the file is open, and
+written with the header to the place "mapoff" points to. */
+#define PF_HDR_MAGIC	0x50463031	/* "PF01": identifies a paged file */
+#define PF_HDR_SIZE	4096	/* bytes reserved for the file header */
+#define PF_MAP_SIZE	3968	/* bytes of page-occupancy bitmap in header */
+#define PF_MAP_PAGES	(PF_MAP_SIZE*8)	/* # of pages it covers */
+
 typedef struct PFhdr_str {
 	int	firstfree;	/* first free page in the linked list of
 				free pages */
 	int	numpages;	/* # of pages in the file */
+	int	magic;		/* PF_HDR_MAGIC */
+	int	numused;	/* # of used pages (bits set in usedmap) */
+	int	allocpages;	/* # of pages for which disk space has been
+				allocated; >= numpages */
+	int	pagesize;	/* size of the page data, chosen at creation */
+	int	flags;		/* PF_FILE_xxx options chosen at creation */
+	long long dataend;	/* compressed files: end of the page data */
+	long long ptmapoff;	/* compressed files: offset of the page
+				translation map, or 0 if none written */
+	unsigned char usedmap[PF_MAP_SIZE]; /* bit i set iff page i is used */
+	/* added after usedmap, so older files read them as 0 */
+	unsigned int seq;	/* shadow files: # of commits */
+	unsigned int cksum;	/* shadow files: checksum of the header */
+	int	ptmapcap;	/* shadow files: bytes of space at ptmapoff */
+	long long mapoff;	/* files of more than PF_MAP_PAGES pages:
+				offset of the rest of the occupancy map */
 } PFhdr_str;
 
-#define PF_HDR_SIZE sizeof(PFhdr_str)	/* size of file header */
-
-/* actual page struct to be written onto the file */
+/* Files written before the header above was added start with just its
+first two fields, firstfree and numpages, and their pages of
+PF_PAGE_SIZE bytes follow at once. Such a file is opened as it is and
+kept in that format: the other header fields are set up in memory, and
+the occupancy map by reading the start of each page once. */
+#define PF_OLD_HDR_SIZE	(2*sizeof(int))	/* bytes of header they have */
+#define PF_FILE_OLDHDR	0x100	/* hdr.flags, in memory only: a file
+				with a header of that format */
+
+/* operations on the page-occupancy bitmap of open file table entry
+"ft": in its header for the first PF_MAP_PAGES pages, in its maptail
+for the others */
+#define PFmapByte(ft,p)	(*(((p) < PF_MAP_PAGES)? &(ft).hdr.usedmap[(p)>>3] : \
+				&(ft).maptail[((p)>>3)-PF_MAP_SIZE]))
+#define PFmapIsUsed(ft,p)	(PFmapByte(ft,p) & (1 << ((p)&7)))
+#define PFmapSetUsed(ft,p)	(PFmapByte(ft,p) |= (1 << ((p)&7)))
+#define PFmapSetFree(ft,p)	(PFmapByte(ft,p) &= ~(1 << ((p)&7)))
+
+/* # of bytes of occupancy map past the header for "n" pages */
+#define PFmapTailSize(n) \
+	(((n) > PF_MAP_PAGES)? ((n)+7)/8 - PF_MAP_SIZE : 0)
+
+/* actual page struct to be written onto the file. The page data
+is "pagesize" bytes long, as recorded in the file header */
 #define PF_PAGE_LIST_END	-1	/* end of list of free pages */
 #define PF_PAGE_USED		-2	/* page is being used */
 typedef struct PFfpage {
 	int nextfree;	/* page number of next free page in the linked
 			list of free pages, or PF_PAGE_LIST_END if
 			end of list, or PF_PAGE_USED if this page is not free */
-	char pagebuf[PF_PAGE_SIZE];	/* actual page data */
+	char pagebuf[];	/* actual page data */
 } PFfpage;
 
+/* bytes taken by a page with "pagesize" bytes of data */
+#define PFfpageSize(pagesize)	(sizeof(PFfpage)+(pagesize))
+
+/* Pages of a compressed file (PF_FILE_COMPRESSED) are stored with
+variable sizes after the header, so a page translation map records
+where each page is. The map is written after the page data when the
+file is closed, and the header points to it. Space given up by pages
+that outgrow it is kept in a list of holes while the file is open,
+and found again from the map when the file is opened. */
+#define PF_ZALIGN	64	/* space for a page is allocated in
+				multiples of this */
+
+/* Shadow files (PF_FILE_SHADOW) use the same map, and never overwrite
+a page, or the map, that the last commit points to. A commit writes
+the map to new space and then the header to whichever of two header
+slots, at 0 and PF_HDR_SIZE, the previous commit did not use. The slot
+with a valid checksum and the higher "seq" is the one read on open. */
+#define PF_FILE_MAPPED	(PF_FILE_COMPRESSED|PF_FILE_SHADOW)
+#define PFdataStart(flags) \
+	(((flags) & PF_FILE_SHADOW)? 2*PF_HDR_SIZE : PF_HDR_SIZE)
+
+typedef struct PFpgloc {
+	long long off;	/* offset of the page in the unix file */
+	int	len;	/* # of bytes stored; PFfpageSize(pagesize) if the
+			page is stored uncompressed, 0 if never written */
+	int	cap;	/* # of bytes of space allocated at "off" */
+} PFpgloc;
+
 /*************************** Opened File Table **********************/
-#define PF_FTAB_SIZE	20	/* size of open file table */
+/* The open file table has one entry per open unix file, found by its
+device and inode through a hash table. A file opened more than once
+gets one descriptor per open, and the descriptors share the entry,
+and so the buffer pages of the file. Descriptors index PFdtab[],
+which gives the PFftab[] entry they use; the buffer pool is keyed by
+the PFftab[] index. Both tables grow as files are opened. */
+#define PF_FTAB_SIZE	20	/* initial size of the open file tables */
 
 /* open file table entry */
 typedef struct PFftab_ele {
 	char *fname;	/* file name, or NULL if entry not used */
 	int unixfd;	/* unix file descriptor*/
+	dev_t dev;	/* device and inode of the unix file */
+	ino_t ino;
+	int refcnt;	/* # of descriptors using this entry */
+	int hashnext;	/* next entry in the same hash chain, or -1 */
+	long syncticket; /* # of flushes that asked for an fdatasync() */
+	long syncdone;	/* # of them known to be durable */
+	short syncing;	/* TRUE while a flush runs fdatasync() */
+	short flushers;	/* # of flushes waiting for an fdatasync() */
 	PFhdr_str hdr;	/* file header */
 	short hdrchanged; /* TRUE if file header has changed */
+	unsigned char *maptail;	/* occupancy map of the pages past the
+			first PF_MAP_PAGES, or NULL */
+	int maptailsize; /* # of bytes allocated in maptail */
+	PFpgloc *ptmap;	/* compressed files: page translation map */
+	int ptmapsize;	/* # of entries allocated in ptmap */
+	PFpgloc *holes;	/* compressed files: unused space before
+			hdr.dataend, as (off,cap) pairs */
+	int nholes;	/* # of entries used in holes */
+	int holesize;	/* # of entries allocated in holes */
+	PFpgloc *pending; /* shadow files: space the last commit points to
+			but the next one will not; holes once it is made */
+	int npending;	/* # of entries used in pending */
+	int pendingsize; /* # of entries allocated in pending */
+	unsigned char *fresh; /* shadow files: TRUE for each page written
+			to new space since the last commit, ptmapsize of them */
 } PFftab_ele;
 
 /************************** Buffer Page Decls *********************/
@@ -53,11 +159,22 @@ typedef struct PFbpage {
 					buffer page */
 	struct PFbpage *prevpage;	/* previous in the linked list
 					of buffer pages */
-	short	dirty:1,		/* TRUE if page is dirty */
-		fixed:1;		/* TRUE if page is fixed in buffer*/
+	short	dirty:1;		/* TRUE if page is dirty */
+	short	fixcnt;			/* # of descriptors that have the
+					page fixed in the buffer */
+	int	*fixdesc;		/* those descriptors, fixcnt of them */
+	int	fixsize;		/* # of entries allocated in fixdesc */
 	int	page;			/* page number of this page */
 	int	fd;			/* file desciptor of this page */
-	PFfpage fpage; /* page data from the file */
+	int	size;			/* page size of this buffer */
+	PFfpage *fpage; /* page data from the file, "size" bytes of data */
+	struct PFbpage **swiz;	/* swizzled references: the buffer page
+				of the child in each slot of this page, or
+				NULL, set by PF_GetChildPage() */
+	int	nswiz;		/* # of entries allocated in swiz */
+	struct PFbpage *swizparent; /* page whose swiz[] points to this
+				page, or NULL */
+	int	swizslot;	/* the slot of swizparent->swiz[] */
 } PFbpage;
 
 
@@ -77,6 +194,34 @@ typedef struct PFhash_entry {
 /* Hash function for hash table */
 #define PFhash(fd,page) (((fd)+(page)) % PF_HASH_TBL_SIZE)
 
+/******************** Compressed Page Cache Decls *****************/
+#define PF_ZCACHE_HASH_SIZE	1024	/* size of its hash table */
+
+/* a compressed page kept by zcache.c */
+typedef struct PFzcache_entry {
+	struct PFzcache_entry *next;	/* next in LRU order, or NULL */
+	struct PFzcache_entry *prev;	/* previous in LRU order, or NULL */
+	struct PFzcache_entry *hashnext; /* next in hash chain, or NULL */
+	int fd;		/* file descriptor */
+	int page;	/* page number */
+	int len;	/* # of bytes in data; PFfpageSize(pagesize) if the
+			page did not compress */
+	unsigned char data[];	/* the compressed page */
+} PFzcache_entry;
+
+#define PFzcacheHash(fd,page) \
+	((int)(((unsigned)(fd)*31 + (unsigned)(page)) % PF_ZCACHE_HASH_SIZE))
+
+/******************* Interface functions from the page codec *************/
+extern int PFlzCompress();
+extern int PFlzDecompress();
+
+/************** Interface functions from the compressed page cache **********/
+extern void PFzcachePut();
+extern int PFzcacheGet();
+extern void PFzcacheDrop();
+extern void PFzcacheDropFile();
+
 /******************* Interface functions from Hash Table ****************/
 extern void PFhashInit();
 extern PFbpage *PFhashFind();
@@ -88,7 +233,10 @@ extern int PFhashPrint();
 extern int PFbufGet();
 extern int PFbufUnfix();
 extern int PFbufAlloc();
+extern int PFbufDescFixed();
 extern int PFbufReleaseFile();
+extern int PFbufFlushFile();
+extern int PFbufGetChild();
 extern int PFbufUsed();
 
 #endif
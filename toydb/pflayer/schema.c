@@ -0,0 +1,375 @@
+#include "schema.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+
+#define HF_CATALOG_LINE 4096
+
+/* 10^s for the scales a dec column can have */
+static const long long HF_pow10[] = {
+    1LL, 10LL, 100LL, 1000LL, 10000LL, 100000LL, 1000000LL, 10000000LL,
+    100000000LL, 1000000000LL
+};
+#define HF_MAX_SCALE 9
+
+/* Bytes of the slot of a column in a tuple */
+static int HF_SlotLen(HF_Column *col) {
+    switch (col->type) {
+    case HF_TYPE_CHAR:
+        return col->width;
+    case HF_TYPE_VARCHAR:
+        return 2 * sizeof(unsigned short);
+    default:
+        return sizeof(int);
+    }
+}
+
+/* Longest text of a value of a column */
+static int HF_TextLen(HF_Column *col) {
+    switch (col->type) {
+    case HF_TYPE_INT:
+        return 11;                  // -2147483648
+    case HF_TYPE_DEC:
+        return 12;                  // and a point
+    default:
+        return col->width;
+    }
+}
+
+/*
+ * Parses "name:type" into *col. Returns HFE_OK or HFE_SCHEMA.
+ */
+static int HF_ParseColumn(const char *token, HF_Column *col) {
+    const char *colon = strchr(token, ':');
+    int n = 0;
+    char end;
+
+    if (colon == NULL || colon == token || colon - token >= HF_NAME_LEN) {
+        return HFE_SCHEMA;
+    }
+    memset(col, 0, sizeof(HF_Column));
+    memcpy(col->name, token, colon - token);
+    const char *type = colon + 1;
+
+    if (strcmp(type, "int") == 0) {
+        col->type = HF_TYPE_INT;
+    } else if (sscanf(type, "dec(%d%c", &n, &end) == 2 && end == ')' &&
+               n >= 0 && n <= HF_MAX_SCALE) {
+        col->type = HF_TYPE_DEC;
+        col->scale = n;
+    } else if (sscanf(type, "char(%d%c", &n, &end) == 2 && end == ')' &&
+               n > 0 && n < USHRT_MAX) {
+        col->type = HF_TYPE_CHAR;
+        col->width = n;
+    } else if (sscanf(type, "varchar(%d%c", &n, &end) == 2 && end == ')' &&
+               n > 0 && n < USHRT_MAX) {
+        col->type = HF_TYPE_VARCHAR;
+        col->width = n;
+    } else {
+        return HFE_SCHEMA;
+    }
+    return HFE_OK;
+}
+
+/*
+ * Parses a catalog line into *schema and lays out its tuples.
+ */
+int HF_ParseSchema(const char *decl, HF_Schema *schema) {
+    char buf[HF_CATALOG_LINE];
+    char *token, *save;
+    int error;
+
+    memset(schema, 0, sizeof(HF_Schema));
+    if (strlen(decl) >= sizeof(buf)) {
+        return HFE_SCHEMA;
+    }
+    strcpy(buf, decl);
+
+    // 1. The table name, then the columns
+    if ((token = strtok_r(buf, " \t\r\n", &save)) == NULL ||
+            strlen(token) >= HF_NAME_LEN) {
+        return HFE_SCHEMA;
+    }
+    strcpy(schema->table, token);
+    while ((token = strtok_r(NULL, " \t\r\n", &save)) != NULL) {
+        if (schema->numCols == HF_MAX_COLS) {
+            return HFE_SCHEMA;
+        }
+        if ((error = HF_ParseColumn(token, &schema->cols[schema->numCols])) != HFE_OK) {
+            return error;
+        }
+        schema->numCols++;
+    }
+    if (schema->numCols == 0) {
+        return HFE_SCHEMA;
+    }
+
+    // 2. Lay out the tuple: the bitmap, then the slots
+    int offset = (schema->numCols + 7) / 8;
+    schema->fixed = TRUE;
+    schema->maxText = schema->numCols - 1;     // the ';'s
+    for (int i = 0; i < schema->numCols; i++) {
+        HF_Column *col = &schema->cols[i];
+        col->offset = offset;
+        offset += HF_SlotLen(col);
+        schema->maxText += HF_TextLen(col);
+        if (col->type == HF_TYPE_VARCHAR) {
+            schema->fixed = FALSE;
+            schema->maxLen += col->width;
+        }
+    }
+    schema->tupleLen = offset;
+    schema->maxLen += offset;
+    if (schema->maxLen > USHRT_MAX) {
+        return HFE_SCHEMA;
+    }
+    return HFE_OK;
+}
+
+/*
+ * Finds the line of table "table" in a catalog file and parses it.
+ */
+int HF_LoadSchema(const char *catalogFile, const char *table, HF_Schema *schema) {
+    char line[HF_CATALOG_LINE];
+    int len = strlen(table);
+    FILE *fp;
+
+    if ((fp = fopen(catalogFile, "r")) == NULL) {
+        PFerrno = PFE_UNIX;
+        return PFerrno;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        if (line[0] != '#' && strncmp(line, table, len) == 0 &&
+                isspace((unsigned char)line[len])) {
+            fclose(fp);
+            return HF_ParseSchema(line, schema);
+        }
+    }
+    fclose(fp);
+    return HFE_SCHEMA;
+}
+
+/*
+ * Writes the catalog line of a schema.
+ */
+void HF_FormatSchema(HF_Schema *schema, char *decl, int size) {
+    int n = snprintf(decl, size, "%s", schema->table);
+
+    for (int i = 0; i < schema->numCols && n < size; i++) {
+        HF_Column *col = &schema->cols[i];
+        switch (col->type) {
+        case HF_TYPE_INT:
+            n += snprintf(decl + n, size - n, " %s:int", col->name);
+            break;
+        case HF_TYPE_DEC:
+            n += snprintf(decl + n, size - n, " %s:dec(%d)", col->name, col->scale);
+            break;
+        case HF_TYPE_CHAR:
+            n += snprintf(decl + n, size - n, " %s:char(%d)", col->name, col->width);
+            break;
+        default:
+            n += snprintf(decl + n, size - n, " %s:varchar(%d)", col->name, col->width);
+            break;
+        }
+    }
+}
+
+/*
+ * Parses len bytes of text as a number with "scale" digits after
+ * the point (none for scale 0), into *value times 10^scale. Only the
+ * form HF_DecodeTuple writes is taken, so that text comes back the
+ * same: no '+', no leading zeros, no "-0".
+ */
+static int HF_ParseNum(const char *text, int len, int scale, int *value) {
+    int neg = (len > 0 && text[0] == '-');
+    int i = neg;
+    long long v = 0;
+
+    // Digits before the point
+    int start = i;
+    while (i < len && isdigit((unsigned char)text[i])) {
+        v = v * 10 + (text[i++] - '0');
+        if (v > INT_MAX) {
+            return FALSE;
+        }
+    }
+    if (i == start || (text[start] == '0' && i - start > 1)) {
+        return FALSE;
+    }
+    // Exactly "scale" digits after it
+    if (scale > 0) {
+        if (i == len || text[i++] != '.') {
+            return FALSE;
+        }
+        for (int k = 0; k < scale; k++, i++) {
+            if (i == len || !isdigit((unsigned char)text[i])) {
+                return FALSE;
+            }
+            v = v * 10 + (text[i] - '0');
+        }
+    }
+    if (i != len || v > INT_MAX || (neg && v == 0)) {
+        return FALSE;
+    }
+    *value = (int)(neg ? -v : v);
+    return TRUE;
+}
+
+/*
+ * Encodes a ';'-separated row as a tuple.
+ */
+int HF_EncodeTuple(HF_Schema *schema, const char *text, int textLen, char *tuple) {
+    unsigned char *nulls = (unsigned char*)tuple;
+    int end = schema->tupleLen;     // where the next varchar value goes
+    int pos = 0;
+
+    memset(tuple, 0, schema->tupleLen);
+    for (int i = 0; i < schema->numCols; i++) {
+        HF_Column *col = &schema->cols[i];
+        char *slot = tuple + col->offset;
+
+        // 1. Find the value: up to the next ';'
+        const char *value = text + pos;
+        int len = 0;
+        while (pos + len < textLen && value[len] != ';') {
+            len++;
+        }
+        pos += len + 1;
+        if (len == 0) {
+            nulls[i / 8] |= 1 << (i % 8);
+            continue;
+        }
+
+        // 2. Store it in its slot
+        int v;
+        unsigned short var[2];
+        switch (col->type) {
+        case HF_TYPE_INT:
+        case HF_TYPE_DEC:
+            if (!HF_ParseNum(value, len, col->scale, &v)) {
+                return HFE_BADVALUE;
+            }
+            memcpy(slot, &v, sizeof(int));
+            break;
+        case HF_TYPE_CHAR:
+            if (len > col->width || memchr(value, '\0', len) != NULL) {
+                return HFE_BADVALUE;
+            }
+            memcpy(slot, value, len);
+            break;
+        default:
+            if (len > col->width) {
+                return HFE_BADVALUE;
+            }
+            var[0] = end;
+            var[1] = len;
+            memcpy(slot, var, sizeof(var));
+            memcpy(tuple + end, value, len);
+            end += len;
+            break;
+        }
+    }
+    if (pos < textLen) {
+        return HFE_BADVALUE;    // more values than columns
+    }
+    return end;
+}
+
+/*
+ * Decodes a tuple into ';'-separated text.
+ */
+int HF_DecodeTuple(HF_Schema *schema, const char *tuple, char *text) {
+    int n = 0;
+
+    for (int i = 0; i < schema->numCols; i++) {
+        HF_Column *col = &schema->cols[i];
+
+        if (i > 0) {
+            text[n++] = ';';
+        }
+        if (HF_TupleIsNull(schema, tuple, i)) {
+            continue;
+        }
+        if (col->type == HF_TYPE_INT) {
+            n += sprintf(text + n, "%d", HF_TupleInt(schema, tuple, i));
+        } else if (col->type == HF_TYPE_DEC) {
+            long long v = HF_TupleInt(schema, tuple, i);
+            long long p = HF_pow10[col->scale];
+            if (v < 0) {
+                text[n++] = '-';
+                v = -v;
+            }
+            n += sprintf(text + n, "%lld", v / p);
+            if (col->scale > 0) {
+                // The digits after the point, zeros included
+                text[n] = '.';
+                for (int k = col->scale; k > 0; k--, v /= 10) {
+                    text[n + k] = '0' + v % 10;
+                }
+                n += col->scale + 1;
+            }
+        } else {
+            int len;
+            const char *value = HF_TupleChar(schema, tuple, i, &len);
+            memcpy(text + n, value, len);
+            n += len;
+        }
+    }
+    text[n] = '\0';
+    return n;
+}
+
+int HF_TupleIsNull(HF_Schema *schema, const char *tuple, int col) {
+    if (col < 0 || col >= schema->numCols) {
+        return TRUE;    // no such column: it has no value
+    }
+    return (((const unsigned char*)tuple)[col / 8] >> (col % 8)) & 1;
+}
+
+int HF_TupleInt(HF_Schema *schema, const char *tuple, int col) {
+    int v;
+
+    memcpy(&v, tuple + schema->cols[col].offset, sizeof(int));
+    return v;
+}
+
+double HF_TupleNum(HF_Schema *schema, const char *tuple, int col) {
+    return (double)HF_TupleInt(schema, tuple, col) /
+        HF_pow10[schema->cols[col].scale];
+}
+
+const char *HF_TupleChar(HF_Schema *schema, const char *tuple, int col, int *len) {
+    HF_Column *c = &schema->cols[col];
+    const char *slot = tuple + c->offset;
+
+    if (c->type == HF_TYPE_CHAR) {
+        const char *nul = memchr(slot, '\0', c->width);
+        *len = (nul != NULL) ? nul - slot : c->width;
+        return slot;
+    }
+    unsigned short var[2];
+    memcpy(var, slot, sizeof(var));
+    *len = var[1];
+    return tuple + var[0];
+}
+
+int HF_ColumnNum(HF_Schema *schema, const char *name) {
+    for (int i = 0; i < schema->numCols; i++) {
+        if (strcmp(schema->cols[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Creates a heap file for the tuples of a schema.
+ */
+int HF_CreateFileSchema(char *fileName, int pageSize, int pfFlags, HF_Schema *schema) {
+    if (schema->fixed) {
+        return HF_CreateFileFixed(fileName, pageSize, pfFlags, schema->tupleLen);
+    }
+    return HF_CreateFileOpt(fileName, pageSize, pfFlags);
+}
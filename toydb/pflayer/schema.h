@@ -0,0 +1,115 @@
+#ifndef SCHEMA_H
+#define SCHEMA_H
+
+#include "hf.h"
+
+/*
+ * Typed schemas, and the binary tuples that the HF layer stores for
+ * tables that have one.
+ *
+ * A schema catalog is a text file with one line per table:
+ *
+ *     table name:type name:type ...
+ *
+ * where a type is int, dec(s), char(n) or varchar(n). Blank lines
+ * and lines starting with '#' are skipped.
+ *
+ * A tuple is a null bitmap, bit i (bit i%8 of byte i/8) set if
+ * column i is NULL, followed by one slot per column at a fixed
+ * offset (HF_Column.offset), and then by the bytes of the varchar
+ * values. The slot of
+ *   int      is the value, 4 bytes
+ *   dec(s)   is the value times 10^s, 4 bytes, so it is exact
+ *   char(n)  is the value, n bytes, padded with '\0'
+ *   varchar  is 2 bytes of offset into the tuple and 2 of length
+ * A NULL value's slot is all zero. A schema without varchar columns
+ * gives tuples that are all tupleLen bytes long.
+ */
+
+#define HF_MAX_COLS   HF_PAX_MAX_FIELDS
+#define HF_NAME_LEN   32
+
+#define HF_TYPE_INT      1
+#define HF_TYPE_DEC      2
+#define HF_TYPE_CHAR     3
+#define HF_TYPE_VARCHAR  4
+
+typedef struct {
+    char name[HF_NAME_LEN];
+    int type;           /* HF_TYPE_xxx */
+    int width;          /* char(n)/varchar(n): n; otherwise 0 */
+    int scale;          /* dec(s): s */
+    int offset;         /* of the column's slot in a tuple */
+} HF_Column;
+
+typedef struct {
+    char table[HF_NAME_LEN];
+    int numCols;
+    HF_Column cols[HF_MAX_COLS];
+    int tupleLen;       /* bitmap and slots: the whole tuple if fixed */
+    int maxLen;         /* longest tuple, varchar values included */
+    int maxText;        /* longest text form, see HF_DecodeTuple */
+    int fixed;          /* TRUE if there are no varchar columns */
+} HF_Schema;
+
+/*
+ * Parses a catalog line, "table name:type ...", into *schema.
+ */
+int HF_ParseSchema(const char *decl, HF_Schema *schema);
+
+/*
+ * Finds table "table" in the catalog file catalogFile.
+ * Returns HFE_OK, HFE_SCHEMA if it is not there, or PFE_UNIX.
+ */
+int HF_LoadSchema(const char *catalogFile, const char *table, HF_Schema *schema);
+
+/*
+ * Writes the catalog line of a schema into decl (size bytes).
+ */
+void HF_FormatSchema(HF_Schema *schema, char *decl, int size);
+
+/*
+ * Encodes a row of text, textLen bytes of values separated by ';',
+ * as a tuple (of at most schema->maxLen bytes). An empty value is
+ * NULL, and so are the values missing at the end of a short row.
+ *
+ * Returns the length of the tuple, or HFE_BADVALUE if the row has
+ * too many values or one does not fit its column.
+ */
+int HF_EncodeTuple(HF_Schema *schema, const char *text, int textLen, char *tuple);
+
+/*
+ * Decodes a tuple into text, the values separated by ';' and NULLs
+ * empty (at most schema->maxText bytes, plus a '\0').
+ * Returns the length of the text.
+ */
+int HF_DecodeTuple(HF_Schema *schema, const char *tuple, char *text);
+
+/*
+ * Field access: a lookup at the column's offset, no parsing.
+ * HF_TupleIsNull also says TRUE for a column the schema does not have.
+ */
+int HF_TupleIsNull(HF_Schema *schema, const char *tuple, int col);
+
+// Value of an int column, or of a dec column times 10^scale
+int HF_TupleInt(HF_Schema *schema, const char *tuple, int col);
+
+// Value of an int or dec column
+double HF_TupleNum(HF_Schema *schema, const char *tuple, int col);
+
+// Bytes of a char or varchar column, *len of them (no '\0' at the end)
+const char *HF_TupleChar(HF_Schema *schema, const char *tuple, int col, int *len);
+
+/*
+ * Number of the column called "name", or -1.
+ */
+int HF_ColumnNum(HF_Schema *schema, const char *name);
+
+/*
+ * Creates a new, empty heap file for the tuples of a schema: a
+ * fixed-length file (see HF_CreateFileFixed) if they are all of
+ * one length, otherwise one of slotted pages.
+ */
+int HF_CreateFileSchema(char *fileName, int pageSize, int pfFlags, HF_Schema *schema);
+
+#endif // SCHEMA_H
@@ -3,8 +3,7 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <math.h>
-
-#define PF_PAGE_SIZE 1020      // same as in pf.h
+#include "pf.h"
 
 // Remove trailing newline / carriage return
 static void rstrip(char *s) {
@@ -72,15 +71,25 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
+    // page size and page count come from the PF file header
+    PF_Init();
+    int fd = PF_OpenFile((char *)student_hf);
+    if (fd < 0) {
+        PF_PrintError("PF_OpenFile");
+        return 1;
+    }
+    int pageSize = PF_GetPageSize(fd);
+    int hfPages  = PF_NumUsedPages(fd);
+    PF_CloseFile(fd);
+
     long long hfBytes = st.st_size;
-    double hfPages   = (double)hfBytes / (double)PF_PAGE_SIZE;
 
     double utilSlotted = (double)totalBytes / (double)hfBytes;
 
     printf("=== Slotted-page file (%s) ===\n", student_hf);
     printf("File size on disk        : %lld bytes\n", hfBytes);
-    printf("Approx. number of PF pages: %.2f (page size = %d bytes)\n",
-           hfPages, PF_PAGE_SIZE);
+    printf("Number of used PF pages  : %d (page size = %d bytes)\n",
+           hfPages, pageSize);
     printf("Space utilisation (slotted) = total_data / file_size = %.4f (%.2f%%)\n\n",
            utilSlotted, utilSlotted * 100.0);
 
@@ -96,7 +105,7 @@ int main(int argc, char *argv[]) {
         }
 
         long long staticBytes = numRecords * (long long)recSize;
-        double staticPages = ceil((double)staticBytes / (double)PF_PAGE_SIZE);
+        double staticPages = ceil((double)staticBytes / (double)pageSize);
         double utilStatic = (double)totalBytes / (double)staticBytes;
 
         printf("--- recSize = %d bytes ---\n", recSize);
@@ -35,7 +35,7 @@ int main() {
     }
 
     // 4. Initialize it as an empty slotted page
-    HF_InitPage(pageBuf);
+    HF_InitPage(pageBuf, PF_GetPageSize(fd));
     printf("Initialized new slotted page (Page %d)\n", pagenum);
 
     // 5. Define some records and insert them
@@ -0,0 +1,257 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pf.h"
+#include "hf.h"
+
+#define TEST_FILE_HF "testhf10.data"
+#define NUM_RECORDS 60
+#define MAX_REC 100000
+
+static char *records[NUM_RECORDS];
+static int lens[NUM_RECORDS];
+static RID rids[NUM_RECORDS];
+
+/*
+ * Makes record i, "#i;long;..." or "#i;short;...": every tenth one
+ * from HF_MaxInline to MAX_REC bytes long, most of them needing
+ * overflow pages (the first two sizes try the edge), the others short.
+ */
+static void makeRecord(int i, int version) {
+    int maxInline = HF_MaxInline(PF_PAGE_SIZE);
+    int sizes[] = { maxInline, maxInline + 1, 5000, 3 * PF_PAGE_SIZE + 7, MAX_REC, 9000 };
+    int len = (i % 10 == 0) ? sizes[(i / 10 + version) % 6] : 40 + i;
+
+    free(records[i]);
+    records[i] = malloc(len);
+    int head = sprintf(records[i], "#%d;%s;", i, len > maxInline ? "long" : "short");
+    for (int k = head; k < len; k++)
+        records[i][k] = 'a' + (i + k * version + k / 7) % 26;
+    lens[i] = len;
+}
+
+/* Checks every record: by RID, by a scan, a batch scan, a stream and a pin */
+static int check(int fd, const char *when) {
+    char *data;
+    int len, failures = 0;
+
+    for (int i = 0; i < NUM_RECORDS; i++) {
+        int error = HF_GetRec(fd, rids[i], &data, &len);
+        if (records[i] == NULL) {
+            if (error == HFE_OK) {
+                printf("  *** ERROR (%s): deleted record %d still found ***\n", when, i);
+                failures++;
+            }
+            continue;
+        }
+        if (error != HFE_OK || len != lens[i] || memcmp(data, records[i], len) != 0) {
+            printf("  *** ERROR (%s): record %d wrong (code %d, %d bytes) ***\n", when, i,
+                   error, len);
+            failures++;
+        }
+
+        // A stream gives the same bytes, a page at a time for a long record
+        HF_RecStream stream;
+        int got = 0, pieces = 0, wrong = 0;
+        error = HF_OpenRecStream(fd, rids[i], &stream);
+        while (error == HFE_OK && (error = HF_ReadRecStream(&stream, &data, &len)) == HFE_OK) {
+            wrong |= (got + len > lens[i] || memcmp(data, records[i] + got, len) != 0);
+            got += len;
+            pieces++;
+        }
+        int wantPieces = (lens[i] > HF_MaxInline(PF_PAGE_SIZE)) ?
+            (lens[i] + PF_PAGE_SIZE - (int)sizeof(HF_OverflowHeader) - 1) /
+            (PF_PAGE_SIZE - (int)sizeof(HF_OverflowHeader)) : 1;
+        if (HF_CloseRecStream(&stream) != HFE_OK || error != HFE_EOF || wrong ||
+                got != lens[i] || stream.recLen != lens[i] || pieces != wantPieces) {
+            printf("  *** ERROR (%s): stream of record %d gave %d bytes in %d pieces ***\n",
+                   when, i, got, pieces);
+            failures++;
+        }
+
+        // A pinned long record is a copy of the handle's own
+        HF_RecHandle handle;
+        if (HF_PinRec(fd, rids[i], &handle) != HFE_OK || handle.recLen != lens[i] ||
+                memcmp(handle.record, records[i], lens[i]) != 0 ||
+                HF_ReleaseRec(&handle) != HFE_OK) {
+            printf("  *** ERROR (%s): pinned record %d wrong ***\n", when, i);
+            failures++;
+        }
+    }
+
+    int live = 0, longRecs = 0;
+    for (int i = 0; i < NUM_RECORDS; i++) {
+        live += (records[i] != NULL);
+        longRecs += (records[i] != NULL && lens[i] > HF_MaxInline(PF_PAGE_SIZE));
+    }
+
+    // Scans put long records together; predicates are tested on them
+    HF_Pred isLong[] = { { 1, HF_OP_EQ, "long" } };
+    for (int p = 0; p <= 1; p++) {
+        HF_Scan scan;
+        RID rid;
+        int found = 0;
+        HF_OpenFileScanWhere(fd, &scan, isLong, p);
+        while (HF_GetNextRec(fd, &scan, &rid, &data, &len) == HFE_OK) {
+            int i = atoi(data + 1);
+            if (i < 0 || i >= NUM_RECORDS || records[i] == NULL ||
+                    rid.pageNum != rids[i].pageNum || rid.slotNum != rids[i].slotNum ||
+                    len != lens[i] || memcmp(data, records[i], len) != 0) {
+                printf("  *** ERROR (%s): scan gave a wrong record at (%d, %d) ***\n",
+                       when, rid.pageNum, rid.slotNum);
+                failures++;
+            }
+            found++;
+        }
+        HF_CloseFileScan(&scan);
+        if (found != (p ? longRecs : live)) {
+            printf("  *** ERROR (%s): scan found %d records ***\n", when, found);
+            failures++;
+        }
+    }
+
+    // A long record comes in a batch of its own
+    RID batchRids[8];
+    char *batch[8];
+    int batchLens[8], n, found = 0;
+    HF_Scan scan;
+    HF_OpenFileScan(fd, &scan);
+    while ((n = HF_GetNextBatch(fd, &scan, batchRids, batch, batchLens, 8)) > 0) {
+        for (int k = 0; k < n; k++) {
+            int i = atoi(batch[k] + 1);
+            if (i < 0 || i >= NUM_RECORDS || records[i] == NULL || batchLens[k] != lens[i] ||
+                    memcmp(batch[k], records[i], lens[i]) != 0 ||
+                    (lens[i] > HF_MaxInline(PF_PAGE_SIZE) && n != 1)) {
+                printf("  *** ERROR (%s): batch scan gave a wrong record ***\n", when);
+                failures++;
+            }
+            found++;
+        }
+    }
+    HF_CloseFileScan(&scan);
+    if (n != HFE_EOF || found != live) {
+        printf("  *** ERROR (%s): batch scan found %d records ***\n", when, found);
+        failures++;
+    }
+    printf("Checked %d records (%d long) %s: %d failures\n", live, longRecs, when, failures);
+    return failures;
+}
+
+/* Counts the records a parallel scan gives */
+static int count(void *arg, int worker, RID ridv[], char *recs[], int lensv[], int n) {
+    for (int k = 0; k < n; k++) {
+        int i = atoi(recs[k] + 1);
+        if (i >= 0 && i < NUM_RECORDS && lensv[k] == lens[i] &&
+                memcmp(recs[k], records[i], lens[i]) == 0)
+            __sync_fetch_and_add((int*)arg, 1);
+    }
+    return HFE_OK;
+}
+
+int main() {
+    int fd, error, failures = 0;
+
+    printf("Starting HF long record test (testhf10)...\n\n");
+    PF_Init();
+    if ((error = HF_CreateFile(TEST_FILE_HF)) != HFE_OK ||
+            (fd = HF_OpenFile(TEST_FILE_HF)) < 0) {
+        PF_PrintError("create " TEST_FILE_HF);
+        exit(1);
+    }
+
+    // 1. The short records, then the long ones, half of them in a batch
+    for (int i = 0; i < NUM_RECORDS; i++) {
+        makeRecord(i, 0);
+        if (i % 10 != 0 && (error = HF_InsertRec(fd, records[i], lens[i], &rids[i])) != HFE_OK) {
+            printf("Error inserting record %d (code: %d)\n", i, error);
+            exit(1);
+        }
+    }
+    for (int i = 0; i < NUM_RECORDS; i += 20) {
+        if ((error = HF_InsertRec(fd, records[i], lens[i], &rids[i])) != HFE_OK) {
+            printf("Error inserting long record %d (code: %d)\n", i, error);
+            exit(1);
+        }
+    }
+    char *batch[NUM_RECORDS / 20];
+    int batchLens[NUM_RECORDS / 20];
+    RID batchRids[NUM_RECORDS / 20];
+    for (int k = 0; k < NUM_RECORDS / 20; k++) {
+        batch[k] = records[20 * k + 10];
+        batchLens[k] = lens[20 * k + 10];
+    }
+    if ((error = HF_InsertBatch(fd, batch, batchLens, NUM_RECORDS / 20, batchRids)) != HFE_OK) {
+        printf("Error inserting a batch of long records (code: %d)\n", error);
+        exit(1);
+    }
+    for (int k = 0; k < NUM_RECORDS / 20; k++)
+        rids[20 * k + 10] = batchRids[k];
+    failures += check(fd, "after insert");
+
+    int found = 0;
+    if (HF_ParallelScan(fd, 3, 1, NULL, 0, count, &found) != HFE_OK || found != NUM_RECORDS) {
+        printf("  *** ERROR: parallel scan gave %d good records ***\n", found);
+        failures++;
+    }
+
+    // 2. Updates: long records change size, short ones turn long and back
+    for (int version = 1; version <= 2; version++) {
+        for (int i = 0; i < NUM_RECORDS; i += 5) {
+            if (i % 10 == 5) {
+                // 45 bytes and up, or long
+                free(records[i]);
+                records[i] = NULL;
+                if (version == 1) {
+                    lens[i] = 20000;
+                    records[i] = malloc(lens[i]);
+                    memset(records[i], 'x', lens[i]);
+                    sprintf(records[i], "#%d;long;", i);
+                } else {
+                    makeRecord(i, 0);
+                }
+            } else {
+                makeRecord(i, version);
+            }
+            if ((error = HF_UpdateRec(fd, rids[i], records[i], lens[i])) != HFE_OK) {
+                printf("Error updating record %d (code: %d)\n", i, error);
+                exit(1);
+            }
+        }
+        failures += check(fd, version == 1 ? "after updates" : "after more updates");
+    }
+
+    // 3. Deleting the long records gives their overflow pages back
+    for (int i = 0; i < NUM_RECORDS; i += 10) {
+        if ((error = HF_DeleteRec(fd, rids[i])) != HFE_OK) {
+            printf("Error deleting record %d (code: %d)\n", i, error);
+            exit(1);
+        }
+        free(records[i]);
+        records[i] = NULL;
+    }
+    failures += check(fd, "after deletes");
+    int pagenum = -1, overflowPages = 0;
+    char *pageBuf;
+    while (PF_GetNextPage(fd, &pagenum, &pageBuf) == PFE_OK) {
+        overflowPages += (((HF_OverflowHeader*)pageBuf)->numSlots == HF_OVERFLOW_PAGE);
+        PF_UnfixPage(fd, pagenum, FALSE);
+    }
+    if (overflowPages != 0) {
+        printf("  *** ERROR: %d overflow pages left ***\n", overflowPages);
+        failures++;
+    }
+
+    // 4. The buffer pool is left with no pages fixed
+    if ((error = HF_CloseFile(fd)) != HFE_OK) {
+        PF_PrintError("HF_CloseFile");
+        failures++;
+    }
+    PF_DestroyFile(TEST_FILE_HF);
+
+    if (failures == 0) {
+        printf("\nSUCCESS! Long records are stored, read, changed and freed.\n");
+        return 0;
+    }
+    printf("\nFAILURE! %d checks failed.\n", failures);
+    return 1;
+}
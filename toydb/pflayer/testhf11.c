@@ -0,0 +1,276 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pf.h"
+#include "hf.h"
+
+#define TEST_FILE_HF "testhf11.data"
+#define NUM_OPS 3000
+#define MAX_SLOTS 1024
+#define OLD_RECORDS 200
+
+/*
+ * Checks the free bytes and slots in use that a format 2 page keeps
+ * in its header against a count over its slots.
+ */
+static int checkCounts(char *pageBuf, int pageSize, const char *when) {
+    HF_PageHeader2 *header = (HF_PageHeader2*)pageBuf;
+    HF_SlotEntry2 *slots = (HF_SlotEntry2*)(pageBuf + sizeof(HF_PageHeader2));
+    int freeBytes = pageSize - (int)(sizeof(HF_PageHeader2) +
+        header->numSlots * sizeof(HF_SlotEntry2));
+    int numRecs = 0;
+
+    for (int i = 0; i < header->numSlots; i++) {
+        if (slots[i].length == HF_SLOT2_FORWARD) {
+            freeBytes -= sizeof(RID);
+        } else if (slots[i].length != HF_SLOT2_FREE) {
+            freeBytes -= slots[i].length & HF_SLOT2_BYTES;
+        }
+        numRecs += (slots[i].length != HF_SLOT2_FREE);
+    }
+    if (header->kind != HF_PAGE2 || freeBytes != HF_Page_FreeBytes(pageBuf, pageSize) ||
+            numRecs != header->numRecs) {
+        printf("  *** ERROR (%s): header says %d free, %d in use; slots say %d, %d ***\n",
+               when, header->freeBytes, header->numRecs, freeBytes, numRecs);
+        return 1;
+    }
+    return 0;
+}
+
+/* Number of slots of a slotted page of either format */
+static int numSlots(char *pageBuf) {
+    return (((HF_PageHeader*)pageBuf)->numSlots == HF_PAGE2) ?
+        ((HF_PageHeader2*)pageBuf)->numSlots : ((HF_PageHeader*)pageBuf)->numSlots;
+}
+
+/*
+ * Does random inserts, deletes and updates on a page of the first
+ * format (format 1) or of format 2, checking its records against
+ * those it should have after each one. Returns the number of inserts.
+ */
+static int runOps(char *pageBuf, int pageSize, int format, int *failures) {
+    static char records[MAX_SLOTS][64];
+    int inserts = 0;
+
+    if (format == 1) {
+        HF_InitPage1(pageBuf, pageSize);
+    } else {
+        HF_InitPage(pageBuf, pageSize);
+    }
+    memset(records, 0, sizeof(records));
+    srand(pageSize);
+    for (int op = 0; op < NUM_OPS && *failures == 0; op++) {
+        int n = numSlots(pageBuf);
+        int slot = (n > 0) ? rand() % n : 0;
+        int kind = rand() % 10;
+        char rec[64];
+        int len = sprintf(rec, "op %d;%.*s", op, rand() % 40,
+                          "0123456789012345678901234567890123456789") + 1;
+
+        if (kind < 5) {
+            int s = HF_Page_InsertRec(pageBuf, rec, len);
+            if (s == HFE_PAGENOFREE && HF_Page_FreeBytes(pageBuf, pageSize) >=
+                    len + (int)sizeof(HF_SlotEntry)) {
+                HF_Page_Compact(pageBuf, pageSize);
+                s = HF_Page_InsertRec(pageBuf, rec, len);
+            }
+            if (s >= 0) {
+                strcpy(records[s], rec);
+                inserts++;
+            }
+        } else if (kind < 8) {
+            if (HF_Page_DeleteRec(pageBuf, slot) == HFE_OK) {
+                records[slot][0] = '\0';
+            }
+        } else if (kind < 9) {
+            if (HF_Page_UpdateRec(pageBuf, pageSize, slot, rec, len) == HFE_OK) {
+                strcpy(records[slot], rec);
+            }
+        } else if (HF_Page_FreeBytes(pageBuf, pageSize) < 200) {
+            // Start over on a full page
+            HF_Page_Compact(pageBuf, pageSize);
+            for (int i = numSlots(pageBuf) - 1; i >= 0; i--) {
+                HF_Page_DeleteRec(pageBuf, i);
+            }
+            memset(records, 0, sizeof(records));
+            if (numSlots(pageBuf) != 0 || HF_Page_FreeBytes(pageBuf, pageSize) !=
+                    pageSize - (format == 1 ? (int)sizeof(HF_PageHeader)
+                                            : (int)sizeof(HF_PageHeader2))) {
+                printf("  *** ERROR: page of format %d not empty after deletes ***\n", format);
+                (*failures)++;
+            }
+        }
+        if (format == 2) {
+            *failures += checkCounts(pageBuf, pageSize, "page operations");
+        }
+
+        for (int i = 0; i < numSlots(pageBuf); i++) {
+            char *got;
+            int gotLen;
+            int error = HF_Page_GetRec(pageBuf, i, &got, &gotLen);
+            if ((error == HFE_OK) != (records[i][0] != '\0') ||
+                    (error == HFE_OK && strcmp(got, records[i]) != 0)) {
+                printf("  *** ERROR: after operation %d, slot %d of a page of format %d "
+                       "is wrong ***\n", op, i, format);
+                (*failures)++;
+                break;
+            }
+        }
+    }
+    return inserts;
+}
+
+/*
+ * Runs the page operations on a page of each format, then fills an
+ * empty page of each with short records: more fit on one of format 2.
+ */
+static int testPages(int pageSize) {
+    char *page1 = malloc(pageSize), *page2 = malloc(pageSize);
+    int failures = 0;
+
+    int inserts1 = runOps(page1, pageSize, 1, &failures);
+    int inserts2 = runOps(page2, pageSize, 2, &failures);
+
+    int n1 = 0, n2 = 0;
+    HF_InitPage1(page1, pageSize);
+    HF_InitPage(page2, pageSize);
+    while (HF_Page_InsertRec(page1, "1995;1;CH 831;BB", 17) >= 0)
+        n1++;
+    while (HF_Page_InsertRec(page2, "1995;1;CH 831;BB", 17) >= 0)
+        n2++;
+    failures += checkCounts(page2, pageSize, "full page");
+    if (n2 <= n1 || HF_Page_FreeBytes(page2, pageSize) >= 17 + (int)sizeof(HF_SlotEntry2)) {
+        printf("  *** ERROR: %d records fit on a format 2 page, %d on the first ***\n", n2, n1);
+        failures++;
+    }
+    printf("%d-byte pages: %d operations, %d and %d inserts; 17-byte records: %d a page, "
+           "%d before\n", pageSize, NUM_OPS, inserts1, inserts2, n2, n1);
+    free(page1);
+    free(page2);
+    return failures;
+}
+
+int main() {
+    int fd, error, failures = 0;
+
+    printf("Starting HF page format test (testhf11)...\n\n");
+    PF_Init();
+
+    // 1. Page operations on pages of both formats
+    failures += testPages(PF_PAGE_SIZE);
+    failures += testPages(HF_PAGE2_MAX_SIZE);
+
+    // 2. A file of first-format pages, as written before format 2,
+    //    is still read, updated and deleted from
+    if ((error = HF_CreateFile(TEST_FILE_HF)) != HFE_OK ||
+            (fd = HF_OpenFile(TEST_FILE_HF)) < 0) {
+        PF_PrintError("create " TEST_FILE_HF);
+        exit(1);
+    }
+    static char records[OLD_RECORDS][160];
+    static RID rids[OLD_RECORDS];
+    int pagenum = -1;
+    char *pageBuf = NULL;
+    for (int i = 0; i < OLD_RECORDS; i++) {
+        sprintf(records[i], "%d;old;%.*s", i, i % 60,
+                "abcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghij");
+        int slot = (pageBuf != NULL) ?
+            HF_Page_InsertRec(pageBuf, records[i], strlen(records[i]) + 1) : HFE_PAGENOFREE;
+        if (slot == HFE_PAGENOFREE) {
+            if ((pageBuf != NULL && PF_UnfixPage(fd, pagenum, TRUE) != PFE_OK) ||
+                    PF_AllocPage(fd, &pagenum, &pageBuf) != PFE_OK) {
+                PF_PrintError("old page");
+                exit(1);
+            }
+            HF_InitPage1(pageBuf, PF_PAGE_SIZE);
+            slot = HF_Page_InsertRec(pageBuf, records[i], strlen(records[i]) + 1);
+        }
+        rids[i].pageNum = pagenum;
+        rids[i].slotNum = slot;
+    }
+    PF_UnfixPage(fd, pagenum, TRUE);
+    int oldPages = pagenum;
+
+    for (int i = 0; i < OLD_RECORDS; i += 3) {
+        // Longer records move to new pages, of format 2
+        strcat(records[i], (i % 2) ? ";updated" :
+               ";updated and made long enough that its old place cannot hold it any more");
+        if ((error = HF_UpdateRec(fd, rids[i], records[i], strlen(records[i]) + 1)) != HFE_OK) {
+            printf("Error updating record %d (code: %d)\n", i, error);
+            exit(1);
+        }
+    }
+    for (int i = 1; i < OLD_RECORDS; i += 7) {
+        if ((error = HF_DeleteRec(fd, rids[i])) != HFE_OK) {
+            printf("Error deleting record %d (code: %d)\n", i, error);
+            exit(1);
+        }
+        records[i][0] = '\0';
+    }
+    long reclaimed;
+    if ((error = HF_Vacuum(fd, &reclaimed)) != HFE_OK) {
+        printf("Error vacuuming (code: %d)\n", error);
+        exit(1);
+    }
+
+    int found = 0, live = 0;
+    for (int i = 0; i < OLD_RECORDS; i++) {
+        char *rec;
+        int len;
+        error = HF_GetRec(fd, rids[i], &rec, &len);
+        live += (records[i][0] != '\0');
+        if ((error == HFE_OK) != (records[i][0] != '\0') ||
+                (error == HFE_OK && strcmp(rec, records[i]) != 0)) {
+            printf("  *** ERROR: record %d is wrong (code %d) ***\n", i, error);
+            failures++;
+        }
+    }
+    HF_Scan scan;
+    RID rid;
+    char *rec;
+    int len;
+    HF_OpenFileScan(fd, &scan);
+    while (HF_GetNextRec(fd, &scan, &rid, &rec, &len) == HFE_OK) {
+        int i = atoi(rec);
+        if (i < 0 || i >= OLD_RECORDS || strcmp(rec, records[i]) != 0 ||
+                rid.pageNum != rids[i].pageNum || rid.slotNum != rids[i].slotNum) {
+            printf("  *** ERROR: scan gave a wrong record at (%d, %d) ***\n",
+                   rid.pageNum, rid.slotNum);
+            failures++;
+        }
+        found++;
+    }
+    HF_CloseFileScan(&scan);
+
+    // The old pages keep their format; the new ones have format 2
+    int pages1 = 0, pages2 = 0;
+    pagenum = -1;
+    while (PF_GetNextPage(fd, &pagenum, &pageBuf) == PFE_OK) {
+        int kind = ((HF_PageHeader*)pageBuf)->numSlots;
+        pages1 += (kind >= 0 && pagenum <= oldPages);
+        pages2 += (kind == HF_PAGE2 && pagenum > oldPages);
+        if (kind == HF_PAGE2) {
+            failures += checkCounts(pageBuf, PF_PAGE_SIZE, "file page");
+        }
+        PF_UnfixPage(fd, pagenum, FALSE);
+    }
+    printf("Old file: %d records found of %d, on %d old pages and %d new ones\n",
+           found, live, pages1, pages2);
+    if (found != live || pages1 != oldPages || pages2 == 0) {
+        printf("  *** ERROR: the pages of the old file are not as they should be ***\n");
+        failures++;
+    }
+
+    if ((error = HF_CloseFile(fd)) != HFE_OK) {
+        PF_PrintError("HF_CloseFile");
+        failures++;
+    }
+    PF_DestroyFile(TEST_FILE_HF);
+
+    if (failures == 0) {
+        printf("\nSUCCESS! Both page formats give the same records.\n");
+        return 0;
+    }
+    printf("\nFAILURE! %d checks failed.\n", failures);
+    return 1;
+}
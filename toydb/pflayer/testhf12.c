@@ -0,0 +1,343 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pf.h"
+#include "hf.h"
+
+#define TEST_FILE_HF "testhf12.data"
+#define NUM_RECORDS 3000
+#define REC_LEN 120
+#define NUM_COURSES 24
+
+/* Records "id;year;course;title;grade;note", most values repeating */
+static char records[NUM_RECORDS][REC_LEN];
+static RID rids[NUM_RECORDS];
+static const char *grades[] = { "AA", "AB", "BB", "BC", "CC", "FR" };
+
+static void makeRecord(int i, int version) {
+    int c = (i * 7 + version) % NUM_COURSES;
+    const char *note = (i % 50 == 0) ? "\x1b" "escaped" :   // never encoded
+                       (i % 13 == 0) ? "" : "regular";
+    sprintf(records[i], "%d;%d;CS %d;Course number %d of the department;%s;%s",
+            i, 1990 + (i + version) % 8, 101 + c, c, grades[(i + version) % 6], note);
+}
+
+/* The record's field, as the scan should see it */
+static int field(int i, int f, char *out) {
+    const char *p = records[i];
+    for (int k = 0; k < f; k++)
+        p = strchr(p, ';') + 1;
+    int len = strcspn(p, ";");
+    memcpy(out, p, len);
+    out[len] = '\0';
+    return len;
+}
+
+/*
+ * Checks the free bytes and slots in use that each dictionary page
+ * keeps in its header against its slots, and that its dictionary is
+ * in its data heap. Returns the number of encoded records.
+ */
+static int checkPages(int fd, const char *when, int *failures) {
+    int pagenum = -1, encoded = 0;
+    char *pageBuf;
+
+    while (PF_GetNextPage(fd, &pagenum, &pageBuf) == PFE_OK) {
+        HF_DictHeader *header = (HF_DictHeader*)pageBuf;
+        HF_SlotEntry2 *slots = (HF_SlotEntry2*)(pageBuf + sizeof(HF_DictHeader));
+        if (header->page.kind != HF_DICT_PAGE) {
+            PF_UnfixPage(fd, pagenum, FALSE);
+            continue;
+        }
+        int freeBytes = PF_PAGE_SIZE - (int)(sizeof(HF_DictHeader) +
+            header->page.numSlots * sizeof(HF_SlotEntry2)) - header->dictLen;
+        int numRecs = 0;
+        for (int i = 0; i < header->page.numSlots; i++) {
+            if (slots[i].length == HF_SLOT2_FORWARD) {
+                freeBytes -= sizeof(RID);
+            } else if (slots[i].length != HF_SLOT2_FREE) {
+                freeBytes -= slots[i].length & (HF_SLOT2_BYTES & ~HF_SLOT2_DICT);
+                encoded += (slots[i].length & HF_SLOT2_DICT) != 0;
+            }
+            numRecs += (slots[i].length != HF_SLOT2_FREE);
+        }
+        if (freeBytes != HF_Page_FreeBytes(pageBuf, PF_PAGE_SIZE) ||
+                numRecs != header->page.numRecs ||
+                (header->dictOffset != 0 && (header->dictOffset < header->page.dataStart ||
+                 header->dictOffset + header->dictLen > PF_PAGE_SIZE))) {
+            printf("  *** ERROR (%s): page %d says %d free, %d in use; slots say %d, %d ***\n",
+                   when, pagenum, header->page.freeBytes, header->page.numRecs,
+                   freeBytes, numRecs);
+            (*failures)++;
+        }
+        PF_UnfixPage(fd, pagenum, FALSE);
+    }
+    return encoded;
+}
+
+/* Counts the records a parallel scan gives */
+static int count(void *arg, int worker, RID ridv[], char *recs[], int lens[], int n) {
+    for (int k = 0; k < n; k++) {
+        int i = atoi(recs[k]);
+        if (i >= 0 && i < NUM_RECORDS && lens[k] == (int)strlen(records[i]) &&
+                memcmp(recs[k], records[i], lens[k]) == 0)
+            __sync_fetch_and_add((int*)arg, 1);
+    }
+    return HFE_OK;
+}
+
+/* Checks every record: by RID, pinned, and by scans with and without predicates */
+static int check(int fd, const char *when) {
+    char *data;
+    int len, failures = 0, live = 0;
+
+    for (int i = 0; i < NUM_RECORDS; i++) {
+        int error = HF_GetRec(fd, rids[i], &data, &len);
+        if (records[i][0] == '\0') {
+            if (error == HFE_OK) {
+                printf("  *** ERROR (%s): deleted record %d still found ***\n", when, i);
+                failures++;
+            }
+            continue;
+        }
+        live++;
+        HF_RecHandle handle;
+        if (error != HFE_OK || len != (int)strlen(records[i]) ||
+                memcmp(data, records[i], len) != 0 ||
+                HF_PinRec(fd, rids[i], &handle) != HFE_OK || handle.recLen != len ||
+                memcmp(handle.record, records[i], len) != 0 || HF_ReleaseRec(&handle) != HFE_OK) {
+            printf("  *** ERROR (%s): record %d wrong (code %d) ***\n", when, i, error);
+            failures++;
+        }
+    }
+
+    // Equality compares codes, other predicates decoded values
+    HF_Pred tests[][2] = {
+        { { 2, HF_OP_EQ, "CS 105" }, { 0 } },
+        { { 2, HF_OP_NE, "CS 105" }, { 0 } },
+        { { 4, HF_OP_EQ, "BB" }, { 2, HF_OP_EQ, "CS 110" } },
+        { { 2, HF_OP_EQ, "CS 999" }, { 0 } },
+        { { 1, HF_OP_LT | HF_OP_NUM, "1993" }, { 3, HF_OP_GE, "Course number 2" } },
+        { { 5, HF_OP_EQ, "" }, { 0 } },
+        { { 5, HF_OP_NE, "regular" }, { 1, HF_OP_EQ, "1995" } },
+    };
+    int numPreds[] = { 1, 1, 2, 1, 2, 1, 2 };
+    for (int t = 0; t < (int)(sizeof(numPreds) / sizeof(int)); t++) {
+        int want = 0, found = 0, batchFound = 0, n;
+        for (int i = 0; i < NUM_RECORDS; i++) {
+            int match = (records[i][0] != '\0');
+            for (int p = 0; p < numPreds[t] && match; p++) {
+                char value[REC_LEN];
+                field(i, tests[t][p].field, value);
+                int op = tests[t][p].op & ~HF_OP_NUM;
+                int cmp = (tests[t][p].op & HF_OP_NUM) ?
+                    atoi(value) - atoi(tests[t][p].value) : strcmp(value, tests[t][p].value);
+                match = (op == HF_OP_EQ) ? cmp == 0 : (op == HF_OP_NE) ? cmp != 0 :
+                        (op == HF_OP_LT) ? cmp < 0 : cmp >= 0;
+            }
+            want += match;
+        }
+
+        HF_Scan scan;
+        RID rid;
+        if (HF_OpenFileScanWhere(fd, &scan, tests[t], numPreds[t]) != HFE_OK) {
+            printf("  *** ERROR (%s): predicates %d not taken ***\n", when, t);
+            failures++;
+            continue;
+        }
+        while (HF_GetNextRec(fd, &scan, &rid, &data, &len) == HFE_OK) {
+            int i = atoi(data);
+            if (i < 0 || i >= NUM_RECORDS || len != (int)strlen(records[i]) ||
+                    memcmp(data, records[i], len) != 0 ||
+                    rid.pageNum != rids[i].pageNum || rid.slotNum != rids[i].slotNum) {
+                printf("  *** ERROR (%s): scan %d gave a wrong record ***\n", when, t);
+                failures++;
+            }
+            found++;
+        }
+        HF_CloseFileScan(&scan);
+
+        RID batchRids[100];
+        char *batch[100];
+        int batchLens[100];
+        HF_OpenFileScanWhere(fd, &scan, tests[t], numPreds[t]);
+        while ((n = HF_GetNextBatch(fd, &scan, batchRids, batch, batchLens, 100)) > 0) {
+            for (int k = 0; k < n; k++) {
+                int i = atoi(batch[k]);
+                if (i < 0 || i >= NUM_RECORDS || batchLens[k] != (int)strlen(records[i]) ||
+                        memcmp(batch[k], records[i], batchLens[k]) != 0 ||
+                        batchRids[k].slotNum != rids[i].slotNum) {
+                    printf("  *** ERROR (%s): batch scan %d gave a wrong record ***\n", when, t);
+                    failures++;
+                }
+            }
+            batchFound += n;
+        }
+        HF_CloseFileScan(&scan);
+
+        int parFound = 0;
+        HF_ParallelScan(fd, 3, 1, tests[t], numPreds[t], count, &parFound);
+        if (found != want || batchFound != want || parFound != want) {
+            printf("  *** ERROR (%s): scan %d found %d, batches %d, in parallel %d, "
+                   "not %d ***\n", when, t, found, batchFound, parFound, want);
+            failures++;
+        }
+    }
+
+    int encoded = checkPages(fd, when, &failures);
+    printf("Checked %d records (%d encoded) %s: %d failures\n", live, encoded, when, failures);
+    if (encoded < live / 2) {
+        printf("  *** ERROR (%s): too few records encoded ***\n", when);
+        failures++;
+    }
+    return failures;
+}
+
+/*
+ * Fills a page of format 2 and a dictionary page with the same
+ * records: more fit on the dictionary page, and read back the same.
+ */
+static int testPage(void) {
+    char page2[PF_PAGE_SIZE], dictPage[PF_PAGE_SIZE];
+    int n2 = 0, nDict = 0, failures = 0;
+
+    HF_InitPage(page2, PF_PAGE_SIZE);
+    HF_InitDictPage(dictPage, PF_PAGE_SIZE);
+    for (int i = 0; i < NUM_RECORDS; i++) {
+        makeRecord(i, 0);
+    }
+    while (n2 < NUM_RECORDS &&
+           HF_Page_InsertRec(page2, records[n2], strlen(records[n2])) >= 0)
+        n2++;
+    while (nDict < NUM_RECORDS) {
+        int len = strlen(records[nDict]);
+        if (HF_Page_InsertRec(dictPage, records[nDict], len) < 0 &&
+                (HF_Page_Encode(dictPage, PF_PAGE_SIZE) <= 0 ||
+                 HF_Page_InsertRec(dictPage, records[nDict], len) < 0))
+            break;
+        nDict++;
+    }
+    for (int i = 0; i < nDict; i++) {
+        char *rec;
+        int len;
+        if (HF_Page_GetRec(dictPage, i, &rec, &len) != HFE_OK ||
+                len != (int)strlen(records[i]) || memcmp(rec, records[i], len) != 0) {
+            printf("  *** ERROR: slot %d of the dictionary page is wrong ***\n", i);
+            failures++;
+        }
+    }
+
+    // Compacting after deletes keeps the dictionary; deleting all drops it
+    for (int i = 0; i < nDict; i += 3) {
+        HF_Page_DeleteRec(dictPage, i);
+    }
+    HF_Page_Compact(dictPage, PF_PAGE_SIZE);
+    for (int i = 1; i < nDict; i += 3) {
+        char *rec;
+        int len;
+        if (HF_Page_GetRec(dictPage, i, &rec, &len) != HFE_OK ||
+                len != (int)strlen(records[i]) || memcmp(rec, records[i], len) != 0) {
+            printf("  *** ERROR: slot %d is wrong after compacting ***\n", i);
+            failures++;
+        }
+    }
+    for (int i = nDict - 1; i >= 0; i--) {
+        HF_Page_DeleteRec(dictPage, i);
+    }
+    HF_Page_Compact(dictPage, PF_PAGE_SIZE);
+    if (HF_Page_FreeBytes(dictPage, PF_PAGE_SIZE) != PF_PAGE_SIZE - (int)sizeof(HF_DictHeader)) {
+        printf("  *** ERROR: empty dictionary page has %d free bytes ***\n",
+               HF_Page_FreeBytes(dictPage, PF_PAGE_SIZE));
+        failures++;
+    }
+    printf("%d records fit on a page of format 2, %d on a dictionary page\n", n2, nDict);
+    if (nDict <= n2 * 5 / 4) {
+        printf("  *** ERROR: the dictionary page holds too few ***\n");
+        failures++;
+    }
+    return failures;
+}
+
+int main() {
+    int fd, error, failures = 0;
+
+    printf("Starting HF dictionary page test (testhf12)...\n\n");
+    PF_Init();
+
+    // 1. Records on a page of their own
+    failures += testPage();
+
+    // 2. A file of dictionary pages, its pages at most HF_DICT_MAX_SIZE
+    if (HF_CreateFileDict(TEST_FILE_HF, 2 * HF_DICT_MAX_SIZE, 0) != PFE_PAGESIZE) {
+        printf("  *** ERROR: a dictionary file of 16K pages was made ***\n");
+        failures++;
+    }
+    if ((error = HF_CreateFileDict(TEST_FILE_HF, PF_PAGE_SIZE, 0)) != HFE_OK ||
+            (fd = HF_OpenFile(TEST_FILE_HF)) < 0) {
+        PF_PrintError("create " TEST_FILE_HF);
+        exit(1);
+    }
+
+    // 3. Half the records one at a time, half in a batch
+    for (int i = 0; i < NUM_RECORDS; i++) {
+        makeRecord(i, 0);
+    }
+    for (int i = 0; i < NUM_RECORDS / 2; i++) {
+        if ((error = HF_InsertRec(fd, records[i], strlen(records[i]), &rids[i])) != HFE_OK) {
+            printf("Error inserting record %d (code: %d)\n", i, error);
+            exit(1);
+        }
+    }
+    static char *batch[NUM_RECORDS / 2];
+    static int batchLens[NUM_RECORDS / 2];
+    for (int k = 0; k < NUM_RECORDS / 2; k++) {
+        batch[k] = records[NUM_RECORDS / 2 + k];
+        batchLens[k] = strlen(batch[k]);
+    }
+    if ((error = HF_InsertBatch(fd, batch, batchLens, NUM_RECORDS / 2,
+                                rids + NUM_RECORDS / 2)) != HFE_OK) {
+        printf("Error inserting a batch (code: %d)\n", error);
+        exit(1);
+    }
+    failures += check(fd, "after insert");
+
+    // 4. Updates, some longer, some moving; deletes; a vacuum
+    for (int i = 0; i < NUM_RECORDS; i += 7) {
+        makeRecord(i, 1);
+        if (i % 2) {
+            strcat(records[i], ";and a tail long enough to move it off its page");
+        }
+        if ((error = HF_UpdateRec(fd, rids[i], records[i], strlen(records[i]))) != HFE_OK) {
+            printf("Error updating record %d (code: %d)\n", i, error);
+            exit(1);
+        }
+    }
+    failures += check(fd, "after updates");
+    for (int i = 3; i < NUM_RECORDS; i += 5) {
+        if ((error = HF_DeleteRec(fd, rids[i])) != HFE_OK) {
+            printf("Error deleting record %d (code: %d)\n", i, error);
+            exit(1);
+        }
+        records[i][0] = '\0';
+    }
+    long reclaimed;
+    if ((error = HF_Vacuum(fd, &reclaimed)) != HFE_OK) {
+        printf("Error vacuuming (code: %d)\n", error);
+        exit(1);
+    }
+    failures += check(fd, "after deletes");
+
+    // 5. The buffer pool is left with no pages fixed
+    if ((error = HF_CloseFile(fd)) != HFE_OK) {
+        PF_PrintError("HF_CloseFile");
+        failures++;
+    }
+    PF_DestroyFile(TEST_FILE_HF);
+
+    if (failures == 0) {
+        printf("\nSUCCESS! Dictionary pages give back the records put on them.\n");
+        return 0;
+    }
+    printf("\nFAILURE! %d checks failed.\n", failures);
+    return 1;
+}
@@ -0,0 +1,352 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "pf.h"
+#include "hf.h"
+
+#define TEST_FILE_HF "testhf13.data"
+#define NUM_RECORDS 4000
+#define REC_LEN 6000
+#define LONG_EVERY 1500
+
+/* Records "id;year;grade;name", the years rising with the id */
+static char *records[NUM_RECORDS];
+static RID rids[NUM_RECORDS];
+
+static void makeRecord(int i, int version) {
+    char year[16];
+    if (i % 97 == 5)
+        strcpy(year, "n/a");   // not a number: in no range
+    else
+        sprintf(year, "%d", 1980 + i * 20 / NUM_RECORDS + version * 3);
+    int len = sprintf(records[i], "%d;%s;%d.%d;Student %d", i, year,
+                      (i * 7) % 4, (i * 3) % 10, i);
+    if (i % LONG_EVERY == LONG_EVERY - 1) {
+        // A long record, on overflow pages
+        memset(records[i] + len, 'x', REC_LEN - 100);
+        records[i][len + REC_LEN - 100] = '\0';
+    } else if (version > 0 && i % 2) {
+        strcat(records[i], ";and a tail long enough to move it off its page");
+    }
+}
+
+/* Field f of a record (its first 63 bytes); FALSE if it has no such field */
+static int text(const char *rec, int len, int f, char *value) {
+    const char *p = rec, *end = rec + len;
+    for (int k = 0; k < f; k++) {
+        if ((p = memchr(p, ';', end - p)) == NULL)
+            return FALSE;
+        p++;
+    }
+    int n = 0;
+    while (p + n < end && p[n] != ';' && n < 63)
+        n++;
+    memcpy(value, p, n);
+    value[n] = '\0';
+    return TRUE;
+}
+
+/* Field f of a record as a number; FALSE if it is not one */
+static int number(const char *rec, int len, int f, double *v) {
+    char value[64], *stop;
+    if (!text(rec, len, f, value))
+        return FALSE;
+    *v = strtod(value, &stop);
+    return value[0] != '\0' && *stop == '\0' &&
+           (value[0] == '-' || (value[0] >= '0' && value[0] <= '9'));
+}
+
+/*
+ * Checks the zone map entry of every data page against its records:
+ * the ranges must hold all of the page's numbers, and if "exact",
+ * be no wider. Returns the number of pages whose range of the year
+ * meets 1995..1997 in *meets and of pages with records in *pages.
+ */
+static int checkZones(int fd, int exact, const char *when, int *meets, int *pages) {
+    int fields[] = { 1, 2 };
+    int pagenum = -1, failures = 0;
+    char *pageBuf;
+
+    *meets = *pages = 0;
+    while (PF_GetNextPage(fd, &pagenum, &pageBuf) == PFE_OK) {
+        double min[2] = { HUGE_VAL, HUGE_VAL }, max[2] = { -HUGE_VAL, -HUGE_VAL };
+        char *rec;
+        int len, slot = -1, n = 0;
+        while ((slot = HF_Page_GetNextRec(pageBuf, slot, &rec, &len)) >= 0) {
+            int error = HF_Page_GetRec(pageBuf, slot, &rec, &len);
+            n++;
+            for (int f = 0; f < 2; f++) {
+                double v;
+                if (error == HFE_LONGREC) {
+                    min[f] = -HUGE_VAL;
+                    max[f] = HUGE_VAL;
+                } else if (number(rec, len, fields[f], &v)) {
+                    min[f] = (v < min[f]) ? v : min[f];
+                    max[f] = (v > max[f]) ? v : max[f];
+                }
+            }
+        }
+        PF_UnfixPage(fd, pagenum, FALSE);
+        for (int f = 0; f < 2; f++) {
+            double zmin, zmax;
+            if (HF_GetZone(fd, pagenum, fields[f], &zmin, &zmax) != HFE_OK) {
+                printf("  *** ERROR (%s): no zone for page %d ***\n", when, pagenum);
+                failures++;
+                continue;
+            }
+            int holds = (min[f] > max[f]) || (zmin <= min[f] && zmax >= max[f]);
+            if (!holds || (exact && (zmin != min[f] || zmax != max[f]))) {
+                printf("  *** ERROR (%s): page %d field %d has %g..%g, zone %g..%g ***\n",
+                       when, pagenum, fields[f], min[f], max[f], zmin, zmax);
+                failures++;
+            }
+            if (f == 0 && n > 0 && zmin <= 1997 && zmax >= 1995)
+                (*meets)++;
+        }
+        *pages += (n > 0);
+    }
+    return failures;
+}
+
+/* Adds up the records a parallel scan gives */
+static int tally(void *arg, int worker, RID ridv[], char *recs[], int lens[], int n) {
+    __sync_fetch_and_add((int*)arg, n);
+    return HFE_OK;
+}
+
+/* Tells whether record i matches predicates "preds" */
+static int matches(int i, HF_Pred *preds, int numPreds) {
+    int match = (records[i][0] != '\0');
+    for (int p = 0; p < numPreds && match; p++) {
+        double v, c = atof(preds[p].value);
+        int op = preds[p].op & ~HF_OP_NUM;
+        if (!(preds[p].op & HF_OP_NUM)) {
+            char value[64];
+            match = text(records[i], strlen(records[i]), preds[p].field, value) &&
+                    strcmp(value, preds[p].value) == 0;     // HF_OP_EQ
+        } else if (!number(records[i], strlen(records[i]), preds[p].field, &v)) {
+            match = FALSE;
+        } else {
+            match = (op == HF_OP_EQ) ? v == c : (op == HF_OP_NE) ? v != c :
+                    (op == HF_OP_LT) ? v < c : (op == HF_OP_LE) ? v <= c :
+                    (op == HF_OP_GT) ? v > c : v >= c;
+        }
+    }
+    return match;
+}
+
+/*
+ * Checks the zone map, and that the pages it rules out hold no match:
+ * scans with predicates, a record, a batch and a worker at a time,
+ * each find as many records as match. The records they give are
+ * checked by testhf12.
+ */
+static int check(int fd, int exact, const char *when) {
+    char *data;
+    int len, failures = 0;
+
+    HF_Pred tests[][2] = {
+        { { 1, HF_OP_GE | HF_OP_NUM, "1995" }, { 1, HF_OP_LE | HF_OP_NUM, "1997" } },
+        { { 1, HF_OP_EQ | HF_OP_NUM, "1990" }, { 0 } },
+        { { 1, HF_OP_NE | HF_OP_NUM, "1985" }, { 0 } },
+        { { 2, HF_OP_GT | HF_OP_NUM, "3.5" }, { 1, HF_OP_LT | HF_OP_NUM, "1983" } },
+        { { 1, HF_OP_GE | HF_OP_NUM, "1999" }, { 0 } },
+        { { 1, HF_OP_EQ, "1995" }, { 0 } },
+        { { 0, HF_OP_LT | HF_OP_NUM, "100" }, { 1, HF_OP_GT | HF_OP_NUM, "2050" } },
+    };
+    int numPreds[] = { 2, 1, 1, 2, 1, 1, 2 };
+    for (int t = 0; t < (int)(sizeof(numPreds) / sizeof(int)); t++) {
+        int want = 0, found = 0, batchFound = 0, parFound = 0, n;
+        for (int i = 0; i < NUM_RECORDS; i++) {
+            want += matches(i, tests[t], numPreds[t]);
+        }
+
+        HF_Scan scan;
+        RID rid;
+        if (HF_OpenFileScanWhere(fd, &scan, tests[t], numPreds[t]) != HFE_OK) {
+            printf("  *** ERROR (%s): predicates %d not taken ***\n", when, t);
+            failures++;
+            continue;
+        }
+        while (HF_GetNextRec(fd, &scan, &rid, &data, &len) == HFE_OK) {
+            found++;
+        }
+        HF_CloseFileScan(&scan);
+
+        RID batchRids[100];
+        char *batch[100];
+        int batchLens[100];
+        HF_OpenFileScanWhere(fd, &scan, tests[t], numPreds[t]);
+        while ((n = HF_GetNextBatch(fd, &scan, batchRids, batch, batchLens, 100)) > 0) {
+            batchFound += n;
+        }
+        HF_CloseFileScan(&scan);
+
+        HF_ParallelScan(fd, 3, 2, tests[t], numPreds[t], tally, &parFound);
+        if (found != want || batchFound != want || parFound != want) {
+            printf("  *** ERROR (%s): scan %d found %d, batches %d, in parallel %d, "
+                   "not %d ***\n", when, t, found, batchFound, parFound, want);
+            failures++;
+        }
+    }
+
+    int meets, pages;
+    failures += checkZones(fd, exact, when, &meets, &pages);
+    printf("Checked scans and zones %s: %d of %d pages may hold 1995..1997, %d failures\n",
+           when, meets, pages, failures);
+    if (exact && meets * 4 > pages) {
+        printf("  *** ERROR (%s): the zone map rules out too few pages ***\n", when);
+        failures++;
+    }
+    return failures;
+}
+
+/* Loads the records into a new file, half before the zone map is made */
+static int testFile(int dict) {
+    int fd, error, failures = 0;
+    int fields[] = { 1, 2 };
+
+    printf("\n-- %s pages --\n", dict ? "Dictionary" : "Slotted");
+    PF_DestroyFile(TEST_FILE_HF);
+    error = dict ? HF_CreateFileDict(TEST_FILE_HF, PF_PAGE_SIZE, 0)
+                 : HF_CreateFile(TEST_FILE_HF);
+    if (error != HFE_OK || (fd = HF_OpenFile(TEST_FILE_HF)) < 0) {
+        PF_PrintError("create " TEST_FILE_HF);
+        exit(1);
+    }
+
+    // 1. Half the records one at a time, then the zone map
+    for (int i = 0; i < NUM_RECORDS; i++) {
+        makeRecord(i, 0);
+    }
+    for (int i = 0; i < NUM_RECORDS / 2; i++) {
+        if ((error = HF_InsertRec(fd, records[i], strlen(records[i]), &rids[i])) != HFE_OK) {
+            printf("Error inserting record %d (code: %d)\n", i, error);
+            exit(1);
+        }
+    }
+    int tooMany[] = { 1, 2, 3, 4, 5 };
+    if (HF_CreateZoneMap(fd, 5, tooMany) != HFE_NOFIELDS) {
+        printf("  *** ERROR: a zone map on 5 fields was made ***\n");
+        failures++;
+    }
+    if ((error = HF_CreateZoneMap(fd, 2, fields)) != HFE_OK) {
+        printf("Error making the zone map (code: %d)\n", error);
+        exit(1);
+    }
+    if (HF_CreateZoneMap(fd, 2, fields) != HFE_NOZONEMAP) {
+        printf("  *** ERROR: a second zone map was made ***\n");
+        failures++;
+    }
+
+    // 2. The other half, some one at a time, the rest in a batch, in
+    //    bulk-append mode so that it starts a page of its own
+    for (int i = NUM_RECORDS / 2; i < NUM_RECORDS * 3 / 4; i++) {
+        if ((error = HF_InsertRec(fd, records[i], strlen(records[i]), &rids[i])) != HFE_OK) {
+            printf("Error inserting record %d (code: %d)\n", i, error);
+            exit(1);
+        }
+    }
+    static int batchLens[NUM_RECORDS / 4];
+    for (int k = 0; k < NUM_RECORDS / 4; k++) {
+        batchLens[k] = strlen(records[NUM_RECORDS * 3 / 4 + k]);
+    }
+    if ((error = HF_BeginBulkAppend(fd)) != HFE_OK ||
+            (error = HF_InsertBatch(fd, records + NUM_RECORDS * 3 / 4, batchLens,
+                                    NUM_RECORDS / 4, rids + NUM_RECORDS * 3 / 4)) != HFE_OK ||
+            (error = HF_EndBulkAppend(fd)) != HFE_OK) {
+        printf("Error inserting a batch (code: %d)\n", error);
+        exit(1);
+    }
+    failures += check(fd, TRUE, "after insert");
+
+    // 3. Deletes narrow the ranges again: all of 1990, and the
+    //    records of 1985 at the ends of their pages
+    for (int i = 0; i < NUM_RECORDS; i++) {
+        double v;
+        if (number(records[i], strlen(records[i]), 1, &v) && (v == 1990 ||
+                (v == 1985 && i % 3 == 0))) {
+            if ((error = HF_DeleteRec(fd, rids[i])) != HFE_OK) {
+                printf("Error deleting record %d (code: %d)\n", i, error);
+                exit(1);
+            }
+            records[i][0] = '\0';
+        }
+    }
+    failures += check(fd, TRUE, "after deletes");
+
+    // 4. Updates, to later years, some moving off their page
+    for (int i = 0; i < NUM_RECORDS; i += 11) {
+        if (records[i][0] == '\0')
+            continue;
+        makeRecord(i, 1);
+        if ((error = HF_UpdateRec(fd, rids[i], records[i], strlen(records[i]))) != HFE_OK) {
+            printf("Error updating record %d (code: %d)\n", i, error);
+            exit(1);
+        }
+    }
+    failures += check(fd, FALSE, "after updates");
+    for (int i = 0; i < NUM_RECORDS; i += 22) {
+        if (records[i][0] == '\0')
+            continue;
+        if ((error = HF_DeleteRec(fd, rids[i])) != HFE_OK) {
+            printf("Error deleting record %d (code: %d)\n", i, error);
+            exit(1);
+        }
+        records[i][0] = '\0';
+    }
+    failures += check(fd, FALSE, "after deleting moved records");
+
+    // 5. The zone map is kept in the file
+    if ((error = HF_CloseFile(fd)) != HFE_OK) {
+        PF_PrintError("HF_CloseFile");
+        failures++;
+    }
+    if ((fd = HF_OpenFile(TEST_FILE_HF)) < 0) {
+        PF_PrintError("open " TEST_FILE_HF);
+        exit(1);
+    }
+    failures += check(fd, FALSE, "after reopening");
+    HF_CloseFile(fd);
+    PF_DestroyFile(TEST_FILE_HF);
+    return failures;
+}
+
+int main() {
+    int fd, failures = 0;
+    int fields[] = { 1 };
+
+    printf("Starting HF zone map test (testhf13)...\n");
+    PF_Init();
+    for (int i = 0; i < NUM_RECORDS; i++) {
+        records[i] = malloc(REC_LEN);
+    }
+
+    // 1. Files of fixed-length records have no zone maps
+    PF_DestroyFile(TEST_FILE_HF);
+    if (HF_CreateFileFixed(TEST_FILE_HF, PF_PAGE_SIZE, 0, 16) != HFE_OK ||
+            (fd = HF_OpenFile(TEST_FILE_HF)) < 0) {
+        PF_PrintError("create " TEST_FILE_HF);
+        exit(1);
+    }
+    if (HF_CreateZoneMap(fd, 1, fields) != HFE_NOZONEMAP) {
+        printf("  *** ERROR: a fixed-length file got a zone map ***\n");
+        failures++;
+    }
+    HF_CloseFile(fd);
+
+    // 2. Slotted and dictionary pages
+    failures += testFile(FALSE);
+    failures += testFile(TRUE);
+
+    for (int i = 0; i < NUM_RECORDS; i++) {
+        free(records[i]);
+    }
+    if (failures == 0) {
+        printf("\nSUCCESS! Zone maps skip pages and scans find every match.\n");
+        return 0;
+    }
+    printf("\nFAILURE! %d checks failed.\n", failures);
+    return 1;
+}
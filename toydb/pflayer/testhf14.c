@@ -0,0 +1,239 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pf.h"
+#include "hf.h"
+
+#define TEST_FILE_HF "testhf14.data"
+#define OLD_FILE_HF  "testhf14.old"
+#define SMALL_LEN    1000
+
+static int perFsm;      /* pages one FSM page covers */
+static int numRecords;  /* full-page records, enough for two FSM pages */
+static char **records;
+static RID *rids;
+
+/* Makes record i, "#i;" and then letters, len bytes long */
+static char *makeRecord(int i, int len) {
+    char *record = malloc(len);
+    int head = sprintf(record, "#%d;", i);
+    for (int k = head; k < len; k++)
+        record[k] = 'a' + (i + k) % 26;
+    return record;
+}
+
+/* Copies the header of page "pagenum"; tells whether it is an FSM page */
+static int fsmHeader(int fd, int pagenum, HF_FsmHeader *header) {
+    char *pageBuf;
+    if (PF_GetThisPage(fd, pagenum, &pageBuf) != PFE_OK)
+        return FALSE;
+    *header = *(HF_FsmHeader*)pageBuf;
+    PF_UnfixPage(fd, pagenum, FALSE);
+    return header->numSlots == HF_FSM_PAGE;
+}
+
+/*
+ * Checks that each record not deleted is found by its RID, and that a
+ * scan finds them and "others" more.
+ */
+static int check(int fd, int len, int others, const char *when) {
+    int failures = 0, found = 0;
+    char *data;
+    int recLen;
+
+    for (int i = 0; i < numRecords; i++) {
+        if (records[i] == NULL)
+            continue;
+        if (HF_GetRec(fd, rids[i], &data, &recLen) != HFE_OK || recLen != len ||
+                memcmp(data, records[i], len) != 0) {
+            printf("  *** ERROR (%s): record %d wrong ***\n", when, i);
+            failures++;
+        }
+    }
+    HF_Scan scan;
+    RID rid;
+    HF_OpenFileScan(fd, &scan);
+    while (HF_GetNextRec(fd, &scan, &rid, &data, &recLen) == HFE_OK)
+        found++;
+    HF_CloseFileScan(&scan);
+    int live = 0;
+    for (int i = 0; i < numRecords; i++)
+        live += (records[i] != NULL);
+    if (found != live + others) {
+        printf("  *** ERROR (%s): scan found %d of %d records ***\n", when, found,
+               live + others);
+        failures++;
+    }
+    printf("Checked %d records %s: %d failures\n", live, when, failures);
+    return failures;
+}
+
+static int reopen(int fd) {
+    if (HF_CloseFile(fd) != HFE_OK || (fd = HF_OpenFile(TEST_FILE_HF)) < 0) {
+        PF_PrintError("reopen " TEST_FILE_HF);
+        exit(1);
+    }
+    return fd;
+}
+
+/*
+ * A file written before FSM pages existed, of one empty slotted page:
+ * records go where a scan of the file finds room, and page 0 stays a
+ * data page.
+ */
+static int checkNoFsm(void) {
+    int fd, pagenum, error, failures = 0;
+    char *pageBuf, *data;
+    int len;
+    RID oldRids[40];
+    char *oldRecs[40];
+
+    if (PF_CreateFile(OLD_FILE_HF) != PFE_OK || (fd = PF_OpenFile(OLD_FILE_HF)) < 0 ||
+            PF_AllocPage(fd, &pagenum, &pageBuf) != PFE_OK) {
+        PF_PrintError("create " OLD_FILE_HF);
+        exit(1);
+    }
+    HF_InitPage(pageBuf, PF_PAGE_SIZE);
+    if (PF_UnfixPage(fd, pagenum, TRUE) != PFE_OK || PF_CloseFile(fd) != PFE_OK ||
+            (fd = HF_OpenFile(OLD_FILE_HF)) < 0) {
+        PF_PrintError("open " OLD_FILE_HF);
+        exit(1);
+    }
+    for (int i = 0; i < 40; i++) {
+        oldRecs[i] = makeRecord(i, SMALL_LEN);
+        if ((error = HF_InsertRec(fd, oldRecs[i], SMALL_LEN, &oldRids[i])) != HFE_OK) {
+            printf("Error inserting record %d without an FSM (code: %d)\n", i, error);
+            exit(1);
+        }
+    }
+    // Four records a page, from page 0 on
+    HF_FsmHeader header;
+    if (fsmHeader(fd, 0, &header) || oldRids[0].pageNum != 0 ||
+            PF_NumPages(fd) != 10) {
+        printf("  *** ERROR: no FSM: page 0 %s, %d pages ***\n",
+               fsmHeader(fd, 0, &header) ? "is an FSM page" : "holds data", PF_NumPages(fd));
+        failures++;
+    }
+
+    // A record deleted on page 0 leaves room that the next one takes
+    HF_DeleteRec(fd, oldRids[1]);
+    RID rid;
+    if (HF_InsertRec(fd, oldRecs[1], SMALL_LEN, &rid) != HFE_OK || rid.pageNum != 0 ||
+            PF_NumPages(fd) != 10) {
+        printf("  *** ERROR: no FSM: record put on page %d ***\n", rid.pageNum);
+        failures++;
+    }
+    oldRids[1] = rid;
+    for (int i = 0; i < 40; i++) {
+        if (HF_GetRec(fd, oldRids[i], &data, &len) != HFE_OK || len != SMALL_LEN ||
+                memcmp(data, oldRecs[i], len) != 0) {
+            printf("  *** ERROR: no FSM: record %d wrong ***\n", i);
+            failures++;
+        }
+        free(oldRecs[i]);
+    }
+    HF_CloseFile(fd);
+    PF_DestroyFile(OLD_FILE_HF);
+    printf("Checked a file without an FSM: %d failures\n", failures);
+    return failures;
+}
+
+int main() {
+    int fd, error, failures = 0;
+    int fullLen = HF_MaxInline(PF_PAGE_SIZE);   // a record that fills its page
+    HF_FsmHeader header;
+
+    printf("Starting HF free-space map test (testhf14)...\n\n");
+    PF_Init();
+    perFsm = HF_FsmEntries(PF_PAGE_SIZE);
+    numRecords = perFsm + 50;
+    records = calloc(numRecords, sizeof(char*));
+    rids = calloc(numRecords, sizeof(RID));
+
+    if ((error = HF_CreateFile(TEST_FILE_HF)) != HFE_OK ||
+            (fd = HF_OpenFile(TEST_FILE_HF)) < 0) {
+        PF_PrintError("create " TEST_FILE_HF);
+        exit(1);
+    }
+
+    // 1. A record a page, for more pages than one FSM page covers
+    for (int i = 0; i < numRecords; i++) {
+        records[i] = makeRecord(i, fullLen);
+        if ((error = HF_InsertRec(fd, records[i], fullLen, &rids[i])) != HFE_OK) {
+            printf("Error inserting record %d (code: %d)\n", i, error);
+            exit(1);
+        }
+    }
+    int numPages = PF_NumPages(fd);
+    if (!fsmHeader(fd, 0, &header) || header.nextFsmPage == -1 ||
+            !fsmHeader(fd, header.nextFsmPage, &header) || header.nextFsmPage != -1 ||
+            numPages != numRecords + 2) {
+        printf("  *** ERROR: FSM pages not chained, %d pages ***\n", numPages);
+        failures++;
+    }
+    failures += check(fd, fullLen, 0, "after insert");
+
+    // 2. The first FSM page keeps its hint past the full pages
+    fd = reopen(fd);
+    if (!fsmHeader(fd, 0, &header) || header.hint != perFsm) {
+        printf("  *** ERROR: hint %d after reopen, not %d ***\n", header.hint, perFsm);
+        failures++;
+    }
+
+    // 3. Deleting records makes room that inserts use before growing the file
+    int near = 4, far = perFsm + 20;    // covered by the first FSM page and the second
+    for (int k = 0; k < 2; k++) {
+        int i = (k == 0) ? near : far;
+        if (HF_DeleteRec(fd, rids[i]) != HFE_OK) {
+            printf("Error deleting record %d\n", i);
+            exit(1);
+        }
+        free(records[i]);
+        records[i] = NULL;
+    }
+    fd = reopen(fd);
+    if (!fsmHeader(fd, 0, &header) || header.hint != rids[near].pageNum) {
+        printf("  *** ERROR: hint %d after a delete on page %d ***\n", header.hint,
+               rids[near].pageNum);
+        failures++;
+    }
+    RID rid;
+    char *small = makeRecord(near, SMALL_LEN);
+    if (HF_InsertRec(fd, small, SMALL_LEN, &rid) != HFE_OK ||
+            rid.pageNum != rids[near].pageNum) {
+        printf("  *** ERROR: small record put on page %d, not %d ***\n", rid.pageNum,
+               rids[near].pageNum);
+        failures++;
+    }
+    // ... a full one does not fit there any more, but does on the far page
+    records[far] = makeRecord(far, fullLen);
+    if (HF_InsertRec(fd, records[far], fullLen, &rid) != HFE_OK ||
+            rid.pageNum != rids[far].pageNum) {
+        printf("  *** ERROR: full record put on page %d, not %d ***\n", rid.pageNum,
+               rids[far].pageNum);
+        failures++;
+    }
+    rids[far] = rid;
+    if (PF_NumPages(fd) != numPages) {
+        printf("  *** ERROR: file grew to %d pages ***\n", PF_NumPages(fd));
+        failures++;
+    }
+    failures += check(fd, fullLen, 1, "after reuse");
+    free(small);
+    HF_CloseFile(fd);
+    PF_DestroyFile(TEST_FILE_HF);
+
+    // 4. Files without an FSM
+    failures += checkNoFsm();
+
+    for (int i = 0; i < numRecords; i++)
+        free(records[i]);
+    free(records);
+    free(rids);
+    if (failures == 0) {
+        printf("\nSUCCESS! The FSM finds room across FSM pages and after deletes.\n");
+        return 0;
+    }
+    printf("\nFAILURE! %d checks failed.\n", failures);
+    return 1;
+}
@@ -0,0 +1,149 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pf.h"
+#include "hf.h"
+
+#define TEST_FILE_HF "testhf15.data"
+#define NUM_RECORDS 200
+#define REC_LEN 200
+#define BIG_LEN 300     /* longer than the gap left on a full page */
+
+static char records[NUM_RECORDS + 1][BIG_LEN];
+static int lens[NUM_RECORDS + 1];
+static RID rids[NUM_RECORDS + 1];   /* the last one is inserted after deletes */
+
+static void makeRecord(int i, int len) {
+    memset(records[i], 'a' + i % 26, len);
+    sprintf(records[i], "#%d;", i);
+    records[i][strlen(records[i])] = 'x';
+    lens[i] = len;
+}
+
+/* Tells whether a record inserted later took the slot of deleted record i */
+static int reused(int i, int n) {
+    for (int j = 0; j < n; j++)
+        if (lens[j] > 0 && rids[j].pageNum == rids[i].pageNum &&
+                rids[j].slotNum == rids[i].slotNum)
+            return TRUE;
+    return FALSE;
+}
+
+/* Checks every record by its RID, deleted ones having length 0 */
+static int check(int fd, int n, const char *when) {
+    int failures = 0, live = 0;
+
+    for (int i = 0; i < n; i++) {
+        char *data;
+        int len;
+        int error = HF_GetRec(fd, rids[i], &data, &len);
+        if (lens[i] == 0) {
+            if (error == HFE_OK && !reused(i, n)) {
+                printf("  *** ERROR (%s): deleted record %d still found ***\n", when, i);
+                failures++;
+            }
+            continue;
+        }
+        live++;
+        if (error != HFE_OK || len != lens[i] || memcmp(data, records[i], len) != 0) {
+            printf("  *** ERROR (%s): record %d at (%d, %d) wrong (code %d) ***\n", when, i,
+                   rids[i].pageNum, rids[i].slotNum, error);
+            failures++;
+        }
+    }
+    printf("Checked %d records %s: %d failures\n", live, when, failures);
+    return failures;
+}
+
+/* Deletes record i, which must be on page "pagenum" */
+static void deleteRec(int fd, int i, int pagenum) {
+    int error;
+    if (rids[i].pageNum != pagenum) {
+        printf("Record %d is on page %d, not %d\n", i, rids[i].pageNum, pagenum);
+        exit(1);
+    }
+    if ((error = HF_DeleteRec(fd, rids[i])) != HFE_OK) {
+        printf("Error deleting record %d (code: %d)\n", i, error);
+        exit(1);
+    }
+    lens[i] = 0;
+}
+
+int main() {
+    int fd, error, failures = 0;
+    long reclaimed;
+
+    printf("Starting HF compaction and vacuum test (testhf15)...\n\n");
+    PF_Init();
+    if ((error = HF_CreateFile(TEST_FILE_HF)) != HFE_OK ||
+            (fd = HF_OpenFile(TEST_FILE_HF)) < 0) {
+        PF_PrintError("create " TEST_FILE_HF);
+        exit(1);
+    }
+    for (int i = 0; i < NUM_RECORDS; i++) {
+        makeRecord(i, REC_LEN);
+        if ((error = HF_InsertRec(fd, records[i], lens[i], &rids[i])) != HFE_OK) {
+            printf("Error inserting record %d (code: %d)\n", i, error);
+            exit(1);
+        }
+    }
+    int perPage = 0;
+    while (rids[perPage].pageNum == rids[0].pageNum)
+        perPage++;
+    failures += check(fd, NUM_RECORDS, "after insert");
+
+    // 1. An insert that only fits in the space of deleted records
+    // compacts the page; the records left on it keep their RIDs
+    int first = rids[0].pageNum;
+    deleteRec(fd, 3, first);
+    deleteRec(fd, 4, first);
+    makeRecord(NUM_RECORDS, BIG_LEN);
+    if ((error = HF_InsertRec(fd, records[NUM_RECORDS], BIG_LEN, &rids[NUM_RECORDS])) != HFE_OK) {
+        printf("Error inserting a record after deletes (code: %d)\n", error);
+        exit(1);
+    }
+    if (rids[NUM_RECORDS].pageNum != first) {
+        printf("  *** ERROR: record put on page %d, not the compacted page %d ***\n",
+               rids[NUM_RECORDS].pageNum, first);
+        failures++;
+    }
+    failures += check(fd, NUM_RECORDS + 1, "after compaction by insert");
+
+    // 2. HF_Vacuum compacts a page with a quarter of it dead, giving
+    // back the bytes of its deleted records, and leaves one with less
+    int many = rids[2 * perPage].pageNum, few = rids[3 * perPage].pageNum;
+    int dead = 0;
+    for (int k = 1; k <= PF_PAGE_SIZE / HF_VACUUM_FRACTION / REC_LEN + 1; k++) {
+        deleteRec(fd, 2 * perPage + k, many);
+        dead += REC_LEN;
+    }
+    deleteRec(fd, 3 * perPage + 1, few);
+    deleteRec(fd, 3 * perPage + 2, few);
+    if ((error = HF_Vacuum(fd, &reclaimed)) != HFE_OK) {
+        printf("Error vacuuming (code: %d)\n", error);
+        exit(1);
+    }
+    if (reclaimed != dead) {
+        printf("  *** ERROR: vacuum reclaimed %ld bytes, not %d ***\n", reclaimed, dead);
+        failures++;
+    }
+    failures += check(fd, NUM_RECORDS + 1, "after vacuum");
+
+    // ... and finds nothing left to do after it
+    HF_CloseFile(fd);
+    if ((fd = HF_OpenFile(TEST_FILE_HF)) < 0 || HF_Vacuum(fd, &reclaimed) != HFE_OK ||
+            reclaimed != 0) {
+        printf("  *** ERROR: second vacuum reclaimed %ld bytes ***\n", reclaimed);
+        failures++;
+    }
+    failures += check(fd, NUM_RECORDS + 1, "after reopen");
+
+    HF_CloseFile(fd);
+    PF_DestroyFile(TEST_FILE_HF);
+    if (failures == 0) {
+        printf("\nSUCCESS! Compaction keeps RIDs and vacuum counts what it reclaims.\n");
+        return 0;
+    }
+    printf("\nFAILURE! %d checks failed.\n", failures);
+    return 1;
+}
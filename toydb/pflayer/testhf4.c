@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pf.h"
+#include "hf.h"
+
+#define TEST_FILE_HF "testhf4.data"
+#define NUM_RECORDS 2000    // enough for a few runs of bulk-appended pages
+#define BATCH 300
+
+static char records[NUM_RECORDS + 2][64];
+
+int main() {
+    int fd;
+    int error;
+    char *recs[BATCH];
+    int lens[BATCH];
+    RID rids[NUM_RECORDS + 2];
+    char *recordData;
+    int recordLen;
+    int i, n;
+    int failures = 0;
+
+    printf("Starting HF batch insert test (testhf4)...\n\n");
+
+    // 1. Init PF layer, then create and open the file
+    PF_Init();
+    if ((error = HF_CreateFile(TEST_FILE_HF)) != HFE_OK) {
+        PF_PrintError("HF_CreateFile");
+        exit(1);
+    }
+    if ((fd = HF_OpenFile(TEST_FILE_HF)) < 0) {
+        PF_PrintError("HF_OpenFile");
+        exit(1);
+    }
+    for (i = 0; i <= NUM_RECORDS + 1; i++)
+        sprintf(records[i], "Batch record %d, of varying length %*s|", i, i % 37, "");
+
+    // 2. The first batch on its own, the rest in bulk-append mode
+    for (i = 0; i < NUM_RECORDS; i += n) {
+        if (i == BATCH && (error = HF_BeginBulkAppend(fd)) != HFE_OK) {
+            printf("HF_BeginBulkAppend failed (code: %d)\n", error);
+            exit(1);
+        }
+        for (n = 0; n < BATCH && i + n < NUM_RECORDS; n++) {
+            recs[n] = records[i + n];
+            lens[n] = strlen(records[i + n]) + 1;
+        }
+        if ((error = HF_InsertBatch(fd, recs, lens, n, &rids[i])) != HFE_OK) {
+            printf("Error inserting batch at record %d (code: %d)\n", i, error);
+            exit(1);
+        }
+    }
+    if ((error = HF_EndBulkAppend(fd)) != HFE_OK) {
+        printf("HF_EndBulkAppend failed (code: %d)\n", error);
+        exit(1);
+    }
+    printf("Inserted %d records in batches of %d.\n", NUM_RECORDS, BATCH);
+
+    // 3. An ordinary insert should go on a page with room, not a new one
+    if ((error = HF_InsertRec(fd, records[NUM_RECORDS],
+                              strlen(records[NUM_RECORDS]) + 1,
+                              &rids[NUM_RECORDS])) != HFE_OK) {
+        printf("Error inserting the last record (code: %d)\n", error);
+        exit(1);
+    }
+    if (rids[NUM_RECORDS].pageNum > rids[NUM_RECORDS - 1].pageNum) {
+        printf("  *** ERROR: HF_InsertRec took a new page (%d) ***\n",
+               rids[NUM_RECORDS].pageNum);
+        failures++;
+    }
+
+    // ... and so should a batch outside bulk-append mode
+    recs[0] = records[NUM_RECORDS + 1];
+    lens[0] = strlen(records[NUM_RECORDS + 1]) + 1;
+    if ((error = HF_InsertBatch(fd, recs, lens, 1, &rids[NUM_RECORDS + 1])) != HFE_OK) {
+        printf("Error inserting the last batch (code: %d)\n", error);
+        exit(1);
+    }
+    if (rids[NUM_RECORDS + 1].pageNum > rids[NUM_RECORDS - 1].pageNum) {
+        printf("  *** ERROR: HF_InsertBatch took a new page (%d) ***\n",
+               rids[NUM_RECORDS + 1].pageNum);
+        failures++;
+    }
+
+    // 4. Every RID must give back its record
+    for (i = 0; i <= NUM_RECORDS + 1; i++) {
+        if (HF_GetRec(fd, rids[i], &recordData, &recordLen) != HFE_OK ||
+                strcmp(recordData, records[i]) != 0) {
+            printf("  *** ERROR: record %d not found at RID (Page %d, Slot %d) ***\n",
+                   i, rids[i].pageNum, rids[i].slotNum);
+            failures++;
+        }
+    }
+
+    // 5. A scan must find all of them once
+    HF_Scan scan;
+    RID rid;
+    int recordsFound = 0;
+    HF_OpenFileScan(fd, &scan);
+    while ((error = HF_GetNextRec(fd, &scan, &rid, &recordData, &recordLen)) == HFE_OK)
+        recordsFound++;
+    HF_CloseFileScan(&scan);
+    printf("Scan found %d records, expected %d.\n", recordsFound, NUM_RECORDS + 2);
+    if (error != HFE_EOF || recordsFound != NUM_RECORDS + 2)
+        failures++;
+
+    // 6. Clean up
+    if ((error = HF_CloseFile(fd)) != HFE_OK) {
+        PF_PrintError("HF_CloseFile");
+        exit(1);
+    }
+    if ((error = PF_DestroyFile(TEST_FILE_HF)) != PFE_OK) {
+        PF_PrintError("PF_DestroyFile");
+        exit(1);
+    }
+
+    if (failures == 0) {
+        printf("SUCCESS! All batch-inserted records are where their RIDs say.\n");
+        return 0;
+    }
+    printf("FAILURE! %d checks failed.\n", failures);
+    return 1;
+}
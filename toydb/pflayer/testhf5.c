@@ -0,0 +1,355 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pf.h"
+#include "hf.h"
+
+#define TEST_FILE_HF "testhf5.data"
+#define NUM_RECORDS 400
+
+static char records[NUM_RECORDS][600];
+
+/* Checks that every record is found by its RID and by a scan */
+static int check(int fd, RID *rids, int live, const char *when) {
+    char *recordData;
+    int recordLen;
+    int failures = 0;
+
+    for (int i = 0; i < NUM_RECORDS; i++) {
+        int error = HF_GetRec(fd, rids[i], &recordData, &recordLen);
+        if (records[i][0] == '\0') {
+            if (error == HFE_OK) {
+                printf("  *** ERROR (%s): deleted record %d still found ***\n", when, i);
+                failures++;
+            }
+        } else if (error != HFE_OK || recordLen != (int)strlen(records[i]) + 1 ||
+                   strcmp(recordData, records[i]) != 0) {
+            printf("  *** ERROR (%s): record %d wrong at RID (Page %d, Slot %d) ***\n",
+                   when, i, rids[i].pageNum, rids[i].slotNum);
+            failures++;
+        }
+    }
+
+    HF_Scan scan;
+    RID rid;
+    int found = 0;
+    HF_OpenFileScan(fd, &scan);
+    while (HF_GetNextRec(fd, &scan, &rid, &recordData, &recordLen) == HFE_OK) {
+        int i = atoi(recordData + 1);   // records start with #<i>
+        if (i < 0 || i >= NUM_RECORDS || rid.pageNum != rids[i].pageNum ||
+                rid.slotNum != rids[i].slotNum || strcmp(recordData, records[i]) != 0) {
+            printf("  *** ERROR (%s): scan gave RID (Page %d, Slot %d) for '%.20s' ***\n",
+                   when, rid.pageNum, rid.slotNum, recordData);
+            failures++;
+        }
+        found++;
+    }
+    HF_CloseFileScan(&scan);
+    if (found != live) {
+        printf("  *** ERROR (%s): scan found %d records, expected %d ***\n", when, found, live);
+        failures++;
+    }
+
+    // A batch scan, in batches smaller than a page, gives the same
+    RID batchRids[7];
+    char *batch[7];
+    int lens[7], n;
+    found = 0;
+    HF_OpenFileScan(fd, &scan);
+    while ((n = HF_GetNextBatch(fd, &scan, batchRids, batch, lens, 7)) > 0) {
+        for (int k = 0; k < n; k++) {
+            int i = atoi(batch[k] + 1);
+            if (i < 0 || i >= NUM_RECORDS || batchRids[k].pageNum != rids[i].pageNum ||
+                    batchRids[k].slotNum != rids[i].slotNum ||
+                    lens[k] != (int)strlen(records[i]) + 1 || strcmp(batch[k], records[i]) != 0) {
+                printf("  *** ERROR (%s): batch scan gave RID (Page %d, Slot %d) for '%.20s' ***\n",
+                       when, batchRids[k].pageNum, batchRids[k].slotNum, batch[k]);
+                failures++;
+            }
+            found++;
+        }
+    }
+    HF_CloseFileScan(&scan);
+    if (n != HFE_EOF || found != live) {
+        printf("  *** ERROR (%s): batch scan found %d records, expected %d ***\n", when, found, live);
+        failures++;
+    }
+    printf("Checked %d records %s: %d failures\n", live, when, failures);
+    return failures;
+}
+
+/*
+ * Pins every record, PIN_BATCH at a time, and the same record twice,
+ * reading other records in between, then checks them all and lets
+ * them go: pinned records stay where they are in the buffer pool.
+ */
+#define PIN_BATCH 50
+static int checkPinned(int fd, RID *rids) {
+    HF_RecHandle handles[PIN_BATCH], again;
+    char *recordData;
+    int recordLen;
+    int failures = 0;
+
+    for (int first = 0; first < NUM_RECORDS; first += PIN_BATCH) {
+        int error = HF_PinRecs(fd, &rids[first], PIN_BATCH, handles);
+        if (error == HFE_OK)
+            error = HF_PinRec(fd, rids[first], &again);
+        if (error != HFE_OK) {
+            printf("  *** ERROR: pinning records %d on failed (code: %d) ***\n", first, error);
+            failures++;
+            continue;
+        }
+        // Other pages come and go in the buffer pool meanwhile
+        for (int i = 0; i < NUM_RECORDS; i += 7)
+            HF_GetRec(fd, rids[i], &recordData, &recordLen);
+        for (int k = 0; k < PIN_BATCH; k++) {
+            int i = first + k;
+            if (handles[k].recLen != (int)strlen(records[i]) + 1 ||
+                    strcmp(handles[k].record, records[i]) != 0) {
+                printf("  *** ERROR: pinned record %d is wrong ***\n", i);
+                failures++;
+            }
+        }
+        if (HF_ReleaseRecs(handles, PIN_BATCH) != HFE_OK ||
+                strcmp(again.record, records[first]) != 0 || HF_ReleaseRec(&again) != HFE_OK) {
+            printf("  *** ERROR: releasing records %d on failed ***\n", first);
+            failures++;
+        }
+    }
+
+    // A second open of the file shares its buffer pages: a record
+    // pinned through one reads through the other, and scans through
+    // both go side by side
+    int fd2 = HF_OpenFile(TEST_FILE_HF);
+    HF_Scan scan, scan2;
+    RID rid, rid2;
+    char *recordData2;
+    int recordLen2, found = 0, error = HFE_OK, error2 = HFE_OK;
+    if (fd2 < 0 || HF_PinRec(fd, rids[1], &again) != HFE_OK ||
+            HF_GetRec(fd2, rids[1], &recordData, &recordLen) != HFE_OK ||
+            recordData != again.record || HF_ReleaseRec(&again) != HFE_OK) {
+        printf("  *** ERROR: record pinned through one open not read through another ***\n");
+        failures++;
+    }
+    HF_OpenFileScan(fd, &scan);
+    HF_OpenFileScan(fd2, &scan2);
+    while ((error = HF_GetNextRec(fd, &scan, &rid, &recordData, &recordLen)) == HFE_OK &&
+            (error2 = HF_GetNextRec(fd2, &scan2, &rid2, &recordData2, &recordLen2)) == HFE_OK &&
+            rid.pageNum == rid2.pageNum && rid.slotNum == rid2.slotNum)
+        found++;
+    HF_CloseFileScan(&scan);
+    HF_CloseFileScan(&scan2);
+    if (error != HFE_EOF || error2 != HFE_OK || found != NUM_RECORDS ||
+            HF_CloseFile(fd2) != HFE_OK) {
+        printf("  *** ERROR: scans through two opens gave %d records (codes %d, %d) ***\n",
+               found, error, error2);
+        failures++;
+    }
+
+    // Their pages are let go: records there are updated as usual
+    for (int i = 0; i < NUM_RECORDS; i += PIN_BATCH / 2) {
+        if (HF_UpdateRec(fd, rids[i], records[i], strlen(records[i]) + 1) != HFE_OK) {
+            printf("  *** ERROR: record %d cannot be updated after release ***\n", i);
+            failures++;
+        }
+    }
+    printf("Checked %d pinned records: %d failures\n", NUM_RECORDS, failures);
+    return failures;
+}
+
+/*
+ * Inserts, scans, updates and deletes through fd while a record is
+ * pinned: the records on its page go on sharing the page with it,
+ * and the pinned record stays where it is.
+ */
+#define NUM_EXTRA 40
+static int checkChangesWhilePinned(int fd, RID *rids, int *live) {
+    char extra[NUM_EXTRA][32];
+    RID extraRids[NUM_EXTRA];
+    HF_RecHandle handle;
+    HF_Scan scan;
+    RID rid, batchRids[7];
+    char *recordData, *batch[7];
+    int recordLen, lens[7], n, found, error;
+    int failures = 0;
+
+    if ((error = HF_PinRec(fd, rids[1], &handle)) != HFE_OK) {
+        printf("  *** ERROR: pinning record 1 failed (code: %d) ***\n", error);
+        return 1;
+    }
+    int page = rids[1].pageNum;
+
+    // 1. Inserts go in, on the pinned page or elsewhere
+    for (int k = 0; k < NUM_EXTRA; k++) {
+        sprintf(extra[k], "#%d new", NUM_RECORDS + k);
+        if ((error = HF_InsertRec(fd, extra[k], strlen(extra[k]) + 1, &extraRids[k])) != HFE_OK) {
+            printf("  *** ERROR: insert %d while pinned failed (code: %d) ***\n", k, error);
+            failures++;
+        }
+    }
+
+    // 2. Scans go over the pinned page
+    found = 0;
+    HF_OpenFileScan(fd, &scan);
+    while ((error = HF_GetNextRec(fd, &scan, &rid, &recordData, &recordLen)) == HFE_OK)
+        found++;
+    HF_CloseFileScan(&scan);
+    if (error != HFE_EOF || found != *live + NUM_EXTRA) {
+        printf("  *** ERROR: scan while pinned found %d records, expected %d (code: %d) ***\n",
+               found, *live + NUM_EXTRA, error);
+        failures++;
+    }
+    found = 0;
+    HF_OpenFileScan(fd, &scan);
+    while ((n = HF_GetNextBatch(fd, &scan, batchRids, batch, lens, 7)) > 0)
+        found += n;
+    HF_CloseFileScan(&scan);
+    if (n != HFE_EOF || found != *live + NUM_EXTRA) {
+        printf("  *** ERROR: batch scan while pinned found %d records, expected %d ***\n",
+               found, *live + NUM_EXTRA);
+        failures++;
+    }
+
+    // 3. Another record of the page is deleted, and one grown
+    int deleted = -1, grown = -1;
+    for (int i = 2; i < NUM_RECORDS && (deleted < 0 || grown < 0); i++) {
+        if (rids[i].pageNum != page || records[i][0] == '\0')
+            continue;
+        if (deleted < 0) {
+            deleted = i;
+            if ((error = HF_DeleteRec(fd, rids[i])) != HFE_OK) {
+                printf("  *** ERROR: deleting record %d while pinned failed (code: %d) ***\n",
+                       i, error);
+                failures++;
+            }
+            records[i][0] = '\0';
+            (*live)--;
+        } else {
+            grown = i;
+            sprintf(records[i], "#%d grown while pinned %0*d", i, 300, 0);
+            if ((error = HF_UpdateRec(fd, rids[i], records[i], strlen(records[i]) + 1)) != HFE_OK) {
+                printf("  *** ERROR: updating record %d while pinned failed (code: %d) ***\n",
+                       i, error);
+                failures++;
+            }
+        }
+    }
+    if (deleted < 0 || grown < 0) {
+        printf("  *** ERROR: no other records on page %d ***\n", page);
+        failures++;
+    }
+    for (int k = 0; k < NUM_EXTRA; k++) {
+        if ((error = HF_DeleteRec(fd, extraRids[k])) != HFE_OK) {
+            printf("  *** ERROR: deleting new record %d while pinned failed (code: %d) ***\n",
+                   k, error);
+            failures++;
+        }
+    }
+
+    // 4. The pinned record has not moved
+    if (handle.recLen != (int)strlen(records[1]) + 1 || strcmp(handle.record, records[1]) != 0 ||
+            HF_GetRec(fd, rids[1], &recordData, &recordLen) != HFE_OK ||
+            recordData != handle.record) {
+        printf("  *** ERROR: pinned record 1 changed while its page was changed ***\n");
+        failures++;
+    }
+    if (HF_ReleaseRec(&handle) != HFE_OK) {
+        printf("  *** ERROR: releasing record 1 failed ***\n");
+        failures++;
+    }
+    printf("Changed the page of a pinned record: %d failures\n", failures);
+    return failures;
+}
+
+int main() {
+    int fd;
+    int error;
+    RID rids[NUM_RECORDS];
+    int i;
+    int failures = 0;
+
+    printf("Starting HF update test (testhf5)...\n\n");
+
+    PF_Init();
+    if ((error = HF_CreateFile(TEST_FILE_HF)) != HFE_OK) {
+        PF_PrintError("HF_CreateFile");
+        exit(1);
+    }
+    if ((fd = HF_OpenFile(TEST_FILE_HF)) < 0) {
+        PF_PrintError("HF_OpenFile");
+        exit(1);
+    }
+
+    // 1. Fill some pages with short records
+    for (i = 0; i < NUM_RECORDS; i++) {
+        sprintf(records[i], "#%d short", i);
+        if ((error = HF_InsertRec(fd, records[i], strlen(records[i]) + 1, &rids[i])) != HFE_OK) {
+            printf("Error inserting record %d (code: %d)\n", i, error);
+            exit(1);
+        }
+    }
+    failures += check(fd, rids, NUM_RECORDS, "after insert");
+
+    // 2. Shrink some in place, and grow every third one far past
+    //    what its page has room for, so that it moves
+    for (i = 0; i < NUM_RECORDS; i++) {
+        if (i % 3 == 0)
+            sprintf(records[i], "#%d grown %0*d", i, 200 + i % 300, 0);
+        else if (i % 3 == 1)
+            sprintf(records[i], "#%d", i);
+        else
+            continue;
+        if ((error = HF_UpdateRec(fd, rids[i], records[i], strlen(records[i]) + 1)) != HFE_OK) {
+            printf("Error updating record %d (code: %d)\n", i, error);
+            exit(1);
+        }
+    }
+    failures += check(fd, rids, NUM_RECORDS, "after growing updates");
+
+    // 3. Grow moved records again, then shrink some back so they go home
+    for (i = 0; i < NUM_RECORDS; i += 3) {
+        if (i % 2 == 0)
+            sprintf(records[i], "#%d grown again %0*d", i, 400, 0);
+        else
+            sprintf(records[i], "#%d home", i);
+        if ((error = HF_UpdateRec(fd, rids[i], records[i], strlen(records[i]) + 1)) != HFE_OK) {
+            printf("Error updating record %d again (code: %d)\n", i, error);
+            exit(1);
+        }
+    }
+    failures += check(fd, rids, NUM_RECORDS, "after moving records again");
+    failures += checkPinned(fd, rids);
+
+    // 4. Delete moved and unmoved records
+    int live = NUM_RECORDS;
+    for (i = 0; i < NUM_RECORDS; i += 4) {
+        if ((error = HF_DeleteRec(fd, rids[i])) != HFE_OK) {
+            printf("Error deleting record %d (code: %d)\n", i, error);
+            exit(1);
+        }
+        records[i][0] = '\0';
+        live--;
+    }
+    failures += check(fd, rids, live, "after deletes");
+
+    // 5. Change the file while a record is pinned
+    failures += checkChangesWhilePinned(fd, rids, &live);
+    failures += check(fd, rids, live, "after changes while pinned");
+
+    // 6. Clean up
+    if ((error = HF_CloseFile(fd)) != HFE_OK) {
+        PF_PrintError("HF_CloseFile");
+        exit(1);
+    }
+    if ((error = PF_DestroyFile(TEST_FILE_HF)) != PFE_OK) {
+        PF_PrintError("PF_DestroyFile");
+        exit(1);
+    }
+
+    if (failures == 0) {
+        printf("SUCCESS! Updated records keep their RIDs.\n");
+        return 0;
+    }
+    printf("FAILURE! %d checks failed.\n", failures);
+    return 1;
+}
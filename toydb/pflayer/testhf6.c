@@ -0,0 +1,301 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pf.h"
+#include "hf.h"
+
+#define TEST_FILE_HF "testhf6.data"
+#define NUM_RECORDS 3000
+#define REC_LEN 24
+#define BATCH 500
+
+/* PAX records: a number field, a text field and a short tag */
+static int paxWidths[] = { 6, REC_LEN - 10, 4 };
+
+static char records[NUM_RECORDS][REC_LEN];
+static int deleted[NUM_RECORDS];
+
+/* Checks that every record is found by its RID and by a scan */
+static int check(int fd, RID *rids, int live, const char *when) {
+    char *recordData;
+    int recordLen;
+    int failures = 0;
+
+    for (int i = 0; i < NUM_RECORDS; i++) {
+        int error = HF_GetRec(fd, rids[i], &recordData, &recordLen);
+        if (deleted[i]) {
+            if (error == HFE_OK) {
+                printf("  *** ERROR (%s): deleted record %d still found ***\n", when, i);
+                failures++;
+            }
+        } else if (error != HFE_OK || recordLen != REC_LEN ||
+                   memcmp(recordData, records[i], REC_LEN) != 0) {
+            printf("  *** ERROR (%s): record %d wrong at RID (Page %d, Slot %d) ***\n",
+                   when, i, rids[i].pageNum, rids[i].slotNum);
+            failures++;
+        }
+    }
+
+    HF_Scan scan;
+    RID rid;
+    int found = 0;
+    HF_OpenFileScan(fd, &scan);
+    while (HF_GetNextRec(fd, &scan, &rid, &recordData, &recordLen) == HFE_OK) {
+        int i = atoi(recordData + 1);   // records start with #<i>
+        if (i < 0 || i >= NUM_RECORDS || deleted[i] ||
+                rid.pageNum != rids[i].pageNum || rid.slotNum != rids[i].slotNum) {
+            printf("  *** ERROR (%s): scan gave RID (Page %d, Slot %d) for '%.20s' ***\n",
+                   when, rid.pageNum, rid.slotNum, recordData);
+            failures++;
+        }
+        found++;
+    }
+    HF_CloseFileScan(&scan);
+    if (found != live) {
+        printf("  *** ERROR (%s): scan found %d records, expected %d ***\n", when, found, live);
+        failures++;
+    }
+
+    // A batch scan gives the same, a page at a time (PAX records put together)
+    RID batchRids[BATCH];
+    char *batch[BATCH];
+    int lens[BATCH], n;
+    found = 0;
+    HF_OpenFileScan(fd, &scan);
+    while ((n = HF_GetNextBatch(fd, &scan, batchRids, batch, lens, BATCH)) > 0) {
+        for (int k = 0; k < n; k++) {
+            int i = atoi(batch[k] + 1);
+            if (i < 0 || i >= NUM_RECORDS || deleted[i] || lens[k] != REC_LEN ||
+                    batchRids[k].pageNum != rids[i].pageNum ||
+                    batchRids[k].slotNum != rids[i].slotNum ||
+                    memcmp(batch[k], records[i], REC_LEN) != 0) {
+                printf("  *** ERROR (%s): batch scan gave RID (Page %d, Slot %d) for '%.20s' ***\n",
+                       when, batchRids[k].pageNum, batchRids[k].slotNum, batch[k]);
+                failures++;
+            }
+            found++;
+        }
+    }
+    HF_CloseFileScan(&scan);
+    if (n != HFE_EOF || found != live) {
+        printf("  *** ERROR (%s): batch scan found %d records, expected %d ***\n", when, found, live);
+        failures++;
+    }
+    HF_OpenFileScan(fd, &scan);
+    if (HF_GetNextBatch(fd + 1, &scan, batchRids, batch, lens, BATCH) != PFE_FD) {
+        printf("  *** ERROR (%s): batch scan of another file's fd ***\n", when);
+        failures++;
+    }
+    HF_CloseFileScan(&scan);
+    printf("Checked %d records %s: %d failures\n", live, when, failures);
+    return failures;
+}
+
+/* Scans the middle field of a PAX file, checking it against the records */
+static int checkField(int fd, RID *rids, int live) {
+    HF_Scan scan;
+    RID rid;
+    char *value;
+    int len, found = 0, failures = 0;
+
+    HF_OpenFileScan(fd, &scan);
+    while (HF_GetNextField(fd, &scan, 1, &rid, &value, &len) == HFE_OK) {
+        int i;
+        for (i = 0; i < NUM_RECORDS; i++)
+            if (!deleted[i] && rids[i].pageNum == rid.pageNum &&
+                    rids[i].slotNum == rid.slotNum)
+                break;
+        if (i == NUM_RECORDS || len != paxWidths[1] ||
+                memcmp(value, records[i] + paxWidths[0], len) != 0) {
+            printf("  *** ERROR: field scan gave a wrong value at RID (Page %d, Slot %d) ***\n",
+                   rid.pageNum, rid.slotNum);
+            failures++;
+        }
+        found++;
+    }
+    HF_CloseFileScan(&scan);
+    if (found != live) {
+        printf("  *** ERROR: field scan found %d values, expected %d ***\n", found, live);
+        failures++;
+    }
+    HF_OpenFileScan(fd, &scan);
+    if (HF_GetNextField(fd + 1, &scan, 1, &rid, &value, &len) != PFE_FD) {
+        printf("  *** ERROR: field scan of another file's fd ***\n");
+        failures++;
+    }
+    HF_CloseFileScan(&scan);
+    printf("Checked field 1 of %d records: %d failures\n", live, failures);
+    return failures;
+}
+
+/* Runs the test on a file of fixed pages, or of PAX pages */
+static int test(int pax) {
+    int fd;
+    int error;
+    RID rids[NUM_RECORDS];
+    char *recs[BATCH];
+    int lens[BATCH];
+    int i, live;
+    int failures = 0;
+
+    printf("--- %s pages ---\n", pax ? "PAX" : "Fixed");
+    memset(deleted, 0, sizeof(deleted));
+    error = pax ? HF_CreateFilePax(TEST_FILE_HF, PF_PAGE_SIZE, 0, 3, paxWidths)
+                : HF_CreateFileFixed(TEST_FILE_HF, PF_PAGE_SIZE, 0, REC_LEN);
+    if (error != HFE_OK) {
+        PF_PrintError("HF_CreateFileFixed/HF_CreateFilePax");
+        exit(1);
+    }
+    if ((fd = HF_OpenFile(TEST_FILE_HF)) < 0) {
+        PF_PrintError("HF_OpenFile");
+        exit(1);
+    }
+    for (i = 0; i < NUM_RECORDS; i++)
+        snprintf(records[i], REC_LEN, "#%d fixed", i);
+
+    // 1. Half the records one at a time, the rest in batches
+    for (i = 0; i < NUM_RECORDS / 2; i++) {
+        if ((error = HF_InsertRec(fd, records[i], REC_LEN, &rids[i])) != HFE_OK) {
+            printf("Error inserting record %d (code: %d)\n", i, error);
+            exit(1);
+        }
+    }
+    for (; i < NUM_RECORDS; i += BATCH) {
+        for (int k = 0; k < BATCH; k++) {
+            recs[k] = records[i + k];
+            lens[k] = REC_LEN;
+        }
+        if ((error = HF_InsertBatch(fd, recs, lens, BATCH, &rids[i])) != HFE_OK) {
+            printf("Error inserting batch at record %d (code: %d)\n", i, error);
+            exit(1);
+        }
+    }
+    failures += check(fd, rids, NUM_RECORDS, "after insert");
+
+    // 2. No slot entries: the rows and one bit each fill the pages
+    int header = pax ? sizeof(HF_PaxHeader) : sizeof(HF_FixedHeader);
+    int perPage = (PF_PAGE_SIZE - header) * 8 / (REC_LEN * 8 + 1);
+    // (plus the FSM page, and a partly filled page for each batch)
+    int maxPages = 1 + (NUM_RECORDS + perPage - 1) / perPage +
+                   NUM_RECORDS / 2 / BATCH + 1;
+    printf("%d records on %d pages (%d rows a page)\n",
+           NUM_RECORDS, PF_NumUsedPages(fd), perPage);
+    if (PF_NumUsedPages(fd) > maxPages) {
+        printf("  *** ERROR: expected at most %d pages ***\n", maxPages);
+        failures++;
+    }
+
+    // 3. Records of another length are turned away
+    char longer[REC_LEN + 1] = "#too long";
+    HF_Scan scan;
+    RID rid;
+    char *recordData;
+    int recordLen;
+    if (HF_InsertRec(fd, longer, REC_LEN + 1, &rid) != HFE_RECLEN ||
+            HF_UpdateRec(fd, rids[0], longer, REC_LEN - 1) != HFE_RECLEN) {
+        printf("  *** ERROR: a record of the wrong length was not refused ***\n");
+        failures++;
+    }
+    // ... in bulk-append mode too, on a page begun with a good record
+    if ((error = HF_BeginBulkAppend(fd)) != HFE_OK ||
+            (error = HF_InsertRec(fd, records[0], REC_LEN, &rid)) != HFE_OK) {
+        printf("Error inserting in bulk-append mode (code: %d)\n", error);
+        exit(1);
+    }
+    if (HF_InsertRec(fd, longer, REC_LEN + 1, &rid) != HFE_RECLEN) {
+        printf("  *** ERROR: a record of the wrong length was bulk-appended ***\n");
+        failures++;
+    }
+    if ((error = HF_EndBulkAppend(fd)) != HFE_OK ||
+            (error = HF_DeleteRec(fd, rid)) != HFE_OK) {
+        printf("Error deleting the bulk-appended record (code: %d)\n", error);
+        exit(1);
+    }
+
+    // 4. Delete every third record, update the others in place
+    live = NUM_RECORDS;
+    for (i = 0; i < NUM_RECORDS; i++) {
+        if (i % 3 == 0) {
+            if ((error = HF_DeleteRec(fd, rids[i])) != HFE_OK) {
+                printf("Error deleting record %d (code: %d)\n", i, error);
+                exit(1);
+            }
+            deleted[i] = 1;
+            live--;
+        } else {
+            snprintf(records[i], REC_LEN, "#%d updated", i);
+            if ((error = HF_UpdateRec(fd, rids[i], records[i], REC_LEN)) != HFE_OK) {
+                printf("Error updating record %d (code: %d)\n", i, error);
+                exit(1);
+            }
+        }
+    }
+    failures += check(fd, rids, live, "after deletes and updates");
+
+    // 5. Inserting them again reuses the free rows: no new pages
+    int pages = PF_NumUsedPages(fd);
+    for (i = 0; i < NUM_RECORDS; i += 3) {
+        snprintf(records[i], REC_LEN, "#%d again", i);
+        if ((error = HF_InsertRec(fd, records[i], REC_LEN, &rids[i])) != HFE_OK) {
+            printf("Error reinserting record %d (code: %d)\n", i, error);
+            exit(1);
+        }
+        deleted[i] = 0;
+        live++;
+    }
+    if (PF_NumUsedPages(fd) != pages) {
+        printf("  *** ERROR: reinserting took %d new pages ***\n",
+               PF_NumUsedPages(fd) - pages);
+        failures++;
+    }
+    failures += check(fd, rids, live, "after reinserting");
+
+    // A pinned record of a PAX page is a copy of its own
+    HF_RecHandle handles[2];
+    if (HF_PinRecs(fd, &rids[1], 2, handles) != HFE_OK ||
+            memcmp(handles[0].record, records[1], REC_LEN) != 0 ||
+            memcmp(handles[1].record, records[2], REC_LEN) != 0 ||
+            HF_ReleaseRecs(handles, 2) != HFE_OK) {
+        printf("  *** ERROR: pinned records 1 and 2 are wrong ***\n");
+        failures++;
+    }
+    if (pax) {
+        failures += checkField(fd, rids, live);
+    } else if (HF_OpenFileScan(fd, &scan) == HFE_OK) {
+        // A field of a fixed page cannot be told apart
+        if (HF_GetNextField(fd, &scan, 1, &rid, &recordData, &recordLen) != HFE_NOFIELDS) {
+            printf("  *** ERROR: field scan of a file without fields ***\n");
+            failures++;
+        }
+        HF_CloseFileScan(&scan);
+    }
+
+    // 6. Clean up
+    if ((error = HF_CloseFile(fd)) != HFE_OK) {
+        PF_PrintError("HF_CloseFile");
+        exit(1);
+    }
+    if ((error = PF_DestroyFile(TEST_FILE_HF)) != PFE_OK) {
+        PF_PrintError("PF_DestroyFile");
+        exit(1);
+    }
+    printf("\n");
+    return failures;
+}
+
+int main() {
+    int failures = 0;
+
+    printf("Starting HF fixed-length record test (testhf6)...\n\n");
+
+    PF_Init();
+    failures += test(FALSE);
+    failures += test(TRUE);
+
+    if (failures == 0) {
+        printf("SUCCESS! Fixed-length records are where their RIDs say.\n");
+        return 0;
+    }
+    printf("FAILURE! %d checks failed.\n", failures);
+    return 1;
+}
@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "pf.h"
+#include "schema.h"
+
+#define TEST_FILE_HF "testhf7.data"
+#define TEST_CATALOG "testhf7.cat"
+
+/* Rows of "emp", with NULLs, a short row and negative decimals */
+static const char *rows[] = {
+    "1;Asha;CSE;12.50;Leads the database group",
+    "2;Ravi;EE;-0.75;",
+    "-3;;ME;0.05;x",
+    "2147483647;Zoe;CSE",
+    ";;;;",
+};
+#define NUM_ROWS (int)(sizeof(rows) / sizeof(rows[0]))
+
+/* Rows that must be turned away */
+static const char *badRows[] = {
+    "x;Asha;CSE;1.00;",             // not a number
+    "1;Asha;CSE;1.5;",              // wrong scale
+    "1;Asha;CSE;-0.00;",            // would not decode the same
+    "01;Asha;CSE;1.00;",            // nor would this
+    "1;Asha;CSEE;1.00;",            // too long for char(3)
+    "1;Asha;CSE;1.00;a;b",          // too many values
+    "2147483648;Asha;CSE;1.00;",    // too big for an int
+};
+#define NUM_BAD (int)(sizeof(badRows) / sizeof(badRows[0]))
+
+/* Text a row decodes to: its values, and ';'s for the missing ones */
+static void expected(const char *row, int numCols, char *out) {
+    int semis = 0;
+    strcpy(out, row);
+    for (const char *p = row; *p; p++)
+        semis += (*p == ';');
+    for (; semis < numCols - 1; semis++)
+        strcat(out, ";");
+}
+
+/* Stores the rows as tuples in a file for the schema, and reads them back */
+static int store(HF_Schema *schema, int wantFixed) {
+    char tuple[1024], text[1024], want[1024];
+    RID rids[NUM_ROWS];
+    int fd, error, failures = 0;
+
+    if ((error = HF_CreateFileSchema(TEST_FILE_HF, PF_PAGE_SIZE, 0, schema)) != HFE_OK ||
+            (fd = HF_OpenFile(TEST_FILE_HF)) < 0) {
+        PF_PrintError("HF_CreateFileSchema");
+        exit(1);
+    }
+    for (int i = 0; i < NUM_ROWS; i++) {
+        int len = HF_EncodeTuple(schema, rows[i], strlen(rows[i]), tuple);
+        if (len < 0 || (error = HF_InsertRec(fd, tuple, len, &rids[i])) != HFE_OK) {
+            printf("Error storing row %d (code: %d)\n", i, len < 0 ? len : error);
+            exit(1);
+        }
+    }
+    // A fixed file takes only tuples of its one length
+    RID rid;
+    memset(tuple, 0, schema->tupleLen + 1);
+    if ((HF_InsertRec(fd, tuple, schema->tupleLen + 1, &rid) == HFE_RECLEN) != wantFixed) {
+        printf("  *** ERROR: %s file is not %s ***\n", schema->table,
+               wantFixed ? "fixed-length" : "variable-length");
+        failures++;
+    }
+    for (int i = 0; i < NUM_ROWS; i++) {
+        char *rec;
+        int len;
+        if (HF_GetRec(fd, rids[i], &rec, &len) != HFE_OK) {
+            printf("  *** ERROR: row %d not found ***\n", i);
+            failures++;
+            continue;
+        }
+        HF_DecodeTuple(schema, rec, text);
+        expected(rows[i], schema->numCols, want);
+        if (strcmp(text, want) != 0) {
+            printf("  *** ERROR: row %d came back as '%s' ***\n", i, text);
+            failures++;
+        }
+    }
+    HF_CloseFile(fd);
+    PF_DestroyFile(TEST_FILE_HF);
+    printf("Stored %d %s tuples: %d failures\n", NUM_ROWS,
+           wantFixed ? "fixed" : "variable", failures);
+    return failures;
+}
+
+int main() {
+    HF_Schema schema;
+    char tuple[1024], text[1024], want[1024];
+    int failures = 0;
+
+    printf("Starting HF schema and tuple test (testhf7)...\n\n");
+    PF_Init();
+
+    // 1. Bad declarations are refused
+    const char *badDecls[] = { "emp", "emp id", "emp id:float", "emp id:char(0)",
+                               "emp id:dec(10)", "emp :int", "emp id:varchar(5" };
+    for (int i = 0; i < (int)(sizeof(badDecls) / sizeof(badDecls[0])); i++) {
+        if (HF_ParseSchema(badDecls[i], &schema) != HFE_SCHEMA) {
+            printf("  *** ERROR: '%s' was taken ***\n", badDecls[i]);
+            failures++;
+        }
+    }
+
+    // 2. The catalog gives the table, and its line again when formatted
+    const char *decl = "emp id:int name:varchar(20) dept:char(3) pay:dec(2) notes:varchar(200)";
+    FILE *fp = fopen(TEST_CATALOG, "w");
+    fprintf(fp, "# test catalog\nempty x:int\n%s\n", decl);
+    fclose(fp);
+    if (HF_LoadSchema(TEST_CATALOG, "emp", &schema) != HFE_OK) {
+        printf("  *** ERROR: emp not found in the catalog ***\n");
+        exit(1);
+    }
+    HF_FormatSchema(&schema, text, sizeof(text));
+    if (strcmp(text, decl) != 0 || schema.fixed || schema.numCols != 5 ||
+            HF_ColumnNum(&schema, "pay") != 3 || HF_ColumnNum(&schema, "age") != -1) {
+        printf("  *** ERROR: emp read back as '%s' ***\n", text);
+        failures++;
+    }
+    if (HF_LoadSchema(TEST_CATALOG, "em", &schema) != HFE_SCHEMA) {
+        printf("  *** ERROR: found a table that is not there ***\n");
+        failures++;
+    }
+    unlink(TEST_CATALOG);
+    HF_ParseSchema(decl, &schema);
+
+    // 3. Rows come back as they went in, and their fields can be read
+    for (int i = 0; i < NUM_ROWS; i++) {
+        int len = HF_EncodeTuple(&schema, rows[i], strlen(rows[i]), tuple);
+        if (len < schema.tupleLen || len > schema.maxLen) {
+            printf("  *** ERROR: row %d encoded to %d bytes ***\n", i, len);
+            failures++;
+            continue;
+        }
+        HF_DecodeTuple(&schema, tuple, text);
+        expected(rows[i], schema.numCols, want);
+        if (strcmp(text, want) != 0) {
+            printf("  *** ERROR: row %d decoded to '%s' ***\n", i, text);
+            failures++;
+        }
+    }
+    HF_EncodeTuple(&schema, rows[1], strlen(rows[1]), tuple);
+    int len;
+    const char *name = HF_TupleChar(&schema, tuple, 1, &len);
+    if (HF_TupleInt(&schema, tuple, 0) != 2 || HF_TupleInt(&schema, tuple, 3) != -75 ||
+            HF_TupleNum(&schema, tuple, 3) != -0.75 || len != 4 ||
+            memcmp(name, "Ravi", 4) != 0 || HF_TupleIsNull(&schema, tuple, 2) ||
+            !HF_TupleIsNull(&schema, tuple, 4) || !HF_TupleIsNull(&schema, tuple, -1) ||
+            !HF_TupleIsNull(&schema, tuple, schema.numCols)) {
+        printf("  *** ERROR: fields of row 1 are wrong ***\n");
+        failures++;
+    }
+    for (int i = 0; i < NUM_BAD; i++) {
+        if (HF_EncodeTuple(&schema, badRows[i], strlen(badRows[i]), tuple) != HFE_BADVALUE) {
+            printf("  *** ERROR: bad row '%s' was taken ***\n", badRows[i]);
+            failures++;
+        }
+    }
+    printf("Encoded %d rows, refused %d: %d failures\n", NUM_ROWS, NUM_BAD, failures);
+
+    // 4. In heap files: variable-length tuples, then fixed ones
+    failures += store(&schema, FALSE);
+    HF_ParseSchema("emp id:int name:char(4) dept:char(3) pay:dec(2) notes:char(24)", &schema);
+    failures += store(&schema, TRUE);
+
+    if (failures == 0) {
+        printf("\nSUCCESS! Tuples come back as their rows went in.\n");
+        return 0;
+    }
+    printf("\nFAILURE! %d checks failed.\n", failures);
+    return 1;
+}
@@ -0,0 +1,232 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pf.h"
+#include "hf.h"
+
+#define TEST_FILE_HF "testhf8.data"
+#define NUM_RECORDS 2000
+#define REC_LEN 40
+
+/* Records "id;program;score;" with ids long enough to cross SSE blocks */
+static int paxWidths[] = { 12, 8, 6, 14 };
+static char records[NUM_RECORDS][REC_LEN + 1];
+static const char *programs[] = { "BTECH", "MTECH", "PHD", "BT", "" };
+
+/* The record's field, as the scan should see it (-1 if missing) */
+static int field(int i, int f, int pax, char *out) {
+    if (pax) {
+        int off = 0;
+        if (f >= 4)
+            return -1;
+        for (int k = 0; k < f; k++)
+            off += paxWidths[k];
+        int len = paxWidths[f];
+        memcpy(out, records[i] + off, len);
+        while (len > 0 && (out[len - 1] == ' ' || out[len - 1] == '\0'))
+            len--;
+        out[len] = '\0';
+        return len;
+    }
+    const char *p = records[i];
+    for (int k = 0; k < f; k++) {
+        if ((p = strchr(p, ';')) == NULL)
+            return -1;
+        p++;
+    }
+    int len = strcspn(p, ";");
+    memcpy(out, p, len);
+    out[len] = '\0';
+    return len;
+}
+
+/* The records a predicate list should give, worked out the slow way */
+static int expected(HF_Pred *preds, int numPreds, int pax, char *want) {
+    int count = 0;
+    for (int i = 0; i < NUM_RECORDS; i++) {
+        want[i] = 1;
+        for (int p = 0; p < numPreds && want[i]; p++) {
+            char value[REC_LEN + 1], *end;
+            if (field(i, preds[p].field, pax, value) < 0) {
+                want[i] = 0;
+                continue;
+            }
+            int cmp, op = preds[p].op & ~HF_OP_NUM;
+            if (preds[p].op & HF_OP_NUM) {
+                double v = strtod(value, &end);
+                if (*end != '\0' || end == value) {
+                    want[i] = 0;
+                    continue;
+                }
+                cmp = (v > atof(preds[p].value)) - (v < atof(preds[p].value));
+            } else {
+                cmp = strcmp(value, preds[p].value);
+            }
+            want[i] = (op == HF_OP_EQ) ? cmp == 0 : (op == HF_OP_NE) ? cmp != 0 :
+                      (op == HF_OP_LT) ? cmp < 0 : (op == HF_OP_LE) ? cmp <= 0 :
+                      (op == HF_OP_GT) ? cmp > 0 : cmp >= 0;
+        }
+        count += want[i];
+    }
+    return count;
+}
+
+/* Runs a predicate scan, a record and a batch at a time */
+static int check(int fd, RID *rids, HF_Pred *preds, int numPreds, int pax, const char *what) {
+    static char want[NUM_RECORDS], seen[NUM_RECORDS];
+    int count = expected(preds, numPreds, pax, want);
+    int failures = 0;
+
+    for (int batched = 0; batched <= 1; batched++) {
+        HF_Scan scan;
+        RID batchRids[50];
+        char *recs[50];
+        int lens[50], n, found = 0;
+        memset(seen, 0, sizeof(seen));
+        if (HF_OpenFileScanWhere(fd, &scan, preds, numPreds) != HFE_OK) {
+            printf("  *** ERROR: predicates %s refused ***\n", what);
+            return 1;
+        }
+        while ((n = batched ? HF_GetNextBatch(fd, &scan, batchRids, recs, lens, 50)
+                            : HF_GetNextRec(fd, &scan, batchRids, recs, lens)) >= 0) {
+            for (int k = 0; k < (batched ? n : 1); k++) {
+                int i = atoi(recs[k] + 1);  // records start with #<i>
+                if (i < 0 || i >= NUM_RECORDS || !want[i] || seen[i] ||
+                        batchRids[k].pageNum != rids[i].pageNum ||
+                        batchRids[k].slotNum != rids[i].slotNum) {
+                    printf("  *** ERROR (%s): scan gave '%.30s' ***\n", what, recs[k]);
+                    failures++;
+                } else {
+                    seen[i] = 1;
+                }
+                found++;
+            }
+        }
+        HF_CloseFileScan(&scan);
+        if (found != count) {
+            printf("  *** ERROR (%s): %s scan found %d records, expected %d ***\n",
+                   what, batched ? "batch" : "record", found, count);
+            failures++;
+        }
+    }
+    printf("  %-32s %5d records: %d failures\n", what, count, failures);
+    return failures;
+}
+
+/* Runs the tests on a slotted, fixed or PAX file */
+static int test(int layout) {
+    static const char *names[] = { "Slotted", "Fixed", "PAX" };
+    RID rids[NUM_RECORDS];
+    int fd, error, failures = 0;
+    int pax = (layout == 2);
+
+    printf("--- %s pages ---\n", names[layout]);
+    error = (layout == 0) ? HF_CreateFile(TEST_FILE_HF) :
+            (layout == 1) ? HF_CreateFileFixed(TEST_FILE_HF, PF_PAGE_SIZE, 0, REC_LEN) :
+            HF_CreateFilePax(TEST_FILE_HF, PF_PAGE_SIZE, 0, 4, paxWidths);
+    if (error != HFE_OK || (fd = HF_OpenFile(TEST_FILE_HF)) < 0) {
+        PF_PrintError("create " TEST_FILE_HF);
+        exit(1);
+    }
+    for (int i = 0; i < NUM_RECORDS; i++) {
+        char score[16];
+        if (i % 7 == 0)
+            strcpy(score, "n/a");
+        else
+            sprintf(score, "%s%d.%d", (i % 11 == 0) ? "-" : "", i % 10, i % 3);
+        memset(records[i], '\0', sizeof(records[i]));
+        if (pax) {
+            // Fields padded to their widths with blanks
+            sprintf(records[i], "#%-11d%-8s%-6s%-14s", i, programs[i % 5], score, "x");
+        } else if (i % 13 == 0) {
+            sprintf(records[i], "#%d;%s", i, programs[i % 5]);   // short record
+        } else {
+            sprintf(records[i], "#%d;%s;%s;%s", i, programs[i % 5], score,
+                    "pad-past-16-bytes");
+        }
+        if (layout == 1)    // rows padded with empty fields
+            memset(records[i] + strlen(records[i]), ';', REC_LEN - strlen(records[i]));
+        int len = (layout == 0) ? (int)strlen(records[i]) : REC_LEN;
+        if ((error = HF_InsertRec(fd, records[i], len, &rids[i])) != HFE_OK) {
+            printf("Error inserting record %d (code: %d)\n", i, error);
+            exit(1);
+        }
+    }
+
+    HF_Pred btech[] = { { 1, HF_OP_EQ, "BTECH" } };
+    HF_Pred notBt[] = { { 1, HF_OP_NE, "BT" } };
+    HF_Pred range[] = { { 1, HF_OP_GE, "BT" }, { 1, HF_OP_LT, "MTECH" } };
+    HF_Pred empty[] = { { 1, HF_OP_EQ, "" } };
+    HF_Pred score[] = { { 2, HF_OP_GE | HF_OP_NUM, "4.5" } };
+    HF_Pred neg[]   = { { 2, HF_OP_LT | HF_OP_NUM, "0" }, { 1, HF_OP_NE, "PHD" } };
+    HF_Pred exact[] = { { 2, HF_OP_EQ | HF_OP_NUM, "-3.0" } };
+    HF_Pred beyond[] = { { 3, HF_OP_GT, "" } };
+    HF_Pred nothing[] = { { 9, HF_OP_EQ, "x" } };
+    failures += check(fd, rids, btech, 1, pax, "program = BTECH");
+    failures += check(fd, rids, notBt, 1, pax, "program != BT");
+    failures += check(fd, rids, range, 2, pax, "BT <= program < MTECH");
+    failures += check(fd, rids, empty, 1, pax, "program = ''");
+    failures += check(fd, rids, score, 1, pax, "score >= 4.5");
+    failures += check(fd, rids, neg, 2, pax, "score < 0 and program != PHD");
+    failures += check(fd, rids, exact, 1, pax, "score = -3.0");
+    failures += check(fd, rids, beyond, 1, pax, "field 3 > ''");
+    failures += check(fd, rids, nothing, 1, pax, "field 9 = x");
+    failures += check(fd, rids, NULL, 0, pax, "no predicates");
+
+    // Predicates that make no sense are refused
+    HF_Scan scan;
+    HF_Pred bad[][1] = { { { -1, HF_OP_EQ, "x" } }, { { 0, 7, "x" } },
+                         { { 0, HF_OP_EQ, NULL } }, { { 0, HF_OP_LT | HF_OP_NUM, "4x" } } };
+    for (int b = 0; b < 4; b++) {
+        if (HF_OpenFileScanWhere(fd, &scan, bad[b], 1) != HFE_BADPRED) {
+            printf("  *** ERROR: bad predicate %d taken ***\n", b);
+            failures++;
+        }
+    }
+
+    // A field scan of a PAX file with a predicate on another field
+    if (pax) {
+        RID rid;
+        char *value;
+        int len, found = 0;
+        HF_OpenFileScanWhere(fd, &scan, btech, 1);
+        while (HF_GetNextField(fd, &scan, 2, &rid, &value, &len) == HFE_OK) {
+            int i;
+            for (i = 0; i < NUM_RECORDS; i++)
+                if (rids[i].pageNum == rid.pageNum && rids[i].slotNum == rid.slotNum)
+                    break;
+            if (i == NUM_RECORDS || i % 5 != 0 || len != paxWidths[2] ||
+                    memcmp(value, records[i] + paxWidths[0] + paxWidths[1], len) != 0) {
+                printf("  *** ERROR: field scan gave a wrong value ***\n");
+                failures++;
+            }
+            found++;
+        }
+        HF_CloseFileScan(&scan);
+        if (found != NUM_RECORDS / 5) {
+            printf("  *** ERROR: field scan found %d values ***\n", found);
+            failures++;
+        }
+    }
+
+    HF_CloseFile(fd);
+    PF_DestroyFile(TEST_FILE_HF);
+    printf("\n");
+    return failures;
+}
+
+int main() {
+    int failures = 0;
+
+    printf("Starting HF predicate scan test (testhf8)...\n\n");
+    PF_Init();
+    for (int layout = 0; layout < 3; layout++)
+        failures += test(layout);
+
+    if (failures == 0) {
+        printf("SUCCESS! Predicate scans give just the matching records.\n");
+        return 0;
+    }
+    printf("FAILURE! %d checks failed.\n", failures);
+    return 1;
+}
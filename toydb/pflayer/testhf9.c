@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pf.h"
+#include "hf.h"
+
+#define TEST_FILE_HF "testhf9.data"
+#define NUM_RECORDS 5000
+#define MAX_WORKERS 8
+#define STOP_AFTER 100
+#define HFE_TEST_STOP -99   /* what the callback stops a scan with */
+
+static char records[NUM_RECORDS][40];
+static RID rids[NUM_RECORDS];
+
+/* What a scan found: each worker keeps its own count, merged at the end */
+typedef struct {
+    int seen[NUM_RECORDS];      // times each record was given (workers
+                                // touch different records, so no lock)
+    long count[MAX_WORKERS];
+    int badRecords;
+    int stopAfter;              // stop the scan after this many, or 0
+} Found;
+
+static int collect(void *arg, int worker, RID ridv[], char *recs[], int lens[], int n) {
+    Found *found = (Found*)arg;
+
+    for (int k = 0; k < n; k++) {
+        int i = atoi(recs[k] + 1);  // records start with #<i>
+        if (i < 0 || i >= NUM_RECORDS || ridv[k].pageNum != rids[i].pageNum ||
+                ridv[k].slotNum != rids[i].slotNum ||
+                lens[k] != (int)strlen(records[i]) || memcmp(recs[k], records[i], lens[k]) != 0) {
+            __sync_fetch_and_add(&found->badRecords, 1);
+            continue;
+        }
+        found->seen[i]++;
+    }
+    found->count[worker] += n;
+    if (found->stopAfter > 0 && found->count[worker] >= found->stopAfter)
+        return HFE_TEST_STOP;
+    return HFE_OK;
+}
+
+/* Runs a parallel scan and checks that each wanted record came once */
+static int check(int fd, int workers, int morselPages, HF_Pred *preds, int numPreds,
+                 int modulo) {
+    static Found found;
+    int failures = 0;
+
+    memset(&found, 0, sizeof(found));
+    int error = HF_ParallelScan(fd, workers, morselPages, preds, numPreds, collect, &found);
+    long total = 0;
+    for (int w = 0; w < MAX_WORKERS; w++)
+        total += found.count[w];
+    int wrong = 0, expected = 0;
+    for (int i = 0; i < NUM_RECORDS; i++) {
+        int want = (i % 4 != 3) && (modulo == 0 || i % 10 == 0);   // i % 4 == 3: deleted
+        expected += want;
+        wrong += (found.seen[i] != want);
+    }
+    if (error != HFE_OK || found.badRecords > 0 || wrong > 0 || total != expected) {
+        printf("  *** ERROR: %d workers, morsels of %d: error %d, %d bad, %d wrong, "
+               "%ld of %d found ***\n", workers, morselPages, error, found.badRecords,
+               wrong, total, expected);
+        failures++;
+    }
+    printf("  %d workers, morsels of %2d pages%s: %ld records, %d failures\n", workers,
+           morselPages, numPreds ? ", with predicate" : "", total, failures);
+    return failures;
+}
+
+int main() {
+    int fd, error, failures = 0;
+
+    printf("Starting HF parallel scan test (testhf9)...\n\n");
+    PF_Init();
+    PF_SetBufferSize(40);
+    if ((error = HF_CreateFile(TEST_FILE_HF)) != HFE_OK ||
+            (fd = HF_OpenFile(TEST_FILE_HF)) < 0) {
+        PF_PrintError("create " TEST_FILE_HF);
+        exit(1);
+    }
+
+    // 1. Records "#i;tag;i mod 10", of different lengths; every fourth deleted
+    for (int i = 0; i < NUM_RECORDS; i++) {
+        sprintf(records[i], "#%d;%.*s;%d", i, i % 17, "abcdefghijklmnopq", i % 10);
+        if ((error = HF_InsertRec(fd, records[i], strlen(records[i]), &rids[i])) != HFE_OK) {
+            printf("Error inserting record %d (code: %d)\n", i, error);
+            exit(1);
+        }
+    }
+    for (int i = 3; i < NUM_RECORDS; i += 4)
+        HF_DeleteRec(fd, rids[i]);
+    printf("%d records on %d pages\n", NUM_RECORDS, PF_NumUsedPages(fd));
+
+    // 2. Every record once, however the pages are split and shared out
+    int workers[] = { 1, 2, 3, 8 };
+    int morsels[] = { 1, 4, 1000 };
+    for (int w = 0; w < 4; w++)
+        for (int m = 0; m < 3; m++)
+            failures += check(fd, workers[w], morsels[m], NULL, 0, 0);
+
+    // 3. Predicates are tested in the workers
+    HF_Pred zero[] = { { 2, HF_OP_EQ | HF_OP_NUM, "0" } };
+    failures += check(fd, 3, 2, zero, 1, 10);
+
+    // 4. An error from the callback stops the scan and is returned
+    static Found found;
+    memset(&found, 0, sizeof(found));
+    found.stopAfter = STOP_AFTER;
+    error = HF_ParallelScan(fd, 4, 1, NULL, 0, collect, &found);
+    long total = 0;
+    for (int w = 0; w < MAX_WORKERS; w++)
+        total += found.count[w];
+    if (error != HFE_TEST_STOP || total >= NUM_RECORDS * 3 / 4) {
+        printf("  *** ERROR: stopped scan gave %d after %ld records ***\n", error, total);
+        failures++;
+    }
+    if (HF_ParallelScan(fd, 0, 1, NULL, 0, collect, &found) != HFE_BADARG ||
+            HF_ParallelScan(fd, 2, 0, NULL, 0, collect, &found) != HFE_BADARG ||
+            HF_ParallelScan(fd, 2, 1, NULL, 0, NULL, &found) != HFE_BADARG) {
+        printf("  *** ERROR: bad arguments taken ***\n");
+        failures++;
+    }
+
+    // 5. No more workers than the buffer pool has pages for: two each
+    PF_SetBufferSize(6);
+    memset(&found, 0, sizeof(found));
+    error = HF_ParallelScan(fd, 8, 1, NULL, 0, collect, &found);
+    total = found.count[0] + found.count[1] + found.count[2];
+    long extra = 0;     // given by workers past the first 3
+    for (int w = 3; w < MAX_WORKERS; w++)
+        extra += found.count[w];
+    if (error != HFE_OK || total != NUM_RECORDS - NUM_RECORDS / 4 || extra != 0) {
+        printf("  *** ERROR: 8 workers, 6 buffer pages: error %d, %ld records, "
+               "%ld more from workers 3 on ***\n", error, total, extra);
+        failures++;
+    }
+    PF_SetBufferSize(40);
+
+    // 6. The buffer pool is left with no pages fixed
+    if ((error = HF_CloseFile(fd)) != HFE_OK) {
+        PF_PrintError("HF_CloseFile");
+        failures++;
+    }
+    PF_DestroyFile(TEST_FILE_HF);
+
+    if (failures == 0) {
+        printf("\nSUCCESS! Parallel scans give every record once.\n");
+        return 0;
+    }
+    printf("\nFAILURE! %d checks failed.\n", failures);
+    return 1;
+}
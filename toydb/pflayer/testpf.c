@@ -2,11 +2,16 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <pthread.h>
 #include "pftypes.h"
 #include "pf.h"
 
 #define FILE1   "file1"
 #define FILE2   "file2"
+#define FILE3   "file3"
 
 /* PF-layer functions we call from pf.c */
 int PF_CreateFile(char *fname);
@@ -23,6 +28,18 @@ int PF_GetNextPage(int fd, int *pagenum, char **pagebuf);
 void writefile(char *fname);
 void readfile(char *fname);
 void printfile(int fd);
+void testshared(char *fname);
+void testoldformat(char *fname);
+void testbigmap(char *fname, int flags);
+void testflushclose(char *fname);
+void testskipfree(char *fname);
+void testpagesize(char *fname);
+void testcompress(char *fname);
+void testflush(char *fname);
+void testcflru(char *fname);
+void testzcache(char *fname);
+void testshadow(char *fname);
+void testswizzle(char *fname);
 
 int main(void)
 {
@@ -306,6 +323,44 @@ int fd1,fd2;
 		exit(1);
 	}
 
+	/* fix a page through two descriptors of file1 */
+	testshared(FILE1);
+
+	/* close a file while another thread flushes it */
+	testflushclose(FILE1);
+
+	/* open a file written before the header had an occupancy map */
+	testoldformat(FILE3);
+
+	/* grow files past the occupancy map in the header */
+	testbigmap(FILE3,0);
+	testbigmap(FILE3,PF_FILE_COMPRESSED);
+	testbigmap(FILE3,PF_FILE_SHADOW);
+
+	/* free pages are not read by scans */
+	testskipfree(FILE3);
+
+	/* files of other page sizes */
+	testpagesize(FILE3);
+
+	/* compressed files */
+	testcompress(FILE3);
+
+	/* flushes and syncs */
+	testflush(FILE3);
+
+	/* CFLRU replacement */
+	testcflru(FILE3);
+
+	/* compressed cache of evicted pages */
+	testzcache(FILE3);
+
+	/* shadow files */
+	testshadow(FILE3);
+
+	/* swizzled references to child pages */
+	testswizzle(FILE3);
+
 	/* print the buffer */
 	printf("buffer:\n");
 	/* PFbufPrint(); */
@@ -419,3 +474,905 @@ int pagenum;
 	printf("eof reached\n");
 
 }
+
+/**************************************************************
+Open the file twice, and fix one of its pages through both
+descriptors. The two share the buffer page: it stays fixed until
+both have unfixed it, and only fixing it twice through the same
+descriptor fails.
+*************************************************************/
+void testshared(fname)
+char *fname;
+{
+int fd1,fd2;
+char *buf1,*buf2;
+int pagenum;
+int error;
+
+	if ((fd1=PF_OpenFile(fname))<0 || (fd2=PF_OpenFile(fname))<0){
+		PF_PrintError("open twice");
+		exit(1);
+	}
+	pagenum = -1;
+	if ((error=PF_GetNextPage(fd1,&pagenum,&buf1))!= PFE_OK){
+		PF_PrintError("get first page on fd1");
+		exit(1);
+	}
+	if ((error=PF_GetThisPage(fd2,pagenum,&buf2))!= PFE_OK){
+		PF_PrintError("get it on fd2");
+		exit(1);
+	}
+	if (buf1 != buf2){
+		printf("fd1 and fd2 have their own copies of page %d\n",pagenum);
+		exit(1);
+	}
+	if ((error=PF_GetThisPage(fd1,pagenum,&buf1))!= PFE_PAGEFIXED){
+		printf("page fixed twice through fd1: %d\n",error);
+		exit(1);
+	}
+	if ((error=PF_DisposePage(fd2,pagenum))!= PFE_PAGEFIXED){
+		printf("page fixed through fd1 disposed through fd2: %d\n",error);
+		exit(1);
+	}
+
+	/* unfixed through fd1, it stays fixed through fd2 */
+	if ((error=PF_UnfixPage(fd1,pagenum,FALSE))!= PFE_OK){
+		PF_PrintError("unfix on fd1");
+		exit(1);
+	}
+	if ((error=PF_UnfixPage(fd1,pagenum,FALSE))!= PFE_PAGEUNFIXED){
+		printf("page unfixed twice through fd1: %d\n",error);
+		exit(1);
+	}
+	if ((error=PF_CloseFile(fd2))!= PFE_PAGEFIXED){
+		printf("fd2 closed with a page fixed: %d\n",error);
+		exit(1);
+	}
+	if ((error=PF_UnfixPage(fd2,pagenum,FALSE))!= PFE_OK){
+		PF_PrintError("unfix on fd2");
+		exit(1);
+	}
+
+	/* a page allocated through one descriptor is seen through the
+	other, also once the first is closed */
+	if (PF_AllocPage(fd2,&pagenum,&buf2)!= PFE_OK){
+		PF_PrintError("alloc on fd2");
+		exit(1);
+	}
+	*(int *)buf2 = 777;
+	if (PF_UnfixPage(fd2,pagenum,TRUE)!= PFE_OK ||
+			PF_GetThisPage(fd1,pagenum,&buf1)!= PFE_OK ||
+			*(int *)buf1 != 777 || PF_UnfixPage(fd1,pagenum,FALSE)!= PFE_OK){
+		PF_PrintError("page allocated on fd2 read on fd1");
+		exit(1);
+	}
+	if (PF_CloseFile(fd1)!= PFE_OK || PF_NumPages(fd2) <= pagenum ||
+			PF_GetThisPage(fd2,pagenum,&buf2)!= PFE_OK ||
+			*(int *)buf2 != 777 || PF_UnfixPage(fd2,pagenum,FALSE)!= PFE_OK){
+		PF_PrintError("page read on fd2 after fd1 closed");
+		exit(1);
+	}
+	if (PF_DisposePage(fd2,pagenum)!= PFE_OK || PF_CloseFile(fd2)!= PFE_OK){
+		PF_PrintError("close fd2");
+		exit(1);
+	}
+	printf("pages shared by two descriptors\n");
+}
+
+/**************************************************************
+Write a file as it was written before the header had a magic number
+and an occupancy map: firstfree and numpages, then the pages. Its
+pages are 0, 2 and 3, with 1 on the free list. Open it, use the free
+page, and check that it is still found after it is closed.
+*************************************************************/
+void testoldformat(fname)
+char *fname;
+{
+FILE *fp;
+int hdr[2];
+PFfpage *fpage;
+char *buf;
+int fd;
+int pagenum;
+int n;
+int error;
+struct stat st;
+
+	fpage = (PFfpage *)calloc(1,PFfpageSize(PF_PAGE_SIZE));
+	hdr[0] = 1;	/* firstfree */
+	hdr[1] = 4;	/* numpages */
+	if ((fp=fopen(fname,"w")) == NULL || fwrite(hdr,sizeof(hdr),1,fp) != 1){
+		printf("cannot write %s\n",fname);
+		exit(1);
+	}
+	for (pagenum=0; pagenum < 4; pagenum++){
+		fpage->nextfree = (pagenum == 1)? PF_PAGE_LIST_END : PF_PAGE_USED;
+		*(int *)fpage->pagebuf = pagenum;
+		fwrite(fpage,PFfpageSize(PF_PAGE_SIZE),1,fp);
+	}
+	fclose(fp);
+	free(fpage);
+
+	if ((fd=PF_OpenFile(fname))<0){
+		PF_PrintError("open file of the old format");
+		exit(1);
+	}
+	if (PF_NumPages(fd) != 4 || PF_NumUsedPages(fd) != 3
+			|| PF_GetPageSize(fd) != PF_PAGE_SIZE){
+		printf("old format: %d pages, %d used, of %d bytes\n",
+			PF_NumPages(fd),PF_NumUsedPages(fd),PF_GetPageSize(fd));
+		exit(1);
+	}
+	pagenum = -1;
+	n = 0;
+	while ((error=PF_GetNextPage(fd,&pagenum,&buf))== PFE_OK){
+		if (*(int *)buf != pagenum || pagenum == 1){
+			printf("old format: page %d holds %d\n",pagenum,*(int *)buf);
+			exit(1);
+		}
+		PF_UnfixPage(fd,pagenum,FALSE);
+		n++;
+	}
+	if (error != PFE_EOF || n != 3){
+		printf("old format: %d pages scanned\n",n);
+		exit(1);
+	}
+	if (PF_AllocPage(fd,&pagenum,&buf)!= PFE_OK || pagenum != 1){
+		PF_PrintError("old format: alloc the free page");
+		exit(1);
+	}
+	*(int *)buf = pagenum;
+	if (PF_UnfixPage(fd,pagenum,TRUE)!= PFE_OK || PF_CloseFile(fd)!= PFE_OK){
+		PF_PrintError("old format: unfix and close");
+		exit(1);
+	}
+
+	/* it is kept in its format */
+	if (stat(fname,&st) != 0 || st.st_size != (off_t)sizeof(hdr)+
+			4*(off_t)PFfpageSize(PF_PAGE_SIZE)){
+		printf("old format: file is %ld bytes\n",(long)st.st_size);
+		exit(1);
+	}
+	if ((fd=PF_OpenFile(fname))<0 || PF_NumUsedPages(fd) != 4 ||
+			PF_GetThisPage(fd,1,&buf)!= PFE_OK || *(int *)buf != 1){
+		PF_PrintError("old format: reopen");
+		exit(1);
+	}
+	if (PF_UnfixPage(fd,1,FALSE)!= PFE_OK || PF_CloseFile(fd)!= PFE_OK ||
+			PF_DestroyFile(fname)!= PFE_OK){
+		PF_PrintError("old format: close");
+		exit(1);
+	}
+	printf("file of the old format opened and written\n");
+}
+
+/************************************************************
+Allocate more pages in a file than the occupancy map in its
+header covers, free one past it, and check that the map is
+found again when the file is reopened, before and after the
+page is used again. The file is grown a page at a time, so
+that the pages never written take no disk space.
+*************************************************************/
+void testbigmap(fname,flags)
+char *fname;
+int flags;
+{
+int fd;
+int first;
+int pagenum;
+int far = PF_MAP_PAGES+10;	/* page past the map in the header */
+int n = PF_MAP_PAGES+100;
+char *pagebuf;
+char *buf;
+
+	PF_SetExtentSize(1);
+	pagebuf = (char *)calloc(1,PF_PAGE_SIZE);
+	if (PF_CreateFileOpt(fname,PF_PAGE_SIZE,flags)!= PFE_OK ||
+			(fd=PF_OpenFile(fname))<0 ||
+			PF_AllocPages(fd,n,&first)!= PFE_OK || first != 0){
+		PF_PrintError("big map: alloc");
+		exit(1);
+	}
+	*(int *)pagebuf = far;
+	if (PF_WritePages(fd,far,1,&pagebuf)!= PFE_OK ||
+			PF_DisposePage(fd,far)!= PFE_OK ||
+			PF_CloseFile(fd)!= PFE_OK){
+		PF_PrintError("big map: dispose");
+		exit(1);
+	}
+
+	if ((fd=PF_OpenFile(fname))<0 || PF_NumPages(fd) != n ||
+			PF_NumUsedPages(fd) != n-1){
+		PF_PrintError("big map: reopen");
+		printf("big map: %d pages, %d used\n",
+			PF_NumPages(fd),PF_NumUsedPages(fd));
+		exit(1);
+	}
+	if (PF_GetThisPage(fd,far,&buf)!= PFE_INVALIDPAGE){
+		printf("big map: page %d is not free\n",far);
+		exit(1);
+	}
+	if (PF_AllocPage(fd,&pagenum,&buf)!= PFE_OK || pagenum != far){
+		PF_PrintError("big map: alloc the free page");
+		exit(1);
+	}
+	*(int *)buf = pagenum;
+	if (PF_UnfixPage(fd,pagenum,TRUE)!= PFE_OK || PF_CloseFile(fd)!= PFE_OK){
+		PF_PrintError("big map: unfix and close");
+		exit(1);
+	}
+
+	if ((fd=PF_OpenFile(fname))<0 || PF_NumUsedPages(fd) != n ||
+			PF_GetThisPage(fd,far,&buf)!= PFE_OK || *(int *)buf != far){
+		PF_PrintError("big map: reopen after alloc");
+		exit(1);
+	}
+	if (PF_UnfixPage(fd,far,FALSE)!= PFE_OK || PF_CloseFile(fd)!= PFE_OK ||
+			PF_DestroyFile(fname)!= PFE_OK){
+		PF_PrintError("big map: close");
+		exit(1);
+	}
+	free(pagebuf);
+	PF_SetExtentSize(PF_DEFAULT_EXTENT);
+	printf("file of %d pages written with flags %d\n",n,flags);
+}
+
+/************************************************************
+Flush a file over and over in another thread, and close it in
+this one while the flushes run: the close waits for the flush
+in progress, and the flushes after it find the descriptor gone.
+*************************************************************/
+static int flushfd;	/* file the flushing thread flushes */
+static int flushes;	/* # of flushes it made */
+
+static void *flusher(arg)
+void *arg;
+{
+int error;
+
+	while ((error=PF_FlushFile(flushfd))== PFE_OK)
+		flushes++;
+	return((void *)(long)error);
+}
+
+void testflushclose(fname)
+char *fname;
+{
+pthread_t tid;
+void *result;
+char *buf;
+int pagenum;
+int i;
+
+	if ((flushfd=PF_OpenFile(fname))<0){
+		PF_PrintError("flush and close: open");
+		exit(1);
+	}
+	flushes = 0;
+	pthread_create(&tid,NULL,flusher,NULL);
+	for (i=0; i < 20; i++){
+		/* give the flusher dirty pages to write */
+		PF_Lock();
+		pagenum = -1;
+		while (PF_GetNextPage(flushfd,&pagenum,&buf)== PFE_OK)
+			PF_UnfixPage(flushfd,pagenum,TRUE);
+		PF_Unlock();
+		usleep(100);
+	}
+	if (PF_CloseFile(flushfd)!= PFE_OK){
+		PF_PrintError("flush and close: close");
+		exit(1);
+	}
+	pthread_join(tid,&result);
+	if ((long)result != PFE_FD){
+		printf("flush and close: flush returned %ld\n",(long)result);
+		exit(1);
+	}
+	if ((flushfd=PF_OpenFile(fname))<0 || PF_CloseFile(flushfd)!= PFE_OK){
+		PF_PrintError("flush and close: reopen");
+		exit(1);
+	}
+	printf("file closed while flushed, after %s flushes\n",
+		(flushes > 0)? "some" : "no");
+}
+
+/************************************************************
+Fill the "size" bytes of a page with data telling it is page
+"pagenum", or tell whether a page holds that data.
+*************************************************************/
+static void fillpage(buf,size,pagenum)
+char *buf;
+int size;
+int pagenum;
+{
+int i;
+
+	for (i=0; i < size/(int)sizeof(int); i++)
+		((int *)buf)[i] = pagenum*1000 + i%10;
+}
+
+static int pageok(buf,size,pagenum)
+char *buf;
+int size;
+int pagenum;
+{
+int i;
+
+	for (i=0; i < size/(int)sizeof(int); i++)
+		if (((int *)buf)[i] != pagenum*1000 + i%10)
+			return(FALSE);
+	return(TRUE);
+}
+
+/************************************************************
+Create file "fname" with the given page size and options,
+holding "n" pages filled by fillpage(), and close it.
+*************************************************************/
+static void makefile(fname,pagesize,flags,n)
+char *fname;
+int pagesize;
+int flags;
+int n;
+{
+int fd;
+int pagenum;
+char *buf;
+int i;
+
+	if (PF_CreateFileOpt(fname,pagesize,flags)!= PFE_OK ||
+			(fd=PF_OpenFile(fname))<0){
+		PF_PrintError(fname);
+		exit(1);
+	}
+	for (i=0; i < n; i++){
+		if (PF_AllocPage(fd,&pagenum,&buf)!= PFE_OK){
+			PF_PrintError("makefile: alloc");
+			exit(1);
+		}
+		fillpage(buf,pagesize,pagenum);
+		if (PF_UnfixPage(fd,pagenum,TRUE)!= PFE_OK){
+			PF_PrintError("makefile: unfix");
+			exit(1);
+		}
+	}
+	if (PF_CloseFile(fd)!= PFE_OK){
+		PF_PrintError("makefile: close");
+		exit(1);
+	}
+}
+
+/************************************************************
+Read every used page of file "fd" in order, checking its data,
+and return the # of pages read.
+*************************************************************/
+static int scanfile(fd)
+int fd;
+{
+int pagenum;
+int n = 0;
+int error;
+char *buf;
+
+	pagenum = -1;
+	while ((error=PF_GetNextPage(fd,&pagenum,&buf))== PFE_OK){
+		if (!pageok(buf,PF_GetPageSize(fd),pagenum)){
+			printf("page %d holds the wrong data\n",pagenum);
+			exit(1);
+		}
+		if (PF_UnfixPage(fd,pagenum,FALSE)!= PFE_OK){
+			PF_PrintError("scan: unfix");
+			exit(1);
+		}
+		n++;
+	}
+	if (error != PFE_EOF){
+		PF_PrintError("scan");
+		exit(1);
+	}
+	return(n);
+}
+
+/************************************************************
+Dispose of pages 3 to 10 of a file of 20, and check that a
+scan after reopening the file reads only the other 12 from
+disk, in order: the occupancy map tells it the free pages.
+*************************************************************/
+void testskipfree(fname)
+char *fname;
+{
+int fd;
+int i;
+
+	makefile(fname,PF_PAGE_SIZE,0,20);
+	if ((fd=PF_OpenFile(fname))<0){
+		PF_PrintError("skip free: open");
+		exit(1);
+	}
+	for (i=3; i <= 10; i++)
+		if (PF_DisposePage(fd,i)!= PFE_OK){
+			PF_PrintError("skip free: dispose");
+			exit(1);
+		}
+	if (PF_CloseFile(fd)!= PFE_OK || (fd=PF_OpenFile(fname))<0){
+		PF_PrintError("skip free: reopen");
+		exit(1);
+	}
+	PF_ResetStats();
+	if ((i=scanfile(fd)) != 12 || PF_stats.physicalReads != 12){
+		printf("skip free: %d pages scanned, %d read\n",i,
+			PF_stats.physicalReads);
+		exit(1);
+	}
+	if (PF_CloseFile(fd)!= PFE_OK || PF_DestroyFile(fname)!= PFE_OK){
+		PF_PrintError("skip free: close");
+		exit(1);
+	}
+	printf("free pages skipped by a scan\n");
+}
+
+/************************************************************
+Page sizes that are not a power of 2 in range are refused.
+A file of 16K pages keeps its page size, and its pages share
+the buffer pool with those of a file of 4K pages.
+*************************************************************/
+void testpagesize(fname)
+char *fname;
+{
+static int bad[] = { 0, 2048, 5000, 2*PF_MAX_PAGE_SIZE };
+int fd,fd4;
+int i;
+
+	for (i=0; i < (int)(sizeof(bad)/sizeof(bad[0])); i++)
+		if (PF_CreateFileSized(fname,bad[i])!= PFE_PAGESIZE){
+			printf("page size %d accepted\n",bad[i]);
+			exit(1);
+		}
+	makefile(fname,4*PF_PAGE_SIZE,0,PF_MAX_BUFS);
+	makefile(FILE2 "x",PF_PAGE_SIZE,0,PF_MAX_BUFS);
+	if ((fd=PF_OpenFile(fname))<0 || (fd4=PF_OpenFile(FILE2 "x"))<0 ||
+			PF_GetPageSize(fd) != 4*PF_PAGE_SIZE ||
+			PF_GetPageSize(fd4) != PF_PAGE_SIZE){
+		PF_PrintError("page size: open");
+		exit(1);
+	}
+
+	/* each file's pages evict the other's */
+	for (i=0; i < 2; i++)
+		if (scanfile(fd) != PF_MAX_BUFS || scanfile(fd4) != PF_MAX_BUFS){
+			printf("page size: pages missing\n");
+			exit(1);
+		}
+	if (PF_CloseFile(fd)!= PFE_OK || PF_CloseFile(fd4)!= PFE_OK ||
+			PF_DestroyFile(fname)!= PFE_OK ||
+			PF_DestroyFile(FILE2 "x")!= PFE_OK){
+		PF_PrintError("page size: close");
+		exit(1);
+	}
+	printf("pages of %d and %d bytes\n",4*PF_PAGE_SIZE,PF_PAGE_SIZE);
+}
+
+/************************************************************
+A compressed file holds an all-zero page, a page that does
+not compress and a page of fillpage() data. Each is read back
+after reopening, then the first two swap contents, so that
+one grows and one shrinks in place, and are read back again.
+*************************************************************/
+static void comppage(buf,kind)
+char *buf;
+int kind;	/* 0: zeros, 1: noise */
+{
+unsigned int x = 12345;
+int i;
+
+	for (i=0; i < PF_PAGE_SIZE; i++){
+		x = x*1103515245 + 12345;
+		buf[i] = (kind == 0)? 0 : (char)(x >> 16);
+	}
+}
+
+static void compcheck(fd,zeropage)
+int fd;
+int zeropage;	/* which of pages 0 and 1 is all zeros */
+{
+char want[PF_PAGE_SIZE];
+char *buf;
+int i;
+
+	for (i=0; i < 3; i++){
+		if (PF_GetThisPage(fd,i,&buf)!= PFE_OK){
+			PF_PrintError("compress: get");
+			exit(1);
+		}
+		if (i == 2){
+			if (!pageok(buf,PF_PAGE_SIZE,2)){
+				printf("compress: page 2 is wrong\n");
+				exit(1);
+			}
+		}
+		else {
+			comppage(want,i != zeropage);
+			if (memcmp(buf,want,PF_PAGE_SIZE) != 0){
+				printf("compress: page %d is wrong\n",i);
+				exit(1);
+			}
+		}
+		PF_UnfixPage(fd,i,FALSE);
+	}
+}
+
+void testcompress(fname)
+char *fname;
+{
+struct stat st;
+char *buf;
+int fd;
+int pagenum;
+int i;
+
+	if (PF_CreateFileOpt(fname,PF_PAGE_SIZE,PF_FILE_COMPRESSED)!= PFE_OK ||
+			(fd=PF_OpenFile(fname))<0){
+		PF_PrintError("compress: create");
+		exit(1);
+	}
+	for (i=0; i < 3; i++){
+		if (PF_AllocPage(fd,&pagenum,&buf)!= PFE_OK){
+			PF_PrintError("compress: alloc");
+			exit(1);
+		}
+		if (i == 2)
+			fillpage(buf,PF_PAGE_SIZE,2);
+		else	comppage(buf,i);
+		PF_UnfixPage(fd,pagenum,TRUE);
+	}
+	if (PF_CloseFile(fd)!= PFE_OK || (fd=PF_OpenFile(fname))<0){
+		PF_PrintError("compress: reopen");
+		exit(1);
+	}
+	compcheck(fd,0);
+
+	/* the noise page is stored whole, the others take less */
+	if (stat(fname,&st) != 0 || st.st_size >= PF_HDR_SIZE+
+			2*(off_t)PFfpageSize(PF_PAGE_SIZE)){
+		printf("compress: file is %ld bytes\n",(long)st.st_size);
+		exit(1);
+	}
+
+	for (i=0; i < 2; i++){
+		PF_GetThisPage(fd,i,&buf);
+		comppage(buf,i == 0);
+		PF_UnfixPage(fd,i,TRUE);
+	}
+	if (PF_CloseFile(fd)!= PFE_OK || (fd=PF_OpenFile(fname))<0){
+		PF_PrintError("compress: reopen after rewrite");
+		exit(1);
+	}
+	compcheck(fd,1);
+	if (PF_CloseFile(fd)!= PFE_OK || PF_DestroyFile(fname)!= PFE_OK){
+		PF_PrintError("compress: close");
+		exit(1);
+	}
+	printf("compressed pages read back\n");
+}
+
+/************************************************************
+PF_FlushFile() writes a dirty page once and syncs, after which
+the page is clean and closing the file writes nothing more.
+PF_Sync() syncs each open file.
+*************************************************************/
+void testflush(fname)
+char *fname;
+{
+int fd,fd2;
+char *buf;
+
+	makefile(fname,PF_PAGE_SIZE,0,4);
+	makefile(FILE2 "x",PF_PAGE_SIZE,0,1);
+	if ((fd=PF_OpenFile(fname))<0 || (fd2=PF_OpenFile(FILE2 "x"))<0){
+		PF_PrintError("flush: open");
+		exit(1);
+	}
+	if (PF_FlushFile(-1) != PFE_FD){
+		printf("flush: bad descriptor flushed\n");
+		exit(1);
+	}
+	PF_GetThisPage(fd,2,&buf);
+	fillpage(buf,PF_PAGE_SIZE,2);
+	PF_UnfixPage(fd,2,TRUE);
+
+	PF_ResetStats();
+	if (PF_FlushFile(fd)!= PFE_OK || PF_stats.physicalWrites != 1 ||
+			PF_stats.syncs != 1){
+		printf("flush: %d writes, %d syncs\n",PF_stats.physicalWrites,
+			PF_stats.syncs);
+		exit(1);
+	}
+	if (PF_Sync()!= PFE_OK || PF_stats.physicalWrites != 1 ||
+			PF_stats.syncs != 3){
+		printf("sync: %d writes, %d syncs\n",PF_stats.physicalWrites,
+			PF_stats.syncs);
+		exit(1);
+	}
+	if (PF_CloseFile(fd)!= PFE_OK || PF_CloseFile(fd2)!= PFE_OK ||
+			PF_stats.physicalWrites != 1){
+		printf("flush: %d writes after close\n",PF_stats.physicalWrites);
+		exit(1);
+	}
+	if ((fd=PF_OpenFile(fname))<0 || scanfile(fd) != 4 ||
+			PF_CloseFile(fd)!= PFE_OK || PF_DestroyFile(fname)!= PFE_OK ||
+			PF_DestroyFile(FILE2 "x")!= PFE_OK){
+		PF_PrintError("flush: close");
+		exit(1);
+	}
+	printf("flushed and synced\n");
+}
+
+/************************************************************
+Fill the buffer pool with page 0, dirty and least recently
+used, and clean pages after it, then read one more page. LRU
+writes page 0 out to make room; CFLRU evicts a clean page
+instead and keeps page 0 buffered.
+*************************************************************/
+static void cflrurun(fd,policy,writes)
+int fd;
+int policy;
+int writes;	/* # of page writes expected */
+{
+char *buf;
+int i;
+
+	PF_SetReplacementPolicy(policy);
+	PF_GetThisPage(fd,0,&buf);
+	PF_UnfixPage(fd,0,TRUE);
+	for (i=1; i < PF_MAX_BUFS; i++){
+		PF_GetThisPage(fd,i,&buf);
+		PF_UnfixPage(fd,i,FALSE);
+	}
+	PF_ResetStats();
+	PF_GetThisPage(fd,PF_MAX_BUFS,&buf);
+	PF_UnfixPage(fd,PF_MAX_BUFS,FALSE);
+	PF_GetThisPage(fd,0,&buf);
+	PF_UnfixPage(fd,0,FALSE);
+	if (PF_stats.physicalWrites != writes ||
+			PF_stats.physicalReads != 1+writes){
+		printf("policy %d: %d writes, %d reads\n",policy,
+			PF_stats.physicalWrites,PF_stats.physicalReads);
+		exit(1);
+	}
+}
+
+void testcflru(fname)
+char *fname;
+{
+int fd;
+
+	makefile(fname,PF_PAGE_SIZE,0,PF_MAX_BUFS+1);
+	if ((fd=PF_OpenFile(fname))<0){
+		PF_PrintError("cflru: open");
+		exit(1);
+	}
+	cflrurun(fd,PF_REPL_LRU,1);
+	if (PF_CloseFile(fd)!= PFE_OK || (fd=PF_OpenFile(fname))<0){
+		PF_PrintError("cflru: reopen");
+		exit(1);
+	}
+	cflrurun(fd,PF_REPL_CFLRU,0);
+	PF_SetReplacementPolicy(PF_REPL_LRU);
+	if (PF_CloseFile(fd)!= PFE_OK || PF_DestroyFile(fname)!= PFE_OK){
+		PF_PrintError("cflru: close");
+		exit(1);
+	}
+	printf("dirty page kept by CFLRU\n");
+}
+
+/************************************************************
+With a compressed cache, a second scan of a file larger than
+the buffer pool reads nothing from disk. A page changed after
+it was cached is read back changed.
+*************************************************************/
+void testzcache(fname)
+char *fname;
+{
+int fd;
+int n = PF_MAX_BUFS+5;
+char *buf;
+int i;
+
+	PF_SetZCacheSize(1L << 20);
+	makefile(fname,PF_PAGE_SIZE,0,n);
+	if ((fd=PF_OpenFile(fname))<0){
+		PF_PrintError("zcache: open");
+		exit(1);
+	}
+	scanfile(fd);
+	PF_ResetStats();
+	if (scanfile(fd) != n || PF_stats.physicalReads != 0 ||
+			PF_stats.zcacheHits != n){
+		printf("zcache: %d reads, %d hits\n",PF_stats.physicalReads,
+			PF_stats.zcacheHits);
+		exit(1);
+	}
+
+	/* page 0 is in the cache; change it in the buffer pool */
+	PF_GetThisPage(fd,0,&buf);
+	fillpage(buf,PF_PAGE_SIZE,n);
+	PF_UnfixPage(fd,0,TRUE);
+	for (i=1; i < n; i++){
+		/* evict it */
+		PF_GetThisPage(fd,i,&buf);
+		PF_UnfixPage(fd,i,FALSE);
+	}
+	PF_GetThisPage(fd,0,&buf);
+	if (!pageok(buf,PF_PAGE_SIZE,n)){
+		printf("zcache: stale copy of page 0 read\n");
+		exit(1);
+	}
+	PF_UnfixPage(fd,0,FALSE);
+
+	if (PF_CloseFile(fd)!= PFE_OK || PF_DestroyFile(fname)!= PFE_OK){
+		PF_PrintError("zcache: close");
+		exit(1);
+	}
+	PF_SetZCacheSize(0);
+	printf("evicted pages read from the compressed cache\n");
+}
+
+/************************************************************
+A shadow file keeps what was flushed across reopens. If the
+header of the last commit is damaged, as by a crash while it
+was written, the file opens as of the commit before.
+*************************************************************/
+static void shadowpage(fd,pagenum,data)
+int fd;
+int pagenum;
+int data;	/* what it should hold, as given to fillpage() */
+{
+char *buf;
+
+	if (PF_GetThisPage(fd,pagenum,&buf)!= PFE_OK ||
+			!pageok(buf,PF_PAGE_SIZE,data)){
+		printf("shadow: page %d does not hold %d\n",pagenum,data);
+		exit(1);
+	}
+	PF_UnfixPage(fd,pagenum,FALSE);
+}
+
+void testshadow(fname)
+char *fname;
+{
+PFhdr_str hdr[2];
+FILE *fp;
+char *buf;
+int fd;
+int last;	/* header slot of the last commit */
+
+	makefile(fname,PF_PAGE_SIZE,PF_FILE_SHADOW,3);
+	if ((fd=PF_OpenFile(fname))<0){
+		PF_PrintError("shadow: open");
+		exit(1);
+	}
+	PF_GetThisPage(fd,1,&buf);
+	fillpage(buf,PF_PAGE_SIZE,101);
+	PF_UnfixPage(fd,1,TRUE);
+	if (PF_FlushFile(fd)!= PFE_OK || PF_CloseFile(fd)!= PFE_OK ||
+			(fd=PF_OpenFile(fname))<0){
+		PF_PrintError("shadow: commit and reopen");
+		exit(1);
+	}
+	shadowpage(fd,0,0);
+	shadowpage(fd,1,101);
+	shadowpage(fd,2,2);
+
+	PF_GetThisPage(fd,1,&buf);
+	fillpage(buf,PF_PAGE_SIZE,202);
+	PF_UnfixPage(fd,1,TRUE);
+	if (PF_FlushFile(fd)!= PFE_OK || PF_CloseFile(fd)!= PFE_OK){
+		PF_PrintError("shadow: second commit");
+		exit(1);
+	}
+
+	/* damage the checksum of the newer header */
+	if ((fp=fopen(fname,"r+")) == NULL ||
+			fread(&hdr[0],sizeof(PFhdr_str),1,fp) != 1 ||
+			fseek(fp,PF_HDR_SIZE,SEEK_SET) != 0 ||
+			fread(&hdr[1],sizeof(PFhdr_str),1,fp) != 1){
+		printf("shadow: cannot read the headers\n");
+		exit(1);
+	}
+	last = (hdr[1].seq > hdr[0].seq);
+	hdr[last].cksum = ~hdr[last].cksum;
+	fseek(fp,last*PF_HDR_SIZE,SEEK_SET);
+	fwrite(&hdr[last],sizeof(PFhdr_str),1,fp);
+	fclose(fp);
+
+	if ((fd=PF_OpenFile(fname))<0){
+		PF_PrintError("shadow: open after damage");
+		exit(1);
+	}
+	shadowpage(fd,0,0);
+	shadowpage(fd,1,101);
+	shadowpage(fd,2,2);
+	if (PF_CloseFile(fd)!= PFE_OK || PF_DestroyFile(fname)!= PFE_OK){
+		PF_PrintError("shadow: close");
+		exit(1);
+	}
+	printf("shadow file opened as of its last good commit\n");
+}
+
+/************************************************************
+Page 0 points to pages 1 and 2 through slot 0. A second descent
+to page 1 follows the swizzled reference; once page 1, or page
+0, has been evicted, the descent goes through the hash table
+again, and a descent to page 2 through the same slot gets page
+2.
+*************************************************************/
+static void descend(fd,childnum,hits)
+int fd;
+int childnum;
+int hits;	/* swizzle hits expected so far */
+{
+char *buf;
+
+	if (PF_GetThisPage(fd,0,&buf)!= PFE_OK ||
+			PF_GetChildPage(fd,0,0,childnum,&buf)!= PFE_OK ||
+			!pageok(buf,PF_PAGE_SIZE,childnum) ||
+			PF_UnfixPage(fd,childnum,FALSE)!= PFE_OK){
+		PF_PrintError("swizzle: descend");
+		exit(1);
+	}
+	if (PF_stats.swizzleHits != hits){
+		printf("swizzle: %d hits going to page %d, not %d\n",
+			PF_stats.swizzleHits,childnum,hits);
+		exit(1);
+	}
+}
+
+static void evictall(fd,keep)
+int fd;
+int keep;	/* page kept fixed meanwhile */
+{
+char *buf;
+int i;
+
+	PF_GetThisPage(fd,keep,&buf);
+	for (i=3; i < PF_MAX_BUFS+4; i++){
+		PF_GetThisPage(fd,i,&buf);
+		PF_UnfixPage(fd,i,FALSE);
+	}
+	PF_UnfixPage(fd,keep,FALSE);
+}
+
+void testswizzle(fname)
+char *fname;
+{
+int fd;
+
+	makefile(fname,PF_PAGE_SIZE,0,PF_MAX_BUFS+4);
+	if ((fd=PF_OpenFile(fname))<0){
+		PF_PrintError("swizzle: open");
+		exit(1);
+	}
+	PF_ResetStats();
+	descend(fd,1,0);
+	descend(fd,1,1);
+
+	/* child evicted */
+	evictall(fd,0);
+	descend(fd,1,1);
+	descend(fd,1,2);
+
+	/* parent evicted */
+	evictall(fd,1);
+	descend(fd,1,2);
+	descend(fd,1,3);
+
+	/* another child through the same slot */
+	descend(fd,2,3);
+	descend(fd,2,4);
+	descend(fd,1,4);
+
+	if (PF_CloseFile(fd)!= PFE_OK || PF_DestroyFile(fname)!= PFE_OK){
+		PF_PrintError("swizzle: close");
+		exit(1);
+	}
+	printf("swizzled child pages evicted\n");
+}
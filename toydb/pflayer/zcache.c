@@ -0,0 +1,205 @@
+/* zcache.c: a second-tier cache of compressed pages, behind the buffer
+pool. The interface routines are PFzcachePut(), PFzcacheGet(),
+PFzcacheDrop() and PFzcacheDropFile().
+
+Pages evicted from the buffer pool are compressed (see lz.c) and kept
+here, in least recently used order, until the cache outgrows its byte
+budget, PF_zcacheBytes. A page found here is taken out again, so a
+page is never both in the buffer pool and in this cache. Only pages
+that match the file on disk are kept: the buffer manager writes a
+dirty page before it is put here. The cache is off when the budget is
+0, which it is by default.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pf.h"
+#include "pftypes.h"
+
+long PF_zcacheBytes = 0;	/* byte budget, 0 if the cache is off */
+
+static PFzcache_entry *PFzchash[PF_ZCACHE_HASH_SIZE];
+static PFzcache_entry *PFzcfirst = NULL;	/* most recently used */
+static PFzcache_entry *PFzclast = NULL;		/* least recently used */
+static long PFzcused = 0;	/* # of bytes taken by the entries */
+
+/* scratch space for compressing one page */
+static unsigned char PFzcbuf[PFfpageSize(PF_MAX_PAGE_SIZE)];
+
+/* bytes of the budget taken by an entry holding "len" bytes of data */
+#define PFzcacheCost(len)	((long)sizeof(PFzcache_entry)+(len))
+
+
+static void PFzcacheRemove(entry)
+PFzcache_entry *entry;	/* entry to remove */
+/****************************************************************************
+SPECIFICATIONS:
+	Unlink "entry" from its hash chain and the LRU list, and free it.
+*****************************************************************************/
+{
+PFzcache_entry **ep;
+
+	for (ep = &PFzchash[PFzcacheHash(entry->fd,entry->page)];
+			*ep != entry; ep = &(*ep)->hashnext)
+		;
+	*ep = entry->hashnext;
+
+	if (entry->prev != NULL)
+		entry->prev->next = entry->next;
+	else	PFzcfirst = entry->next;
+	if (entry->next != NULL)
+		entry->next->prev = entry->prev;
+	else	PFzclast = entry->prev;
+
+	PFzcused -= PFzcacheCost(entry->len);
+	free((char *)entry);
+}
+
+static PFzcache_entry *PFzcacheFind(fd,pagenum)
+int fd;		/* file descriptor */
+int pagenum;	/* page number */
+{
+PFzcache_entry *entry;
+
+	for (entry = PFzchash[PFzcacheHash(fd,pagenum)];
+			entry != NULL; entry = entry->hashnext)
+		if (entry->fd == fd && entry->page == pagenum)
+			return(entry);
+	return(NULL);
+}
+
+void PFzcachePut(fd,pagenum,fpage,size)
+int fd;		/* file descriptor */
+int pagenum;	/* page number */
+PFfpage *fpage;	/* page, as it is on disk */
+int size;	/* page size of the file */
+/****************************************************************************
+SPECIFICATIONS:
+	Keep a compressed copy of page "pagenum" of file "fd", just
+	evicted from the buffer pool, making room for it by dropping
+	least recently used pages. Pages that do not compress are kept
+	as they are, as they still save a read.
+*****************************************************************************/
+{
+PFzcache_entry *entry;
+unsigned char *data;	/* bytes to keep */
+int disksize = PFfpageSize(size);
+int len;
+
+	if (PF_zcacheBytes <= 0)
+		return;
+
+	/* an older copy is stale */
+	if ((entry=PFzcacheFind(fd,pagenum)) != NULL)
+		PFzcacheRemove(entry);
+
+	if ((len=PFlzCompress((unsigned char *)fpage,disksize,PFzcbuf,
+			disksize-1)) > 0)
+		data = PFzcbuf;
+	else {
+		data = (unsigned char *)fpage;
+		len = disksize;
+	}
+	if (PFzcacheCost(len) > PF_zcacheBytes)
+		return;
+
+	while (PFzcused + PFzcacheCost(len) > PF_zcacheBytes)
+		PFzcacheRemove(PFzclast);
+
+	if ((entry=(PFzcache_entry *)malloc(PFzcacheCost(len))) == NULL)
+		/* the page is only a cached copy, so just forget it */
+		return;
+	entry->fd = fd;
+	entry->page = pagenum;
+	entry->len = len;
+	memcpy(entry->data,data,len);
+
+	entry->hashnext = PFzchash[PFzcacheHash(fd,pagenum)];
+	PFzchash[PFzcacheHash(fd,pagenum)] = entry;
+	entry->prev = NULL;
+	entry->next = PFzcfirst;
+	if (PFzcfirst != NULL)
+		PFzcfirst->prev = entry;
+	else	PFzclast = entry;
+	PFzcfirst = entry;
+	PFzcused += PFzcacheCost(len);
+}
+
+int PFzcacheGet(fd,pagenum,fpage,size)
+int fd;		/* file descriptor */
+int pagenum;	/* page number */
+PFfpage *fpage;	/* where to put the page */
+int size;	/* page size of the file */
+/****************************************************************************
+SPECIFICATIONS:
+	Look for page "pagenum" of file "fd" in the cache. If it is
+	there, decompress it into "fpage" and take it out of the cache.
+
+RETURN VALUE:
+	TRUE	if the page was found.
+	FALSE	if not; the page must be read from the file.
+*****************************************************************************/
+{
+PFzcache_entry *entry;
+int disksize = PFfpageSize(size);
+int found;
+
+	if (PFzcfirst == NULL || (entry=PFzcacheFind(fd,pagenum)) == NULL)
+		return(FALSE);
+
+	if (entry->len == disksize){
+		memcpy((char *)fpage,entry->data,disksize);
+		found = TRUE;
+	}
+	else	found = PFlzDecompress(entry->data,entry->len,
+			(unsigned char *)fpage,disksize) == disksize;
+	PFzcacheRemove(entry);
+	if (found)
+		PF_stats.zcacheHits++;
+	return(found);
+}
+
+void PFzcacheDrop(fd,pagenum)
+int fd;		/* file descriptor */
+int pagenum;	/* page number */
+/****************************************************************************
+SPECIFICATIONS:
+	Forget any copy of page "pagenum" of file "fd".
+*****************************************************************************/
+{
+PFzcache_entry *entry;
+
+	if (PFzcfirst != NULL && (entry=PFzcacheFind(fd,pagenum)) != NULL)
+		PFzcacheRemove(entry);
+}
+
+void PFzcacheDropFile(fd)
+int fd;		/* file descriptor */
+/****************************************************************************
+SPECIFICATIONS:
+	Forget all the pages of file "fd", which is being closed.
+*****************************************************************************/
+{
+PFzcache_entry *entry, *next;
+
+	for (entry = PFzcfirst; entry != NULL; entry = next){
+		next = entry->next;
+		if (entry->fd == fd)
+			PFzcacheRemove(entry);
+	}
+}
+
+void PF_SetZCacheSize(bytes)
+long bytes;	/* byte budget, 0 to turn the cache off */
+/****************************************************************************
+SPECIFICATIONS:
+	Set the byte budget of the compressed page cache, dropping
+	pages that no longer fit.
+*****************************************************************************/
+{
+	if (bytes < 0)
+		return;
+	PF_zcacheBytes = bytes;
+	while (PFzclast != NULL && PFzcused > PF_zcacheBytes)
+		PFzcacheRemove(PFzclast);
+}